@@ -51,6 +51,7 @@
 #include <86box/mem.h>
 #include "cpu.h"
 #ifdef USE_DYNAREC
+#    include "codegen_profile.h"
 #    include "codegen_public.h"
 #endif
 #include "x86_ops.h"
@@ -78,6 +79,7 @@
 #include <86box/mouse.h>
 #include <86box/gameport.h>
 #include <86box/fdd.h>
+#include <86box/fdd_cache.h>
 #include <86box/fdc.h>
 #include <86box/fdc_ext.h>
 #include <86box/hdd.h>
@@ -198,11 +200,13 @@ int      cpu_use_dynarec                        = 0;              /* (C) cpu use
 int      cpu                                    = 0;              /* (C) cpu type */
 int      fpu_type                               = 0;              /* (C) fpu type */
 int      fpu_softfloat                          = 0;              /* (C) fpu uses softfloat */
+int      fpu_hybrid                             = 0;              /* (C) softfloat fpu uses host fast path */
 int      time_sync                              = 0;              /* (C) enable time sync */
 int      confirm_reset                          = 1;              /* (C) enable reset confirmation */
 int      confirm_exit                           = 1;              /* (C) enable exit confirmation */
 int      confirm_save                           = 1;              /* (C) enable save confirmation */
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
+int      log_stats                              = 0;              /* (C) log performance statistics */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
 int      open_dir_usr_path                      = 0;              /* (C) default file open dialog directory
@@ -609,6 +613,7 @@ pc_init(int argc, char *argv[])
     time_t           now;
     int              c;
     int              lvmp = 0;
+    int              packed;
 #ifdef ENABLE_NG
     int ng = 0;
 #endif
@@ -686,6 +691,8 @@ usage:
 #ifdef USE_INSTRUMENT
                    "-J or --instrument name\t- set 'name' to be the profiling instrument\n"
 #endif
+                   "-K or --packroms path\t\t- pack the ROMs in 'path' into a ROM pack\n"
+                   "\t\t\t\t   in the same directory, and exit\n"
                    "-L or --logfile pat\t\t- set 'path' to be the logfile\n"
                    "-M or --missing\t\t- dump missing machines and video cards\n"
                    "-N or --noconfirm\t\t- do not ask for confirmation on quit\n"
@@ -814,6 +821,17 @@ usage:
             // The return value of 0 only means that the code is invalid,
             //   not related to that translation is exists or not for the
             //  selected language.
+        } else if (!strcasecmp(argv[c], "--packroms") || !strcasecmp(argv[c], "-K")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            packed = rom_pack_build(argv[++c]);
+            if (packed < 0)
+                printf("\nUnable to make the ROM pack.\n\n");
+            else
+                printf("\n%i ROM files packed into %s.\n\n", packed, ROM_PACK_FILE);
+
+            return 0;
         } else if (!strcasecmp(argv[c], "--test") || !strcasecmp(argv[c], "-T")) {
             /* some (undocumented) test function here.. */
 
@@ -1269,6 +1287,10 @@ pc_reset_hard_close(void)
 {
     ui_sb_set_ready(0);
 
+    mem_tlb_stats_log();
+    x87_hybrid_stats_log();
+    timer_stats_log();
+
     /* Close all the memory mappings. */
     mem_close();
 
@@ -1534,6 +1556,13 @@ pc_close(UNUSED(thread_t *ptr))
 
     plat_mouse_capture(0);
 
+    mem_tlb_stats_log();
+    x87_hybrid_stats_log();
+    timer_stats_log();
+#ifdef USE_DYNAREC
+    codegen_prof_dump();
+#endif
+
     /* Close all the memory mappings. */
     mem_close();
 
@@ -1544,6 +1573,7 @@ pc_close(UNUSED(thread_t *ptr))
 
     for (uint8_t i = 0; i < FDD_NUM; i++)
         fdd_close(i);
+    fdd_cache_close();
 
 #ifdef ENABLE_808X_LOG
     if (dump_on_exit)
@@ -34,9 +34,13 @@
 #include <86box/log.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/cdrom.h>
 #include <86box/cdrom_image.h>
 #include <86box/cdrom_image_viso.h>
+#ifdef USE_CHD
+#    include <86box/cdrom_image_chd.h>
+#endif
 
 #include <sndfile.h>
 
@@ -51,6 +55,15 @@ static char temp_keyword[1024];
 #define INDEX_ZERO     0 /* Block not in the file, return all 0x00's. */
 #define INDEX_NORMAL   1 /* Block in the file. */
 
+/*
+   Sector cache: file data is read in blocks of consecutive sectors of one
+   index, and sequential streams get the following blocks read ahead by
+   a worker thread.
+ */
+#define CACHE_BLOCK_SECTORS 16
+#define CACHE_BLOCKS        16
+#define CACHE_READ_AHEAD    4
+
 typedef struct track_index_t {
     /*
        Is the current block in the file? If not, return all 0x00's. -1 means not
@@ -84,6 +97,46 @@ typedef struct track_t {
     track_index_t idx[3];
 } track_t;
 
+/* An index range of the track map, sorted by start. */
+typedef struct track_map_t {
+    uint64_t      start;
+    uint64_t      end;
+    int           track;
+    int           index;
+} track_map_t;
+
+typedef struct cache_block_t {
+    const track_file_t *file;
+    uint64_t      pos;
+    uint32_t      sector_size;
+    uint32_t      stamp;
+    int           loading;
+    uint8_t      *data;
+} cache_block_t;
+
+typedef struct sector_cache_t {
+    /* Block state and the read ahead window, protected by mutex. */
+    mutex_t      *mutex;
+    cache_block_t blocks[CACHE_BLOCKS];
+    uint32_t      stamp;
+    const track_index_t *last_idx;
+    uint64_t      last_block;
+    const track_t       *ahead_trk;
+    const track_index_t *ahead_idx;
+    uint64_t      ahead_next;
+    uint64_t      ahead_end;
+    event_t      *loaded;
+
+    /* Serializes the accesses to the track files. */
+    mutex_t      *io_mutex;
+
+    thread_t     *thread;
+    event_t      *wake;
+    volatile int  quit;
+
+    uint8_t      *buffer;
+} sector_cache_t;
+
 typedef struct cd_image_t {
     cdrom_t      *dev;
     void         *log;
@@ -93,6 +146,10 @@ typedef struct cd_image_t {
     uint32_t      bad_sectors_num;
     track_t      *tracks;
     uint32_t     *bad_sectors;
+    int           map_num;
+    track_map_t  *map;
+    /* Behind a pointer, so sector reads through a const image can use it. */
+    sector_cache_t *cache;
 } cd_image_t;
 
 #ifdef ENABLE_IMAGE_LOG
@@ -381,44 +438,330 @@ index_file_close(track_index_t *idx)
 
 /* Internal functions. */
 static int
-image_get_track(const cd_image_t *img, const uint32_t sector)
+image_map_compare(const void *a, const void *b)
 {
-    int ret = -1;
+    const track_map_t *ma = (const track_map_t *) a;
+    const track_map_t *mb = (const track_map_t *) b;
+
+    if (ma->start < mb->start)
+        return -1;
+
+    return (ma->start > mb->start);
+}
+
+/* Builds the sorted list of index ranges used to look up the track of a sector. */
+static void
+image_build_map(cd_image_t *img)
+{
+    free(img->map);
+    img->map     = (track_map_t *) calloc(img->tracks_num * 3, sizeof(track_map_t));
+    img->map_num = 0;
+
+    if (img->map == NULL)
+        return;
 
     for (int i = 0; i < img->tracks_num; i++) {
-        track_t *ct = &(img->tracks[i]);
+        const track_t *ct = &(img->tracks[i]);
         for (int j = 0; j < 3; j++) {
             const track_index_t *ci = &(ct->idx[j]);
-            if ((ci->type >= INDEX_ZERO) && (ci->length != 0ULL) &&
-                ((sector + 150) >= ci->start) && ((sector + 150) <= (ci->start + ci->length - 1))) {
-                ret = i;
-                break;
+            if ((ci->type >= INDEX_ZERO) && (ci->length != 0ULL)) {
+                track_map_t *cm = &(img->map[img->map_num++]);
+
+                cm->start = ci->start;
+                cm->end   = ci->start + ci->length;
+                cm->track = i;
+                cm->index = j;
             }
         }
     }
 
-    return ret;
+    qsort(img->map, img->map_num, sizeof(track_map_t), image_map_compare);
+}
+
+static const track_map_t *
+image_find_map(const cd_image_t *img, const uint32_t sector)
+{
+    const uint64_t pos = (uint32_t) (sector + 150);
+    int            lo  = 0;
+    int            hi  = img->map_num;
+
+    /* Find the last range starting at or before the sector. */
+    while (lo < hi) {
+        const int mid = (lo + hi) >> 1;
+
+        if (img->map[mid].start <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo > 0) && (pos < img->map[lo - 1].end))
+        return &(img->map[lo - 1]);
+
+    return NULL;
+}
+
+static int
+image_get_track(const cd_image_t *img, const uint32_t sector)
+{
+    const track_map_t *cm = image_find_map(img, sector);
+
+    return (cm != NULL) ? cm->track : -1;
 }
 
 static void
 image_get_track_and_index(const cd_image_t *img, const uint32_t sector,
                           int *track, int *index)
 {
+    const track_map_t *cm = image_find_map(img, sector);
+
     *track = -1;
     *index = -1;
 
-    for (int i = 0; i < img->tracks_num; i++) {
-        track_t *ct = &(img->tracks[i]);
-        if ((ct->point >= 1) && (ct->point <= 99))  for (int j = 0; j < 3; j++) {
-            track_index_t *ci = &(ct->idx[j]);
-            if ((ci->type >= INDEX_ZERO) && (ci->length != 0ULL) &&
-                ((sector + 150) >= ci->start) && ((sector + 150) <= (ci->start + ci->length - 1))) {
-                *track = i;
-                *index = j;
+    if (cm != NULL) {
+        const track_t *ct = &(img->tracks[cm->track]);
+
+        if ((ct->point >= 1) && (ct->point <= 99)) {
+            *track = cm->track;
+            *index = cm->index;
+        }
+    }
+}
+
+/* Sector cache functions. */
+static void
+cache_block_geometry(const track_t *trk, const track_index_t *idx, const uint64_t block,
+                     uint64_t *pos, uint32_t *sectors)
+{
+    const uint64_t first = block * CACHE_BLOCK_SECTORS;
+
+    *sectors = (uint32_t) MIN((uint64_t) CACHE_BLOCK_SECTORS, idx->length - first);
+    *pos     = ((idx->file_start + first) * trk->sector_size) + trk->skip;
+}
+
+/* Returns the block holding the data, or -1. Called with the mutex held. */
+static int
+cache_find(const sector_cache_t *cache, const track_file_t *file, const uint64_t pos,
+           const uint32_t sector_size)
+{
+    for (int i = 0; i < CACHE_BLOCKS; i++) {
+        const cache_block_t *cb = &(cache->blocks[i]);
+
+        if ((cb->file == file) && (cb->pos == pos) && (cb->sector_size == sector_size))
+            return i;
+    }
+
+    return -1;
+}
+
+/* Claims the least recently used block that is not being loaded. Called with the mutex held. */
+static int
+cache_claim(sector_cache_t *cache, const track_file_t *file, const uint64_t pos,
+            const uint32_t sector_size)
+{
+    int slot = -1;
+
+    for (int i = 0; i < CACHE_BLOCKS; i++) {
+        if (cache->blocks[i].loading)
+            continue;
+        if ((slot == -1) || (cache->blocks[i].stamp < cache->blocks[slot].stamp))
+            slot = i;
+    }
+
+    if (slot != -1) {
+        cache->blocks[slot].file        = file;
+        cache->blocks[slot].pos         = pos;
+        cache->blocks[slot].sector_size = sector_size;
+        cache->blocks[slot].loading     = 1;
+    }
+
+    return slot;
+}
+
+/* Reads a claimed block from its file. Called without the mutex held. */
+static int
+cache_load(sector_cache_t *cache, const int slot, const track_t *trk, const uint32_t sectors)
+{
+    cache_block_t *cb = &(cache->blocks[slot]);
+    track_file_t  *tf = (track_file_t *) cb->file;
+    int            ret;
+
+    thread_wait_mutex(cache->io_mutex);
+    ret = tf->read(tf, cb->data, cb->pos, (sectors * trk->sector_size) + trk->skip);
+    thread_release_mutex(cache->io_mutex);
+
+    thread_wait_mutex(cache->mutex);
+    cb->loading = 0;
+    cb->stamp   = ++cache->stamp;
+    /* Failed, most likely a partial block at the end of the file. */
+    if (ret <= 0)
+        cb->file = NULL;
+    thread_release_mutex(cache->mutex);
+
+    thread_set_event(cache->loaded);
+
+    return (ret > 0);
+}
+
+static void
+cache_thread(void *priv)
+{
+    sector_cache_t *cache = (sector_cache_t *) priv;
+    const track_t  *trk   = NULL;
+    uint64_t        pos;
+    uint32_t        sectors;
+    int             slot;
+
+    while (!cache->quit) {
+        thread_wait_event(cache->wake, -1);
+        thread_reset_event(cache->wake);
+
+        while (!cache->quit) {
+            slot = -1;
+
+            thread_wait_mutex(cache->mutex);
+            while (cache->ahead_next < cache->ahead_end) {
+                trk = cache->ahead_trk;
+                cache_block_geometry(trk, cache->ahead_idx, cache->ahead_next++, &pos, &sectors);
+                if (cache_find(cache, cache->ahead_idx->file, pos, trk->sector_size) == -1) {
+                    slot = cache_claim(cache, cache->ahead_idx->file, pos, trk->sector_size);
+                    break;
+                }
+            }
+            thread_release_mutex(cache->mutex);
+
+            if (slot == -1)
                 break;
+
+            (void) cache_load(cache, slot, trk, sectors);
+        }
+    }
+}
+
+/* Reads one sector of an index present in the file, going through the cache. */
+static int
+cache_read(const cd_image_t *img, const track_t *trk, const track_index_t *idx,
+           const uint64_t sector, uint8_t *buffer)
+{
+    sector_cache_t *cache   = img->cache;
+    const uint64_t  block   = sector / CACHE_BLOCK_SECTORS;
+    const uint32_t  offset  = (sector % CACHE_BLOCK_SECTORS) * trk->sector_size;
+    uint64_t        pos;
+    uint32_t        sectors;
+    int             slot;
+    int             ret;
+
+    if (cache == NULL) {
+        pos = ((idx->file_start + sector) * trk->sector_size) + trk->skip;
+        return idx->file->read(idx->file, buffer, pos, trk->sector_size);
+    }
+
+    cache_block_geometry(trk, idx, block, &pos, &sectors);
+
+    thread_wait_mutex(cache->mutex);
+
+    while (1) {
+        slot = cache_find(cache, idx->file, pos, trk->sector_size);
+
+        if ((slot != -1) && !cache->blocks[slot].loading) {
+            memcpy(buffer, &(cache->blocks[slot].data[offset]), trk->sector_size);
+            cache->blocks[slot].stamp = ++cache->stamp;
+            break;
+        } else if (slot != -1) {
+            /* Being read ahead, wait for it. */
+            thread_reset_event(cache->loaded);
+            thread_release_mutex(cache->mutex);
+            thread_wait_event(cache->loaded, 1);
+            thread_wait_mutex(cache->mutex);
+        } else {
+            slot = cache_claim(cache, idx->file, pos, trk->sector_size);
+            thread_release_mutex(cache->mutex);
+
+            if ((slot == -1) || !cache_load(cache, slot, trk, sectors)) {
+                /* Could not read the whole block, read the sector on its own. */
+                thread_wait_mutex(cache->io_mutex);
+                ret = idx->file->read(idx->file, buffer, pos + offset, trk->sector_size);
+                thread_release_mutex(cache->io_mutex);
+
+                return ret;
             }
+
+            thread_wait_mutex(cache->mutex);
         }
     }
+
+    /* A sequential stream, queue the following blocks for the read ahead thread. */
+    if ((idx == cache->last_idx) &&
+        ((block == cache->last_block) || (block == (cache->last_block + 1)))) {
+        const uint64_t blocks = (idx->length + CACHE_BLOCK_SECTORS - 1) / CACHE_BLOCK_SECTORS;
+
+        if ((idx != cache->ahead_idx) || (cache->ahead_next <= block))
+            cache->ahead_next = block + 1;
+        cache->ahead_trk = trk;
+        cache->ahead_idx = idx;
+        cache->ahead_end = MIN(block + 1 + CACHE_READ_AHEAD, blocks);
+
+        if (cache->ahead_next < cache->ahead_end)
+            thread_set_event(cache->wake);
+    }
+    cache->last_idx   = idx;
+    cache->last_block = block;
+
+    thread_release_mutex(cache->mutex);
+
+    return 1;
+}
+
+static void
+cache_init(cd_image_t *img)
+{
+    sector_cache_t *cache;
+    const size_t    size = (CACHE_BLOCK_SECTORS * 2448) + 8;
+
+    cache = (sector_cache_t *) calloc(1, sizeof(sector_cache_t));
+    if (cache == NULL)
+        return;
+
+    cache->buffer = (uint8_t *) malloc(CACHE_BLOCKS * size);
+    if (cache->buffer == NULL) {
+        free(cache);
+        return;
+    }
+
+    for (int i = 0; i < CACHE_BLOCKS; i++)
+        cache->blocks[i].data = &(cache->buffer[i * size]);
+
+    cache->mutex    = thread_create_mutex();
+    cache->io_mutex = thread_create_mutex();
+    cache->loaded   = thread_create_event();
+    cache->wake     = thread_create_event();
+    cache->thread   = thread_create(cache_thread, cache);
+
+    img->cache = cache;
+}
+
+static void
+cache_close(cd_image_t *img)
+{
+    sector_cache_t *cache = img->cache;
+
+    if (cache == NULL)
+        return;
+
+    if (cache->thread != NULL) {
+        cache->quit = 1;
+        thread_set_event(cache->wake);
+        thread_wait(cache->thread);
+    }
+
+    thread_destroy_event(cache->wake);
+    thread_destroy_event(cache->loaded);
+    thread_close_mutex(cache->io_mutex);
+    thread_close_mutex(cache->mutex);
+
+    free(cache->buffer);
+    free(cache);
+    img->cache = NULL;
 }
 
 static int
@@ -1173,6 +1516,12 @@ image_process(cd_image_t *img)
         }
     }
 
+    /*
+       Pass 7 - building the map used to look up the track and index of a sector.
+     */
+    image_log(img->log, "Pass 7 (building the track map)...\n");
+    image_build_map(img);
+
 #ifdef ENABLE_IMAGE_LOG
     image_log(img->log, "Final tracks list:\n");
     for (int i = 0; i < img->tracks_num; i++) {
@@ -1205,6 +1554,42 @@ image_set_track_subch_type(track_t *ct)
         ct->subch_type = 0x00;
 }
 
+static int
+image_set_track_type(track_t *ct, const char *type)
+{
+    char temp;
+
+    if (!strcmp(type, "AUDIO")) {
+        ct->sector_size = RAW_SECTOR_SIZE;
+        ct->attr        = AUDIO_TRACK;
+    } else if (!memcmp(type, "MODE", 4)) {
+        uint32_t mode;
+        ct->attr        = DATA_TRACK;
+        sscanf(type, "MODE%" PRIu32 "/%" PRIu32,
+               &mode, &(ct->sector_size));
+        ct->mode = mode;
+        if (ct->mode == 2)  switch(ct->sector_size) {
+            default:
+                break;
+            case 2324: case 2328:
+                ct->form = 2;
+                break;
+            case 2048: case 2332: case 2336: case 2352: case 2368: case 2448:
+                ct->form = 1;
+                break;
+        }
+        if (((ct->sector_size == 2336) || (ct->sector_size == 2332)) && (ct->mode == 2) && (ct->form == 1))
+            ct->skip        = 8;
+    } else if (!memcmp(type, "CD", 2)) {
+        ct->attr        = DATA_TRACK;
+        ct->mode        = 2;
+        sscanf(type, "CD%c/%i", &temp, &(ct->sector_size));
+    } else
+        return 0;
+
+    return 1;
+}
+
 static int
 image_load_iso(cd_image_t *img, const char *filename)
 {
@@ -1334,7 +1719,6 @@ image_load_cue(cd_image_t *img, const char *cuefile)
     char          *line;
     char          *command;
     char          *type;
-    char           temp;
 
     img->tracks     = NULL;
     img->tracks_num = 0;
@@ -1464,33 +1848,7 @@ image_load_cue(cd_image_t *img, const char *cuefile)
             ct->form         = 0;
             ct->mode         = 0;
 
-            if (!strcmp(type, "AUDIO")) {
-                ct->sector_size = RAW_SECTOR_SIZE;
-                ct->attr        = AUDIO_TRACK;
-            } else if (!memcmp(type, "MODE", 4)) {
-                uint32_t mode;
-                ct->attr        = DATA_TRACK;
-                sscanf(type, "MODE%" PRIu32 "/%" PRIu32,
-                       &mode, &(ct->sector_size));
-                ct->mode = mode;
-                if (ct->mode == 2)  switch(ct->sector_size) {
-                    default:
-                        break;
-                    case 2324: case 2328:
-                        ct->form = 2;
-                        break;
-                    case 2048: case 2332: case 2336: case 2352: case 2368: case 2448:
-                        ct->form = 1;
-                        break;
-                }
-                if (((ct->sector_size == 2336) || (ct->sector_size == 2332)) && (ct->mode == 2) && (ct->form == 1))
-                    ct->skip        = 8;
-            } else if (!memcmp(type, "CD", 2)) {
-                ct->attr        = DATA_TRACK;
-                ct->mode        = 2;
-                sscanf(type, "CD%c/%i", &temp, &(ct->sector_size));
-            } else
-                success = 0;
+            success          = image_set_track_type(ct, type);
 
             if (success) {
                 image_set_track_subch_type(ct);
@@ -1662,6 +2020,111 @@ image_load_cue(cd_image_t *img, const char *cuefile)
     return success;
 }
 
+#ifdef USE_CHD
+static int
+image_load_chd(cd_image_t *img, const char *filename)
+{
+    track_t       *ct         = NULL;
+    track_index_t *ci         = NULL;
+    track_file_t  *tf         = NULL;
+    void          *chd;
+    chd_track_t    info;
+    int            tracks_num = 0;
+    int            success    = 1;
+    int            error;
+
+    img->tracks     = NULL;
+    img->tracks_num = 0;
+
+    chd = chd_image_open(img->dev->id, filename, &tracks_num);
+    if (chd == NULL) {
+        image_log(img->log, "    [CHD     ] Unable to open CHD \"%s\"\n", filename);
+        return 0;
+    }
+
+    /*
+       Pass 1 - loading the CHD track list.
+     */
+    image_log(img->log, "Pass 1 (loading the CHD track list)...\n");
+
+    image_insert_track(img, 1, 0xa0);
+    image_insert_track(img, 1, 0xa1);
+    image_insert_track(img, 1, 0xa2);
+
+    for (int i = 0; i < tracks_num; i++) {
+        if (!chd_image_get_track(chd, i, &info)) {
+            success = 0;
+            break;
+        }
+
+        ct = image_insert_track(img, 1, info.number);
+
+        if (!image_set_track_type(ct, info.type)) {
+            success = 0;
+            break;
+        }
+
+        /* Raw sectors carry the subchannel data along if the CHD has it. */
+        if (info.raw_subcode && (ct->sector_size == RAW_SECTOR_SIZE))
+            ct->sector_size = 2448;
+
+        tf = chd_track_init(img->dev->id, chd, i, ct->sector_size, &error);
+        if (error) {
+            if (tf != NULL)
+                tf->close(tf);
+            success = 0;
+            break;
+        }
+
+        /* Pre-gap. */
+        ci = &(ct->idx[0]);
+        if (info.pregap_in_file) {
+            ci->type       = INDEX_NORMAL;
+            ci->file_start = 0ULL;
+        } else if (info.pregap > 0) {
+            ci->type       = INDEX_ZERO;
+            ci->length     = info.pregap;
+        }
+
+        ci             = &(ct->idx[1]);
+        ci->type       = INDEX_NORMAL;
+        ci->file_start = info.pregap_in_file ? info.pregap : 0ULL;
+
+        /* Post-gap. */
+        if (info.postgap > 0) {
+            ci             = &(ct->idx[2]);
+            ci->type       = INDEX_ZERO;
+            ci->length     = info.postgap;
+        }
+
+        for (int j = 0; j < 3; j++)
+            ct->idx[j].file = tf;
+
+        image_set_track_subch_type(ct);
+
+        image_log(img->log, "    [TRACK   ] %02X/%02X, ATTR %02X, MODE %02X/%02X,\n",
+                  ct->session,
+                  ct->point,
+                  ct->attr,
+                  ct->mode, ct->form);
+        image_log(img->log, "               %i\n",
+                  ct->sector_size);
+    }
+
+    /* The tracks hold their own references to the CHD. */
+    chd_image_release(chd);
+
+    if (success && (tracks_num > 0))
+        image_process(img);
+    else {
+        image_log(img->log, "    [CHD     ] Unable to load CHD \"%s\"\n", filename);
+        return 0;
+    }
+
+    return success;
+}
+#endif
+
 /* Root functions. */
 static void
 image_clear_tracks(cd_image_t *img)
@@ -1692,6 +2155,10 @@ image_clear_tracks(cd_image_t *img)
         free(img->tracks);
         img->tracks = NULL;
 
+        free(img->map);
+        img->map     = NULL;
+        img->map_num = 0;
+
         /* Mark that there's no tracks. */
         img->tracks_num = 0;
     }
@@ -1804,8 +2271,6 @@ image_read_sector(const void *local, uint8_t *buffer,
     const track_index_t *idx          = &(trk->idx[index]);
     const int            track_is_raw = ((trk->sector_size == RAW_SECTOR_SIZE) ||
                                          (trk->sector_size == 2448));
-    const uint64_t       seek         = ((sect + 150 - idx->start + idx->file_start) *
-                                         trk->sector_size) + trk->skip;
 
     if (track >= 0) {
         /* Signal CIRC error to the guest if sector is bad. */
@@ -1846,7 +2311,7 @@ image_read_sector(const void *local, uint8_t *buffer,
 
             if (idx->type >= INDEX_NORMAL) {
                 /* Read the data from the file. */
-                ret = idx->file->read(idx->file, buffer, seek, trk->sector_size);
+                ret = cache_read(img, trk, idx, sect + 150 - idx->start, buffer);
             } else
                 /* Index is not in the file, no read to fail here. */
                 ret = 1;
@@ -1970,6 +2435,8 @@ image_close(void *local)
     cd_image_t *img = (cd_image_t *) local;
 
     if (img != NULL) {
+        cache_close(img);
+
         image_clear_tracks(img);
 
         image_log(img->log, "Log closed\n");
@@ -2006,6 +2473,9 @@ image_open(cdrom_t *dev, const char *path)
     if (img != NULL) {
         int       ret;
         const int is_cue = ((ext == 4) && !stricmp(path + strlen(path) - ext + 1, "CUE"));
+#ifdef USE_CHD
+        const int is_chd = ((ext == 4) && !stricmp(path + strlen(path) - ext + 1, "CHD"));
+#endif
 
         img->dev = dev;
 
@@ -2016,6 +2486,16 @@ image_open(cdrom_t *dev, const char *path)
                 img->has_audio = 0;
             else if (ret)
                 img->has_audio = 1;
+#ifdef USE_CHD
+        } else if (is_chd) {
+            ret = image_load_chd(img, path);
+
+            if (!ret) {
+                image_close(img);
+                img = NULL;
+            } else
+                img->has_audio = 1;
+#endif
         } else {
             ret = image_load_iso(img, path);
 
@@ -2032,6 +2512,8 @@ image_open(cdrom_t *dev, const char *path)
             sprintf(n, "CD-ROM %i Image", dev->id + 1);
             img->log          = log_open(n);
 
+            cache_init(img);
+
             dev->ops = &image_ops;
         }
     }
@@ -0,0 +1,579 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CHD (MAME compressed hunks of data) CD-ROM image back-end.
+ *
+ *          Every track of the CHD is exposed as its own track file, laid
+ *          out like a BIN file with the sector size of the track, so the
+ *          rest of the image code handles it like a multi-file Cue sheet.
+ *          Decompressed hunks are kept in a small LRU cache, and a worker
+ *          thread decompresses the hunks following a sequential stream
+ *          ahead of time.
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#ifdef ENABLE_IMAGE_CHD_LOG
+#include <stdarg.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <86box/86box.h>
+#include <86box/cdrom.h>
+#include <86box/cdrom_image.h>
+#include <86box/cdrom_image_chd.h>
+#include <86box/log.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+
+#include <libchdr/chd.h>
+
+#define CHD_FRAME_SIZE    2448 /* 2352 bytes of sector data followed by 96 bytes of subcode. */
+#define CHD_SECTOR_DATA   2352
+#define CHD_TRACK_PADDING 4    /* Tracks are padded to a multiple of 4 frames. */
+#define CHD_MAX_TRACKS    99
+
+#define CHD_CACHE_HUNKS   16
+#define CHD_READ_AHEAD    4
+#define CHD_HUNK_NONE     0xffffffff
+
+typedef struct chd_hunk_t {
+    uint32_t hunk;
+    uint32_t stamp;
+    int      loading;
+    uint8_t *data;
+} chd_hunk_t;
+
+typedef struct chd_image_t {
+    chd_file   *chd;
+    void       *log;
+
+    uint32_t    hunk_bytes;
+    uint32_t    hunk_frames;
+    uint32_t    total_hunks;
+
+    /* Cache, protected by mutex. */
+    mutex_t    *mutex;
+    chd_hunk_t  cache[CHD_CACHE_HUNKS];
+    uint32_t    stamp;
+    uint32_t    last_hunk;
+    uint32_t    ahead_start;
+    uint32_t    ahead_end;
+    event_t    *loaded;
+
+    /* The CHD file itself is not reentrant. */
+    mutex_t    *chd_mutex;
+
+    thread_t   *thread;
+    event_t    *wake;
+    volatile int quit;
+
+    int         refs;
+
+    int         tracks_num;
+    chd_track_t tracks[CHD_MAX_TRACKS];
+    uint32_t    first_frame[CHD_MAX_TRACKS];
+} chd_image_t;
+
+typedef struct chd_track_file_t {
+    chd_image_t *img;
+    uint32_t     first_frame;
+    uint32_t     frames;
+    uint32_t     data_size;
+    uint32_t     sector_size;
+    int          audio;
+} chd_track_file_t;
+
+#ifdef ENABLE_IMAGE_CHD_LOG
+int image_chd_do_log = ENABLE_IMAGE_CHD_LOG;
+
+static void
+image_chd_log(void *priv, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (image_chd_do_log) {
+        va_start(ap, fmt);
+        log_out(priv, fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define image_chd_log(priv, fmt, ...)
+#endif
+
+/* Returns the cache slot holding the hunk, or -1. Called with the mutex held. */
+static int
+chd_cache_find(const chd_image_t *img, const uint32_t hunk)
+{
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++)
+        if (img->cache[i].hunk == hunk)
+            return i;
+
+    return -1;
+}
+
+/* Claims the least recently used slot that is not being loaded. Called with the mutex held. */
+static int
+chd_cache_claim(chd_image_t *img, const uint32_t hunk)
+{
+    int slot = -1;
+
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++) {
+        if (img->cache[i].loading)
+            continue;
+        if ((slot == -1) || (img->cache[i].stamp < img->cache[slot].stamp))
+            slot = i;
+    }
+
+    if (slot != -1) {
+        img->cache[slot].hunk    = hunk;
+        img->cache[slot].loading = 1;
+    }
+
+    return slot;
+}
+
+/* Decompresses a hunk into a claimed slot. Called without the mutex held. */
+static int
+chd_cache_load(chd_image_t *img, const int slot)
+{
+    chd_error err;
+
+    thread_wait_mutex(img->chd_mutex);
+    err = chd_read(img->chd, img->cache[slot].hunk, img->cache[slot].data);
+    thread_release_mutex(img->chd_mutex);
+
+    thread_wait_mutex(img->mutex);
+    img->cache[slot].loading = 0;
+    img->cache[slot].stamp   = ++img->stamp;
+    if (err != CHDERR_NONE) {
+        image_chd_log(img->log, "Unable to read hunk %08X: %i\n", img->cache[slot].hunk, err);
+        img->cache[slot].hunk = CHD_HUNK_NONE;
+    }
+    thread_release_mutex(img->mutex);
+
+    thread_set_event(img->loaded);
+
+    return (err == CHDERR_NONE);
+}
+
+static void
+chd_read_ahead_thread(void *priv)
+{
+    chd_image_t *img = (chd_image_t *) priv;
+    uint32_t     hunk;
+    int          slot;
+
+    while (!img->quit) {
+        thread_wait_event(img->wake, -1);
+        thread_reset_event(img->wake);
+
+        while (!img->quit) {
+            slot = -1;
+
+            thread_wait_mutex(img->mutex);
+            while (img->ahead_start < img->ahead_end) {
+                hunk = img->ahead_start++;
+                if (chd_cache_find(img, hunk) == -1) {
+                    slot = chd_cache_claim(img, hunk);
+                    break;
+                }
+            }
+            thread_release_mutex(img->mutex);
+
+            if (slot == -1)
+                break;
+
+            (void) chd_cache_load(img, slot);
+        }
+    }
+}
+
+/* Copies one frame out of the cache, decompressing its hunk if needed. */
+static int
+chd_read_frame(chd_image_t *img, const uint32_t frame, uint8_t *buffer)
+{
+    const uint32_t hunk   = frame / img->hunk_frames;
+    const uint32_t offset = (frame % img->hunk_frames) * CHD_FRAME_SIZE;
+    int            slot;
+
+    if (hunk >= img->total_hunks)
+        return 0;
+
+    thread_wait_mutex(img->mutex);
+
+    while (1) {
+        slot = chd_cache_find(img, hunk);
+
+        if ((slot != -1) && !img->cache[slot].loading) {
+            memcpy(buffer, &(img->cache[slot].data[offset]), CHD_FRAME_SIZE);
+            img->cache[slot].stamp = ++img->stamp;
+            break;
+        } else if (slot != -1) {
+            /* The read ahead thread is on it, wait for it. */
+            thread_reset_event(img->loaded);
+            thread_release_mutex(img->mutex);
+            thread_wait_event(img->loaded, 1);
+            thread_wait_mutex(img->mutex);
+        } else {
+            slot = chd_cache_claim(img, hunk);
+            thread_release_mutex(img->mutex);
+
+            if ((slot == -1) || !chd_cache_load(img, slot))
+                return 0;
+
+            thread_wait_mutex(img->mutex);
+        }
+    }
+
+    /* A sequential stream, queue the following hunks for the read ahead thread. */
+    if (((hunk == img->last_hunk) || (hunk == (img->last_hunk + 1))) &&
+        ((hunk + 1) < img->total_hunks)) {
+        if (img->ahead_start <= hunk)
+            img->ahead_start = hunk + 1;
+        img->ahead_end = hunk + 1 + CHD_READ_AHEAD;
+        if (img->ahead_end > img->total_hunks)
+            img->ahead_end = img->total_hunks;
+        if (img->ahead_start < img->ahead_end)
+            thread_set_event(img->wake);
+    }
+    img->last_hunk = hunk;
+
+    thread_release_mutex(img->mutex);
+
+    return 1;
+}
+
+/* Track file functions. */
+static int
+chd_track_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
+{
+    const track_file_t     *tf    = (track_file_t *) priv;
+    const chd_track_file_t *track = (chd_track_file_t *) tf->priv;
+    uint8_t                 frame[CHD_FRAME_SIZE];
+    uint64_t                pos   = seek;
+    size_t                  left  = count;
+
+    image_chd_log(tf->log, "chd_read(pos=%" PRIu64 " count=%lu)\n", seek, count);
+
+    while (left > 0) {
+        const uint32_t sector = (uint32_t) (pos / track->sector_size);
+        uint32_t       offset = (uint32_t) (pos % track->sector_size);
+        uint32_t       len    = track->sector_size - offset;
+
+        if (len > left)
+            len = left;
+
+        if (sector >= track->frames)
+            memset(buffer, 0x00, len);
+        else {
+            if (!chd_read_frame(track->img, track->first_frame + sector, frame))
+                return -1;
+
+            /* CHD stores audio big endian. */
+            if (track->audio) {
+                for (int i = 0; i < CHD_SECTOR_DATA; i += 2) {
+                    const uint8_t b = frame[i];
+                    frame[i]        = frame[i + 1];
+                    frame[i + 1]    = b;
+                }
+            }
+
+            /* The sector data is followed by the subcode data, if the track has it. */
+            if (offset < track->data_size) {
+                const uint32_t n = MIN(len, track->data_size - offset);
+                memcpy(buffer, &(frame[offset]), n);
+                if (n < len)
+                    memcpy(buffer + n, &(frame[CHD_SECTOR_DATA]), len - n);
+            } else
+                memcpy(buffer, &(frame[CHD_SECTOR_DATA + offset - track->data_size]), len);
+        }
+
+        buffer += len;
+        pos += len;
+        left -= len;
+    }
+
+    return 1;
+}
+
+static uint64_t
+chd_track_get_length(void *priv)
+{
+    const track_file_t     *tf    = (track_file_t *) priv;
+    const chd_track_file_t *track = (chd_track_file_t *) tf->priv;
+
+    return ((uint64_t) track->frames) * track->sector_size;
+}
+
+static void
+chd_track_close(void *priv)
+{
+    track_file_t     *tf    = (track_file_t *) priv;
+    chd_track_file_t *track = (chd_track_file_t *) tf->priv;
+
+    if (track != NULL) {
+        chd_image_release(track->img);
+        free(track);
+    }
+
+    memset(tf->fn, 0x00, sizeof(tf->fn));
+    free(tf);
+}
+
+/* Converts a CHD track type to Cue sheet notation. */
+static int
+chd_convert_type(char *dest, const char *type)
+{
+    static const struct {
+        const char *chd;
+        const char *cue;
+    } types[] = {
+        { "MODE1",          "MODE1/2048" },
+        { "MODE1_RAW",      "MODE1/2352" },
+        { "MODE2",          "MODE2/2336" },
+        { "MODE2_FORM1",    "MODE2/2048" },
+        { "MODE2_FORM2",    "MODE2/2324" },
+        { "MODE2_FORM_MIX", "MODE2/2336" },
+        { "MODE2_RAW",      "MODE2/2352" },
+        { "AUDIO",          "AUDIO"      }
+    };
+
+    for (size_t i = 0; i < (sizeof(types) / sizeof(types[0])); i++) {
+        if (!strcmp(type, types[i].chd)) {
+            strcpy(dest, types[i].cue);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+chd_parse_tracks(chd_image_t *img)
+{
+    char     meta[256];
+    char     type[16];
+    char     subtype[16];
+    char     pgtype[16];
+    char     pgsub[16];
+    uint32_t frame = 0;
+    int      number;
+    int      frames;
+    int      pregap;
+    int      postgap;
+
+    img->tracks_num = 0;
+
+    for (int i = 0; i < CHD_MAX_TRACKS; i++) {
+        chd_track_t *trk = &(img->tracks[i]);
+
+        memset(meta, 0x00, sizeof(meta));
+        pregap     = 0;
+        postgap    = 0;
+        pgtype[0]  = '\0';
+
+        if (chd_get_metadata(img->chd, CDROM_TRACK_METADATA2_TAG, i, meta, sizeof(meta) - 1,
+                             NULL, NULL, NULL) == CHDERR_NONE) {
+            if (sscanf(meta, "TRACK:%d TYPE:%15s SUBTYPE:%15s FRAMES:%d PREGAP:%d PGTYPE:%15s "
+                       "PGSUB:%15s POSTGAP:%d", &number, type, subtype, &frames, &pregap,
+                       pgtype, pgsub, &postgap) != 8)
+                return 0;
+        } else if (chd_get_metadata(img->chd, CDROM_TRACK_METADATA_TAG, i, meta, sizeof(meta) - 1,
+                                    NULL, NULL, NULL) == CHDERR_NONE) {
+            if (sscanf(meta, "TRACK:%d TYPE:%15s SUBTYPE:%15s FRAMES:%d", &number, type,
+                       subtype, &frames) != 4)
+                return 0;
+        } else
+            break;
+
+        if ((number != (i + 1)) || (frames <= 0) || !chd_convert_type(trk->type, type))
+            return 0;
+
+        trk->number         = number;
+        trk->frames         = frames;
+        trk->pregap         = pregap;
+        /* A pre-gap type starting with V means its data is in the CHD. */
+        trk->pregap_in_file = (pgtype[0] == 'V') && (pregap > 0);
+        trk->postgap        = postgap;
+        trk->raw_subcode    = !strcmp(subtype, "RW_RAW");
+
+        img->first_frame[i] = frame;
+        frame += (frames + CHD_TRACK_PADDING - 1) & ~(CHD_TRACK_PADDING - 1);
+
+        image_chd_log(img->log, "Track %02i: %s, %i frames at %08X, pre-gap %i (%s), "
+                      "post-gap %i\n", number, trk->type, frames, img->first_frame[i],
+                      pregap, trk->pregap_in_file ? "stored" : "not stored", postgap);
+
+        img->tracks_num++;
+    }
+
+    return (img->tracks_num > 0);
+}
+
+/* CHD functions. */
+void
+chd_image_release(void *chd)
+{
+    chd_image_t *img = (chd_image_t *) chd;
+
+    if ((img == NULL) || (--img->refs > 0))
+        return;
+
+    if (img->thread != NULL) {
+        img->quit = 1;
+        thread_set_event(img->wake);
+        thread_wait(img->thread);
+    }
+
+    if (img->wake != NULL)
+        thread_destroy_event(img->wake);
+    if (img->loaded != NULL)
+        thread_destroy_event(img->loaded);
+    if (img->mutex != NULL)
+        thread_close_mutex(img->mutex);
+    if (img->chd_mutex != NULL)
+        thread_close_mutex(img->chd_mutex);
+
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++)
+        free(img->cache[i].data);
+
+    if (img->chd != NULL)
+        chd_close(img->chd);
+
+    image_chd_log(img->log, "Log closed\n");
+    if (img->log != NULL)
+        log_close(img->log);
+
+    free(img);
+}
+
+int
+chd_image_get_track(void *chd, const int track, chd_track_t *info)
+{
+    const chd_image_t *img = (chd_image_t *) chd;
+
+    if ((img == NULL) || (track < 0) || (track >= img->tracks_num))
+        return 0;
+
+    memcpy(info, &(img->tracks[track]), sizeof(chd_track_t));
+
+    return 1;
+}
+
+track_file_t *
+chd_track_init(const uint8_t id, void *chd, const int track, const uint32_t sector_size, int *error)
+{
+    chd_image_t      *img = (chd_image_t *) chd;
+    track_file_t     *tf;
+    chd_track_file_t *trk;
+    char              n[1024] = { 0 };
+
+    *error = 1;
+
+    if ((img == NULL) || (track < 0) || (track >= img->tracks_num) ||
+        (sector_size == 0) || (sector_size > CHD_FRAME_SIZE))
+        return NULL;
+
+    tf  = (track_file_t *) calloc(1, sizeof(track_file_t));
+    trk = (chd_track_file_t *) calloc(1, sizeof(chd_track_file_t));
+    if ((tf == NULL) || (trk == NULL)) {
+        free(tf);
+        free(trk);
+        return NULL;
+    }
+
+    trk->img         = img;
+    trk->first_frame = img->first_frame[track];
+    trk->frames      = img->tracks[track].frames;
+    trk->sector_size = sector_size;
+    trk->data_size   = MIN(sector_size, CHD_SECTOR_DATA);
+    trk->audio       = !strcmp(img->tracks[track].type, "AUDIO");
+    img->refs++;
+
+    tf->priv       = trk;
+    tf->fp         = NULL;
+    tf->read       = chd_track_read;
+    tf->get_length = chd_track_get_length;
+    tf->close      = chd_track_close;
+
+    sprintf(n, "CD-ROM %i CHD  ", id + 1);
+    tf->log = log_open(n);
+
+    *error = 0;
+
+    return tf;
+}
+
+void *
+chd_image_open(const uint8_t id, const char *filename, int *tracks_num)
+{
+    chd_image_t      *img = (chd_image_t *) calloc(1, sizeof(chd_image_t));
+    const chd_header *hdr;
+    char              n[1024] = { 0 };
+
+    *tracks_num = 0;
+
+    if (img == NULL)
+        return NULL;
+
+    img->refs = 1;
+
+    sprintf(n, "CD-ROM %i CHD  ", id + 1);
+    img->log = log_open(n);
+
+    if (chd_open(filename, CHD_OPEN_READ, NULL, &img->chd) != CHDERR_NONE) {
+        image_chd_log(img->log, "Unable to open \"%s\"\n", filename);
+        img->chd = NULL;
+        goto fail;
+    }
+
+    hdr              = chd_get_header(img->chd);
+    img->hunk_bytes  = hdr->hunkbytes;
+    img->total_hunks = hdr->totalhunks;
+    img->hunk_frames = hdr->hunkbytes / CHD_FRAME_SIZE;
+
+    if ((hdr->unitbytes != CHD_FRAME_SIZE) || (img->hunk_frames == 0) ||
+        ((hdr->hunkbytes % CHD_FRAME_SIZE) != 0)) {
+        image_chd_log(img->log, "\"%s\" is not a CD-ROM CHD\n", filename);
+        goto fail;
+    }
+
+    if (!chd_parse_tracks(img)) {
+        image_chd_log(img->log, "Unable to parse the track list of \"%s\"\n", filename);
+        goto fail;
+    }
+
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++) {
+        img->cache[i].hunk = CHD_HUNK_NONE;
+        img->cache[i].data = (uint8_t *) malloc(img->hunk_bytes);
+        if (img->cache[i].data == NULL)
+            goto fail;
+    }
+    img->last_hunk = CHD_HUNK_NONE - 1;
+
+    img->mutex     = thread_create_mutex();
+    img->chd_mutex = thread_create_mutex();
+    img->loaded    = thread_create_event();
+    img->wake      = thread_create_event();
+    img->thread    = thread_create(chd_read_ahead_thread, img);
+
+    *tracks_num = img->tracks_num;
+
+    return img;
+
+fail:
+    chd_image_release(img);
+    return NULL;
+}
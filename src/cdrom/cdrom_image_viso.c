@@ -81,6 +81,8 @@ typedef struct stat stat_t;
 #define VISO_SECTOR_SIZE COOKED_SECTOR_SIZE
 #define VISO_OPEN_FILES  32
 
+#define VISO_CACHE_VERSION 1
+
 enum {
     VISO_CHARSET_D = 0,
     VISO_CHARSET_A,
@@ -104,14 +106,18 @@ enum {
 
 typedef struct _viso_entry_ {
     union { /* save some memory */
-        uint64_t pt_offsets[4];
-        FILE    *file;
+        uint64_t pt_offsets[4]; /* directories, while laying out */
+        uint8_t *dr_data[2];    /* directories, records generated on first access */
+        FILE    *file;          /* files */
     };
     union {
-        char     name_short[13];
-        uint64_t dr_offsets[2];
-        uint64_t data_offset;
+        uint64_t data_offset; /* files */
+        struct {              /* directories */
+            uint32_t dr_lba[2];
+            uint32_t dr_size[2];
+        };
     };
+    char     name_short[13];
     uint16_t pt_idx;
 
     stat_t stats;
@@ -124,15 +130,31 @@ typedef struct _viso_entry_ {
 typedef struct {
     uint64_t vol_size_offsets[2];
     uint64_t pt_meta_offsets[2];
+    uint64_t root_dr_offsets[2];
     int      format;
+    int      max_vd;
     uint8_t  use_version_suffix : 1;
     size_t   metadata_sectors, all_sectors, entry_map_size, sector_size, file_fifo_pos;
+    size_t   metadata_size, dir_map_size;
     uint8_t *metadata;
 
-    track_file_t   tf;
-    viso_entry_t  *root_dir;
-    viso_entry_t **entry_map;
-    viso_entry_t  *file_fifo[VISO_OPEN_FILES];
+    track_file_t        tf;
+    viso_entry_t       *root_dir;
+    viso_entry_t      **entry_map;
+    viso_entry_t      **dir_map; /* directory record extents of both trees, in LBA order */
+    viso_entry_t       *file_fifo[VISO_OPEN_FILES];
+    const viso_entry_t *eltorito_dir;
+    const viso_entry_t *eltorito_entry;
+
+    /* Layout cache: directory listings keyed on the directory mtimes. */
+    char      cache_fn[64];
+    int64_t   cache_time;
+    size_t    cache_dirs_num;
+    uint8_t  *cache_data;
+    uint8_t **cache_dirs;
+    uint8_t  *cache_out;
+    size_t    cache_out_size, cache_out_len;
+    int       cache_dirty;
 } viso_t;
 
 static const char rr_eid[]   = "RRIP_1991A"; /* identifiers used in ER field for Rock Ridge */
@@ -157,18 +179,6 @@ image_viso_log(void *priv, const char *fmt, ...)
 #    define image_viso_log(priv, fmt, ...)
 #endif
 
-static size_t
-viso_pread(void *ptr, const uint64_t offset, const size_t size,
-           const size_t count, FILE *fp)
-{
-    const uint64_t cur_pos = ftello64(fp);
-    size_t         ret     = 0;
-    if (fseeko64(fp, offset, SEEK_SET) != -1)
-        ret = fread(ptr, size, count, fp);
-    fseeko64(fp, cur_pos, SEEK_SET);
-    return ret;
-}
-
 static size_t
 viso_pwrite(const void *ptr, const uint64_t offset, const size_t size,
             const size_t count, FILE *fp)
@@ -562,7 +572,8 @@ viso_fill_dir_record(uint8_t *data, viso_entry_t *entry, viso_t *viso, int type)
                 *p++ = 5; /* length */
                 *p++ = 1; /* version */
 
-                q = p++; /* save Rock Ridge flags location for later */
+                q    = p; /* save Rock Ridge flags location for later */
+                *p++ = 0;
 
 #ifndef _WIN32              /* attributes reported by MinGW don't really make sense because it's Windows */
                 *q |= 0x01; /* PX = POSIX attributes */
@@ -668,6 +679,383 @@ viso_compare_entries(const void *a, const void *b)
     return strcmp((*((viso_entry_t **) a))->name_short, (*((viso_entry_t **) b))->name_short);
 }
 
+/* Fills a directory's record array for tree i (0 = ISO, 1 = Joliet), or
+   only returns its size if data is NULL. Extent locations must be known. */
+static size_t
+viso_fill_dir_records(viso_t *viso, const viso_entry_t *dir, int i, uint8_t *data)
+{
+    uint8_t             record[256];
+    uint8_t            *p;
+    const viso_entry_t *target;
+    size_t              pos      = 0;
+    size_t              write;
+    int                 dir_type = (!i && (dir == viso->root_dir)) ? VISO_DIR_CURRENT_ROOT : VISO_DIR_CURRENT;
+
+    /* Go through entries in this directory. */
+    viso_entry_t *entry = dir->first_child;
+    while (entry) {
+        /* Skip the El Torito boot code entry if present, or hide the
+           boot code directory if no other files are present in it. */
+        if ((entry == viso->eltorito_entry) || (entry == viso->eltorito_dir))
+            goto next_entry;
+
+        /* Fill directory record. */
+        viso_fill_dir_record(record, entry, viso, dir_type);
+
+        /* Entries cannot cross sector boundaries, so pad to the next sector if needed. */
+        write = VISO_SECTOR_SIZE - (pos % VISO_SECTOR_SIZE);
+        if (write < record[0])
+            pos += write;
+
+        /* The . and .. pseudo-subdirectories point to this directory and its
+           parent, while advancing the current directory type. */
+        target = NULL;
+        if (dir_type < VISO_DIR_PARENT) {
+            target   = dir;
+            dir_type = VISO_DIR_PARENT;
+        } else if (dir_type == VISO_DIR_PARENT) {
+            target   = dir->parent;
+            dir_type = i ? VISO_DIR_JOLIET : VISO_DIR_REGULAR;
+        } else if (S_ISDIR(entry->stats.st_mode)) {
+            target = entry;
+        }
+
+        if (data) {
+            /* Fill in the extent location and size. */
+            p = record + 2;
+            if (target) {
+                VISO_LBE_32(p, target->dr_lba[i]);
+                VISO_LBE_32(p, target->dr_size[i]);
+            } else {
+                VISO_LBE_32(p, entry->data_offset / VISO_SECTOR_SIZE);
+            }
+
+            memcpy(data + pos, record, record[0]);
+        }
+        pos += record[0];
+
+next_entry:
+        /* Move on to the next entry, and stop if the end of this directory was reached. */
+        entry = entry->next;
+        if (entry && (entry->parent != dir))
+            break;
+    }
+
+    return pos;
+}
+
+/* Returns the directory records covering an offset in the directory record area. */
+static const uint8_t *
+viso_get_dir_records(viso_t *viso, uint64_t seek, size_t *remain)
+{
+    const uint32_t lba = seek / VISO_SECTOR_SIZE;
+    size_t         lo  = 0;
+    size_t         hi  = viso->dir_map_size;
+    viso_entry_t  *dir = NULL;
+    int            i;
+
+    /* Find the last extent starting at or before this sector. */
+    while (lo < hi) {
+        const size_t mid = (lo + hi) >> 1;
+        const int    t   = viso->max_vd && (mid >= (viso->dir_map_size >> 1));
+
+        if (viso->dir_map[mid]->dr_lba[t] <= lba)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+
+    dir = viso->dir_map[lo - 1];
+    i   = viso->max_vd && ((lo - 1) >= (viso->dir_map_size >> 1));
+
+    const uint64_t offset = seek - (((uint64_t) dir->dr_lba[i]) * VISO_SECTOR_SIZE);
+    if (offset >= dir->dr_size[i])
+        return NULL;
+
+    /* Generate the records on first access. */
+    if (!dir->dr_data[i]) {
+        image_viso_log(viso->tf.log, "Generating directory records #%d for [%s]\n", i, dir->path);
+        dir->dr_data[i] = (uint8_t *) calloc(1, dir->dr_size[i]);
+        if (!dir->dr_data[i])
+            return NULL;
+        viso_fill_dir_records(viso, dir, i, dir->dr_data[i]);
+    }
+
+    *remain = dir->dr_size[i] - offset;
+    return dir->dr_data[i] + offset;
+}
+
+/* Layout cache functions. */
+static const char viso_cache_magic[16] = "86Box VISO cache";
+
+static int
+viso_cache_compare(const void *a, const void *b)
+{
+    return strcmp((const char *) (*((uint8_t **) a) + 4), (const char *) (*((uint8_t **) b) + 4));
+}
+
+static int
+viso_cache_compare_path(const void *key, const void *b)
+{
+    return strcmp((const char *) key, (const char *) (*((uint8_t **) b) + 4));
+}
+
+static void
+viso_cache_put(viso_t *viso, const void *data, size_t len)
+{
+    if (!viso->cache_out)
+        return;
+
+    if ((viso->cache_out_len + len) > viso->cache_out_size) {
+        size_t   new_size = MAX(viso->cache_out_size * 2, viso->cache_out_len + len + 65536);
+        uint8_t *new_out  = (uint8_t *) realloc(viso->cache_out, new_size);
+        if (!new_out) {
+            /* Give up on saving the cache. */
+            free(viso->cache_out);
+            viso->cache_out = NULL;
+            return;
+        }
+        viso->cache_out      = new_out;
+        viso->cache_out_size = new_size;
+    }
+
+    memcpy(viso->cache_out + viso->cache_out_len, data, len);
+    viso->cache_out_len += len;
+}
+
+static void
+viso_cache_load(viso_t *viso, const char *dirname)
+{
+    uint32_t hash = 0x811c9dc5; /* FNV-1a */
+    uint32_t len;
+    uint32_t temp;
+
+    for (const char *c = dirname; *c; c++)
+        hash = (hash ^ (uint8_t) *c) * 0x01000193;
+    sprintf(viso->cache_fn, "viso-%08X.cache", hash);
+
+    /* Start the new cache, listings are added as directories are traversed. */
+    viso->cache_out = (uint8_t *) malloc(65536);
+    if (viso->cache_out)
+        viso->cache_out_size = 65536;
+    viso->cache_out_len = 0;
+    viso->cache_time    = time(NULL);
+    viso_cache_put(viso, viso_cache_magic, sizeof(viso_cache_magic));
+    temp = VISO_CACHE_VERSION;
+    viso_cache_put(viso, &temp, sizeof(temp));
+    temp = sizeof(stat_t);
+    viso_cache_put(viso, &temp, sizeof(temp));
+    viso_cache_put(viso, &viso->cache_time, sizeof(viso->cache_time));
+    len = strlen(dirname) + 1;
+    viso_cache_put(viso, &len, sizeof(len));
+    viso_cache_put(viso, dirname, len);
+
+    /* Read the existing cache. */
+    FILE *fp = plat_fopen64(nvr_path(viso->cache_fn), "rb");
+    if (!fp)
+        return;
+
+    fseeko64(fp, 0, SEEK_END);
+    size_t size = ftello64(fp);
+    fseeko64(fp, 0, SEEK_SET);
+    viso->cache_data = (uint8_t *) malloc(size + 1);
+    if (!viso->cache_data || (fread(viso->cache_data, 1, size, fp) != size)) {
+        fclose(fp);
+        goto invalid;
+    }
+    fclose(fp);
+
+    /* Validate the header. */
+    uint8_t *p   = viso->cache_data;
+    uint8_t *end = viso->cache_data + size;
+    if ((size < (sizeof(viso_cache_magic) + 20)) || memcmp(p, viso_cache_magic, sizeof(viso_cache_magic)))
+        goto invalid;
+    p += sizeof(viso_cache_magic);
+    memcpy(&temp, p, sizeof(temp));
+    if (temp != VISO_CACHE_VERSION)
+        goto invalid;
+    p += sizeof(temp);
+    memcpy(&temp, p, sizeof(temp));
+    if (temp != sizeof(stat_t))
+        goto invalid;
+    p += sizeof(temp);
+    memcpy(&viso->cache_time, p, sizeof(viso->cache_time));
+    p += sizeof(viso->cache_time);
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    if ((len > (end - p)) || (len != (strlen(dirname) + 1)) || memcmp(p, dirname, len))
+        goto invalid;
+    p += len;
+
+    /* Index the directory listings. */
+    size_t dirs_size = 0;
+    while (p < end) {
+        uint8_t *dir = p;
+        uint32_t count;
+        uint16_t name_len;
+
+        if ((end - p) < 4)
+            goto invalid;
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (!len || (len > (end - p)) || p[len - 1])
+            goto invalid;
+        p += len;
+        if ((end - p) < (sizeof(int64_t) + sizeof(count)))
+            goto invalid;
+        p += sizeof(int64_t);
+        memcpy(&count, p, sizeof(count));
+        p += sizeof(count);
+        while (count-- > 0) {
+            if ((end - p) < (sizeof(stat_t) + sizeof(name_len)))
+                goto invalid;
+            p += sizeof(stat_t);
+            memcpy(&name_len, p, sizeof(name_len));
+            p += sizeof(name_len);
+            if (!name_len || (name_len > (end - p)) || p[name_len - 1])
+                goto invalid;
+            p += name_len;
+        }
+
+        if (viso->cache_dirs_num == dirs_size) {
+            dirs_size = dirs_size ? (dirs_size * 2) : 256;
+            uint8_t **new_dirs = (uint8_t **) realloc(viso->cache_dirs, dirs_size * sizeof(uint8_t *));
+            if (!new_dirs)
+                goto invalid;
+            viso->cache_dirs = new_dirs;
+        }
+        viso->cache_dirs[viso->cache_dirs_num++] = dir;
+    }
+
+    qsort(viso->cache_dirs, viso->cache_dirs_num, sizeof(uint8_t *), viso_cache_compare);
+
+    image_viso_log(viso->tf.log, "Loaded layout cache with %zu directories\n", viso->cache_dirs_num);
+    return;
+
+invalid:
+    image_viso_log(viso->tf.log, "Discarding invalid layout cache\n");
+    free(viso->cache_data);
+    viso->cache_data = NULL;
+    free(viso->cache_dirs);
+    viso->cache_dirs     = NULL;
+    viso->cache_dirs_num = 0;
+    viso->cache_time     = time(NULL);
+}
+
+/* Returns the cached listing of a directory if its mtime has not changed since. */
+static const uint8_t *
+viso_cache_find(const viso_t *viso, const viso_entry_t *dir, uint32_t *count)
+{
+    uint8_t **found;
+    uint32_t  len;
+    int64_t   mtime;
+
+    if (!viso->cache_dirs_num || !VISO_TIME_VALID(dir->stats.st_mtime))
+        return NULL;
+
+    found = (uint8_t **) bsearch(dir->path, viso->cache_dirs, viso->cache_dirs_num, sizeof(uint8_t *),
+                                 viso_cache_compare_path);
+    if (!found)
+        return NULL;
+
+    const uint8_t *p = *found;
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len) + len;
+    memcpy(&mtime, p, sizeof(mtime));
+    p += sizeof(mtime);
+
+    /* Listings taken in the same second the directory was modified may be incomplete. */
+    if ((mtime != dir->stats.st_mtime) || (mtime >= viso->cache_time))
+        return NULL;
+
+    memcpy(count, p, sizeof(uint32_t));
+    return p + sizeof(uint32_t);
+}
+
+static void
+viso_cache_invalidate(viso_t *viso)
+{
+    if (!viso->cache_fn[0])
+        return;
+
+    image_viso_log(viso->tf.log, "Invalidating layout cache\n");
+    remove(nvr_path(viso->cache_fn));
+    viso->cache_fn[0] = '\0';
+}
+
+static void
+viso_cache_save(viso_t *viso)
+{
+    if (!viso->cache_out || !viso->cache_dirty || !viso->cache_fn[0])
+        return;
+
+    image_viso_log(viso->tf.log, "Saving layout cache (%zu bytes)\n", viso->cache_out_len);
+
+    FILE *fp = plat_fopen64(nvr_path(viso->cache_fn), "wb");
+    if (fp) {
+        if (fwrite(viso->cache_out, 1, viso->cache_out_len, fp) != viso->cache_out_len) {
+            fclose(fp);
+            remove(nvr_path(viso->cache_fn));
+        } else
+            fclose(fp);
+    }
+}
+
+static void
+viso_close_file(viso_t *viso, viso_entry_t *entry)
+{
+    image_viso_log(viso->tf.log, "Closing [%s]...\n", entry->path);
+    if (entry->file) {
+        fclose(entry->file);
+        entry->file = NULL;
+    }
+    image_viso_log(viso->tf.log, "Done\n");
+}
+
+static int
+viso_open_file(viso_t *viso, viso_entry_t *entry)
+{
+    uint64_t size;
+
+    /* Close any existing FIFO entry's file. */
+    viso_entry_t *other_entry = viso->file_fifo[viso->file_fifo_pos];
+    if (other_entry && other_entry->file)
+        viso_close_file(viso, other_entry);
+
+    /* Open the file. Host files are not mapped, as one truncated by another
+       process while mapped would fault on access instead of reading short. */
+    image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
+    if ((entry->file = fopen(entry->path, "rb"))) {
+        fseeko64(entry->file, 0, SEEK_END);
+        size = ftello64(entry->file);
+    } else {
+        image_viso_log(viso->tf.log, "Failed\n");
+
+        /* It may have gone since the layout was made. */
+        viso_cache_invalidate(viso);
+
+        /* Clear any existing FIFO entry. */
+        viso->file_fifo[viso->file_fifo_pos] = NULL;
+        return 0;
+    }
+    image_viso_log(viso->tf.log, "Done\n");
+
+    /* A file changed in place does not change the mtime of its directory,
+       make sure the next mount does not reuse a stale layout. */
+    if (MIN(size, (uint32_t) -1) != (uint64_t) entry->stats.st_size) {
+        image_viso_log(viso->tf.log, "[%s] changed size since the layout was made\n", entry->path);
+        viso_cache_invalidate(viso);
+    }
+
+    /* Add this entry to the FIFO. */
+    viso->file_fifo[viso->file_fifo_pos++] = entry;
+    viso->file_fifo_pos &= (sizeof(viso->file_fifo) / sizeof(viso->file_fifo[0])) - 1;
+
+    return 1;
+}
+
 int
 viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
 {
@@ -682,9 +1070,22 @@ viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
         size_t sector_remain = MIN(count, viso->sector_size - sector_offset);
 
         /* Handle sector. */
-        if (sector < viso->metadata_sectors) {
+        if (seek < viso->metadata_size) {
             /* Copy metadata. */
+            sector_remain = MIN(sector_remain, viso->metadata_size - seek);
             memcpy(buffer, viso->metadata + seek, sector_remain);
+        } else if (sector < viso->metadata_sectors) {
+            /* Copy directory records, which do not cross logical sectors. */
+            size_t         dr_remain = 0;
+            const uint8_t *records   = viso_get_dir_records(viso, seek, &dr_remain);
+
+            sector_remain = MIN(sector_remain, VISO_SECTOR_SIZE - (seek % VISO_SECTOR_SIZE));
+            if (records) {
+                dr_remain = MIN(dr_remain, sector_remain);
+                memcpy(buffer, records, dr_remain);
+            }
+            if (dr_remain < sector_remain)
+                memset(buffer + dr_remain, 0x00, sector_remain - dr_remain);
         } else {
             size_t read = 0;
 
@@ -692,34 +1093,12 @@ viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
             viso_entry_t *entry = viso->entry_map[sector - viso->metadata_sectors];
             if (entry) {
                 /* Open file if it's not already open. */
-                if (!entry->file) {
-                    /* Close any existing FIFO entry's file. */
-                    viso_entry_t *other_entry = viso->file_fifo[viso->file_fifo_pos];
-                    if (other_entry && other_entry->file) {
-                        image_viso_log(viso->tf.log, "Closing [%s]...\n", other_entry->path);
-                        fclose(other_entry->file);
-                        other_entry->file = NULL;
-                        image_viso_log(viso->tf.log, "Done\n");
-                    }
-
-                    /* Open file. */
-                    image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
-                    if ((entry->file = fopen(entry->path, "rb"))) {
-                        image_viso_log(viso->tf.log, "Done\n");
-
-                        /* Add this entry to the FIFO. */
-                        viso->file_fifo[viso->file_fifo_pos++] = entry;
-                        viso->file_fifo_pos &= (sizeof(viso->file_fifo) / sizeof(viso->file_fifo[0])) - 1;
-                    } else {
-                        image_viso_log(viso->tf.log, "Failed\n");
-
-                        /* Clear any existing FIFO entry. */
-                        viso->file_fifo[viso->file_fifo_pos] = NULL;
-                    }
-                }
+                if (!entry->file)
+                    (void) viso_open_file(viso, entry);
 
                 /* Read data. */
-                if (!entry->file || (fseeko64(entry->file, seek - entry->data_offset, SEEK_SET) == -1))
+                const uint64_t offset = seek - entry->data_offset;
+                if (!entry->file || (fseeko64(entry->file, offset, SEEK_SET) == -1))
                     return -1;
                 read = fread(buffer, 1, sector_remain, entry->file);
                 if (sector_remain && !read)
@@ -770,7 +1149,13 @@ viso_close(void *priv)
     viso_entry_t *entry = viso->root_dir;
     viso_entry_t *next_entry;
     while (entry) {
-        if (entry->file)
+        if (S_ISDIR(entry->stats.st_mode)) {
+            /* The record pointers are only valid once the layout is done. */
+            if (viso->dir_map) {
+                free(entry->dr_data[0]);
+                free(entry->dr_data[1]);
+            }
+        } else if (entry->file)
             fclose(entry->file);
         next_entry = entry->next;
         free(entry);
@@ -781,6 +1166,11 @@ viso_close(void *priv)
         free(viso->metadata);
     if (viso->entry_map)
         free(viso->entry_map);
+    if (viso->dir_map)
+        free(viso->dir_map);
+    free(viso->cache_data);
+    free(viso->cache_dirs);
+    free(viso->cache_out);
 
     if (tf->log != NULL) {
 
@@ -857,21 +1247,37 @@ viso_init(const uint8_t id, const char *dirname, int *error)
     dir->parent = dir; /* for the root's path table and .. entries */
     image_viso_log(viso->tf.log, "[%08X] %s => [root]\n", dir, dir->path);
 
+    /* Load the layout cache, so unchanged directories don't have to be listed again. */
+    viso_cache_load(viso, dirname);
+
     /* Traverse directories, starting with the root. */
     viso_entry_t **dir_entries     = NULL;
     size_t         dir_entries_len = 0;
     while (dir) {
-        /* Open directory for listing. */
-        DIR *dirp = opendir(dir->path);
-
-        /* Iterate through this directory's children to determine the entry array size. */
+        DIR           *dirp         = NULL;
+        const uint8_t *cached       = NULL;
+        uint32_t       cached_count = 0;
+        stat_t         cached_stats;
+        uint16_t       name_len;
+        const char    *name;
+
+        /* Use the cached listing if this directory has not changed since, or open it for listing. */
         size_t children_count = 3; /* include terminator, . and .. */
-        if (dirp) {                /* create empty directory if opendir failed */
-            while ((readdir_entry = readdir(dirp))) {
-                /* Ignore . and .. pseudo-directories. */
-                if ((readdir_entry->d_name[0] == '.') && ((readdir_entry->d_name[1] == '\0') || (*((uint16_t *) &readdir_entry->d_name[1]) == '.')))
-                    continue;
-                children_count++;
+        if ((cached = viso_cache_find(viso, dir, &cached_count))) {
+            image_viso_log(viso->tf.log, "Using cached listing of [%s]\n", dir->path);
+            children_count += cached_count;
+        } else {
+            viso->cache_dirty = 1;
+            dirp              = opendir(dir->path);
+
+            /* Iterate through this directory's children to determine the entry array size. */
+            if (dirp) { /* create empty directory if opendir failed */
+                while ((readdir_entry = readdir(dirp))) {
+                    /* Ignore . and .. pseudo-directories. */
+                    if ((readdir_entry->d_name[0] == '.') && ((readdir_entry->d_name[1] == '\0') || (*((uint16_t *) &readdir_entry->d_name[1]) == '.')))
+                        continue;
+                    children_count++;
+                }
             }
         }
 
@@ -896,11 +1302,8 @@ viso_init(const uint8_t id, const char *dirname, int *error)
             if (!children_count)
                 dir->first_child = entry;
 
-            /* Stat the current directory or parent directory. */
-            if (stat(children_count ? dir->parent->path : dir->path, &entry->stats) != 0) {
-                /* Use a blank structure if stat failed. */
-                memset(&entry->stats, 0x00, sizeof(stat_t));
-            }
+            /* Copy the stats of the current directory or parent directory. */
+            memcpy(&entry->stats, children_count ? &dir->parent->stats : &dir->stats, sizeof(stat_t));
 
             /* Set basename. */
             strcpy(entry->name_short, children_count ? ".." : ".");
@@ -909,33 +1312,76 @@ viso_init(const uint8_t id, const char *dirname, int *error)
                            dir->path, entry->name_short);
         }
 
+        /* Start this directory's listing in the new layout cache. */
+        size_t   cache_count_pos = 0;
+        uint32_t cache_count     = 0;
+        int64_t  cache_mtime     = dir->stats.st_mtime;
+        uint32_t cache_len       = dir_path_len + 1;
+        viso_cache_put(viso, &cache_len, sizeof(cache_len));
+        viso_cache_put(viso, dir->path, cache_len);
+        viso_cache_put(viso, &cache_mtime, sizeof(cache_mtime));
+        cache_count_pos = viso->cache_out_len;
+        viso_cache_put(viso, &cache_count, sizeof(cache_count));
+
         /* Iterate through this directory's children again, making the entries. */
-        if (dirp) {
+        if (dirp)
             rewinddir(dirp);
-            while ((readdir_entry = readdir(dirp))) {
-                /* Ignore . and .. pseudo-directories. */
-                if ((readdir_entry->d_name[0] == '.') &&
-                    ((readdir_entry->d_name[1] == '\0') ||
-                    (*((uint16_t *) &readdir_entry->d_name[1]) == '.')))
-                    continue;
+        if (cached || dirp) {
+            while (1) {
+                if (cached) {
+                    if (cache_count >= cached_count)
+                        break;
+                    memcpy(&cached_stats, cached, sizeof(stat_t));
+                    cached += sizeof(stat_t);
+                    memcpy(&name_len, cached, sizeof(name_len));
+                    cached += sizeof(name_len);
+                    name = (const char *) cached;
+                    cached += name_len;
+                } else {
+                    if (!(readdir_entry = readdir(dirp)))
+                        break;
+                    name = readdir_entry->d_name;
+
+                    /* Ignore . and .. pseudo-directories. */
+                    if ((name[0] == '.') &&
+                        ((name[1] == '\0') ||
+                        (*((uint16_t *) &name[1]) == '.')))
+                        continue;
+                }
 
                 /* Add and fill entry. */
                 entry = dir_entries[children_count++] =
                     (viso_entry_t *) calloc(1, sizeof(viso_entry_t) +
-                        dir_path_len + strlen(readdir_entry->d_name) + 2);
+                        dir_path_len + strlen(name) + 2);
                 if (entry == NULL)
                     break;
                 entry->parent = dir;
                 strcpy(entry->path, dir->path);
                 path_slash(&entry->path[dir_path_len]);
                 entry->basename = &entry->path[dir_path_len + 1];
-                strcpy(entry->basename, readdir_entry->d_name);
-
-                /* Stat this child. */
-                if (stat(entry->path, &entry->stats) != 0) {
+                strcpy(entry->basename, name);
+
+                /* Stat this child. Files in a cached listing keep their cached stats, a
+                   file changed in place is caught when it is opened (see viso_open_file).
+                   Directories are stat'd again, as their mtime decides whether their own
+                   cached listing can be used. */
+                if (cached && !S_ISDIR(cached_stats.st_mode))
+                    memcpy(&entry->stats, &cached_stats, sizeof(stat_t));
+                else if (stat(entry->path, &entry->stats) != 0) {
                     /* Use a blank structure if stat failed. */
                     memset(&entry->stats, 0x00, sizeof(stat_t));
                 }
+                if (cached && (entry->stats.st_mode != cached_stats.st_mode)) {
+                    image_viso_log(viso->tf.log, "[%s] changed since the cached listing\n", entry->path);
+                    viso->cache_dirty = 1;
+                }
+
+                /* Add this child to the new layout cache. */
+                name_len = strlen(name) + 1;
+                viso_cache_put(viso, &entry->stats, sizeof(stat_t));
+                viso_cache_put(viso, &name_len, sizeof(name_len));
+                viso_cache_put(viso, name, name_len);
+                cache_count++;
 
                 /* Handle file size and El Torito boot code. */
                 if (!S_ISDIR(entry->stats.st_mode)) {
@@ -950,22 +1396,22 @@ viso_init(const uint8_t id, const char *dirname, int *error)
 
                     /* Detect El Torito boot code file and set it accordingly. */
                     if (dir == eltorito_dir) {
-                        if (!stricmp(readdir_entry->d_name, "Boot-NoEmul.img")) {
+                        if (!stricmp(name, "Boot-NoEmul.img")) {
                             eltorito_type = 0x00;
 have_eltorito_entry:
                             if (eltorito_entry)
                                 eltorito_others_present = 1; /* flag that the boot code directory contains other files */
                             eltorito_entry = entry;
-                        } else if (!stricmp(readdir_entry->d_name, "Boot-1.2M.img")) {
+                        } else if (!stricmp(name, "Boot-1.2M.img")) {
                             eltorito_type = 0x01;
                             goto have_eltorito_entry;
-                        } else if (!stricmp(readdir_entry->d_name, "Boot-1.44M.img")) {
+                        } else if (!stricmp(name, "Boot-1.44M.img")) {
                             eltorito_type = 0x02;
                             goto have_eltorito_entry;
-                        } else if (!stricmp(readdir_entry->d_name, "Boot-2.88M.img")) {
+                        } else if (!stricmp(name, "Boot-2.88M.img")) {
                             eltorito_type = 0x03;
                             goto have_eltorito_entry;
-                        } else if (!stricmp(readdir_entry->d_name, "Boot-HardDisk.img")) {
+                        } else if (!stricmp(name, "Boot-HardDisk.img")) {
                             eltorito_type = 0x04;
                             goto have_eltorito_entry;
                         } else {
@@ -974,13 +1420,13 @@ have_eltorito_entry:
                     } else {
                         /* Disable version suffixes if this structure appears to contain the Windows NT
                            El Torito boot code, which is known not to tolerate suffixed file names. */
-                        if (eltorito_dir &&                                  /* El Torito directory present? */
-                            (eltorito_type == 0x00) &&                       /* El Torito directory not checked yet, or confirmed to contain non-emulation boot code? */
-                            (dir->parent == viso->root_dir) &&               /* one subdirectory deep? (I386 for instance) */
-                            !stricmp(readdir_entry->d_name, "SETUPLDR.BIN")) /* SETUPLDR.BIN present? */
+                        if (eltorito_dir &&                    /* El Torito directory present? */
+                            (eltorito_type == 0x00) &&         /* El Torito directory not checked yet, or confirmed to contain non-emulation boot code? */
+                            (dir->parent == viso->root_dir) && /* one subdirectory deep? (I386 for instance) */
+                            !stricmp(name, "SETUPLDR.BIN"))    /* SETUPLDR.BIN present? */
                             viso->use_version_suffix = 0;
                     }
-                } else if ((dir == viso->root_dir) && !stricmp(readdir_entry->d_name, "[BOOT]")) {
+                } else if ((dir == viso->root_dir) && !stricmp(name, "[BOOT]")) {
                     /* Set this as the directory containing El Torito boot code. */
                     eltorito_dir            = entry;
                     eltorito_others_present = 0;
@@ -1001,6 +1447,10 @@ have_eltorito_entry:
                            dir->path);
         }
 
+        /* Finish this directory's listing in the new layout cache. */
+        if (viso->cache_out)
+            memcpy(viso->cache_out + cache_count_pos, &cache_count, sizeof(cache_count));
+
         /* Add terminator. */
         dir_entries[children_count] = NULL;
 
@@ -1046,6 +1496,7 @@ next_dir:
     /* Determine whether or not we're working with 2 volume descriptors
        (as well as 2 directory trees and 4 path tables) for Joliet. */
     int max_vd = (viso->format & VISO_FORMAT_JOLIET) ? 1 : 0;
+    viso->max_vd = max_vd;
 
     /* Write volume descriptors. */
     for (int i = 0; i <= max_vd; i++) {
@@ -1095,7 +1546,7 @@ next_dir:
         viso->pt_meta_offsets[i] = ftello64(viso->tf.fp) + (p - data);
         VISO_SKIP(p, 24 + (16 * !(viso->format & VISO_FORMAT_ISO))); /* PT size, LE PT offset, optional LE PT offset (three on HSF), BE PT offset, optional BE PT offset (three on HSF) */
 
-        viso->root_dir->dr_offsets[i] = ftello64(viso->tf.fp) + (p - data);
+        viso->root_dr_offsets[i] = ftello64(viso->tf.fp) + (p - data);
         p += viso_fill_dir_record(p, viso->root_dir, viso, VISO_DIR_CURRENT); /* root directory */
 
         int copyright_abstract_len = (viso->format & VISO_FORMAT_ISO) ? 37 : 32;
@@ -1260,6 +1711,8 @@ next_dir:
         if (eltorito_others_present)
             eltorito_dir = NULL;
     }
+    viso->eltorito_dir   = eltorito_dir;
+    viso->eltorito_entry = eltorito_entry;
 
     /* Write each path table. */
     for (int i = 0; i <= ((max_vd << 1) | 1); i++) {
@@ -1351,10 +1804,15 @@ next_dir:
         }
     }
 
-    /* Write directory records for each type. */
-    int dir_type = VISO_DIR_CURRENT_ROOT;
+    /* Lay out the directory records for each type. The records themselves
+       are only generated when the guest first reads them, but their extents
+       must be known now for the path tables and parent records. */
+    uint64_t dir_pos = ftello64(viso->tf.fp);
+    viso->metadata_size = dir_pos;
+    size_t         dir_map_size = 0;
+    viso_entry_t **dir_map      = NULL;
     for (int i = 0; i <= max_vd; i++) {
-        image_viso_log(viso->tf.log, "Generating directory record set #%d:\n", i);
+        image_viso_log(viso->tf.log, "Laying out directory record set #%d:\n", i);
 
         /* Go through directories. */
         dir = viso->root_dir;
@@ -1365,104 +1823,57 @@ next_dir:
                 continue;
             }
 
-            /* Pad to the next sector if required. */
-            write = ftello64(viso->tf.fp) % viso->sector_size;
-            if (write) {
-                write = viso->sector_size - write;
-                memset(data, 0x00, write);
-                fwrite(data, write, 1, viso->tf.fp);
-            }
+            /* Start this directory's child record array on the next sector. */
+            if (dir_pos % viso->sector_size)
+                dir_pos += viso->sector_size - (dir_pos % viso->sector_size);
+            dir->dr_lba[i]  = dir_pos / viso->sector_size;
+            dir->dr_size[i] = viso_fill_dir_records(viso, dir, i, NULL);
 
-            /* Save this directory's child record array's start offset. */
-            uint64_t dir_start = ftello64(viso->tf.fp);
+            image_viso_log(viso->tf.log, "[%08X] %s => %u + %u bytes\n", dir,
+                           dir->path, dir->dr_lba[i], dir->dr_size[i]);
 
-            /* Write this directory's child record array's sector offset to its record... */
-            uint32_t dir_temp = dir_start / viso->sector_size;
-            p                 = data;
-            VISO_LBE_32(p, dir_temp);
-            viso_pwrite(data, dir->dr_offsets[i] + 2, 8, 1, viso->tf.fp);
-
-            /* ...and to its path table entries. */
+            /* Write this directory's child record array's sector offset to its path table entries... */
+            p = data;
+            VISO_LBE_32(p, dir->dr_lba[i]);
             viso_pwrite(data, dir->pt_offsets[i << 1], 4, 1, viso->tf.fp);           /* little endian */
             viso_pwrite(data + 4, dir->pt_offsets[(i << 1) | 1], 4, 1, viso->tf.fp); /* big endian */
 
-            if (i == max_vd) /* overwrite pt_offsets in the union if we no longer need them */
-                dir->file = NULL;
-
-            /* Go through entries in this directory. */
-            entry = dir->first_child;
-            while (entry) {
-                /* Skip the El Torito boot code entry if present, or hide the
-                   boot code directory if no other files are present in it. */
-                if ((entry == eltorito_entry) || (entry == eltorito_dir))
-                    goto next_entry;
-
-                image_viso_log(viso->tf.log, "[%08X] %s => %s\n", entry, dir->path,
-                               ((dir_type == VISO_DIR_PARENT) ? ".." :
-                               ((dir_type < VISO_DIR_PARENT) ? "." :
-                                (i ? entry->basename : entry->name_short))));
-
-                /* Fill directory record. */
-                viso_fill_dir_record(data, entry, viso, dir_type);
-
-                /* Entries cannot cross sector boundaries, so pad to the next sector if needed. */
-                write = viso->sector_size - (ftello64(viso->tf.fp) % viso->sector_size);
-                if (write < data[0]) {
-                    p = data + (viso->sector_size * 2) - write;
-                    memset(p, 0x00, write);
-                    fwrite(p, write, 1, viso->tf.fp);
-                }
-
-                /* Save this entry's record's offset. This overwrites name_short in the union. */
-                entry->dr_offsets[i] = ftello64(viso->tf.fp);
-
-                /* Write data related to the . and .. pseudo-subdirectories,
-                   while advancing the current directory type. */
-                if (dir_type < VISO_DIR_PARENT) {
-                    /* Write a self-referential pointer to this entry. */
-                    p = data + 2;
-                    VISO_LBE_32(p, dir_temp);
-
-                    dir_type = VISO_DIR_PARENT;
-                } else if (dir_type == VISO_DIR_PARENT) {
-                    /* Copy the parent directory's offset and size. The root directory's
-                       parent size is a special, self-referential case handled later. */
-                    viso_pread(data + 2, dir->parent->dr_offsets[i] + 2, 16, 1, viso->tf.fp);
+            /* ...and its offset and size to the volume descriptor if this is the root. */
+            if (dir == viso->root_dir) {
+                VISO_LBE_32(p, dir->dr_size[i]);
+                viso_pwrite(data, viso->root_dr_offsets[i] + 2, 16, 1, viso->tf.fp);
+            }
 
-                    dir_type = i ? VISO_DIR_JOLIET : VISO_DIR_REGULAR;
+            /* Add this directory to the extent map. */
+            if (!(dir_map_size & 255)) {
+                viso_entry_t **new_dir_map = (viso_entry_t **) realloc(dir_map, (dir_map_size + 256) * sizeof(viso_entry_t *));
+                if (!new_dir_map) {
+                    free(dir_map);
+                    goto end;
                 }
-
-                /* Write entry. */
-                fwrite(data, data[0], 1, viso->tf.fp);
-next_entry:
-                /* Move on to the next entry, and stop if the end of this directory was reached. */
-                entry = entry->next;
-                if (entry && (entry->parent != dir))
-                    break;
+                dir_map = new_dir_map;
             }
-
-            /* Write this directory's child record array's size to its parent and . records. */
-            dir_temp = ftello64(viso->tf.fp) - dir_start;
-            p        = data;
-            VISO_LBE_32(p, dir_temp);
-            viso_pwrite(data, dir->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
-            viso_pwrite(data, dir->first_child->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
-            if (dir->parent == dir) /* write size to .. on root directory as well */
-                viso_pwrite(data, dir->first_child->next->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
+            dir_map[dir_map_size++] = dir;
+            dir_pos += dir->dr_size[i];
 
             /* Move on to the next directory. */
-            dir_type = VISO_DIR_CURRENT;
-            dir      = dir->next_dir;
+            dir = dir->next_dir;
         }
 
         /* Pad to the next even sector. */
-        write = ftello64(viso->tf.fp) % (viso->sector_size * 2);
-        if (write) {
-            write = (viso->sector_size * 2) - write;
-            memset(data, 0x00, write);
-            fwrite(data, write, 1, viso->tf.fp);
-        }
+        if (dir_pos % (viso->sector_size * 2))
+            dir_pos += (viso->sector_size * 2) - (dir_pos % (viso->sector_size * 2));
+    }
+
+    /* The path table offsets are no longer needed, overwrite them in the union. */
+    entry = viso->root_dir;
+    while (entry) {
+        if (S_ISDIR(entry->stats.st_mode))
+            entry->dr_data[0] = entry->dr_data[1] = NULL;
+        entry = entry->next;
     }
+    viso->dir_map      = dir_map;
+    viso->dir_map_size = dir_map_size;
 
     /* Allocate entry map for sector->file lookups. */
     size_t orig_sector_size = viso->sector_size;
@@ -1499,34 +1910,31 @@ next_entry:
                 goto end;
 
             /* Pad metadata to the new size's next sector. */
-            while (ftello64(viso->tf.fp) % viso->sector_size)
-                fwrite(data, orig_sector_size, 1, viso->tf.fp);
+            if (dir_pos % viso->sector_size)
+                dir_pos += viso->sector_size - (dir_pos % viso->sector_size);
         }
     }
 
     /* Start sector counts. */
-    viso->metadata_sectors = ftello64(viso->tf.fp) / viso->sector_size;
+    viso->metadata_sectors = dir_pos / viso->sector_size;
     viso->all_sectors      = viso->metadata_sectors;
 
     /* Go through files, assigning sectors to them. */
     image_viso_log(viso->tf.log, "Assigning sectors to files:\n");
     size_t        base_factor  = viso->sector_size / orig_sector_size;
-    viso_entry_t *prev_entry   = viso->root_dir;
     viso_entry_t **entry_map_p = viso->entry_map;
-    entry                      = prev_entry->next;
+    entry                      = viso->root_dir->next;
     while (entry) {
-        /* Skip this entry if it corresponds to a directory. */
+        /* Skip this entry if it corresponds to a directory, which
+           must be kept around for generating directory records. */
         if (S_ISDIR(entry->stats.st_mode)) {
-            /* Deallocate directory entries to save some memory. */
-            prev_entry->next = entry->next;
-            free(entry);
-            entry = prev_entry->next;
+            entry = entry->next;
             continue;
         }
 
-        /* Write this file's base sector offset to its directory
-           entries, unless this is the El Torito boot code entry,
-           in which case, write offset and size to the boot entry. */
+        /* Write offset and size to the boot entry if this is the El Torito
+           boot code entry. Directory records pick up the base sector offset
+           of other files when generated. */
         if (entry == eltorito_entry) {
             /* Load the entire file if not emulating, or just the first virtual
                sector (which usually contains all the boot code) if emulating. */
@@ -1540,14 +1948,9 @@ next_entry:
             }
             *((uint32_t *) &data[2]) = cpu_to_le32(viso->all_sectors * base_factor);
             viso_pwrite(data, eltorito_offset, 6, 1, viso->tf.fp);
-        } else {
-            p = data;
-            VISO_LBE_32(p, viso->all_sectors * base_factor);
-            for (int i = 0; i <= max_vd; i++)
-                viso_pwrite(data, entry->dr_offsets[i] + 2, 8, 1, viso->tf.fp);
         }
 
-        /* Save this file's base offset. This overwrites dr_offsets in the union. */
+        /* Save this file's base offset. */
         entry->data_offset = ((uint64_t) viso->all_sectors) * viso->sector_size;
 
         /* Determine how many sectors this file will take. */
@@ -1563,8 +1966,7 @@ next_entry:
             *entry_map_p++ = entry;
 
         /* Move on to the next entry. */
-        prev_entry = entry;
-        entry      = entry->next;
+        entry = entry->next;
     }
 
     /* Write final volume size to all volume descriptors. */
@@ -1574,13 +1976,13 @@ next_entry:
         viso_pwrite(data, viso->vol_size_offsets[i], 8, 1, viso->tf.fp);
 
     /* Metadata processing is finished, read it back to memory. */
-    image_viso_log(viso->tf.log, "Reading back %zu %zu-byte sectors of metadata\n",
-                   viso->metadata_sectors, viso->sector_size);
-    viso->metadata = (uint8_t *) calloc(viso->metadata_sectors, viso->sector_size);
+    image_viso_log(viso->tf.log, "Reading back %zu bytes of metadata\n",
+                   viso->metadata_size);
+    viso->metadata = (uint8_t *) calloc(1, viso->metadata_size);
     if (viso->metadata == NULL)
         goto end;
     fseeko64(viso->tf.fp, 0, SEEK_SET);
-    size_t metadata_size = viso->metadata_sectors * viso->sector_size;
+    size_t metadata_size = viso->metadata_size;
     size_t metadata_remain = metadata_size;
     while (metadata_remain > 0)
         metadata_remain -= fread(viso->metadata + (metadata_size - metadata_remain), 1, MIN(metadata_remain, viso->sector_size), viso->tf.fp);
@@ -1592,6 +1994,9 @@ next_entry:
     remove(nvr_path(viso->tf.fn));
 #endif
 
+    /* Save the layout cache for the next time this directory is mounted. */
+    viso_cache_save(viso);
+
     /* All good. */
     *error = 0;
 
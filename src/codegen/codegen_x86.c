@@ -61,6 +61,7 @@
 #    include "386_common.h"
 
 #    include "codegen.h"
+#    include "codegen_profile.h"
 #    include "codegen_accumulate.h"
 #    include "codegen_ops.h"
 #    include "codegen_ops_x86.h"
@@ -1359,6 +1360,7 @@ codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
 
     while (block) {
         if (mask & block->page_mask) {
+            codegen_prof_block_invalidate(block->pnt);
             delete_block(block);
         }
         if (block == block->next)
@@ -1370,6 +1372,7 @@ codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
 
     while (block) {
         if (mask & block->page_mask2) {
+            codegen_prof_block_invalidate(block->pnt);
             delete_block(block);
         }
         if (block == block->next_2)
@@ -1390,6 +1393,8 @@ codegen_block_init(uint32_t phys_addr)
     block_current = (block_current + 1) & BLOCK_MASK;
     block         = &codeblock[block_current];
 
+    codegen_prof_block_mark();
+
     if (block->valid != 0) {
         delete_block(block);
     }
@@ -1431,6 +1436,8 @@ codegen_block_start_recompile(codeblock_t *block)
     if (block->pc != cs + cpu_state.pc || block->was_recompiled)
         fatal("Recompile to used block!\n");
 
+    codegen_prof_block_start(block_current, block->pc, block->phys);
+
     block->status = cpu_cur_status;
 
     block_pos = BLOCK_GPF_OFFSET;
@@ -1602,6 +1609,8 @@ codegen_block_end_recompile(codeblock_t *block)
     if (block_pos > BLOCK_GPF_OFFSET)
         fatal("Over limit!\n");
 
+    codegen_prof_block_end(block_pos, block->ins);
+
     remove_from_block_list(block, block->pc);
     block->next = block->prev = NULL;
     block->next_2 = block->prev_2 = NULL;
@@ -2057,6 +2066,7 @@ generate_call:
     if (recomp_op_table && recomp_op_table[(opcode | op_32) & 0x1ff]) {
         uint32_t new_pc = recomp_op_table[(opcode | op_32) & 0x1ff](opcode, fetchdat, op_32, op_pc, block);
         if (new_pc) {
+            codegen_prof_opcode(opcode, old_pc, op_pc, 1);
             if (new_pc != -1)
                 STORE_IMM_ADDR_L((uintptr_t) &cpu_state.pc, new_pc);
 
@@ -2081,6 +2091,7 @@ generate_call:
     }
 
     op = op_table[((opcode >> opcode_shift) | op_32) & opcode_mask];
+    codegen_prof_opcode(opcode, old_pc, op_pc, 0);
     if (op_ssegs != last_ssegs) {
         last_ssegs = op_ssegs;
 
@@ -18,6 +18,7 @@
 #include "codegen_ir.h"
 #include "codegen_ops.h"
 #include "codegen_ops_helpers.h"
+#include "codegen_profile.h"
 
 #define MAX_INSTRUCTION_COUNT 50
 
@@ -678,6 +679,7 @@ generate_call:
     if (recomp_op_table && recomp_op_table[(opcode | op_32) & recomp_opcode_mask]) {
         uint32_t new_pc = recomp_op_table[(opcode | op_32) & recomp_opcode_mask](block, ir, opcode, fetchdat, op_32, op_pc);
         if (new_pc) {
+            codegen_prof_opcode(opcode, old_pc, op_pc, 1);
             if (new_pc != -1)
                 uop_MOV_IMM(ir, IREG_pc, new_pc);
 
@@ -699,6 +701,7 @@ generate_call:
     }
 
     op = op_table[((opcode >> opcode_shift) | op_32) & opcode_mask];
+    codegen_prof_opcode(opcode, old_pc, op_pc, 0);
 
     if (!test_modrm || (op_table == x86_dynarec_opcodes && opcode_modrm[opcode]) || (op_table == x86_dynarec_opcodes_0f && opcode_0f_modrm[opcode]) || (op_table == x86_dynarec_opcodes_3DNOW)) {
         int stack_offset = 0;
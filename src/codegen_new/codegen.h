@@ -28,6 +28,13 @@
   The 64 byte granularity appears to work reasonably well for most cases,
   avoiding most unnecessary evictions (eg when code & data are stored in the
   same page).
+
+  Blocks that keep getting evicted are first moved to byte granularity masks
+  (CODEBLOCK_BYTE_MASK), then stop inlining immediates. Once a block has been
+  evicted CODEBLOCK_CHECKSUM_THRESHOLD times, a checksum of its code bytes is
+  kept as well (CODEBLOCK_CHECKSUM), and codegen_check_flush() only evicts it
+  if the checksum no longer matches - writes to data sharing the same bytes
+  mask bits then no longer cause a recompile.
 */
 
 typedef struct codeblock_t {
@@ -39,6 +46,12 @@ typedef struct codeblock_t {
     uint8_t  ins;
     uint8_t  TOP;
 
+    /*Number of times this block has been evicted by self-modifying code, and
+      the extent and checksum of its code bytes if CODEBLOCK_CHECKSUM is set.*/
+    uint8_t  smc_count;
+    uint16_t code_len;
+    uint64_t checksum;
+
     /*Pointers for codeblock tree, used to search for blocks when hash lookup
       fails.*/
     uint16_t parent, left, right;
@@ -81,6 +94,10 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block is only evicted if the checksum of its code bytes has changed*/
+#define CODEBLOCK_CHECKSUM 0x100
+
+#define CODEBLOCK_CHECKSUM_THRESHOLD 3
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -22,6 +22,7 @@
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
 #include "codegen_ir.h"
+#include "codegen_profile.h"
 #include "codegen_reg.h"
 
 uint8_t *block_write_data = NULL;
@@ -378,6 +379,8 @@ invalidate_block(codeblock_t *block)
 #endif
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
+    if (block->smc_count < 255)
+        block->smc_count++;
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -449,18 +452,100 @@ codegen_delete_random_block(int required_mem_block)
     }
 }
 
+static uint64_t
+codegen_block_checksum(codeblock_t *block)
+{
+    const uint8_t *p        = &pages[block->phys >> 12].mem[block->phys & 0xfff];
+    uint32_t       len      = 0x1000 - (block->phys & 0xfff);
+    uint64_t       checksum = 0xcbf29ce484222325ULL;
+
+    /*FNV-1a over the code bytes, which may continue into the second page*/
+    if (len > block->code_len)
+        len = block->code_len;
+    for (uint32_t c = 0; c < len; c++)
+        checksum = (checksum ^ p[c]) * 0x100000001b3ULL;
+
+    if ((len < block->code_len) && (block->phys_2 != -1)) {
+        p   = pages[block->phys_2 >> 12].mem;
+        len = block->code_len - len;
+        for (uint32_t c = 0; c < len; c++)
+            checksum = (checksum ^ p[c]) * 0x100000001b3ULL;
+    }
+
+    return checksum;
+}
+
+static int
+codegen_block_can_checksum(codeblock_t *block)
+{
+    if ((pages[block->phys >> 12].mem == NULL) || (pages[block->phys >> 12].mem == page_ff))
+        return 0;
+    if ((block->phys_2 != -1) && ((pages[block->phys_2 >> 12].mem == NULL) || (pages[block->phys_2 >> 12].mem == page_ff)))
+        return 0;
+
+    return 1;
+}
+
+/*Returns 1 if the block has been written to but its code bytes are unchanged*/
+static int
+codegen_block_verify(codeblock_t *block, int block_nr)
+{
+    if (!(block->flags & CODEBLOCK_CHECKSUM) || !(block->flags & CODEBLOCK_WAS_RECOMPILED))
+        return 0;
+    if (codegen_block_checksum(block) != block->checksum)
+        return 0;
+
+    codegen_prof_block_verified(block_nr);
+    return 1;
+}
+
+/*Re-marks the code of blocks that survived codegen_check_flush() as present*/
+static void
+codegen_block_restore_code_present(page_t *page)
+{
+    uint16_t block_nr = page->block;
+
+    while (block_nr) {
+        codeblock_t *block = &codeblock[block_nr];
+
+        if (block->flags & CODEBLOCK_BYTE_MASK)
+            page->byte_code_present_mask[(block->phys >> PAGE_BYTE_MASK_SHIFT) & PAGE_BYTE_MASK_OFFSET_MASK] |= block->page_mask;
+        else
+            page->code_present_mask |= block->page_mask;
+        block_nr = block->next;
+    }
+
+    block_nr = page->block_2;
+
+    while (block_nr) {
+        codeblock_t *block = &codeblock[block_nr];
+
+        if (block->flags & CODEBLOCK_BYTE_MASK)
+            page->byte_code_present_mask[(block->phys_2 >> PAGE_BYTE_MASK_SHIFT) & PAGE_BYTE_MASK_OFFSET_MASK] |= block->page_mask2;
+        else
+            page->code_present_mask |= block->page_mask2;
+        block_nr = block->next_2;
+    }
+}
+
 void
 codegen_check_flush(page_t *page, UNUSED(uint64_t mask), UNUSED(uint32_t phys_addr))
 {
     uint16_t block_nr               = page->block;
     int      remove_from_evict_list = 0;
+    int      verified               = 0;
 
     while (block_nr) {
         codeblock_t *block      = &codeblock[block_nr];
         uint16_t     next_block = block->next;
 
         if (*block->dirty_mask & block->page_mask) {
-            invalidate_block(block);
+            if (codegen_block_verify(block, block_nr))
+                verified = 1;
+            else {
+                codegen_prof_block_invalidate(block_nr);
+                invalidate_block(block);
+            }
         }
 #ifndef RELEASE_BUILD
         if (block_nr == next_block)
@@ -476,7 +561,12 @@ codegen_check_flush(page_t *page, UNUSED(uint64_t mask), UNUSED(uint32_t phys_ad
         uint16_t     next_block = block->next_2;
 
         if (*block->dirty_mask2 & block->page_mask2) {
-            invalidate_block(block);
+            if (codegen_block_verify(block, block_nr))
+                verified = 1;
+            else {
+                codegen_prof_block_invalidate(block_nr);
+                invalidate_block(block);
+            }
         }
 #ifndef RELEASE_BUILD
         if (block_nr == next_block)
@@ -496,6 +586,8 @@ codegen_check_flush(page_t *page, UNUSED(uint64_t mask), UNUSED(uint32_t phys_ad
         page->byte_code_present_mask[c] &= ~page->byte_dirty_mask[c];
         page->byte_dirty_mask[c] = 0;
     }
+    if (verified)
+        codegen_block_restore_code_present(page);
     if (remove_from_evict_list)
         page_remove_from_evict_list(page);
 }
@@ -515,6 +607,8 @@ codegen_block_init(uint32_t phys_addr)
 #endif
     block_current = get_block_nr(block);
 
+    codegen_prof_block_mark();
+
     block_num                 = HASH(phys_addr);
     codeblock_hash[block_num] = block_current;
 
@@ -529,6 +623,7 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->smc_count                     = 0;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -558,6 +653,8 @@ codegen_block_start_recompile(codeblock_t *block)
         fatal("Recompile to used block!\n");
 #endif
 
+    codegen_prof_block_start(block_current, block->pc, block->phys);
+
     block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
 
@@ -759,6 +856,10 @@ codegen_block_end(void)
 void
 codegen_block_end_recompile(codeblock_t *block)
 {
+#ifdef USE_DYNAREC_PROFILE
+    int mem_blocks = codegen_allocator_usage;
+#endif
+
     codegen_timing_block_end();
     codegen_accumulate(ir_data, ACCREG_cycles, -codegen_block_cycles);
 
@@ -774,8 +875,22 @@ codegen_block_end_recompile(codeblock_t *block)
     if (!(block->flags & CODEBLOCK_HAS_FPU))
         block->flags &= ~CODEBLOCK_STATIC_TOP;
 
+    /*Only trust the checksum if the block did not write to its own code
+      while being recompiled*/
+    if (block->flags & CODEBLOCK_CHECKSUM) {
+        block->code_len = MIN(codegen_endpc - block->pc, 0xffff);
+        if (!codegen_block_can_checksum(block) || (*block->dirty_mask & block->page_mask) ||
+            (block->page_mask2 && (*block->dirty_mask2 & block->page_mask2)))
+            block->flags &= ~CODEBLOCK_CHECKSUM;
+        else
+            block->checksum = codegen_block_checksum(block);
+    }
+
     codegen_accumulate_flush(ir_data);
     codegen_ir_compile(ir_data, block);
+
+    /* Host code is the first memory block plus any chained to it during compilation. */
+    codegen_prof_block_end(((codegen_allocator_usage - mem_blocks) * MEM_BLOCK_SIZE) + block_pos, block->ins);
 }
 
 void
@@ -57,6 +57,7 @@
 #include <86box/gameport.h>
 #include <86box/serial_passthrough.h>
 #include <86box/machine.h>
+#include <86box/mem.h>
 #include <86box/mouse.h>
 #include <86box/thread.h>
 #include <86box/network.h>
@@ -197,6 +198,8 @@ load_general(void)
 
     enable_discord = !!ini_section_get_int(cat, "enable_discord", 0);
 
+    log_stats = !!ini_section_get_int(cat, "log_stats", 0);
+
     open_dir_usr_path = ini_section_get_int(cat, "open_dir_usr_path", 0);
 
     video_framerate = ini_section_get_int(cat, "video_gl_framerate", -1);
@@ -393,9 +396,16 @@ load_machine(void)
         mem_size = machine_get_max_ram(machine);
 
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cachesize = ini_section_get_int(cat, "tlb_size", TLB_DEFAULT_SIZE);
+    mem_huge_pages = ini_section_get_int(cat, "mem_huge_pages", MEM_HUGE_PAGES_NONE);
+    if ((mem_huge_pages < MEM_HUGE_PAGES_NONE) || (mem_huge_pages > MEM_HUGE_PAGES_EXPLICIT))
+        mem_huge_pages = MEM_HUGE_PAGES_NONE;
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
+    fpu_hybrid = ini_section_get_int(cat, "fpu_hybrid", 0);
+    if ((fpu_hybrid < 0) || (fpu_hybrid > 2))
+        fpu_hybrid = 0;
 
     p = ini_section_get_string(cat, "time_sync", NULL);
     if (p != NULL) {
@@ -661,6 +671,8 @@ load_network(void)
                 nc->net_type = NET_TYPE_SLIRP;
             else if (!strcmp(p, "vde") || !strcmp(p, "2"))
                 nc->net_type = NET_TYPE_VDE;
+            else if (!strcmp(p, "switch"))
+                nc->net_type = NET_TYPE_SWITCH;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -707,6 +719,8 @@ load_network(void)
                 nc->net_type = NET_TYPE_SLIRP;
             else if (!strcmp(p, "vde") || !strcmp(p, "2"))
                 nc->net_type = NET_TYPE_VDE;
+            else if (!strcmp(p, "switch"))
+                nc->net_type = NET_TYPE_SWITCH;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -734,6 +748,15 @@ load_network(void)
                                              (NET_LINK_10_HD | NET_LINK_10_FD |
                                               NET_LINK_100_HD | NET_LINK_100_FD |
                                               NET_LINK_1000_HD | NET_LINK_1000_FD));
+
+        sprintf(temp, "net_%02i_capture", c + 1);
+        nc->capture = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "net_%02i_capture_limit", c + 1);
+        nc->capture_limit = ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "net_%02i_slirp_sockbuf", c + 1);
+        nc->slirp_sockbuf = ini_section_get_int(cat, temp, 0);
     }
 }
 
@@ -1167,6 +1190,9 @@ load_hard_disks(void)
         sprintf(temp, "hdd_%02i_vhd_blocksize", c + 1);
         hdd[c].vhd_blocksize = ini_section_get_int(cat, temp, 0);
 
+        sprintf(temp, "hdd_%02i_host_cache", c + 1);
+        hdd[c].host_cache = ini_section_get_int(cat, temp, 0);
+
         sprintf(temp, "hdd_%02i_vhd_parent", c + 1);
         p = ini_section_get_string(cat, temp, "");
         strncpy(hdd[c].vhd_parent, p, sizeof(hdd[c].vhd_parent) - 1);
@@ -2073,6 +2099,11 @@ save_general(void)
     else
         ini_section_delete_var(cat, "enable_discord");
 
+    if (log_stats)
+        ini_section_set_int(cat, "log_stats", log_stats);
+    else
+        ini_section_delete_var(cat, "log_stats");
+
     if (open_dir_usr_path)
         ini_section_set_int(cat, "open_dir_usr_path", open_dir_usr_path);
     else
@@ -2180,11 +2211,26 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cachesize == TLB_DEFAULT_SIZE)
+        ini_section_delete_var(cat, "tlb_size");
+    else
+        ini_section_set_int(cat, "tlb_size", cachesize);
+
+    if (mem_huge_pages == MEM_HUGE_PAGES_NONE)
+        ini_section_delete_var(cat, "mem_huge_pages");
+    else
+        ini_section_set_int(cat, "mem_huge_pages", mem_huge_pages);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
         ini_section_set_int(cat, "fpu_softfloat", fpu_softfloat);
 
+    if (fpu_hybrid == 0)
+        ini_section_delete_var(cat, "fpu_hybrid");
+    else
+        ini_section_set_int(cat, "fpu_hybrid", fpu_hybrid);
+
     if (time_sync & TIME_SYNC_ENABLED)
         if (time_sync & TIME_SYNC_UTC)
             ini_section_set_string(cat, "time_sync", "utc");
@@ -2426,6 +2472,9 @@ save_network(void)
             case NET_TYPE_VDE:
                 ini_section_set_string(cat, temp, "vde");
                 break;
+            case NET_TYPE_SWITCH:
+                ini_section_set_string(cat, temp, "switch");
+                break;
 
             default:
                 break;
@@ -2447,6 +2496,24 @@ save_network(void)
             ini_section_delete_var(cat, temp);
         else
             ini_section_set_int(cat, temp, nc->link_state);
+
+        sprintf(temp, "net_%02i_capture", c + 1);
+        if (nc->capture)
+            ini_section_set_int(cat, temp, nc->capture);
+        else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "net_%02i_capture_limit", c + 1);
+        if (nc->capture_limit)
+            ini_section_set_int(cat, temp, nc->capture_limit);
+        else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "net_%02i_slirp_sockbuf", c + 1);
+        if (nc->slirp_sockbuf)
+            ini_section_set_int(cat, temp, nc->slirp_sockbuf);
+        else
+            ini_section_delete_var(cat, temp);
     }
 
     ini_delete_section_if_empty(config, cat);
@@ -2841,6 +2908,12 @@ save_hard_disks(void)
         else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "hdd_%02i_host_cache", c + 1);
+        if (hdd_is_valid(c) && hdd[c].host_cache)
+            ini_section_set_int(cat, temp, hdd[c].host_cache);
+        else
+            ini_section_delete_var(cat, temp);
+
         sprintf(temp, "hdd_%02i_vhd_parent", c + 1);
         if (hdd_is_valid(c) && hdd[c].vhd_parent[0]) {
             path_normalize(hdd[c].vhd_parent);
@@ -34,6 +34,7 @@
 #include <86box/gdbstub.h>
 #ifdef USE_DYNAREC
 #    include "codegen.h"
+#    include "codegen_profile.h"
 #    ifdef USE_NEW_DYNAREC
 #        include "codegen_backend.h"
 #    endif
@@ -480,6 +481,8 @@ exec386_dynarec_dyn(void)
                 block->flags |= CODEBLOCK_NO_IMMEDIATES;
             else
                 block->flags |= CODEBLOCK_BYTE_MASK;
+            if (block->smc_count >= CODEBLOCK_CHECKSUM_THRESHOLD)
+                block->flags |= CODEBLOCK_CHECKSUM;
         }
         if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED) && (block->flags & CODEBLOCK_STATIC_TOP) && block->TOP != (cpu_state.TOP & 7))
 #    else
@@ -508,6 +511,7 @@ exec386_dynarec_dyn(void)
 #    ifndef USE_NEW_DYNAREC
         codeblock_hash[hash] = block;
 #    endif
+        codegen_prof_block_exec(block - codeblock);
         inrecomp = 1;
         code();
 #    ifdef USE_ACYCS
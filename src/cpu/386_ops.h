@@ -226,6 +226,57 @@ extern void x386_dynarec_log(const char *fmt, ...);
 #else
 #    include "x86_ops_prefix.h"
 #endif
+#ifndef OPS_286_386
+/* REP INS/OUTS block transfers: the number of units of the given size that
+   fit at seg:offset without leaving the page, the segment limit or the
+   64k offset wrap, or 0 if seg:offset is not plain RAM in the lookup tables. */
+static __inline uint32_t
+rep_io_block_units(uintptr_t lookup, x86seg *seg, uint32_t offset, uint32_t count, int size)
+{
+    uint32_t addr = seg->base + offset;
+    uint64_t n;
+    uint64_t max;
+
+    if ((lookup == (uintptr_t) LOOKUP_INV) || (seg->base == 0xffffffff) || (addr & (size - 1)) || (count < 2))
+        return 0;
+#    ifdef USE_DEBUG_REGS_486
+    if (dr[7] & 0xff)
+        return 0;
+#    endif
+
+    n = (0x1000 - (addr & 0xfff)) / size;
+    if ((max = (0x10000 - (offset & 0xffff)) / size) < n)
+        n = max;
+    if ((max = ((uint64_t) seg->limit_high - offset + 1) / size) < n)
+        n = max;
+
+    return (n < count) ? (uint32_t) n : count;
+}
+
+static __inline uint32_t
+rep_ins_block(x86seg *seg, uint32_t offset, uint32_t count, int size)
+{
+    uint32_t addr = seg->base + offset;
+    uint32_t n    = rep_io_block_units(writelookup2[addr >> 12], seg, offset, count, size);
+
+    if (n)
+        n = io_in_block(DX, (void *) (writelookup2[addr >> 12] + (uintptr_t) addr), size, n);
+
+    return n;
+}
+
+static __inline uint32_t
+rep_outs_block(x86seg *seg, uint32_t offset, uint32_t count, int size)
+{
+    uint32_t addr = seg->base + offset;
+    uint32_t n    = rep_io_block_units(readlookup2[addr >> 12], seg, offset, count, size);
+
+    if (n)
+        n = io_out_block(DX, (void *) (readlookup2[addr >> 12] + (uintptr_t) addr), size, n);
+
+    return n;
+}
+#endif
 #ifdef IS_DYNAREC
 #    include "x86_ops_rep_dyn.h"
 #else
@@ -0,0 +1,352 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Recompiler profiler.
+ *
+ *          Keeps per guest block statistics (executions, compilations,
+ *          invalidations by self-modifying code, writes that left the code
+ *          bytes unchanged, guest instruction count, interpreter fallbacks
+ *          and host code size), keyed by linear
+ *          and physical address, so that they survive the block being
+ *          evicted and recompiled. Per opcode, it counts how often the
+ *          opcode was recompiled, how often it fell back to a call to the
+ *          interpreter, and how many times those fallbacks were executed.
+ *
+ *          The report is written to dynarec_profile.txt in the user
+ *          directory at exit, or on demand from the UI.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include "x86.h"
+#include "x86_ops.h"
+#include "x86seg_common.h"
+#include "x87_sf.h"
+#include "x87.h"
+#include "386_common.h"
+#include "codegen_profile.h"
+
+#define PROF_BLOCKS        65536 /* Must be a power of 2. */
+#define PROF_BLOCK_SLOTS   65536 /* Largest BLOCK_SIZE of any recompiler. */
+#define PROF_FALLBACKS_MAX 32
+#define PROF_REPORT_LINES  64
+
+typedef struct prof_block_t {
+    uint32_t pc;
+    uint32_t phys;
+    uint32_t eip;
+    uint16_t seg;
+    uint8_t  ins;
+    uint8_t  nr_fallbacks;
+
+    uint64_t execs;
+    uint64_t execs_compiled; /* Executions since the last compile. */
+    uint32_t compiles;
+    uint32_t invalidations;
+    uint32_t verified;
+    uint32_t host_size;
+
+    uint16_t fallbacks[PROF_FALLBACKS_MAX];
+} prof_block_t;
+
+static prof_block_t *prof_blocks;
+static uint32_t     *prof_slots; /* codeblock[] index -> prof_blocks[] index + 1. */
+static prof_block_t *prof_cur;
+
+/* Opcodes are keyed as (escape << 8) | opcode, escape being 0x0f, 0xd8-0xdf, 0xf2 or 0xf3. */
+static uint32_t prof_op_recompiled[65536];
+static uint32_t prof_op_fallback[65536];
+static uint64_t prof_op_fallback_execs[65536];
+
+static uint64_t prof_nr_marked;
+static uint64_t prof_nr_compiled;
+static uint64_t prof_nr_invalidated;
+static uint64_t prof_nr_verified;
+static uint64_t prof_nr_execs;
+static uint64_t prof_nr_dropped;
+
+static volatile int prof_dump_pending = 0;
+
+static void
+prof_init(void)
+{
+    if (prof_blocks == NULL) {
+        prof_blocks = (prof_block_t *) calloc(PROF_BLOCKS, sizeof(prof_block_t));
+        prof_slots  = (uint32_t *) calloc(PROF_BLOCK_SLOTS, sizeof(uint32_t));
+        if ((prof_blocks == NULL) || (prof_slots == NULL))
+            fatal("codegen_prof: out of memory\n");
+    }
+}
+
+static prof_block_t *
+prof_find(uint32_t pc, uint32_t phys)
+{
+    uint32_t hash = ((pc * 0x9e3779b1) ^ (phys >> 2)) & (PROF_BLOCKS - 1);
+
+    for (int c = 0; c < PROF_BLOCKS; c++) {
+        prof_block_t *pb = &prof_blocks[(hash + c) & (PROF_BLOCKS - 1)];
+
+        if (pb->compiles == 0) {
+            pb->pc   = pc;
+            pb->phys = phys;
+            return pb;
+        }
+        if ((pb->pc == pc) && (pb->phys == phys))
+            return pb;
+    }
+
+    return NULL;
+}
+
+/* Credits the executions since the last compile to the block's fallback opcodes. */
+static void
+prof_fold_fallbacks(prof_block_t *pb, uint64_t *op_execs)
+{
+    for (int c = 0; c < pb->nr_fallbacks; c++)
+        op_execs[pb->fallbacks[c]] += pb->execs_compiled;
+}
+
+void
+codegen_prof_block_mark(void)
+{
+    prof_nr_marked++;
+}
+
+void
+codegen_prof_block_start(int slot, uint32_t pc, uint32_t phys)
+{
+    prof_init();
+
+    prof_cur = prof_find(pc, phys);
+    if (prof_cur == NULL) {
+        prof_nr_dropped++;
+        prof_slots[slot] = 0;
+        return;
+    }
+
+    prof_fold_fallbacks(prof_cur, prof_op_fallback_execs);
+    prof_cur->execs_compiled = 0;
+    prof_cur->nr_fallbacks   = 0;
+    prof_cur->compiles++;
+    prof_cur->seg = CS;
+    prof_cur->eip = cpu_state.pc;
+
+    prof_slots[slot] = (uint32_t) (prof_cur - prof_blocks) + 1;
+    prof_nr_compiled++;
+}
+
+void
+codegen_prof_opcode(uint8_t opcode, uint32_t old_pc, uint32_t op_pc, int recompiled)
+{
+    uint16_t key = opcode;
+
+    /* The bytes between the start of the instruction and the opcode are all prefixes. */
+    for (uint32_t pc = old_pc; (pc + 1) < op_pc; pc++) {
+        uint8_t prefix = fastreadb(cs + pc);
+
+        if ((prefix == 0x0f) || ((prefix & 0xf8) == 0xd8) || (prefix == 0xf2) || (prefix == 0xf3))
+            key = (prefix << 8) | opcode;
+    }
+
+    if (recompiled)
+        prof_op_recompiled[key]++;
+    else {
+        prof_op_fallback[key]++;
+        if ((prof_cur != NULL) && (prof_cur->nr_fallbacks < PROF_FALLBACKS_MAX))
+            prof_cur->fallbacks[prof_cur->nr_fallbacks++] = key;
+    }
+}
+
+void
+codegen_prof_block_end(int host_size, int ins)
+{
+    if (prof_cur != NULL) {
+        prof_cur->host_size = host_size;
+        prof_cur->ins       = ins;
+        prof_cur            = NULL;
+    }
+}
+
+void
+codegen_prof_block_invalidate(int slot)
+{
+    prof_nr_invalidated++;
+
+    if ((prof_slots != NULL) && prof_slots[slot])
+        prof_blocks[prof_slots[slot] - 1].invalidations++;
+}
+
+void
+codegen_prof_block_verified(int slot)
+{
+    prof_nr_verified++;
+
+    if ((prof_slots != NULL) && prof_slots[slot])
+        prof_blocks[prof_slots[slot] - 1].verified++;
+}
+
+void
+codegen_prof_block_exec(int slot)
+{
+    if ((prof_slots != NULL) && prof_slots[slot]) {
+        prof_block_t *pb = &prof_blocks[prof_slots[slot] - 1];
+
+        pb->execs++;
+        pb->execs_compiled++;
+    }
+    prof_nr_execs++;
+
+    if (prof_dump_pending) {
+        prof_dump_pending = 0;
+        codegen_prof_dump();
+    }
+}
+
+void
+codegen_prof_request_dump(void)
+{
+    prof_dump_pending = 1;
+}
+
+static const uint64_t *prof_sort_keys;
+
+static int
+prof_sort_desc(const void *a, const void *b)
+{
+    uint64_t ka = prof_sort_keys[*(const uint32_t *) a];
+    uint64_t kb = prof_sort_keys[*(const uint32_t *) b];
+
+    return (ka < kb) - (ka > kb);
+}
+
+static void
+prof_op_name(char *buf, uint16_t key)
+{
+    if (key & 0xff00)
+        sprintf(buf, "%02X %02X", key >> 8, key & 0xff);
+    else
+        sprintf(buf, "%02X", key);
+}
+
+void
+codegen_prof_dump(void)
+{
+    char      path[1024];
+    char      name[8];
+    FILE     *fp;
+    uint64_t *op_execs;
+    uint64_t *block_execs;
+    uint32_t *order;
+    uint64_t  total_fallback_execs = 0;
+    uint32_t  nr_ops               = 0;
+    uint32_t  nr_blocks            = 0;
+
+    if (prof_blocks == NULL)
+        return;
+
+    path_append_filename(path, usr_path, "dynarec_profile.txt");
+    fp = plat_fopen(path, "w");
+    if (fp == NULL) {
+        pclog("codegen_prof: unable to write %s\n", path);
+        return;
+    }
+
+    op_execs    = (uint64_t *) malloc(65536 * sizeof(uint64_t));
+    block_execs = (uint64_t *) malloc(PROF_BLOCKS * sizeof(uint64_t));
+    order       = (uint32_t *) malloc(PROF_BLOCKS * sizeof(uint32_t));
+
+    memcpy(op_execs, prof_op_fallback_execs, 65536 * sizeof(uint64_t));
+    for (uint32_t c = 0; c < PROF_BLOCKS; c++) {
+        block_execs[c] = prof_blocks[c].execs;
+        if (prof_blocks[c].compiles) {
+            prof_fold_fallbacks(&prof_blocks[c], op_execs);
+            order[nr_blocks++] = c;
+        }
+    }
+
+    fprintf(fp, "Recompiler profile\n\n");
+    fprintf(fp, "Blocks marked:           %" PRIu64 "\n", prof_nr_marked);
+    fprintf(fp, "Blocks compiled:         %" PRIu64 "\n", prof_nr_compiled);
+    fprintf(fp, "Blocks invalidated:      %" PRIu64 "\n", prof_nr_invalidated);
+    fprintf(fp, "Blocks kept by checksum: %" PRIu64 "\n", prof_nr_verified);
+    fprintf(fp, "Block executions:        %" PRIu64 "\n", prof_nr_execs);
+    fprintf(fp, "Unique blocks:           %" PRIu32 " (%" PRIu64 " compiles not tracked)\n\n", nr_blocks, prof_nr_dropped);
+
+    /* Hot blocks. */
+    prof_sort_keys = block_execs;
+    qsort(order, nr_blocks, sizeof(uint32_t), prof_sort_desc);
+
+    fprintf(fp, "Hottest blocks:\n");
+    fprintf(fp, "  CS:EIP          Phys      Executions    Compiles  Invalid.  Ins  Fallb.  Host bytes\n");
+    for (uint32_t c = 0; (c < nr_blocks) && (c < PROF_REPORT_LINES); c++) {
+        const prof_block_t *pb = &prof_blocks[order[c]];
+
+        fprintf(fp, "  %04X:%08X  %08X  %12" PRIu64 "  %8" PRIu32 "  %8" PRIu32 "  %3i  %6i  %10" PRIu32 "\n",
+                pb->seg, pb->eip, pb->phys, pb->execs, pb->compiles, pb->invalidations,
+                pb->ins, pb->nr_fallbacks, pb->host_size);
+    }
+
+    /* Self-modifying code hot spots, by writes to the block's code (or data sharing its mask bits). */
+    for (uint32_t c = 0; c < nr_blocks; c++)
+        block_execs[order[c]] = (uint64_t) prof_blocks[order[c]].invalidations + prof_blocks[order[c]].verified;
+    qsort(order, nr_blocks, sizeof(uint32_t), prof_sort_desc);
+
+    fprintf(fp, "\nInvalidation hot spots:\n");
+    fprintf(fp, "  CS:EIP          Phys      Executions    Compiles  Invalid.  Kept\n");
+    for (uint32_t c = 0; (c < nr_blocks) && (c < PROF_REPORT_LINES); c++) {
+        const prof_block_t *pb = &prof_blocks[order[c]];
+
+        if (!pb->invalidations && !pb->verified)
+            break;
+        fprintf(fp, "  %04X:%08X  %08X  %12" PRIu64 "  %8" PRIu32 "  %8" PRIu32 "  %8" PRIu32 "\n",
+                pb->seg, pb->eip, pb->phys, pb->execs, pb->compiles, pb->invalidations, pb->verified);
+    }
+
+    /* Interpreter fallbacks. */
+    for (uint32_t c = 0; c < 65536; c++) {
+        if (prof_op_fallback[c] || prof_op_recompiled[c])
+            order[nr_ops++] = c;
+        total_fallback_execs += op_execs[c];
+    }
+    prof_sort_keys = op_execs;
+    qsort(order, nr_ops, sizeof(uint32_t), prof_sort_desc);
+
+    fprintf(fp, "\nInterpreter fallbacks (%" PRIu64 " executed):\n", total_fallback_execs);
+    fprintf(fp, "  Opcode  Executions    Fallbacks  Recompiled\n");
+    for (uint32_t c = 0; c < nr_ops; c++) {
+        if (!prof_op_fallback[order[c]])
+            continue;
+        prof_op_name(name, order[c]);
+        fprintf(fp, "  %-6s  %12" PRIu64 "  %9" PRIu32 "  %10" PRIu32 "\n",
+                name, op_execs[order[c]], prof_op_fallback[order[c]], prof_op_recompiled[order[c]]);
+    }
+
+    fclose(fp);
+
+    free(order);
+    free(block_execs);
+    free(op_execs);
+
+    pclog("codegen_prof: report written to %s\n", path);
+}
@@ -0,0 +1,47 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the recompiler profiler.
+ *
+ *          Only built with the DYNAREC_PROF build option, otherwise all
+ *          the hooks compile to nothing.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#ifndef _CODEGEN_PROFILE_H_
+#define _CODEGEN_PROFILE_H_
+
+#ifdef USE_DYNAREC_PROFILE
+/* Called by the recompilers, slot is the index of the block in codeblock[]. */
+extern void codegen_prof_block_mark(void);
+extern void codegen_prof_block_start(int slot, uint32_t pc, uint32_t phys);
+extern void codegen_prof_opcode(uint8_t opcode, uint32_t old_pc, uint32_t op_pc, int recompiled);
+extern void codegen_prof_block_end(int host_size, int ins);
+extern void codegen_prof_block_invalidate(int slot);
+extern void codegen_prof_block_verified(int slot);
+extern void codegen_prof_block_exec(int slot);
+
+/* Writes the report now (CPU thread only), or on the next block executed. */
+extern void codegen_prof_dump(void);
+extern void codegen_prof_request_dump(void);
+#else
+#    define codegen_prof_block_mark()
+#    define codegen_prof_block_start(slot, pc, phys)
+#    define codegen_prof_opcode(opcode, old_pc, op_pc, recompiled)
+#    define codegen_prof_block_end(host_size, ins)
+#    define codegen_prof_block_invalidate(slot)
+#    define codegen_prof_block_verified(slot)
+#    define codegen_prof_block_exec(slot)
+#    define codegen_prof_dump()
+#endif
+
+#endif /*_CODEGEN_PROFILE_H_*/
@@ -786,6 +786,8 @@ typedef struct {
 
 extern uint32_t x87_op;
 
+extern void x87_hybrid_stats_log(void);
+
 extern uint32_t addr64;
 extern uint32_t addr64_2;
 extern uint32_t addr64a[8];
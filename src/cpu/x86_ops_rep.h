@@ -1,11 +1,24 @@
 #define REP_OPS(size, CNT_REG, SRC_REG, DEST_REG)                                                                 \
     static int opREP_INSB_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
         addr64 = 0x00000000;                                                                                      \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
+            check_io_perm(DX, 1);                                                                                 \
+            CHECK_WRITE(&cpu_state.seg_es, DEST_REG, DEST_REG);                                                   \
+            blk = rep_ins_block(&cpu_state.seg_es, DEST_REG, CNT_REG, 1);                                         \
+            DEST_REG += blk;                                                                                      \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 15 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 15 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint8_t temp;                                                                                         \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
@@ -40,11 +53,24 @@
     }                                                                                                             \
     static int opREP_INSW_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
         addr64a[0] = addr64a[1] = 0x00000000;                                                                     \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
+            check_io_perm(DX, 2);                                                                                 \
+            CHECK_WRITE(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                             \
+            blk = rep_ins_block(&cpu_state.seg_es, DEST_REG, CNT_REG, 2);                                         \
+            DEST_REG += blk << 1;                                                                                 \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 15 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 15 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint16_t temp;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
@@ -79,11 +105,24 @@
     }                                                                                                             \
     static int opREP_INSL_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
         addr64a[0] = addr64a[1] = addr64a[2] = addr64a[3] = 0x00000000;                                           \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
+            check_io_perm(DX, 4);                                                                                 \
+            CHECK_WRITE(&cpu_state.seg_es, DEST_REG, DEST_REG + 3UL);                                             \
+            blk = rep_ins_block(&cpu_state.seg_es, DEST_REG, CNT_REG, 4);                                         \
+            DEST_REG += blk << 2;                                                                                 \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 15 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 15 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint32_t temp;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
@@ -119,9 +158,22 @@
                                                                                                                   \
     static int opREP_OUTSB_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
+            CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                       \
+            check_io_perm(DX, 1);                                                                                 \
+            blk = rep_outs_block(cpu_state.ea_seg, SRC_REG, CNT_REG, 1);                                          \
+            SRC_REG += blk;                                                                                       \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 14 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 14 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint8_t temp;                                                                                         \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                       \
@@ -150,9 +202,22 @@
     }                                                                                                             \
     static int opREP_OUTSW_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
+            CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                                 \
+            check_io_perm(DX, 2);                                                                                 \
+            blk = rep_outs_block(cpu_state.ea_seg, SRC_REG, CNT_REG, 2);                                          \
+            SRC_REG += blk << 1;                                                                                  \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 14 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 14 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint16_t temp;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                                 \
@@ -181,9 +246,22 @@
     }                                                                                                             \
     static int opREP_OUTSL_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        uint32_t blk = 0;                                                                                         \
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
-        if (CNT_REG > 0) {                                                                                        \
+        if (!(cpu_state.flags & D_FLAG) && (CNT_REG > 1)) {                                                       \
+            SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
+            CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                                 \
+            check_io_perm(DX, 4);                                                                                 \
+            blk = rep_outs_block(cpu_state.ea_seg, SRC_REG, CNT_REG, 4);                                          \
+            SRC_REG += blk << 2;                                                                                  \
+            CNT_REG -= blk;                                                                                       \
+            cycles -= 14 * blk;                                                                                   \
+            reads += blk;                                                                                         \
+            writes += blk;                                                                                        \
+            total_cycles += 14 * blk;                                                                             \
+        }                                                                                                         \
+        if (!blk && (CNT_REG > 0)) {                                                                              \
             uint32_t temp;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                                 \
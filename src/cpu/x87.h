@@ -152,6 +152,10 @@ int                   FPU_handle_NaN64(extFloat80_t a, float64 b, extFloat80_t *
 int                   FPU_tagof(const extFloat80_t reg);
 uint8_t               pack_FPU_TW(uint16_t twd);
 uint16_t              unpack_FPU_TW(uint16_t tag_byte);
+extFloat80_t          FPU_add(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status);
+extFloat80_t          FPU_sub(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status);
+extFloat80_t          FPU_mul(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status);
+extFloat80_t          FPU_div(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status);
 
 static __inline uint16_t
 i387_get_control_word(void)
@@ -0,0 +1,376 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Host floating point fast path for the softfloat x87 core.
+ *
+ *          FADD/FSUB/FMUL/FDIV are done with host float or double
+ *          arithmetic when the rounding control is round-to-nearest,
+ *          the operands are exactly representable in the host type
+ *          selected by the precision control, and the result lies well
+ *          inside the normal range of that type. The rounding error is
+ *          recovered exactly (TwoSum, FMA, or exact remainders), which
+ *          gives the precision exception and C1 without any guesswork.
+ *          Everything else falls back to softfloat3e, so the results
+ *          are bit-identical either way.
+ *
+ *          With fpu_hybrid set to 2, every fast path result is checked
+ *          against softfloat. The differential test over random
+ *          operands is in x87_hybrid_test.c.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x87_sf.h"
+#include "x87.h"
+
+/* Largest (absolute) unbiased exponent of operands and results handled on the host. */
+#define X87_FAST_EXP_FLOAT  100
+#define X87_FAST_EXP_DOUBLE 900
+
+enum {
+    X87_OP_ADD = 0,
+    X87_OP_SUB,
+    X87_OP_MUL,
+    X87_OP_DIV
+};
+
+static uint64_t x87_hybrid_fast;
+static uint64_t x87_hybrid_slow;
+static uint64_t x87_hybrid_mismatch;
+
+/* Returns the unbiased exponent of a normal extended value, or INT32_MIN
+   for zeroes, denormals, unnormals, infinities and NaNs. */
+static __inline int32_t
+x87_exp(extFloat80_t a)
+{
+    int32_t exp = a.signExp & 0x7fff;
+
+    if ((exp == 0) || (exp == 0x7fff) || !(a.signif >> 63))
+        return INT32_MIN;
+
+    return exp - 0x3fff;
+}
+
+static __inline int
+x87_to_float(extFloat80_t a, float *f)
+{
+    int32_t  exp = x87_exp(a);
+    uint32_t bits;
+
+    if ((exp < -X87_FAST_EXP_FLOAT) || (exp > X87_FAST_EXP_FLOAT) || (a.signif & 0x000000ffffffffffULL))
+        return 0;
+
+    bits = ((uint32_t) (a.signExp >> 15) << 31) | ((uint32_t) (exp + 127) << 23) | ((uint32_t) (a.signif >> 40) & 0x007fffff);
+    memcpy(f, &bits, sizeof(float));
+    return 1;
+}
+
+static __inline int
+x87_to_double(extFloat80_t a, double *d)
+{
+    int32_t  exp = x87_exp(a);
+    uint64_t bits;
+
+    if ((exp < -X87_FAST_EXP_DOUBLE) || (exp > X87_FAST_EXP_DOUBLE) || (a.signif & 0x7ff))
+        return 0;
+
+    bits = ((uint64_t) (a.signExp >> 15) << 63) | ((uint64_t) (exp + 1023) << 52) | ((a.signif >> 11) & 0x000fffffffffffffULL);
+    memcpy(d, &bits, sizeof(double));
+    return 1;
+}
+
+static __inline int
+x87_from_float(float f, extFloat80_t *r)
+{
+    uint32_t bits;
+    int32_t  exp;
+
+    memcpy(&bits, &f, sizeof(float));
+    exp = ((bits >> 23) & 0xff) - 127;
+    if ((exp < -X87_FAST_EXP_FLOAT) || (exp > X87_FAST_EXP_FLOAT))
+        return 0;
+
+    r->signExp = ((bits >> 16) & 0x8000) | (uint16_t) (exp + 0x3fff);
+    r->signif  = 0x8000000000000000ULL | ((uint64_t) (bits & 0x007fffff) << 40);
+    return 1;
+}
+
+static __inline int
+x87_from_double(double d, extFloat80_t *r)
+{
+    uint64_t bits;
+    int32_t  exp;
+
+    memcpy(&bits, &d, sizeof(double));
+    exp = (int32_t) ((bits >> 52) & 0x7ff) - 1023;
+    if ((exp < -X87_FAST_EXP_DOUBLE) || (exp > X87_FAST_EXP_DOUBLE))
+        return 0;
+
+    r->signExp = ((bits >> 48) & 0x8000) | (uint16_t) (exp + 0x3fff);
+    r->signif  = 0x8000000000000000ULL | ((bits & 0x000fffffffffffffULL) << 11);
+    return 1;
+}
+
+/* Flags for a result that differs from the exact value by err (exact - result):
+   inexact if err is non-zero, and C1 if the magnitude was rounded up. */
+static __inline void
+x87_round_flags(int err_sign, int res_neg, struct softfloat_status_t *status)
+{
+    if (err_sign == 0)
+        return;
+
+    softfloat_raiseFlags(status, softfloat_flag_inexact);
+    if ((err_sign < 0) != res_neg)
+        softfloat_setRoundingUp(status);
+}
+
+#define SIGN_OF(x) (((x) > 0) - ((x) < 0))
+
+static int
+x87_fast_float(int op, extFloat80_t a, extFloat80_t b, extFloat80_t *r, struct softfloat_status_t *status)
+{
+    float  fa;
+    float  fb;
+    float  res;
+    float  bb;
+    double exact;
+    double rem;
+    int    err_sign;
+
+    if (!x87_to_float(a, &fa) || !x87_to_float(b, &fb))
+        return 0;
+
+    switch (op) {
+        case X87_OP_SUB:
+            fb = -fb;
+            /* Fall through. */
+        case X87_OP_ADD:
+            res = fa + fb;
+            if (res == 0.0f)
+                return 0;
+            /* TwoSum - the error term is exact in round-to-nearest. */
+            bb       = res - fa;
+            err_sign = SIGN_OF((fa - (res - bb)) + (fb - bb));
+            break;
+        case X87_OP_MUL:
+            /* The product of two floats is exact in a double. */
+            exact    = (double) fa * (double) fb;
+            res      = (float) exact;
+            err_sign = SIGN_OF(exact - (double) res);
+            break;
+        case X87_OP_DIV:
+            res = fa / fb;
+            /* The remainder of a correctly rounded quotient is exact. */
+            rem      = (double) fa - ((double) res * (double) fb);
+            err_sign = SIGN_OF(rem) * SIGN_OF(fb);
+            break;
+        default:
+            return 0;
+    }
+
+    if (!x87_from_float(res, r))
+        return 0;
+
+    x87_round_flags(err_sign, res < 0.0f, status);
+    return 1;
+}
+
+static int
+x87_fast_double(int op, extFloat80_t a, extFloat80_t b, extFloat80_t *r, struct softfloat_status_t *status, int exact_only)
+{
+    double da;
+    double db;
+    double res;
+    double bb;
+    int    err_sign;
+
+    if (!x87_to_double(a, &da) || !x87_to_double(b, &db))
+        return 0;
+
+    switch (op) {
+        case X87_OP_SUB:
+            db = -db;
+            /* Fall through. */
+        case X87_OP_ADD:
+            res = da + db;
+            if (res == 0.0)
+                return 0;
+            bb       = res - da;
+            err_sign = SIGN_OF((da - (res - bb)) + (db - bb));
+            break;
+        case X87_OP_MUL:
+            res = da * db;
+            if (!isnormal(res))
+                return 0;
+            err_sign = SIGN_OF(fma(da, db, -res));
+            break;
+        case X87_OP_DIV:
+            res = da / db;
+            if (!isnormal(res))
+                return 0;
+            err_sign = SIGN_OF(fma(-res, db, da)) * SIGN_OF(db);
+            break;
+        default:
+            return 0;
+    }
+
+    /* With 64-bit precision, only results that need no rounding at all are
+       guaranteed to match. */
+    if (exact_only && err_sign)
+        return 0;
+
+    if (!x87_from_double(res, r))
+        return 0;
+
+    x87_round_flags(err_sign, res < 0.0, status);
+    return 1;
+}
+
+static int
+x87_fast(int op, extFloat80_t a, extFloat80_t b, extFloat80_t *r, struct softfloat_status_t *status)
+{
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+    if (softfloat_getRoundingMode(status) != softfloat_round_near_even)
+        return 0;
+
+    switch (softfloat_extF80_roundingPrecision(status)) {
+        case 32:
+            return x87_fast_float(op, a, b, r, status);
+        case 64:
+            return x87_fast_double(op, a, b, r, status, 0);
+        default:
+            return x87_fast_double(op, a, b, r, status, 1);
+    }
+#else
+    /* Host arithmetic with excess precision (x87 host FPU) can not be trusted here. */
+    return 0;
+#endif
+}
+
+static extFloat80_t
+x87_soft(int op, extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    switch (op) {
+        case X87_OP_ADD:
+            return extF80_add(a, b, status);
+        case X87_OP_SUB:
+            return extF80_sub(a, b, status);
+        case X87_OP_MUL:
+            return extF80_mul(a, b, status);
+        default:
+            return extF80_div(a, b, status);
+    }
+}
+
+/* Runs both paths and logs any difference, returns 1 if they agree. */
+static int
+x87_hybrid_compare(int op, extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    static const char        op_names[4] = { '+', '-', '*', '/' };
+    struct softfloat_status_t fast_status = *status;
+    struct softfloat_status_t soft_status = *status;
+    extFloat80_t              fast_res;
+    extFloat80_t              soft_res;
+
+    if (!x87_fast(op, a, b, &fast_res, &fast_status))
+        return 1;
+
+    soft_res = x87_soft(op, a, b, &soft_status);
+    if ((fast_res.signExp == soft_res.signExp) && (fast_res.signif == soft_res.signif) &&
+        (fast_status.softfloat_exceptionFlags == soft_status.softfloat_exceptionFlags))
+        return 1;
+
+    x87_hybrid_mismatch++;
+    pclog("x87 hybrid: mismatch %04X:%016" PRIX64 " %c %04X:%016" PRIX64 " (RC %i, PC %i): "
+          "host %04X:%016" PRIX64 " flags %04X, softfloat %04X:%016" PRIX64 " flags %04X\n",
+          a.signExp, a.signif, op_names[op], b.signExp, b.signif,
+          status->softfloat_roundingMode, status->extF80_roundingPrecision,
+          fast_res.signExp, fast_res.signif, fast_status.softfloat_exceptionFlags,
+          soft_res.signExp, soft_res.signif, soft_status.softfloat_exceptionFlags);
+    return 0;
+}
+
+static __inline extFloat80_t
+x87_hybrid_op(int op, extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_hybrid == 2) {
+        if (!x87_hybrid_compare(op, a, b, status)) {
+            x87_hybrid_slow++;
+            return x87_soft(op, a, b, status);
+        }
+    }
+
+    if (x87_fast(op, a, b, &r, status)) {
+        x87_hybrid_fast++;
+        return r;
+    }
+
+    x87_hybrid_slow++;
+    return x87_soft(op, a, b, status);
+}
+
+extFloat80_t
+FPU_add(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    if (!fpu_hybrid)
+        return extF80_add(a, b, status);
+
+    return x87_hybrid_op(X87_OP_ADD, a, b, status);
+}
+
+extFloat80_t
+FPU_sub(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    if (!fpu_hybrid)
+        return extF80_sub(a, b, status);
+
+    return x87_hybrid_op(X87_OP_SUB, a, b, status);
+}
+
+extFloat80_t
+FPU_mul(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    if (!fpu_hybrid)
+        return extF80_mul(a, b, status);
+
+    return x87_hybrid_op(X87_OP_MUL, a, b, status);
+}
+
+extFloat80_t
+FPU_div(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    if (!fpu_hybrid)
+        return extF80_div(a, b, status);
+
+    return x87_hybrid_op(X87_OP_DIV, a, b, status);
+}
+
+void
+x87_hybrid_stats_log(void)
+{
+    if (fpu_hybrid && log_stats)
+        pclog("x87 hybrid: %" PRIu64 " host, %" PRIu64 " softfloat, %" PRIu64 " mismatches\n",
+              x87_hybrid_fast, x87_hybrid_slow, x87_hybrid_mismatch);
+}
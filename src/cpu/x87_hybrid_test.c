@@ -0,0 +1,173 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Differential test of the x87 host floating point fast path
+ *          against softfloat3e.
+ *
+ *          Operands come from a fixed-seed xorshift generator, so every
+ *          run tests the same values. The seed and the number of operand
+ *          pairs can be given on the command line.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x87_sf.h"
+#include "x87.h"
+
+#define X87_TEST_SEED       0x86b0c5f1e7a2d349ULL
+#define X87_TEST_ITERATIONS 1000000
+
+/* The fast path and softfloat only need these from the rest of the emulator. */
+int fpu_type   = FPU_387;
+int fpu_hybrid = 1;
+int log_stats  = 1;
+
+void
+pclog_ex(const char *fmt, va_list ap)
+{
+    vprintf(fmt, ap);
+}
+
+void
+pclog(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    pclog_ex(fmt, ap);
+    va_end(ap);
+}
+
+static uint64_t x87_test_state;
+
+static uint64_t
+x87_test_rand(void)
+{
+    x87_test_state ^= x87_test_state << 13;
+    x87_test_state ^= x87_test_state >> 7;
+    x87_test_state ^= x87_test_state << 17;
+
+    return x87_test_state;
+}
+
+static extFloat80_t
+x87_test_operand(uint64_t mask)
+{
+    uint64_t     r = x87_test_rand();
+    extFloat80_t a;
+
+    a.signExp = ((r >> 48) & 0x8000) | (0x3fff + (int) (r & 63) - 32);
+    a.signif  = (x87_test_rand() | 0x8000000000000000ULL) & mask;
+
+    return a;
+}
+
+static int
+x87_test_op(int op, extFloat80_t a, extFloat80_t b, uint8_t prec)
+{
+    static const char         op_names[4] = { '+', '-', '*', '/' };
+    struct softfloat_status_t status;
+    struct softfloat_status_t fast_status;
+    struct softfloat_status_t soft_status;
+    extFloat80_t              fast_res;
+    extFloat80_t              soft_res;
+
+    memset(&status, 0, sizeof(status));
+    status.softfloat_roundingMode   = softfloat_round_near_even;
+    status.softfloat_exceptionMasks = softfloat_all_exceptions_mask;
+    status.extF80_roundingPrecision = prec;
+    fast_status                     = status;
+    soft_status                     = status;
+
+    switch (op) {
+        case 0:
+            fast_res = FPU_add(a, b, &fast_status);
+            soft_res = extF80_add(a, b, &soft_status);
+            break;
+        case 1:
+            fast_res = FPU_sub(a, b, &fast_status);
+            soft_res = extF80_sub(a, b, &soft_status);
+            break;
+        case 2:
+            fast_res = FPU_mul(a, b, &fast_status);
+            soft_res = extF80_mul(a, b, &soft_status);
+            break;
+        default:
+            fast_res = FPU_div(a, b, &fast_status);
+            soft_res = extF80_div(a, b, &soft_status);
+            break;
+    }
+
+    if ((fast_res.signExp == soft_res.signExp) && (fast_res.signif == soft_res.signif) &&
+        (fast_status.softfloat_exceptionFlags == soft_status.softfloat_exceptionFlags))
+        return 0;
+
+    printf("mismatch %04X:%016" PRIX64 " %c %04X:%016" PRIX64 " (PC %i): "
+           "host %04X:%016" PRIX64 " flags %04X, softfloat %04X:%016" PRIX64 " flags %04X\n",
+           a.signExp, a.signif, op_names[op], b.signExp, b.signif, prec,
+           fast_res.signExp, fast_res.signif, fast_status.softfloat_exceptionFlags,
+           soft_res.signExp, soft_res.signif, soft_status.softfloat_exceptionFlags);
+    return 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    /* Low mantissa bits are cleared so that most operands are accepted by
+       the host path at the precision being tested. */
+    static const uint8_t  precs[3]   = { 32, 64, 80 };
+    static const uint64_t masks[3]   = { 0xffffff0000000000ULL, 0xfffffffffffff800ULL, 0xfffffffffffff800ULL };
+    uint64_t              seed       = X87_TEST_SEED;
+    long                  iterations = X87_TEST_ITERATIONS;
+    long                  mismatches = 0;
+    extFloat80_t          a;
+    extFloat80_t          b;
+    int                   p;
+
+    if (argc > 1)
+        seed = strtoull(argv[1], NULL, 0);
+    if (argc > 2)
+        iterations = strtol(argv[2], NULL, 0);
+
+    x87_test_state = seed ? seed : X87_TEST_SEED;
+
+    for (long i = 0; i < iterations; i++) {
+        p = i % 3;
+
+        a = x87_test_operand(masks[p]);
+        b = x87_test_operand(masks[p]);
+        /* Make cancellation and exact results common enough to matter. */
+        if (!(i & 7))
+            b.signExp = (b.signExp & 0x8000) | (a.signExp & 0x7fff);
+        if (!(i & 15))
+            b.signif &= 0xffff000000000000ULL;
+
+        for (int op = 0; op < 4; op++)
+            mismatches += x87_test_op(op, a, b, precs[p]);
+    }
+
+    /* Shows how many of the operations actually took the host path. */
+    x87_hybrid_stats_log();
+    printf("x87 hybrid: %li operand pairs (seed %016" PRIX64 "), %li mismatches\n",
+           iterations, seed, mismatches);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -56,6 +56,7 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/sound.h>
+#include <86box/timer.h>
 #include <86box/ui.h>
 
 #define DEVICE_MAX 256 /* max # of devices */
@@ -208,9 +209,14 @@ device_add_common(const device_t *dev, void *p, void *params, int inst)
         device_set_context(&device_current, dev, inst);
 
         if (dev->init != NULL) {
+            /* Timers added by the device are reported under its name. */
+            const char *owner = timer_set_owner(dev->name);
+
             /* Give it our temporary device in case we have dynamically changed info->local. */
             priv = dev->init(init_dev);
 
+            timer_set_owner(owner);
+
             if (priv == NULL) {
 #ifdef ENABLE_DEVICE_LOG
                 if (dev->name)
@@ -57,6 +57,11 @@ static serial_device_t serial_devices[SERIAL_MAX];
 
 static void            serial_xmit_d_empty_evt(void *priv);
 
+/* From this line rate up, with the FIFO enabled, the transmitter skips the
+   bit periods in which nothing happens and host-backed devices may hand over
+   received data a FIFO at a time. */
+#define SERIAL_BURST_MIN_BAUD 38400.0
+
 #ifdef ENABLE_SERIAL_LOG
 int serial_do_log = ENABLE_SERIAL_LOG;
 
@@ -90,6 +95,7 @@ serial_reset_port(serial_t *dev)
 
     dev->fifo_enabled                         = 0;
     dev->baud_cycles                          = 0;
+    dev->baud_skip                            = 1;
     dev->out_new                              = 0xffff;
 
     dev->txsr_empty = 1;
@@ -162,6 +168,12 @@ serial_receive_timer(void *priv)
 
     serial_log("serial_receive_timer()\n");
 
+    /* Nothing in the RSR, sleep until the attached device sends a byte. */
+    if (dev->out_new == 0xffff) {
+        timer_idle(&dev->receive_timer);
+        return;
+    }
+
     timer_on_auto(&dev->receive_timer, /* dev->bits * */ dev->transmit_period);
 
     if (dev->fifo_enabled) {
@@ -216,6 +228,8 @@ write_fifo(serial_t *dev, uint8_t dat)
 
     /* Do this here, because in non-FIFO mode, this is read directly. */
     dev->out_new = (uint16_t) dat;
+
+    timer_kick(&dev->receive_timer, /* dev->bits * */ dev->transmit_period);
 }
 
 void
@@ -230,6 +244,47 @@ serial_write_fifo(serial_t *dev, uint8_t dat)
         write_fifo(dev, dat);
 }
 
+static int
+serial_burst_enabled(const serial_t *dev)
+{
+    return (dev->type >= SERIAL_16550) && dev->fifo_enabled &&
+           ((1000000.0 / dev->transmit_period) >= SERIAL_BURST_MIN_BAUD);
+}
+
+/* How many received bytes the device may pass to serial_write_fifo_burst()
+   right now, 0 if it has to use serial_write_fifo() instead. */
+int
+serial_get_burst_len(serial_t *dev)
+{
+    if ((dev == NULL) || (dev->mctrl & 0x10) || (dev->out_new != 0xffff) || !serial_burst_enabled(dev))
+        return 0;
+
+    return SERIAL_FIFO_SIZE - fifo_get_count(dev->rcvr_fifo);
+}
+
+/* Puts a run of received bytes straight into the receiver FIFO, as if they
+   had all come in during the last character time. The device is expected to
+   wait for as many character times before sending the next run, so the line
+   rate seen by the guest stays the same. Returns the number of bytes taken. */
+int
+serial_write_fifo_burst(serial_t *dev, const uint8_t *buf, int len)
+{
+    int i;
+
+    if (serial_get_burst_len(dev) == 0)
+        return 0;
+
+    serial_clear_timeout(dev);
+
+    for (i = 0; (i < len) && !fifo_get_full(dev->rcvr_fifo); i++)
+        fifo_write_evt(buf[i], dev->rcvr_fifo);
+
+    if (i > 0)
+        timer_on_auto(&dev->timeout_timer, 4.0 * dev->bits * dev->transmit_period);
+
+    return i;
+}
+
 void
 serial_transmit(serial_t *dev, uint8_t val)
 {
@@ -295,6 +350,51 @@ serial_process_txsr(serial_t *dev)
     serial_update_ints(dev);
 }
 
+/* Schedules the transmit timer for the next BAUDOUT cycle. In burst mode, it
+   goes straight to the next cycle in which serial_transmit_timer() moves or
+   transmits a byte. */
+static void
+serial_transmit_next(serial_t *dev)
+{
+    int delay = 1;
+    int next  = 0;
+
+    dev->baud_skip = 1;
+
+    if (serial_burst_enabled(dev)) {
+        if ((dev->transmit_enabled & 1) && (dev->transmit_enabled & 2))
+            delay = dev->data_bits + 1;
+
+        if (dev->transmit_enabled & 2)
+            next = dev->bits + 1;
+        if ((dev->transmit_enabled & 1) && (delay > dev->baud_cycles) && (!next || (delay < next)))
+            next = delay;
+
+        if (next > (dev->baud_cycles + 1))
+            dev->baud_skip = next - dev->baud_cycles;
+    }
+
+    timer_on_auto(&dev->transmit_timer, dev->baud_skip * dev->transmit_period);
+}
+
+/* Called before the transmit timer is restarted from outside its callback:
+   accounts for the skipped cycles that have already gone by, so the timer can
+   continue one cycle at a time from the current one. */
+static void
+serial_transmit_resync(serial_t *dev)
+{
+    uint64_t period = (uint64_t) (dev->transmit_period * ((double) TIMER_USEC));
+    uint64_t left;
+
+    if ((dev->baud_skip > 1) && timer_is_enabled(&dev->transmit_timer) && period) {
+        left = (timer_get_remaining_u64(&dev->transmit_timer) + period - 1) / period;
+        if (left < dev->baud_skip)
+            dev->baud_cycles += dev->baud_skip - left;
+    }
+
+    dev->baud_skip = 1;
+}
+
 /* Transmit_enable flags:
         Bit 0 = Do move if set;
         Bit 1 = Do transmit if set. */
@@ -318,7 +418,8 @@ serial_transmit_timer(void *priv)
         if ((dev->transmit_enabled & 1) && (dev->transmit_enabled & 2))
             delay = dev->data_bits + 1;
 
-        dev->baud_cycles++;
+        /* Nothing happens in the periods skipped by serial_transmit_next(). */
+        dev->baud_cycles += dev->baud_skip;
 
         /* We have processed (delay + total bits) BAUDOUT cycles, transmit the byte. */
         if ((dev->baud_cycles == (dev->bits + 1)) && (dev->transmit_enabled & 2))
@@ -329,7 +430,7 @@ serial_transmit_timer(void *priv)
             serial_move_to_txsr(dev);
 
         if (dev->transmit_enabled & 3)
-            timer_on_auto(&dev->transmit_timer, dev->transmit_period);
+            serial_transmit_next(dev);
     } else {
         dev->baud_cycles = 0;
         return;
@@ -366,10 +467,13 @@ static void
 serial_update_speed(serial_t *dev)
 {
     serial_log("serial_update_speed(%lf)\n", dev->transmit_period);
-    timer_on_auto(&dev->receive_timer, /* dev->bits * */ dev->transmit_period);
+    if (!timer_is_idle(&dev->receive_timer))
+        timer_on_auto(&dev->receive_timer, /* dev->bits * */ dev->transmit_period);
 
-    if (dev->transmit_enabled & 3)
+    if (dev->transmit_enabled & 3) {
+        serial_transmit_resync(dev);
         timer_on_auto(&dev->transmit_timer, dev->transmit_period);
+    }
 
     if (timer_is_on(&dev->timeout_timer))
         timer_on_auto(&dev->timeout_timer, 4.0 * dev->bits * dev->transmit_period);
@@ -497,6 +601,7 @@ serial_write(uint16_t addr, uint8_t val, void *priv)
 
             if (dev->fifo_enabled && (fifo_get_count(dev->xmit_fifo) < 16)) {
                 /* FIFO mode, begin transmitting. */
+                serial_transmit_resync(dev);
                 timer_on_auto(&dev->transmit_timer, dev->transmit_period);
                 dev->transmit_enabled |= 1; /* Start moving. */
                 fifo_write_evt(val, dev->xmit_fifo);
@@ -507,6 +612,7 @@ serial_write(uint16_t addr, uint8_t val, void *priv)
                 serial_update_ints(dev);
 
                 /* Non-FIFO mode, begin transmitting. */
+                serial_transmit_resync(dev);
                 timer_on_auto(&dev->transmit_timer, dev->transmit_period);
                 dev->transmit_enabled |= 1; /* Start moving. */
                 dev->thr = val;
@@ -907,6 +1013,7 @@ serial_reset(void *priv)
         dev->dat = dev->int_status = dev->scratch = dev->fcr = 0x00;
         dev->fifo_enabled = dev->bits = 0x000;
         dev->data_bits = dev->baud_cycles = 0x00;
+        dev->baud_skip = 0x01;
         dev->txsr = 0x00;
         dev->txsr_empty = 0x01;
         dev->thr_empty = 0x0001;
@@ -964,6 +1071,7 @@ serial_init(const device_t *info)
         timer_add(&dev->transmit_timer, serial_transmit_timer, dev, 0);
         timer_add(&dev->timeout_timer, serial_timeout_timer, dev, 0);
         timer_add(&dev->receive_timer, serial_receive_timer, dev, 0);
+        dev->baud_skip = 1;
         serial_transmit_period(dev);
         serial_update_speed(dev);
 
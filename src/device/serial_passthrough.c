@@ -73,7 +73,9 @@ host_to_serial_cb(void *priv)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
 
-    uint8_t byte;
+    uint8_t buf[SERIAL_FIFO_SIZE];
+    int     len  = 1;
+    int     sent = 1;
 
     /* write_fifo has no failure indication, but if we write to fast, the host
      * can never fetch the bytes in time, so check if the fifo is full if in
@@ -87,11 +89,18 @@ host_to_serial_cb(void *priv)
             goto no_write_to_machine;
         }
     }
-    if (plat_serpt_read(dev, &byte)) {
+    /* At high rates, read as much as the receiver FIFO can take and wait for
+       as many character times before the next read. */
+    if (serial_get_burst_len(dev->serial) > 1)
+        len = serial_get_burst_len(dev->serial);
+    if ((len = plat_serpt_read(dev, buf, len)) > 0) {
 #if 0
-        printf("got byte %02X\n", byte);
+        printf("got %i bytes\n", len);
 #endif
-        serial_write_fifo(dev->serial, byte);
+        if (len > 1)
+            sent = serial_write_fifo_burst(dev->serial, buf, len);
+        else
+            serial_write_fifo(dev->serial, buf[0]);
 #if 0
         serial_set_dsr(dev->serial, 1);
 #endif
@@ -100,7 +109,7 @@ no_write_to_machine:
 #if 0
     serial_device_timeout(dev->serial);
 #endif
-    timer_on_auto(&dev->host_to_serial_timer, (1000000.0 / dev->baudrate) * (double) dev->bits);
+    timer_on_auto(&dev->host_to_serial_timer, (1000000.0 / dev->baudrate) * (double) (dev->bits * sent));
 }
 
 static void
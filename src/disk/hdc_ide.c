@@ -98,6 +98,7 @@
 #define WIN_SETIDLE1                   0xe3
 #define WIN_CHECKPOWERMODE1            0xe5
 #define WIN_SLEEP1                     0xe6
+#define WIN_FLUSH_CACHE                0xe7
 #define WIN_IDENTIFY                   0xec /* Ask drive to identify itself */
 #define WIN_SET_FEATURES               0xef
 #define WIN_READ_NATIVE_MAX            0xf8
@@ -1918,6 +1919,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                 case WIN_SETIDLE1:          /* Idle */
                 case WIN_CHECKPOWERMODE1:
                 case WIN_SLEEP1:
+                case WIN_FLUSH_CACHE:
                     ide->tf->atastat = BSY_STAT;
                     ide_callback(ide);
                     break;
@@ -2222,6 +2224,75 @@ ide_readl(uint16_t addr, void *priv)
     return ret;
 }
 
+/* REP INSW/INSD on the data port: copy straight out of the sector buffer,
+   the last word of a sector goes through ide_read_data() so the end of
+   sector handling runs exactly as it would for a single access. */
+static int
+ide_read_block(uint16_t addr, void *buf, int size, int count, void *priv)
+{
+    const ide_board_t *dev  = (ide_board_t *) priv;
+    ide_t             *ide  = ide_drives[dev->cur_dev];
+    uint16_t          *bufw = (uint16_t *) buf;
+    const uint16_t    *idebufferw;
+    int                words;
+    int                left;
+    int                n;
+
+    if ((addr & 0x7) || (size == 1) || ((size == 4) && (!dev->bit32 || (ide->tf->pos & 2))))
+        return 0;
+
+    if ((ide->type == IDE_NONE) || (ide->type & IDE_SHADOW) || (ide->buffer == NULL) ||
+        (ide->command == WIN_PACKETCMD) || (ide->tf->pos >= 512))
+        return 0;
+
+    idebufferw = ide->buffer;
+    words      = count * (size >> 1);
+    left       = (512 - ide->tf->pos) >> 1;
+    n          = (words < left) ? words : (left - 1);
+
+    memcpy(bufw, &(idebufferw[ide->tf->pos >> 1]), n << 1);
+    ide->tf->pos += (n << 1);
+
+    if (n < words)
+        bufw[n++] = ide_read_data(ide);
+
+    return n / (size >> 1);
+}
+
+static int
+ide_write_block(uint16_t addr, const void *buf, int size, int count, void *priv)
+{
+    const ide_board_t *dev  = (ide_board_t *) priv;
+    ide_t             *ide  = ide_drives[dev->cur_dev];
+    const uint16_t    *bufw = (const uint16_t *) buf;
+    uint16_t          *idebufferw;
+    int                words;
+    int                left;
+    int                n;
+
+    if ((addr & 0x7) || (size == 1) || ((size == 4) && (!dev->bit32 || (ide->tf->pos & 2))))
+        return 0;
+
+    if ((ide->type == IDE_NONE) || (ide->type & IDE_SHADOW) || (ide->buffer == NULL) ||
+        (ide->command == WIN_PACKETCMD) || (ide->tf->pos >= 512))
+        return 0;
+
+    idebufferw = ide->buffer;
+    words      = count * (size >> 1);
+    left       = (512 - ide->tf->pos) >> 1;
+    n          = (words < left) ? words : (left - 1);
+
+    memcpy(&(idebufferw[ide->tf->pos >> 1]), bufw, n << 1);
+    ide->tf->pos += (n << 1);
+
+    if (n < words) {
+        ide_write_data(ide, bufw[n]);
+        n++;
+    }
+
+    return n / (size >> 1);
+}
+
 static void
 ide_board_callback(void *priv)
 {
@@ -2342,6 +2413,15 @@ ide_callback(void *priv)
             ide_irq_raise(ide);
             break;
 
+        case WIN_FLUSH_CACHE:
+            if ((ide->type != IDE_HDD) || (hdd_image_flush(ide->hdd_num) < 0))
+                err = ABRT_ERR;
+            else {
+                ide->tf->atastat = DRDY_STAT | DSC_STAT;
+                ide_irq_raise(ide);
+            }
+            break;
+
         case WIN_READ:
         case WIN_READ_NORETRY:
             if (ide->type == IDE_ATAPI) {
@@ -2766,6 +2846,10 @@ ide_handlers(uint8_t board, int set)
                        ide_readb, ide_readw, ide_readl,
                        ide_writeb, ide_writew, ide_writel,
                        ide_boards[board]);
+            if (set)
+                io_sethandler_block(ide_boards[board]->base[0], 1,
+                                    ide_read_block, ide_write_block,
+                                    ide_boards[board]);
         }
 
         if (ide_boards[board]->base[1]) {
@@ -19,6 +19,7 @@
 #define _GNU_SOURCE
 #include <stdarg.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -43,14 +44,52 @@
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
 
+#define HDD_CACHE_BLOCK_SHIFT 3 /* 8 sectors (4 kB) per block */
+#define HDD_CACHE_BLOCK_SIZE  (1 << HDD_CACHE_BLOCK_SHIFT)
+#define HDD_CACHE_BYPASS      128 /* Transfers longer than this go straight to the image. */
+#define HDD_CACHE_RUN_MAX     128 /* Longest run of sectors written back at once. */
+#define HDD_CACHE_RUN_BLOCKS  ((HDD_CACHE_RUN_MAX >> HDD_CACHE_BLOCK_SHIFT) + 1)
+
+/* A block of the host cache, with a bit per sector in the masks. */
+typedef struct hdd_cache_block_t {
+    uint32_t block;
+    uint8_t  valid;
+    uint8_t  dirty;
+    uint8_t  pad[2];
+    int32_t  hash_next;
+    int32_t  prev;
+    int32_t  next;
+} hdd_cache_block_t;
+
+typedef struct hdd_host_cache_t {
+    hdd_cache_block_t *blocks;
+    uint8_t           *data;
+    uint8_t           *run;
+    int32_t            run_block[HDD_CACHE_RUN_BLOCKS]; /* blocks with sectors in the run */
+    uint8_t            run_mask[HDD_CACHE_RUN_BLOCKS];  /* and which of their sectors */
+    uint32_t           run_num;
+    int32_t           *hash;
+    uint32_t           hash_mask;
+    uint32_t           num_blocks;
+    uint32_t           used;
+    uint32_t           dirty;
+    int32_t            head; /* most recently used */
+    int32_t            tail; /* least recently used */
+
+    uint64_t           hits;
+    uint64_t           misses;
+    uint64_t           write_backs;
+} hdd_host_cache_t;
+
 typedef struct hdd_image_t {
-    FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
-    MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
-    uint32_t  base;
-    uint32_t  pos;
-    uint32_t  last_sector;
-    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
-    uint8_t   loaded;
+    FILE             *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
+    MVHDMeta         *vhd;  /* Used for HDD_IMAGE_VHD. */
+    hdd_host_cache_t *cache;
+    uint32_t          base;
+    uint32_t          pos;
+    uint32_t          last_sector;
+    uint8_t           type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
+    uint8_t           loaded;
 } hdd_image_t;
 
 hdd_image_t hdd_images[HDD_NUM];
@@ -58,6 +97,9 @@ hdd_image_t hdd_images[HDD_NUM];
 static char  empty_sector[512];
 static char *empty_sector_1mb;
 
+static int  hdd_image_write_direct(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+static void hdd_image_cache_close(uint8_t id);
+
 #ifdef ENABLE_HDD_IMAGE_LOG
 int hdd_image_do_log = ENABLE_HDD_IMAGE_LOG;
 
@@ -273,6 +315,8 @@ hdd_image_load(int id)
     hdd_images[id].base = 0;
 
     if (hdd_images[id].loaded) {
+        hdd_image_cache_close(id);
+
         if (hdd_images[id].file) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
@@ -525,8 +569,8 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_read_direct(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
@@ -552,6 +596,440 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+/*
+ * Host cache.
+ *
+ * An image whose disk has a host cache size set (hdd_XX_host_cache, in
+ * kB; it is off by default) gets a cache of 4 kB blocks in host memory,
+ * so the sectors guests keep going back to (FAT, directories, registry
+ * hives) are served without touching the image. Writes stay in the cache and are written back in sector order
+ * when half of it is dirty, when a dirty block has to be evicted, when
+ * the guest flushes the disk's cache, and when the image is closed.
+ */
+static uint32_t
+hdd_image_cache_hash(const hdd_host_cache_t *cache, uint32_t block)
+{
+    return (block * 0x9e3779b1) & cache->hash_mask;
+}
+
+static uint8_t *
+hdd_image_cache_data(const hdd_host_cache_t *cache, int32_t i)
+{
+    return cache->data + ((size_t) i << (HDD_CACHE_BLOCK_SHIFT + 9));
+}
+
+static uint8_t
+hdd_image_cache_mask(uint32_t first, uint32_t num)
+{
+    return (uint8_t) (((1 << num) - 1) << first);
+}
+
+static hdd_host_cache_t *
+hdd_image_cache_get(uint8_t id)
+{
+    hdd_host_cache_t *cache     = hdd_images[id].cache;
+    int32_t           size      = hdd[id].host_cache;
+    uint32_t          hash_size = 1;
+    uint32_t          num_blocks;
+
+    if ((cache != NULL) || !hdd_images[id].loaded || (size <= 0))
+        return cache;
+
+    if (size > HDD_HOST_CACHE_MAX)
+        size = HDD_HOST_CACHE_MAX;
+    num_blocks = ((uint32_t) size << 10) >> (HDD_CACHE_BLOCK_SHIFT + 9);
+    if (num_blocks < 2)
+        return NULL;
+    while (hash_size < num_blocks)
+        hash_size <<= 1;
+
+    cache = (hdd_host_cache_t *) calloc(1, sizeof(hdd_host_cache_t));
+    if (cache == NULL)
+        return NULL;
+
+    cache->blocks = (hdd_cache_block_t *) calloc(num_blocks, sizeof(hdd_cache_block_t));
+    cache->data   = (uint8_t *) malloc((size_t) num_blocks << (HDD_CACHE_BLOCK_SHIFT + 9));
+    cache->run    = (uint8_t *) malloc(HDD_CACHE_RUN_MAX << 9);
+    cache->hash   = (int32_t *) malloc(hash_size * sizeof(int32_t));
+    if ((cache->blocks == NULL) || (cache->data == NULL) || (cache->run == NULL) || (cache->hash == NULL)) {
+        hdd_image_log("Hard disk image %i: Unable to allocate a %i kB host cache\n", id, size);
+        free(cache->blocks);
+        free(cache->data);
+        free(cache->run);
+        free(cache->hash);
+        free(cache);
+        return NULL;
+    }
+
+    memset(cache->hash, 0xff, hash_size * sizeof(int32_t));
+    cache->hash_mask  = hash_size - 1;
+    cache->num_blocks = num_blocks;
+    cache->head       = -1;
+    cache->tail       = -1;
+
+    hdd_images[id].cache = cache;
+
+    return cache;
+}
+
+static int32_t
+hdd_image_cache_find(const hdd_host_cache_t *cache, uint32_t block)
+{
+    int32_t i = cache->hash[hdd_image_cache_hash(cache, block)];
+
+    while ((i != -1) && (cache->blocks[i].block != block))
+        i = cache->blocks[i].hash_next;
+
+    return i;
+}
+
+static void
+hdd_image_cache_unlink(hdd_host_cache_t *cache, int32_t i)
+{
+    hdd_cache_block_t *b = &cache->blocks[i];
+
+    if (b->prev != -1)
+        cache->blocks[b->prev].next = b->next;
+    else
+        cache->head = b->next;
+
+    if (b->next != -1)
+        cache->blocks[b->next].prev = b->prev;
+    else
+        cache->tail = b->prev;
+}
+
+static void
+hdd_image_cache_touch(hdd_host_cache_t *cache, int32_t i)
+{
+    hdd_cache_block_t *b = &cache->blocks[i];
+
+    if (cache->head == i)
+        return;
+
+    hdd_image_cache_unlink(cache, i);
+
+    b->prev = -1;
+    b->next = cache->head;
+    if (cache->head != -1)
+        cache->blocks[cache->head].prev = i;
+    cache->head = i;
+    if (cache->tail == -1)
+        cache->tail = i;
+}
+
+/* Writes out the run of sectors collected for writing back. The sectors in it
+   are only marked clean if the write succeeded, so a failed one is retried. */
+static int
+hdd_image_cache_run_flush(uint8_t id, hdd_host_cache_t *cache, uint32_t *run_start, uint32_t *run_len)
+{
+    hdd_cache_block_t *b;
+    int                ret = 0;
+
+    if (*run_len) {
+        ret = hdd_image_write_direct(id, *run_start, *run_len, cache->run);
+        cache->write_backs++;
+        *run_len = 0;
+
+        for (uint32_t j = 0; (ret == 0) && (j < cache->run_num); j++) {
+            b = &cache->blocks[cache->run_block[j]];
+            if (b->dirty) {
+                b->dirty &= ~cache->run_mask[j];
+                if (!b->dirty)
+                    cache->dirty--;
+            }
+        }
+        cache->run_num = 0;
+    }
+
+    return ret;
+}
+
+/* Adds the dirty sectors of a block to the run, writing the run out whenever it can not be extended. */
+static int
+hdd_image_cache_write_back(uint8_t id, hdd_host_cache_t *cache, int32_t i, uint32_t *run_start, uint32_t *run_len)
+{
+    hdd_cache_block_t *b   = &cache->blocks[i];
+    const uint32_t     lba = b->block << HDD_CACHE_BLOCK_SHIFT;
+    int                ret = 0;
+
+    for (uint32_t s = 0; s < HDD_CACHE_BLOCK_SIZE; s++) {
+        if (!(b->dirty & (1 << s)))
+            continue;
+
+        if (*run_len && (((*run_start + *run_len) != (lba + s)) || (*run_len == HDD_CACHE_RUN_MAX)) &&
+            (hdd_image_cache_run_flush(id, cache, run_start, run_len) < 0))
+            ret = -1;
+
+        if (*run_len == 0)
+            *run_start = lba + s;
+        if (!cache->run_num || (cache->run_block[cache->run_num - 1] != i)) {
+            cache->run_block[cache->run_num] = i;
+            cache->run_mask[cache->run_num]  = 0x00;
+            cache->run_num++;
+        }
+        cache->run_mask[cache->run_num - 1] |= (1 << s);
+        memcpy(cache->run + (*run_len << 9), hdd_image_cache_data(cache, i) + (s << 9), 512);
+        (*run_len)++;
+    }
+
+    return ret;
+}
+
+static int
+hdd_image_cache_compare(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Writes all dirty blocks back to the image, in sector order. */
+int
+hdd_image_flush(uint8_t id)
+{
+    hdd_host_cache_t *cache     = hdd_images[id].cache;
+    uint32_t          run_start = 0;
+    uint32_t          run_len   = 0;
+    uint32_t          num       = 0;
+    uint64_t         *list;
+    int               ret       = 0;
+
+    if ((cache == NULL) || !cache->dirty)
+        return 0;
+
+    list = (uint64_t *) malloc(cache->dirty * sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < cache->used; i++) {
+        if (!cache->blocks[i].dirty)
+            continue;
+
+        if (list != NULL)
+            list[num++] = (((uint64_t) cache->blocks[i].block) << 32) | i;
+        else if (hdd_image_cache_write_back(id, cache, i, &run_start, &run_len) < 0)
+            ret = -1;
+    }
+
+    if (list != NULL) {
+        qsort(list, num, sizeof(uint64_t), hdd_image_cache_compare);
+
+        for (uint32_t i = 0; i < num; i++) {
+            if (hdd_image_cache_write_back(id, cache, (int32_t) (list[i] & 0xffffffff), &run_start, &run_len) < 0)
+                ret = -1;
+        }
+
+        free(list);
+    }
+
+    if (hdd_image_cache_run_flush(id, cache, &run_start, &run_len) < 0)
+        ret = -1;
+
+    return ret;
+}
+
+/* Takes a block for the given block number, evicting the least recently used one if needed.
+   Returns -1 if that block is dirty and could not be written back. */
+static int32_t
+hdd_image_cache_alloc(uint8_t id, hdd_host_cache_t *cache, uint32_t block)
+{
+    hdd_cache_block_t *b;
+    int32_t           *p;
+    int32_t            i;
+
+    if (cache->used < cache->num_blocks) {
+        i = (int32_t) cache->used++;
+        b = &cache->blocks[i];
+
+        b->prev = b->next = -1;
+        if (cache->tail == -1)
+            cache->head = cache->tail = i;
+        else {
+            b->prev                         = cache->tail;
+            cache->blocks[cache->tail].next = i;
+            cache->tail                     = i;
+        }
+    } else {
+        i = cache->tail;
+        b = &cache->blocks[i];
+
+        /* Write back everything rather than just this block, so the writes get merged. */
+        if (b->dirty && (hdd_image_flush(id) < 0) && b->dirty)
+            return -1;
+
+        p = &cache->hash[hdd_image_cache_hash(cache, b->block)];
+        while (*p != i)
+            p = &cache->blocks[*p].hash_next;
+        *p = b->hash_next;
+    }
+
+    b->block     = block;
+    b->valid     = 0x00;
+    b->dirty     = 0x00;
+    p            = &cache->hash[hdd_image_cache_hash(cache, block)];
+    b->hash_next = *p;
+    *p           = i;
+
+    return i;
+}
+
+/* Reads the sectors of a block that are on the image, keeping those that are dirty. */
+static int
+hdd_image_cache_load(uint8_t id, hdd_host_cache_t *cache, int32_t i)
+{
+    hdd_cache_block_t *b    = &cache->blocks[i];
+    const uint32_t     lba  = b->block << HDD_CACHE_BLOCK_SHIFT;
+    uint32_t           num  = hdd_images[id].last_sector + 1 - lba;
+    uint8_t           *data = hdd_image_cache_data(cache, i);
+
+    if (num > HDD_CACHE_BLOCK_SIZE)
+        num = HDD_CACHE_BLOCK_SIZE;
+
+    if (hdd_image_read_direct(id, lba, num, b->dirty ? cache->run : data) < 0)
+        return -1;
+
+    if (b->dirty) {
+        for (uint32_t s = 0; s < num; s++) {
+            if (!(b->dirty & (1 << s)))
+                memcpy(data + (s << 9), cache->run + (s << 9), 512);
+        }
+    }
+    b->valid = hdd_image_cache_mask(0, num);
+
+    return 0;
+}
+
+/* Drops the cached copies of the given sectors. */
+static void
+hdd_image_cache_discard(hdd_host_cache_t *cache, uint32_t sector, uint32_t count)
+{
+    const uint32_t end = sector + count;
+    uint32_t       first;
+    uint32_t       num;
+    uint8_t        mask;
+    int32_t        i;
+
+    while (sector < end) {
+        first = sector & (HDD_CACHE_BLOCK_SIZE - 1);
+        num   = MIN(HDD_CACHE_BLOCK_SIZE - first, end - sector);
+        mask  = hdd_image_cache_mask(first, num);
+        i     = hdd_image_cache_find(cache, sector >> HDD_CACHE_BLOCK_SHIFT);
+
+        if (i != -1) {
+            cache->blocks[i].valid &= ~mask;
+            if (cache->blocks[i].dirty) {
+                cache->blocks[i].dirty &= ~mask;
+                if (!cache->blocks[i].dirty)
+                    cache->dirty--;
+            }
+        }
+
+        sector += num;
+    }
+}
+
+/* Copies the dirty cached sectors over data read directly from the image. */
+static void
+hdd_image_cache_overlay(hdd_host_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    const uint32_t end = sector + count;
+    uint32_t       first;
+    uint32_t       num;
+    int32_t        i;
+
+    while (sector < end) {
+        first = sector & (HDD_CACHE_BLOCK_SIZE - 1);
+        num   = MIN(HDD_CACHE_BLOCK_SIZE - first, end - sector);
+        i     = hdd_image_cache_find(cache, sector >> HDD_CACHE_BLOCK_SHIFT);
+
+        if ((i != -1) && cache->blocks[i].dirty) {
+            for (uint32_t s = first; s < (first + num); s++) {
+                if (cache->blocks[i].dirty & (1 << s))
+                    memcpy(buffer + ((s - first) << 9), hdd_image_cache_data(cache, i) + (s << 9), 512);
+            }
+        }
+
+        buffer += num << 9;
+        sector += num;
+    }
+}
+
+static int
+hdd_image_cache_bypass(uint8_t id, uint32_t sector, uint32_t count)
+{
+    return (count > HDD_CACHE_BYPASS) || ((sector + count) < sector) ||
+           ((sector + count) > (hdd_images[id].last_sector + 1));
+}
+
+static void
+hdd_image_cache_close(uint8_t id)
+{
+    hdd_host_cache_t *cache = hdd_images[id].cache;
+
+    if (cache == NULL)
+        return;
+
+    if (hdd_image_flush(id) < 0)
+        pclog("Hard disk image %i: Error writing back the host cache, %u blocks lost\n", id, cache->dirty);
+
+    if (log_stats)
+        pclog("Hard disk image %i: Host cache: %" PRIu64 " hits, %" PRIu64 " misses, "
+              "%" PRIu64 " write backs\n", id, cache->hits, cache->misses, cache->write_backs);
+
+    free(cache->blocks);
+    free(cache->data);
+    free(cache->run);
+    free(cache->hash);
+    free(cache);
+
+    hdd_images[id].cache = NULL;
+}
+
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_host_cache_t *cache = hdd_image_cache_get(id);
+    const uint32_t    end   = sector + count;
+    uint32_t          first;
+    uint32_t          num;
+    uint8_t           mask;
+    int32_t           i;
+    int               ret   = 0;
+
+    if ((cache == NULL) || hdd_image_cache_bypass(id, sector, count)) {
+        ret = hdd_image_read_direct(id, sector, count, buffer);
+        if ((cache != NULL) && cache->dirty)
+            hdd_image_cache_overlay(cache, sector, count, buffer);
+        return ret;
+    }
+
+    while (sector < end) {
+        first = sector & (HDD_CACHE_BLOCK_SIZE - 1);
+        num   = MIN(HDD_CACHE_BLOCK_SIZE - first, end - sector);
+        mask  = hdd_image_cache_mask(first, num);
+        i     = hdd_image_cache_find(cache, sector >> HDD_CACHE_BLOCK_SHIFT);
+
+        if ((i != -1) && ((cache->blocks[i].valid & mask) == mask))
+            cache->hits++;
+        else {
+            cache->misses++;
+            if ((i == -1) && ((i = hdd_image_cache_alloc(id, cache, sector >> HDD_CACHE_BLOCK_SHIFT)) == -1))
+                return -1;
+            if (hdd_image_cache_load(id, cache, i) < 0)
+                return -1;
+        }
+        hdd_image_cache_touch(cache, i);
+
+        memcpy(buffer, hdd_image_cache_data(cache, i) + (first << 9), num << 9);
+        buffer += num << 9;
+        sector += num;
+    }
+
+    hdd_images[id].pos = end;
+
+    return ret;
+}
+
 uint32_t
 hdd_image_get_last_sector(uint8_t id)
 {
@@ -581,8 +1059,8 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_write_direct(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_write;
@@ -609,6 +1087,53 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_host_cache_t  *cache = hdd_image_cache_get(id);
+    const uint32_t     end   = sector + count;
+    hdd_cache_block_t *b;
+    uint32_t           first;
+    uint32_t           num;
+    uint8_t            mask;
+    int32_t            i;
+    int                ret   = 0;
+
+    if ((cache == NULL) || hdd_image_cache_bypass(id, sector, count)) {
+        if (cache != NULL)
+            hdd_image_cache_discard(cache, sector, count);
+        return hdd_image_write_direct(id, sector, count, buffer);
+    }
+
+    while (sector < end) {
+        first = sector & (HDD_CACHE_BLOCK_SIZE - 1);
+        num   = MIN(HDD_CACHE_BLOCK_SIZE - first, end - sector);
+        mask  = hdd_image_cache_mask(first, num);
+        i     = hdd_image_cache_find(cache, sector >> HDD_CACHE_BLOCK_SHIFT);
+
+        if ((i == -1) && ((i = hdd_image_cache_alloc(id, cache, sector >> HDD_CACHE_BLOCK_SHIFT)) == -1))
+            return -1;
+        hdd_image_cache_touch(cache, i);
+
+        b = &cache->blocks[i];
+        memcpy(hdd_image_cache_data(cache, i) + (first << 9), buffer, num << 9);
+        if (!b->dirty)
+            cache->dirty++;
+        b->valid |= mask;
+        b->dirty |= mask;
+
+        buffer += num << 9;
+        sector += num;
+    }
+
+    hdd_images[id].pos = end;
+
+    if ((cache->dirty > (cache->num_blocks >> 1)) && (hdd_image_flush(id) < 0))
+        ret = -1;
+
+    return ret;
+}
+
 int
 hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
@@ -626,8 +1151,8 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+static int
+hdd_image_zero_direct(uint8_t id, uint32_t sector, uint32_t count)
 {
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
@@ -658,6 +1183,15 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
     return 0;
 }
 
+int
+hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+{
+    if (hdd_images[id].cache != NULL)
+        hdd_image_cache_discard(hdd_images[id].cache, sector, count);
+
+    return hdd_image_zero_direct(id, sector, count);
+}
+
 int
 hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
 {
@@ -693,6 +1227,8 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
         return;
 
     if (hdd_images[id].loaded) {
+        hdd_image_cache_close(id);
+
         if (hdd_images[id].file != NULL) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
@@ -716,6 +1252,8 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_image_cache_close(id);
+
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
@@ -60,11 +60,19 @@
 
 #define MVHD_START_TS          946684800
 
+/* Number of block sector bitmaps kept in memory per image */
+#define MVHD_BITMAP_CACHE_SIZE 16
+
 
 typedef struct MVHDSectorBitmap {
     uint8_t* curr_bitmap;
     int      sector_count;
     int      curr_block;
+    /* LRU cache of block bitmaps, curr_bitmap points into cache_data */
+    uint8_t* cache_data;
+    int      cache_block[MVHD_BITMAP_CACHE_SIZE];
+    uint32_t cache_stamp[MVHD_BITMAP_CACHE_SIZE];
+    uint32_t cache_clock;
 } MVHDSectorBitmap;
 
 typedef struct MVHDFooter {
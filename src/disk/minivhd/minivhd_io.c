@@ -97,10 +97,11 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 }
 
 /**
- * \brief Read the sector bitmap for a block.
+ * \brief Make the sector bitmap for a block the current one.
  *
- * If the block is sparse, the sector bitmap in memory will be
- * zeroed. Otherwise, the sector bitmap is read from the VHD file.
+ * The bitmap is taken from the cache if present, otherwise the least recently
+ * used cache entry is replaced. If the block is sparse, the sector bitmap in
+ * memory will be zeroed. Otherwise, the sector bitmap is read from the VHD file.
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [in] blk The block for which to read the sector bitmap from
@@ -108,14 +109,92 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 static void
 read_sect_bitmap(MVHDMeta *vhdm, int blk)
 {
+    MVHDSectorBitmap *bm = &vhdm->bitmap;
+    int bm_size = bm->sector_count * MVHD_SECTOR_SIZE;
+    int slot = 0;
+
+    if (bm->curr_block == blk)
+        return;
+
+    for (int i = 0; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+        if (bm->cache_block[i] == blk) {
+            slot = i;
+            goto done;
+        }
+        if (bm->cache_stamp[i] < bm->cache_stamp[slot])
+            slot = i;
+    }
+
+    bm->cache_block[slot] = -1;
     if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
         mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
-        if (!fread(vhdm->bitmap.curr_bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
+        if (!fread(&bm->cache_data[slot * bm_size], bm_size, 1, vhdm->f)) {
             vhdm->error = 1;
+            /* Not cached, so the next access retries the read */
+            memset(&bm->cache_data[slot * bm_size], 0, bm_size);
+            bm->curr_bitmap = &bm->cache_data[slot * bm_size];
+            bm->curr_block = -1;
+            return;
+        }
     } else
-        memset(vhdm->bitmap.curr_bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+        memset(&bm->cache_data[slot * bm_size], 0, bm_size);
+    bm->cache_block[slot] = blk;
+
+done:
+    bm->cache_stamp[slot] = ++bm->cache_clock;
+    bm->curr_bitmap = &bm->cache_data[slot * bm_size];
+    bm->curr_block = blk;
+}
+
+/**
+ * \brief Count the sectors from sib onwards that share the bitmap state of sib
+ *
+ * \param [in] bitmap The sector bitmap of the block
+ * \param [in] sib The first sector in the block
+ * \param [in] max The maximum number of sectors to count
+ *
+ * \return The length of the run, at least 1
+ */
+static int
+sect_bitmap_run(const uint8_t *bitmap, int sib, int max)
+{
+    int present = !!VHD_TESTBIT(bitmap, sib);
+    uint8_t full = present ? 0xff : 0x00;
+    int n = 1;
+
+    while (n < max) {
+        int k = sib + n;
+        /* Whole bytes at once where possible */
+        if (!(k & 7) && ((max - n) >= 8) && (bitmap[k >> 3] == full)) {
+            n += 8;
+            continue;
+        }
+        if (!!VHD_TESTBIT(bitmap, k) != present)
+            break;
+        n++;
+    }
 
-    vhdm->bitmap.curr_block = blk;
+    return n;
+}
+
+/**
+ * \brief Read a run of present sectors from the data area of a block
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to read from
+ * \param [in] sib The first sector in the block
+ * \param [in] count The number of sectors
+ * \param [out] buff The buffer to read into
+ */
+static void
+read_blk_sectors(MVHDMeta *vhdm, int blk, int sib, int count, uint8_t *buff)
+{
+    int64_t addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!fread(buff, (size_t) count * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+        vhdm->error = 1;
 }
 
 /**
@@ -246,39 +325,29 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t* buff = (uint8_t*)out_buff;
-    int64_t addr = 0ULL;
     uint32_t s = 0;
     uint32_t ls = 0;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
+    int run = 0;
     ls = offset + transfer_sectors;
 
-    for (s = offset; s < ls; s++) {
+    /* Sectors are handled in runs of the same bitmap state, each run being a single read */
+    for (s = offset; s < ls; s += run) {
         blk = s / vhdm->sect_per_block;
         sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
-                addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                       MVHD_SECTOR_SIZE;
-                if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                    vhdm->error = 1;
-            }
-        }
+        run = vhdm->sect_per_block - sib;
+        if ((uint32_t) run > (ls - s))
+            run = ls - s;
 
-        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
-            memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
-        }
-        buff += MVHD_SECTOR_SIZE;
+        read_sect_bitmap(vhdm, blk);
+        run = sect_bitmap_run(vhdm->bitmap.curr_bitmap, sib, run);
+
+        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib))
+            read_blk_sectors(vhdm, blk, sib, run, buff);
+        else
+            memset(buff, 0, (size_t) run * MVHD_SECTOR_SIZE);
+        buff += (size_t) run * MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -294,39 +363,36 @@ mvhd_diff_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t *buff = (uint8_t*)out_buff;
-    MVHDMeta *curr_vhdm = vhdm;
+    MVHDMeta *parent = vhdm->parent;
     uint32_t s = 0;
     uint32_t ls = 0;
     int blk = 0;
     int sib = 0;
+    int run = 0;
     ls = offset + transfer_sectors;
 
-    for (s = offset; s < ls; s++) {
-        while (curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) {
-            blk = s / curr_vhdm->sect_per_block;
-            sib = s % curr_vhdm->sect_per_block;
-            if (curr_vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(curr_vhdm, blk);
+    /* Runs present in this image are read from it in one go, runs that are not are
+       handed to the parent as a whole, which does the same down the chain. */
+    for (s = offset; s < ls; s += run) {
+        blk = s / vhdm->sect_per_block;
+        sib = s % vhdm->sect_per_block;
+        run = vhdm->sect_per_block - sib;
+        if ((uint32_t) run > (ls - s))
+            run = ls - s;
+
+        read_sect_bitmap(vhdm, blk);
+        run = sect_bitmap_run(vhdm->bitmap.curr_bitmap, sib, run);
+
+        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib))
+            read_blk_sectors(vhdm, blk, sib, run, buff);
+        else {
+            parent->read_sectors(parent, s, run, buff);
+            if (parent->error) {
+                parent->error = 0;
+                vhdm->error = 1;
             }
-            if (!VHD_TESTBIT(curr_vhdm->bitmap.curr_bitmap, sib)) {
-                curr_vhdm = curr_vhdm->parent;
-            } else { break; }
         }
-
-        /* We handle actual sector reading using the fixed or sparse functions,
-           as a differencing VHD is also a sparse VHD */
-        if ((curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) ||
-            (curr_vhdm->footer.disk_type == MVHD_TYPE_DYNAMIC))
-            mvhd_sparse_read(curr_vhdm, s, 1, buff);
-        else
-            mvhd_fixed_read(curr_vhdm, s, 1, buff);
-        if (curr_vhdm->error) {
-            curr_vhdm->error = 0;
-            vhdm->error = 1;
-        }
-
-        curr_vhdm = vhdm;
-        buff += MVHD_SECTOR_SIZE;
+        buff += (size_t) run * MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -366,50 +432,39 @@ mvhd_sparse_diff_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *i
     uint32_t s = 0;
     uint32_t ls = 0;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
+    int run = 0;
     ls = offset + transfer_sectors;
 
     if (offset < total_sectors) {
-        for (s = offset; s < ls; s++) {
+        /* One write per block touched, followed by its updated sector bitmap */
+        for (s = offset; s < ls; s += run) {
             blk = s / vhdm->sect_per_block;
             sib = s % vhdm->sect_per_block;
-            if (vhdm->bitmap.curr_block != blk && prev_blk >= 0) {
-                /* Write the sector bitmap for the previous block, before we replace it. */
-                write_curr_sect_bitmap(vhdm);
-            }
+            run = vhdm->sect_per_block - sib;
+            if ((uint32_t) run > (ls - s))
+                run = ls - s;
 
-            if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK) {
-                /* "read" the sector bitmap first, before creating a new block, as the bitmap will be
-                   zero either way */
-                read_sect_bitmap(vhdm, blk);
+            /* The bitmap of a sparse block is zero, both before and after creating it */
+            read_sect_bitmap(vhdm, blk);
+            if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK)
                 create_block(vhdm, blk);
-            }
 
-            if (blk != prev_blk) {
-                if (vhdm->bitmap.curr_block != blk) {
-                    read_sect_bitmap(vhdm, blk);
-                    if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                        vhdm->error = 1;
-                } else {
-                    addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                           MVHD_SECTOR_SIZE;
-                    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                        vhdm->error = 1;
-                }
-                prev_blk = blk;
-            }
-
-            if (!fwrite(buff, MVHD_SECTOR_SIZE, 1, vhdm->f))
+            addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
+                   MVHD_SECTOR_SIZE;
+            if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+                vhdm->error = 1;
+            if (!fwrite(buff, (size_t) run * MVHD_SECTOR_SIZE, 1, vhdm->f))
                 vhdm->error = 1;
-            VHD_SETBIT(vhdm->bitmap.curr_bitmap, sib);
-            buff += MVHD_SECTOR_SIZE;
+
+            for (int k = sib; k < (sib + run); k++)
+                VHD_SETBIT(vhdm->bitmap.curr_bitmap, k);
+            write_curr_sect_bitmap(vhdm);
+
+            buff += (size_t) run * MVHD_SECTOR_SIZE;
         }
     }
 
-    /* And write the sector bitmap for the last block we visited to disk */
-    write_curr_sect_bitmap(vhdm);
-
     fflush(vhdm->f);
 
     return truncated_sectors;
@@ -81,6 +81,8 @@ char *fdd_image_history[FDD_NUM][FLOPPY_IMAGE_HISTORY];
 
 pc_timer_t fdd_poll_time[FDD_NUM];
 
+static uint32_t fdd_poll_skip_periods[FDD_NUM];
+
 static int fdd_notfound = 0;
 static int driveloaders[FDD_NUM];
 
@@ -492,6 +494,7 @@ fdd_load(int drive, char *fn)
                 drive_empty[drive] = 0;
                 fdd_forced_seek(drive, 0);
                 fdd_changed[drive] = 1;
+                timer_kick_u64(&fdd_poll_time[drive], 0);
                 return;
             }
             c++;
@@ -574,11 +577,49 @@ fdd_poll(void *priv)
     if (drv->poll)
         drv->poll(drive);
 
+    /* The image back-end has nothing to do for a while. */
+    if (fdd_poll_skip_periods[drive]) {
+        if (timer_is_enabled(&fdd_poll_time[drive]))
+            timer_advance_u64(&fdd_poll_time[drive], fdd_byteperiod(drive) * fdd_poll_skip_periods[drive]);
+        fdd_poll_skip_periods[drive] = 0;
+    }
+
     if (fdd_notfound) {
         fdd_notfound--;
         if (!fdd_notfound)
             fdc_noidam(fdd_fdc);
-    }
+    } else if (!drv->poll)
+        /* Empty drive, sleep until an image is loaded or a command fails. */
+        timer_idle(&fdd_poll_time[drive]);
+}
+
+/* Called from the poll: the image back-end will not need the next few polls,
+   so the one after them is scheduled directly. */
+void
+fdd_poll_skip(int drive, uint32_t periods)
+{
+    fdd_poll_skip_periods[drive] = periods;
+}
+
+/* Called when a command arrives in the middle of a skip: the poll is moved
+   back to the next period, and the number of periods that had not elapsed
+   yet is returned so the back-end can rewind its position on the track. */
+uint32_t
+fdd_poll_resync(int drive)
+{
+    uint64_t period = fdd_byteperiod(drive);
+    uint64_t remaining;
+    uint32_t periods;
+
+    if (!timer_is_enabled(&fdd_poll_time[drive]))
+        return 0;
+
+    remaining = timer_get_remaining_u64(&fdd_poll_time[drive]);
+    periods   = remaining ? ((remaining - 1) / period) : 0;
+    if (periods)
+        timer_set_delay_u64(&fdd_poll_time[drive], remaining - (periods * period));
+
+    return periods;
 }
 
 int
@@ -616,13 +657,24 @@ fdd_reset(void)
     }
 }
 
+/* A command was given to an empty drive, the polls of the drives whose motor
+   is on count the timeout down. */
+static void
+fdd_set_notfound(void)
+{
+    fdd_notfound = 1000;
+
+    for (int i = 0; i < FDD_NUM; i++)
+        timer_kick_u64(&fdd_poll_time[i], 0);
+}
+
 void
 fdd_readsector(int drive, int sector, int track, int side, int density, int sector_size)
 {
     if (drives[drive].readsector)
         drives[drive].readsector(drive, sector, track, side, density, sector_size);
     else
-        fdd_notfound = 1000;
+        fdd_set_notfound();
 }
 
 void
@@ -631,7 +683,7 @@ fdd_writesector(int drive, int sector, int track, int side, int density, int sec
     if (drives[drive].writesector)
         drives[drive].writesector(drive, sector, track, side, density, sector_size);
     else
-        fdd_notfound = 1000;
+        fdd_set_notfound();
 }
 
 void
@@ -640,7 +692,7 @@ fdd_comparesector(int drive, int sector, int track, int side, int density, int s
     if (drives[drive].comparesector)
         drives[drive].comparesector(drive, sector, track, side, density, sector_size);
     else
-        fdd_notfound = 1000;
+        fdd_set_notfound();
 }
 
 void
@@ -656,7 +708,7 @@ fdd_format(int drive, int side, int density, uint8_t fill)
     if (drives[drive].format)
         drives[drive].format(drive, side, density, fill);
     else
-        fdd_notfound = 1000;
+        fdd_set_notfound();
 }
 
 void
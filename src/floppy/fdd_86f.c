@@ -150,17 +150,28 @@ typedef union decoded_t {
 } decoded_t;
 
 typedef struct sector_t {
-    uint8_t c;
-    uint8_t h;
-    uint8_t r;
-    uint8_t n;
-    uint8_t flags;
-    uint8_t pad;
-    uint8_t pad0;
-    uint8_t pad1;
-    void   *prev;
+    uint8_t  c;
+    uint8_t  h;
+    uint8_t  r;
+    uint8_t  n;
+    uint8_t  flags;
+    uint8_t  gap2;
+    uint16_t gap3;
+    uint16_t pos;      /* Position of the sector on the track, in words. */
+    uint16_t id_end;   /* Position right after the ID field CRC. */
+    uint16_t data_end; /* Position right after the data field CRC. */
+    uint16_t data_len;
+    void    *prev;
 } sector_t;
 
+/* Sector-level mode command phases. */
+enum {
+    SECTOR_CMD_NONE = 0,
+    SECTOR_CMD_WAIT_ID,
+    SECTOR_CMD_WAIT_DATA,
+    SECTOR_CMD_NOT_FOUND
+};
+
 /* Disk flags:
  *  Bit 0   Has surface data (1 = yes, 0 = no)
  *  Bits 2, 1   Hole (3 = ED + 2000 kbps, 2 = ED, 1 = HD, 0 = DD)
@@ -192,6 +203,8 @@ typedef struct d86f_t {
     uint16_t  disk_flags;
     uint16_t  satisfying_bytes;
     uint16_t  turbo_pos;
+    uint8_t   sector_std[2]; /* Every sector on this side of the track is a plain one. */
+    uint8_t   sector_cmd;
     uint16_t  cur_track;
     uint16_t  track_encoded_data[2][53048];
     uint16_t *track_surface_data[2];
@@ -224,6 +237,7 @@ typedef struct d86f_t {
     uint8_t    *filebuf;
     uint8_t    *outbuf;
     sector_t   *last_side_sector[2];
+    sector_t   *sector_target;
     uint16_t    crc_table[256];
 } d86f_t;
 
@@ -258,6 +272,8 @@ void     d86f_writeback(int drive);
 uint8_t  d86f_poll_read_data(int drive, int side, uint16_t pos);
 void     d86f_poll_write_data(int drive, int side, uint16_t pos, uint8_t data);
 int      d86f_format_conditions(int drive);
+static uint16_t d86f_encode_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t *data_buf, int data_len,
+                                   int gap2, int gap3, int flags, sector_t *s);
 
 #ifdef ENABLE_D86F_LOG
 int d86f_do_log = ENABLE_D86F_LOG;
@@ -579,6 +595,7 @@ d86f_unregister(int drive)
     d86f_handler[drive].index_hole_pos    = null_index_hole_pos;
     d86f_handler[drive].get_raw_size      = common_get_raw_size;
     d86f_handler[drive].check_crc         = 0;
+    d86f_handler[drive].sector_level      = 0;
 
     dev->version = 0x0063; /* Proxied formats report as version 0.99. */
 }
@@ -598,6 +615,7 @@ d86f_register_86f(int drive)
     d86f_handler[drive].index_hole_pos    = d86f_index_hole_pos;
     d86f_handler[drive].get_raw_size      = common_get_raw_size;
     d86f_handler[drive].check_crc         = 1;
+    d86f_handler[drive].sector_level      = 0;
 }
 
 int
@@ -2433,6 +2451,299 @@ d86f_turbo_poll(int drive, int side)
     }
 }
 
+/*
+ * Sector-level mode.
+ *
+ * Standard-layout proxied images (every sector a plain one, with a data
+ * field of the size given in its ID) do not need their bit cells decoded
+ * to service the data commands: the positions of the ID and data fields
+ * on the track are known from when the track was built. The head position
+ * is still kept in bit cells, but the poll is skipped ahead to the end of
+ * the next field of interest, and a whole sector is transferred at once.
+ * This needs DMA, as the FDC can not buffer a sector for the CPU to read.
+ */
+static int
+d86f_sector_level(int drive)
+{
+    const d86f_t *dev = d86f[drive];
+
+    return !fdd_get_turbo(drive) && (dev->version == 0x0063) && d86f_handler[drive].sector_level;
+}
+
+static int
+d86f_sector_mode(int drive, int side)
+{
+    const d86f_t *dev = d86f[drive];
+
+    switch (dev->state) {
+        case STATE_IDLE:
+            return d86f_sector_level(drive);
+
+        case STATE_0A_FIND_ID:
+        case STATE_05_FIND_ID:
+        case STATE_06_FIND_ID:
+        case STATE_11_FIND_ID:
+        case STATE_16_FIND_ID:
+            return d86f_sector_level(drive) && dev->sector_std[side] && fdc_is_dma(d86f_fdc) &&
+                   d86f_can_read_address(drive) && !d86f_wrong_densel(drive);
+
+        default:
+            return 0;
+    }
+}
+
+/* Number of bit cells until the head reaches the given word on the track. */
+static uint32_t
+d86f_sector_distance(int drive, int side, uint32_t word)
+{
+    const d86f_t *dev      = d86f[drive];
+    uint32_t      raw_size = d86f_handler[drive].get_raw_size(drive, side);
+
+    return (((word << 4) % raw_size) + raw_size - dev->track_pos) % raw_size;
+}
+
+/* Moves the head by the given number of bit cells, and skips the polls in between. */
+static void
+d86f_sector_skip(int drive, int side, uint32_t bits)
+{
+    d86f_t  *dev      = d86f[drive];
+    uint32_t raw_size = d86f_handler[drive].get_raw_size(drive, side);
+    uint32_t index    = d86f_handler[drive].index_hole_pos(drive, side);
+    uint32_t dist;
+
+    if (!bits)
+        bits = 1;
+
+    /* Account for the index holes passed on the way. */
+    dist = (index + raw_size - dev->track_pos) % raw_size;
+    if (!dist)
+        dist = raw_size;
+    while (dist <= bits) {
+        d86f_handler[drive].read_revolution(drive);
+        if (dev->state != STATE_IDLE)
+            dev->index_count++;
+        dist += raw_size;
+    }
+
+    dev->track_pos = (dev->track_pos + bits) % raw_size;
+    fdd_poll_skip(drive, bits - 1);
+}
+
+/* A command has arrived, possibly in the middle of a skip: move the head
+   back to where the disk actually is. */
+static void
+d86f_sector_resync(int drive)
+{
+    d86f_t  *dev = d86f[drive];
+    uint32_t periods;
+    uint32_t raw_size;
+    int      side;
+
+    dev->sector_cmd = SECTOR_CMD_NONE;
+
+    periods = fdd_poll_resync(drive);
+    if (periods) {
+        side     = fdd_is_double_sided(drive) ? fdd_get_head(drive) : 0;
+        raw_size = d86f_handler[drive].get_raw_size(drive, side);
+
+        dev->track_pos = (dev->track_pos + raw_size - (periods % raw_size)) % raw_size;
+    }
+}
+
+/* Rebuilds the encoded data of a sector after it was written to. */
+static void
+d86f_sector_reencode(int drive, int side, sector_t *s)
+{
+    uint8_t  id[4] = { s->c, s->h, s->r, s->n };
+    uint8_t *buf   = (uint8_t *) malloc(s->data_len);
+
+    if (buf == NULL)
+        return;
+
+    for (uint32_t i = 0; i < s->data_len; i++)
+        buf[i] = d86f_handler[drive].read_data(drive, side, i);
+    d86f_encode_sector(drive, side, s->pos, id, buf, s->data_len, s->gap2, s->gap3, s->flags, NULL);
+
+    free(buf);
+}
+
+static void
+d86f_sector_transfer(int drive, int side)
+{
+    d86f_t  *dev         = d86f[drive];
+    uint32_t sector_len  = 128UL << dev->last_sector.id.n;
+    uint32_t data_len    = d86f_get_data_len(drive);
+    uint8_t  state       = dev->state;
+    uint8_t  dat;
+    int      recv_data;
+
+    if (state == STATE_05_WRITE_DATA) {
+        for (uint32_t i = 0; i < sector_len; i++) {
+            dev->data_find.bytes_obtained = i + 1;
+            dat                           = d86f_get_data(drive, 1);
+            if (!fdc_get_diswr(d86f_fdc))
+                d86f_handler[drive].write_data(drive, side, i, dat);
+        }
+
+        d86f_sector_reencode(drive, side, dev->sector_target);
+    } else {
+        for (uint32_t i = 0; i < sector_len; i++) {
+            dat = d86f_handler[drive].read_data(drive, side, i);
+
+            if (state == STATE_11_SCAN_DATA) {
+                /* Scan/compare command. */
+                dev->data_find.bytes_obtained = i;
+                recv_data                     = d86f_get_data(drive, 0);
+                d86f_compare_byte(drive, recv_data, dat);
+            } else if ((i < data_len) && (state != STATE_16_VERIFY_DATA)) {
+                if (fdc_data(d86f_fdc, dat, i == (data_len - 1)) == -1)
+                    dev->dma_over++;
+            }
+        }
+    }
+
+    dev->data_find.sync_marks = dev->data_find.bits_obtained = dev->data_find.bytes_obtained = 0;
+    dev->error_condition                                                                     = 0;
+    dev->state                                                                               = STATE_IDLE;
+    fdc_sector_finishread(d86f_fdc);
+}
+
+/* Looks for the requested sector, or for any sector on READ SECTOR ID. */
+static sector_t *
+d86f_sector_find(int drive, int side, uint32_t *dist)
+{
+    d86f_t   *dev  = d86f[drive];
+    sector_t *s    = dev->last_side_sector[side];
+    sector_t *best = NULL;
+    uint32_t  d;
+
+    *dist = 0;
+    while (s) {
+        if ((dev->state == STATE_0A_FIND_ID) || ((s->c == dev->req_sector.id.c) && (s->h == dev->req_sector.id.h) &&
+                                                 (s->r == dev->req_sector.id.r) && (s->n == dev->req_sector.id.n))) {
+            d = d86f_sector_distance(drive, side, s->id_end);
+            if (!best || (d < *dist)) {
+                best  = s;
+                *dist = d;
+            }
+        } else {
+            /* The FDC would have seen this ID go by. */
+            dev->id_found |= 1;
+            if (s->c != dev->req_sector.id.c)
+                dev->error_condition |= (s->c == 0xFF) ? 0x08 : 0x10;
+        }
+        s = (sector_t *) s->prev;
+    }
+
+    return best;
+}
+
+static void
+d86f_sector_poll(int drive, int side)
+{
+    d86f_t   *dev      = d86f[drive];
+    uint32_t  raw_size = d86f_handler[drive].get_raw_size(drive, side);
+    uint32_t  dist;
+    sector_t *s;
+
+    /* First, do what was waited for. */
+    switch (dev->sector_cmd) {
+        case SECTOR_CMD_WAIT_ID:
+            dev->sector_cmd = SECTOR_CMD_NONE;
+            s               = dev->sector_target;
+            if (dev->state == STATE_0A_FIND_ID) {
+                dev->error_condition = 0;
+                dev->state           = STATE_IDLE;
+                fdc_sectorid(d86f_fdc, s->c, s->h, s->r, s->n, 0, 0);
+            } else {
+                dev->last_sector.id.c = s->c;
+                dev->last_sector.id.h = s->h;
+                dev->last_sector.id.r = s->r;
+                dev->last_sector.id.n = s->n;
+                dev->id_found |= 1;
+                d86f_handler[drive].set_sector(drive, side, s->c, s->h, s->r, s->n);
+                dev->state += 3; /* on to the data stage */
+            }
+            break;
+
+        case SECTOR_CMD_WAIT_DATA:
+            dev->sector_cmd = SECTOR_CMD_NONE;
+            d86f_sector_transfer(drive, side);
+            break;
+
+        case SECTOR_CMD_NOT_FOUND:
+            dev->sector_cmd = SECTOR_CMD_NONE;
+            if (dev->state == STATE_0A_FIND_ID) {
+                dev->state = STATE_IDLE;
+                fdc_noidam(d86f_fdc);
+            } else {
+                dev->state = STATE_IDLE;
+                if (dev->id_found) {
+                    if (dev->error_condition & 0x18) {
+                        if ((dev->error_condition & 0x18) == 0x08)
+                            fdc_badcylinder(d86f_fdc);
+                        if ((dev->error_condition & 0x10) == 0x10)
+                            fdc_wrongcylinder(d86f_fdc);
+                        else
+                            fdc_nosector(d86f_fdc);
+                    } else
+                        fdc_nosector(d86f_fdc);
+                } else
+                    fdc_noidam(d86f_fdc);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* A new command may have been issued from the callbacks above,
+       in which case the bit level poll may be the one to service it. */
+    if ((dev->sector_cmd == SECTOR_CMD_NONE) && (dev->state != STATE_IDLE) &&
+        ((dev->state & 0x03) == 0x00) && !d86f_sector_mode(drive, side))
+        return;
+
+    /* Then work out when the next thing of interest happens. */
+    switch (dev->state) {
+        case STATE_IDLE:
+            /* Nothing to do but keep the disk spinning. */
+            d86f_sector_skip(drive, side, raw_size);
+            break;
+
+        case STATE_0A_FIND_ID:
+        case STATE_05_FIND_ID:
+        case STATE_06_FIND_ID:
+        case STATE_11_FIND_ID:
+        case STATE_16_FIND_ID:
+            dev->sector_target = d86f_sector_find(drive, side, &dist);
+            if (dev->sector_target) {
+                dev->sector_cmd = SECTOR_CMD_WAIT_ID;
+            } else {
+                /* Give up after the second index hole, like the bit level poll. */
+                dev->sector_cmd = SECTOR_CMD_NOT_FOUND;
+                dist            = (d86f_handler[drive].index_hole_pos(drive, side) + raw_size - dev->track_pos) % raw_size;
+                if (!dist)
+                    dist = raw_size;
+                dist += raw_size;
+            }
+            d86f_sector_skip(drive, side, dist);
+            break;
+
+        case STATE_05_WRITE_DATA:
+        case STATE_06_READ_DATA:
+        case STATE_11_SCAN_DATA:
+        case STATE_16_VERIFY_DATA:
+            /* The FDC finishes after the data field CRC and the gap. */
+            dev->sector_cmd = SECTOR_CMD_WAIT_DATA;
+            dist            = d86f_sector_distance(drive, side, dev->sector_target->data_end) + (fdc_get_gap(d86f_fdc) << 4);
+            d86f_sector_skip(drive, side, dist);
+            break;
+
+        default:
+            break;
+    }
+}
+
 void
 d86f_poll(int drive)
 {
@@ -2456,6 +2767,11 @@ d86f_poll(int drive)
         return;
     }
 
+    if (dev->sector_cmd || d86f_sector_mode(drive, side)) {
+        d86f_sector_poll(drive, side);
+        return;
+    }
+
     if ((dev->state != STATE_IDLE) && (dev->state != STATE_SECTOR_NOT_FOUND) && ((dev->state & 0xF8) != 0xE8)) {
         if (!d86f_can_read_address(drive))
             dev->state = STATE_SECTOR_NOT_FOUND;
@@ -2658,6 +2974,7 @@ d86f_prepare_pretrack(int drive, int side, int iso)
     dev->index_hole_pos[side] = 0;
 
     d86f_destroy_linked_lists(drive, side);
+    dev->sector_std[side] = 1;
 
     for (uint32_t i = 0; i < raw_size; i++)
         d86f_write_direct_common(drive, side, gap_fill, 0, i);
@@ -2692,13 +3009,12 @@ d86f_prepare_pretrack(int drive, int side, int iso)
     return pos;
 }
 
-uint16_t
-d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t *data_buf, int data_len, int gap2, int gap3, int flags)
+static uint16_t
+d86f_encode_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t *data_buf, int data_len, int gap2, int gap3, int flags, sector_t *s)
 {
     d86f_t   *dev = d86f[drive];
     uint16_t  pos;
     int       i;
-    sector_t *s;
 
     int      real_gap2_len = gap2;
     int      real_gap3_len = gap3;
@@ -2713,18 +3029,6 @@ d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t
     uint16_t dataam_mfm  = 0x4555;
     uint16_t datadam_mfm = 0x4A55;
 
-    if (fdd_get_turbo(drive) && (dev->version == 0x0063)) {
-        s = (sector_t *) calloc(1, sizeof(sector_t));
-        s->c     = id_buf[0];
-        s->h     = id_buf[1];
-        s->r     = id_buf[2];
-        s->n     = id_buf[3];
-        s->flags = flags;
-        if (dev->last_side_sector[side])
-            s->prev = dev->last_side_sector[side];
-        dev->last_side_sector[side] = s;
-    }
-
     mfm = d86f_is_mfm(drive);
 
     gap_fill = mfm ? 0x4E : 0xFF;
@@ -2764,6 +3068,8 @@ d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t
             d86f_write_direct_common(drive, side, dev->calc_crc.bytes[i], 0, pos);
             pos = (pos + 1) % raw_size;
         }
+        if (s)
+            s->id_end = pos;
         for (i = 0; i < real_gap2_len; i++) {
             d86f_write_direct_common(drive, side, gap_fill, 0, pos);
             pos = (pos + 1) % raw_size;
@@ -2798,6 +3104,8 @@ d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t
                     pos = (pos + 1) % raw_size;
                 }
             }
+            if (s)
+                s->data_end = pos;
             for (i = 0; i < real_gap3_len; i++) {
                 d86f_write_direct_common(drive, side, gap_fill, 0, pos);
                 pos = (pos + 1) % raw_size;
@@ -2808,6 +3116,35 @@ d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t
     return pos;
 }
 
+uint16_t
+d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t *data_buf, int data_len, int gap2, int gap3, int flags)
+{
+    d86f_t   *dev = d86f[drive];
+    sector_t *s   = NULL;
+
+    /* Keep a list of the sectors of proxied formats for turbo and sector-level modes. */
+    if (dev->version == 0x0063) {
+        s           = (sector_t *) calloc(1, sizeof(sector_t));
+        s->c        = id_buf[0];
+        s->h        = id_buf[1];
+        s->r        = id_buf[2];
+        s->n        = id_buf[3];
+        s->flags    = flags;
+        s->gap2     = gap2;
+        s->gap3     = gap3;
+        s->pos      = prev_pos;
+        s->data_len = (data_len > 0) ? data_len : 0;
+        if (dev->last_side_sector[side])
+            s->prev = dev->last_side_sector[side];
+        dev->last_side_sector[side] = s;
+
+        if (flags || (id_buf[3] > 7) || (data_len != (128 << id_buf[3])))
+            dev->sector_std[side] = 0;
+    }
+
+    return d86f_encode_sector(drive, side, prev_pos, id_buf, data_buf, data_len, gap2, gap3, flags, s);
+}
+
 /*
  * Note on handling of tracks on thick track drives:
  *
@@ -3218,8 +3555,10 @@ d86f_stop(int drive)
 {
     d86f_t *dev = d86f[drive];
 
-    if (dev)
+    if (dev) {
+        d86f_sector_resync(drive);
         dev->state = STATE_IDLE;
+    }
 }
 
 int
@@ -3227,6 +3566,8 @@ d86f_common_command(int drive, int sector, int track, int side, UNUSED(int rate)
 {
     d86f_t *dev = d86f[drive];
 
+    d86f_sector_resync(drive);
+
     d86f_log("d86f_common_command (drive %i): fdc_period=%i img_period=%i rate=%i sector=%i track=%i side=%i\n", drive, fdc_get_bitcell_period(d86f_fdc), d86f_get_bitcell_period(drive), rate, sector, track, side);
 
     dev->req_sector.id.c = track;
@@ -3279,6 +3620,8 @@ d86f_writesector(int drive, int sector, int track, int side, int rate, int secto
     d86f_t *dev = d86f[drive];
     int     ret = 0;
 
+    d86f_sector_resync(drive);
+
     if (writeprot[drive]) {
         fdc_writeprotect(d86f_fdc);
         dev->state       = STATE_IDLE;
@@ -3311,6 +3654,8 @@ d86f_readaddress(int drive, UNUSED(int side), UNUSED(int rate))
 {
     d86f_t *dev = d86f[drive];
 
+    d86f_sector_resync(drive);
+
     if (fdd_get_head(drive) && (d86f_get_sides(drive) == 1)) {
         fdc_noidam(d86f_fdc);
         dev->state       = STATE_IDLE;
@@ -3364,6 +3709,8 @@ d86f_common_format(int drive, int side, UNUSED(int rate), uint8_t fill, int prox
     uint16_t temp2;
     uint32_t array_size;
 
+    d86f_sector_resync(drive);
+
     if (writeprot[drive]) {
         fdc_writeprotect(d86f_fdc);
         dev->state       = STATE_IDLE;
@@ -0,0 +1,501 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Decoded floppy image cache.
+ *
+ *          Formats that have to decompress or parse the whole image on
+ *          insertion (Teledisk, ImageDisk) keep the decoded image here,
+ *          so swapping back and forth between the disks of a set only
+ *          decodes each of them once. Entries are keyed on the file name,
+ *          size and modification time, so a changed file is decoded anew.
+ *
+ *          When an image is inserted, the next one of its set (the same
+ *          name with the last number in it incremented, eg. DISK2.TD0
+ *          after DISK1.TD0) is decoded by a background thread, so it is
+ *          ready by the time it is asked for.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/fdd_cache.h>
+
+#define FDD_CACHE_ENTRIES  32
+#define FDD_CACHE_MAX_SIZE (64ULL << 20) /* decoded images not in use */
+#define FDD_CACHE_QUEUE    4
+
+typedef struct fdd_cache_entry_t {
+    const fdd_cache_ops_t *ops;
+    char                  *fn;
+    int                    flags;
+    int64_t                file_size;
+    int64_t                mtime;
+
+    void    *image;
+    size_t   size;
+    int      refs;
+    uint8_t  loading;
+    uint8_t  stale; /* the file has changed, drop once no longer in use */
+    uint32_t stamp;
+} fdd_cache_entry_t;
+
+typedef struct fdd_cache_request_t {
+    const fdd_cache_ops_t *ops;
+    char                  *fn;
+    int                    flags;
+} fdd_cache_request_t;
+
+static fdd_cache_entry_t   fdd_cache[FDD_CACHE_ENTRIES];
+static uint32_t            fdd_cache_stamp;
+static fdd_cache_request_t fdd_cache_queue[FDD_CACHE_QUEUE];
+static int                 fdd_cache_queued;
+static mutex_t            *fdd_cache_mutex;
+static mutex_t            *fdd_cache_decode_mutex;
+static event_t            *fdd_cache_loaded;
+static event_t            *fdd_cache_wake;
+static thread_t           *fdd_cache_thread;
+static volatile int        fdd_cache_quit;
+
+#ifdef ENABLE_FDD_CACHE_LOG
+int fdd_cache_do_log = ENABLE_FDD_CACHE_LOG;
+
+static void
+fdd_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (fdd_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define fdd_cache_log(fmt, ...)
+#endif
+
+/* Goes through the platform, which takes UTF-8 paths on every host. */
+static int
+fdd_cache_stat(const char *fn, int64_t *file_size, int64_t *mtime)
+{
+    uint64_t size;
+    int      is_dir;
+
+    if (!plat_stat(fn, &size, mtime, &is_dir) || is_dir)
+        return 0;
+
+    *file_size = (int64_t) size;
+
+    return 1;
+}
+
+static void
+fdd_cache_free_entry(fdd_cache_entry_t *e)
+{
+    if (e->image != NULL)
+        e->ops->free(e->image);
+    free(e->fn);
+    memset(e, 0x00, sizeof(fdd_cache_entry_t));
+}
+
+/* Called with the mutex held. */
+static fdd_cache_entry_t *
+fdd_cache_find(const fdd_cache_ops_t *ops, const char *fn, int flags)
+{
+    for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+        fdd_cache_entry_t *e = &fdd_cache[i];
+
+        if ((e->fn != NULL) && !e->stale && (e->ops == ops) && (e->flags == flags) && !strcmp(e->fn, fn))
+            return e;
+    }
+
+    return NULL;
+}
+
+/* Drops the least recently used images not in use, until the rest fit. Called with the mutex held. */
+static void
+fdd_cache_evict(int need_slot)
+{
+    fdd_cache_entry_t *lru;
+    uint64_t           idle_size;
+    int                used;
+
+    while (1) {
+        lru       = NULL;
+        idle_size = 0;
+        used      = 0;
+
+        for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+            fdd_cache_entry_t *e = &fdd_cache[i];
+
+            if (e->fn == NULL)
+                continue;
+            used++;
+            if (e->refs || e->loading)
+                continue;
+            idle_size += e->size;
+            if ((lru == NULL) || ((int32_t) (e->stamp - lru->stamp) < 0))
+                lru = e;
+        }
+
+        if ((lru == NULL) || ((idle_size <= FDD_CACHE_MAX_SIZE) && (!need_slot || (used < FDD_CACHE_ENTRIES))))
+            break;
+
+        fdd_cache_log("FDD cache: Dropping %s\n", lru->fn);
+        fdd_cache_free_entry(lru);
+    }
+}
+
+/* Claims an entry for an image about to be decoded. Called with the mutex held. */
+static fdd_cache_entry_t *
+fdd_cache_claim(const fdd_cache_ops_t *ops, const char *fn, int flags, int64_t file_size, int64_t mtime, int refs)
+{
+    fdd_cache_evict(1);
+
+    for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+        fdd_cache_entry_t *e = &fdd_cache[i];
+
+        if (e->fn == NULL) {
+            e->fn = strdup(fn);
+            if (e->fn == NULL)
+                return NULL;
+            e->ops       = ops;
+            e->flags     = flags;
+            e->file_size = file_size;
+            e->mtime     = mtime;
+            e->refs      = refs;
+            e->loading   = 1;
+            e->stamp     = ++fdd_cache_stamp;
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/* Decodes an image into a claimed entry. Called without the mutex held. */
+static void *
+fdd_cache_load(fdd_cache_entry_t *e)
+{
+    void  *image;
+    size_t size = 0;
+
+    /* Some of the decoders keep their state in globals. */
+    thread_wait_mutex(fdd_cache_decode_mutex);
+    image = e->ops->decode(e->fn, e->flags, &size);
+    thread_release_mutex(fdd_cache_decode_mutex);
+
+    thread_wait_mutex(fdd_cache_mutex);
+    e->loading = 0;
+    if (image == NULL) {
+        fdd_cache_log("FDD cache: Unable to decode %s\n", e->fn);
+        fdd_cache_free_entry(e);
+    } else {
+        fdd_cache_log("FDD cache: Decoded %s (%i bytes)\n", e->fn, (int) size);
+        e->image = image;
+        e->size  = size;
+        e->stamp = ++fdd_cache_stamp;
+        if (e->stale && !e->refs)
+            fdd_cache_free_entry(e);
+        else
+            fdd_cache_evict(0);
+    }
+    thread_release_mutex(fdd_cache_mutex);
+
+    thread_set_event(fdd_cache_loaded);
+
+    return image;
+}
+
+static void
+fdd_cache_init(void)
+{
+    if (fdd_cache_mutex != NULL)
+        return;
+
+    fdd_cache_mutex        = thread_create_mutex();
+    fdd_cache_decode_mutex = thread_create_mutex();
+    fdd_cache_loaded       = thread_create_event();
+    fdd_cache_wake         = thread_create_event();
+}
+
+/* Returns the decoded image of a file, decoding it if it is not in the cache yet. */
+void *
+fdd_cache_acquire(const fdd_cache_ops_t *ops, const char *fn, int flags)
+{
+    fdd_cache_entry_t *e;
+    int64_t            file_size;
+    int64_t            mtime;
+    size_t             size;
+    void              *image = NULL;
+
+    fdd_cache_init();
+
+    if (!fdd_cache_stat(fn, &file_size, &mtime)) {
+        /* Nothing to key it on, decode it without caching it. */
+        thread_wait_mutex(fdd_cache_decode_mutex);
+        image = ops->decode(fn, flags, &size);
+        thread_release_mutex(fdd_cache_decode_mutex);
+        return image;
+    }
+
+    thread_wait_mutex(fdd_cache_mutex);
+
+    while (1) {
+        e = fdd_cache_find(ops, fn, flags);
+
+        if ((e != NULL) && ((e->file_size != file_size) || (e->mtime != mtime))) {
+            /* The file has changed since it was decoded. */
+            if (e->refs || e->loading)
+                e->stale = 1;
+            else
+                fdd_cache_free_entry(e);
+            continue;
+        }
+
+        if ((e != NULL) && !e->loading) {
+            fdd_cache_log("FDD cache: Hit on %s\n", fn);
+            e->refs++;
+            e->stamp = ++fdd_cache_stamp;
+            image    = e->image;
+            break;
+        } else if (e != NULL) {
+            /* The prefetch thread is on it, wait for it. */
+            thread_reset_event(fdd_cache_loaded);
+            thread_release_mutex(fdd_cache_mutex);
+            thread_wait_event(fdd_cache_loaded, 10);
+            thread_wait_mutex(fdd_cache_mutex);
+        } else {
+            e = fdd_cache_claim(ops, fn, flags, file_size, mtime, 1);
+            thread_release_mutex(fdd_cache_mutex);
+
+            if (e == NULL) {
+                /* No room, decode it without caching it. */
+                thread_wait_mutex(fdd_cache_decode_mutex);
+                image = ops->decode(fn, flags, &size);
+                thread_release_mutex(fdd_cache_decode_mutex);
+                return image;
+            }
+
+            /* The entry is claimed with our reference already taken. */
+            return fdd_cache_load(e);
+        }
+    }
+
+    thread_release_mutex(fdd_cache_mutex);
+
+    return image;
+}
+
+void
+fdd_cache_release(const fdd_cache_ops_t *ops, void *image)
+{
+    fdd_cache_entry_t *e = NULL;
+
+    if (image == NULL)
+        return;
+
+    if (fdd_cache_mutex != NULL) {
+        thread_wait_mutex(fdd_cache_mutex);
+
+        for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+            if ((fdd_cache[i].fn != NULL) && (fdd_cache[i].image == image)) {
+                e = &fdd_cache[i];
+                break;
+            }
+        }
+
+        if (e != NULL) {
+            e->refs--;
+            if (!e->refs && e->stale)
+                fdd_cache_free_entry(e);
+            else
+                fdd_cache_evict(0);
+        }
+
+        thread_release_mutex(fdd_cache_mutex);
+
+        if (e != NULL)
+            return;
+    }
+
+    /* Not in the cache, decoded while it was full. */
+    ops->free(image);
+}
+
+/* Forgets a decoded image whose file is being written to. */
+void
+fdd_cache_invalidate(const fdd_cache_ops_t *ops, const char *fn)
+{
+    fdd_cache_entry_t *e;
+
+    if (fdd_cache_mutex == NULL)
+        return;
+
+    thread_wait_mutex(fdd_cache_mutex);
+    for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+        e = &fdd_cache[i];
+
+        if ((e->fn == NULL) || (e->ops != ops) || strcmp(e->fn, fn))
+            continue;
+
+        if (e->refs || e->loading)
+            e->stale = 1;
+        else
+            fdd_cache_free_entry(e);
+    }
+    thread_release_mutex(fdd_cache_mutex);
+}
+
+static void
+fdd_cache_thread_func(UNUSED(void *priv))
+{
+    fdd_cache_request_t req;
+    fdd_cache_entry_t  *e;
+    int64_t             file_size;
+    int64_t             mtime;
+
+    while (!fdd_cache_quit) {
+        thread_wait_event(fdd_cache_wake, -1);
+        thread_reset_event(fdd_cache_wake);
+
+        while (!fdd_cache_quit) {
+            e = NULL;
+
+            thread_wait_mutex(fdd_cache_mutex);
+            if (!fdd_cache_queued) {
+                thread_release_mutex(fdd_cache_mutex);
+                break;
+            }
+            req = fdd_cache_queue[0];
+            memmove(&fdd_cache_queue[0], &fdd_cache_queue[1], (--fdd_cache_queued) * sizeof(fdd_cache_request_t));
+
+            if (fdd_cache_stat(req.fn, &file_size, &mtime) && (fdd_cache_find(req.ops, req.fn, req.flags) == NULL))
+                e = fdd_cache_claim(req.ops, req.fn, req.flags, file_size, mtime, 0);
+            thread_release_mutex(fdd_cache_mutex);
+
+            if (e != NULL) {
+                fdd_cache_log("FDD cache: Prefetching %s\n", req.fn);
+                (void) fdd_cache_load(e);
+            }
+
+            free(req.fn);
+        }
+    }
+}
+
+/* Works out the name of the next image of a set, by incrementing the last number in the file name. */
+static int
+fdd_cache_next_name(const char *fn, char *next, size_t len)
+{
+    char       *name;
+    const char *ext;
+    char       *p;
+    char       *start;
+    int         digits;
+    unsigned    num;
+
+    if (strlen(fn) >= (len - 8))
+        return 0;
+    strcpy(next, fn);
+
+    name = path_get_filename(next);
+    ext  = path_get_extension(name);
+    p    = (ext != NULL) ? (char *) (ext - 1) : (name + strlen(name));
+
+    /* Find the last run of digits before the extension. */
+    while ((p > name) && !isdigit((unsigned char) p[-1]))
+        p--;
+    if (p == name)
+        return 0;
+    start = p;
+    while ((start > name) && isdigit((unsigned char) start[-1]))
+        start--;
+
+    digits = (int) (p - start);
+    if (digits > 4)
+        return 0;
+    num = (unsigned) strtoul(start, NULL, 10) + 1;
+
+    snprintf(start, len - (start - next), "%0*u%s", digits, num, fn + (p - next));
+
+    return 1;
+}
+
+/* Queues the next image of the set an image belongs to for decoding in the background. */
+void
+fdd_cache_prefetch_next(const fdd_cache_ops_t *ops, const char *fn, int flags)
+{
+    char    next[1024];
+    int64_t file_size;
+    int64_t mtime;
+
+    if (!fdd_cache_next_name(fn, next, sizeof(next)) || !fdd_cache_stat(next, &file_size, &mtime))
+        return;
+
+    fdd_cache_init();
+
+    thread_wait_mutex(fdd_cache_mutex);
+    if ((fdd_cache_find(ops, next, flags) == NULL) && (fdd_cache_queued < FDD_CACHE_QUEUE)) {
+        fdd_cache_queue[fdd_cache_queued].ops   = ops;
+        fdd_cache_queue[fdd_cache_queued].fn    = strdup(next);
+        fdd_cache_queue[fdd_cache_queued].flags = flags;
+        if (fdd_cache_queue[fdd_cache_queued].fn != NULL)
+            fdd_cache_queued++;
+    }
+    thread_release_mutex(fdd_cache_mutex);
+
+    if (fdd_cache_thread == NULL) {
+        fdd_cache_quit   = 0;
+        fdd_cache_thread = thread_create(fdd_cache_thread_func, NULL);
+    }
+    thread_set_event(fdd_cache_wake);
+}
+
+void
+fdd_cache_close(void)
+{
+    if (fdd_cache_mutex == NULL)
+        return;
+
+    if (fdd_cache_thread != NULL) {
+        fdd_cache_quit = 1;
+        thread_set_event(fdd_cache_wake);
+        thread_wait(fdd_cache_thread);
+        fdd_cache_thread = NULL;
+    }
+
+    for (int i = 0; i < fdd_cache_queued; i++)
+        free(fdd_cache_queue[i].fn);
+    fdd_cache_queued = 0;
+
+    for (int i = 0; i < FDD_CACHE_ENTRIES; i++) {
+        if (fdd_cache[i].fn != NULL)
+            fdd_cache_free_entry(&fdd_cache[i]);
+    }
+
+    thread_destroy_event(fdd_cache_wake);
+    thread_destroy_event(fdd_cache_loaded);
+    thread_close_mutex(fdd_cache_decode_mutex);
+    thread_close_mutex(fdd_cache_mutex);
+    fdd_cache_mutex = NULL;
+}
@@ -29,6 +29,7 @@
 #include <86box/fdd.h>
 #include <86box/fdd_86f.h>
 #include <86box/fdd_imd.h>
+#include <86box/fdd_cache.h>
 #include <86box/fdc.h>
 
 typedef struct imd_track_t {
@@ -51,6 +52,8 @@ typedef struct imd_track_t {
 typedef struct imd_t {
     FILE       *fp;
     char       *buffer;
+    uint32_t    buffer_size;
+    uint8_t     read_only; /* has compressed or missing sectors */
     uint32_t    start_offs;
     int         track_count;
     int         sides;
@@ -68,6 +71,8 @@ typedef struct imd_t {
 static imd_t *imd[FDD_NUM];
 static fdc_t *imd_fdc;
 
+static const fdd_cache_ops_t imd_cache_ops;
+
 #ifdef ENABLE_IMD_LOG
 int imd_do_log = ENABLE_IMD_LOG;
 
@@ -524,6 +529,9 @@ imd_writeback(int drive)
     if (writeprot[drive])
         return;
 
+    /* The image in the cache no longer matches the file. */
+    fdd_cache_invalidate(&imd_cache_ops, floppyfns[drive]);
+
     for (int side = 0; side < dev->sides; side++) {
         if (dev->tracks[track][side].is_present) {
             fseek(dev->fp, dev->tracks[track][side].file_offs, SEEK_SET);
@@ -604,13 +612,24 @@ imd_init(void)
     memset(imd, 0x00, sizeof(imd));
 }
 
-void
-imd_load(int drive, char *fn)
+static void
+imd_free(void *image)
+{
+    imd_t *dev = (imd_t *) image;
+
+    free(dev->buffer);
+    free(dev);
+}
+
+/* Reads and parses a whole image, without reference to a drive so it can be done in the background. */
+static void *
+imd_decode(const char *fn, UNUSED(int flags), size_t *size)
 {
     uint32_t    magic = 0;
     uint32_t    fsize = 0;
     const char *buffer;
     const char *buffer2;
+    FILE       *fp;
     imd_t      *dev;
     int         track_spt    = 0;
     int         sector_size  = 0;
@@ -630,65 +649,63 @@ imd_load(int drive, char *fn)
     int         size_diff;
     int         gap_sum;
 
-    d86f_unregister(drive);
-
-    writeprot[drive] = 0;
-
-    /* Allocate a drive block. */
-    dev = (imd_t *) calloc(1, sizeof(imd_t));
+    fp = plat_fopen(fn, "rb");
+    if (fp == NULL)
+        return NULL;
 
-    dev->fp = plat_fopen(fn, "rb+");
-    if (dev->fp == NULL) {
-        dev->fp = plat_fopen(fn, "rb");
-        if (dev->fp == NULL) {
-            memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-            free(dev);
-            return;
-        }
-        writeprot[drive] = 1;
+    /* This may run in the background on an image that was never selected,
+       so errors fail the decode rather than the emulator. */
+    if ((fseek(fp, 0, SEEK_SET) == -1) || (fread(&magic, 1, 4, fp) != 4)) {
+        imd_log("IMD: Error reading the magic number\n");
+        fclose(fp);
+        return NULL;
     }
-
-    if (ui_writeprot[drive])
-        writeprot[drive] = 1;
-    fwriteprot[drive] = writeprot[drive];
-
-    if (fseek(dev->fp, 0, SEEK_SET) == -1)
-        fatal("imd_load(): Error seeking to the beginning of the file\n");
-    if (fread(&magic, 1, 4, dev->fp) != 4)
-        fatal("imd_load(): Error reading the magic number\n");
     if (magic != 0x20444D49) {
         imd_log("IMD: Not a valid ImageDisk image\n");
-        fclose(dev->fp);
-        free(dev);
-        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-        return;
+        fclose(fp);
+        return NULL;
     } else
         imd_log("IMD: Valid ImageDisk image\n");
 
-    if (fseek(dev->fp, 0, SEEK_END) == -1)
-        fatal("imd_load(): Error seeking to the end of the file\n");
-    fsize = ftell(dev->fp);
+    if (fseek(fp, 0, SEEK_END) == -1) {
+        imd_log("IMD: Error seeking to the end of the file\n");
+        fclose(fp);
+        return NULL;
+    }
+    fsize = ftell(fp);
     if (fsize <= 0) {
         imd_log("IMD: Too small ImageDisk image\n");
-        fclose(dev->fp);
-        free(dev);
-        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-        return;
+        fclose(fp);
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_SET) == -1) {
+        imd_log("IMD: Error seeking to the beginning of the file again\n");
+        fclose(fp);
+        return NULL;
+    }
+
+    /* Allocate a drive block. */
+    dev = (imd_t *) calloc(1, sizeof(imd_t));
+    if (dev == NULL) {
+        fclose(fp);
+        return NULL;
     }
-    if (fseek(dev->fp, 0, SEEK_SET) == -1)
-        fatal("imd_load(): Error seeking to the beginning of the file again\n");
-    dev->buffer = malloc(fsize);
-    if (fread(dev->buffer, 1, fsize, dev->fp) != fsize)
-        fatal("imd_load(): Error reading data\n");
+    dev->buffer      = malloc(fsize);
+    dev->buffer_size = fsize;
+    if ((dev->buffer == NULL) || (fread(dev->buffer, 1, fsize, fp) != fsize)) {
+        imd_log("IMD: Error reading data\n");
+        fclose(fp);
+        imd_free(dev);
+        return NULL;
+    }
+    fclose(fp);
     buffer = dev->buffer;
 
     buffer2 = memchr(buffer, 0x1A, fsize);
     if (buffer2 == NULL) {
         imd_log("IMD: No ASCII EOF character\n");
-        fclose(dev->fp);
-        free(dev);
-        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-        return;
+        imd_free(dev);
+        return NULL;
     } else {
         imd_log("IMD: ASCII EOF character found at offset %08X\n", buffer2 - buffer);
     }
@@ -696,10 +713,8 @@ imd_load(int drive, char *fn)
     buffer2++;
     if ((buffer2 - buffer) == fsize) {
         imd_log("IMD: File ends after ASCII EOF character\n");
-        fclose(dev->fp);
-        free(dev);
-        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-        return;
+        imd_free(dev);
+        return NULL;
     } else {
         imd_log("IMD: File continues after ASCII EOF character\n");
     }
@@ -709,9 +724,6 @@ imd_load(int drive, char *fn)
     dev->track_count = 0;
     dev->sides       = 1;
 
-    /* Set up the drive unit. */
-    imd[drive] = dev;
-
     while (1) {
         imd_log("In : %02X %02X %02X %02X %02X\n",
                 buffer2[0], buffer2[1], buffer2[2], buffer2[3], buffer2[4]);
@@ -790,17 +802,14 @@ imd_load(int drive, char *fn)
                     /* Invalid sector data type, possibly a malformed HxC IMG image (it outputs data errored
                        sectors with a variable amount of bytes, against the specification). */
                     imd_log("IMD: Invalid sector data type %02X\n", dev->buffer[dev->tracks[track][side].sector_data_offs[i]]);
-                    fclose(dev->fp);
-                    free(dev);
-                    imd[drive] = NULL;
-                    memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-                    return;
+                    imd_free(dev);
+                    return NULL;
                 }
                 if (buffer[dev->tracks[track][side].sector_data_offs[i]] != 0)
                     dev->tracks[track][side].sector_data_size[i] += (buffer[dev->tracks[track][side].sector_data_offs[i]] & 1) ? data_size : 1;
                 last_offset += dev->tracks[track][side].sector_data_size[i];
                 if (!(buffer[dev->tracks[track][side].sector_data_offs[i]] & 1))
-                    fwriteprot[drive] = writeprot[drive] = 1;
+                    dev->read_only = 1;
                 type = dev->buffer[dev->tracks[track][side].sector_data_offs[i]];
                 if (type != 0x00) {
                     type = ((type - 1) >> 1) & 7;
@@ -822,17 +831,14 @@ imd_load(int drive, char *fn)
                     /* Invalid sector data type, possibly a malformed HxC IMG image (it outputs data errored
                        sectors with a variable amount of bytes, against the specification). */
                     imd_log("IMD: Invalid sector data type %02X\n", dev->buffer[dev->tracks[track][side].sector_data_offs[i]]);
-                    fclose(dev->fp);
-                    free(dev);
-                    imd[drive] = NULL;
-                    memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-                    return;
+                    imd_free(dev);
+                    return NULL;
                 }
                 if (buffer[dev->tracks[track][side].sector_data_offs[i]] != 0)
                     dev->tracks[track][side].sector_data_size[i] += (buffer[dev->tracks[track][side].sector_data_offs[i]] & 1) ? data_size : 1;
                 last_offset += dev->tracks[track][side].sector_data_size[i];
                 if (!(buffer[dev->tracks[track][side].sector_data_offs[i]] & 1))
-                    fwriteprot[drive] = writeprot[drive] = 1;
+                    dev->read_only = 1;
                 type = dev->buffer[dev->tracks[track][side].sector_data_offs[i]];
                 if (type != 0x00) {
                     type = ((type - 1) >> 1) & 7;
@@ -871,11 +877,8 @@ imd_load(int drive, char *fn)
                 if (size_diff < gap_sum) {
                     /* If we can't fit the sectors with a reasonable minimum gap even at 2% slower RPM, abort. */
                     imd_log("IMD: Unable to fit the %i sectors in a track\n", track_spt);
-                    fclose(dev->fp);
-                    free(dev);
-                    imd[drive] = NULL;
-                    memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-                    return;
+                    imd_free(dev);
+                    return NULL;
                 }
             }
 
@@ -932,6 +935,58 @@ imd_load(int drive, char *fn)
     imd_log("%i tracks, %i sides\n", dev->track_count, dev->sides);
 #endif
 
+    *size = sizeof(imd_t) + fsize;
+
+    return dev;
+}
+
+static const fdd_cache_ops_t imd_cache_ops = {
+    .name   = "IMD",
+    .decode = imd_decode,
+    .free   = imd_free
+};
+
+void
+imd_load(int drive, char *fn)
+{
+    imd_t *image;
+    imd_t *dev;
+
+    d86f_unregister(drive);
+
+    writeprot[drive] = 0;
+
+    image = (imd_t *) fdd_cache_acquire(&imd_cache_ops, fn, 0);
+    if (image == NULL) {
+        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
+        return;
+    }
+
+    /* The image can be written to, so the drive gets its own copy of the parsed one. */
+    dev         = (imd_t *) malloc(sizeof(imd_t));
+    memcpy(dev, image, sizeof(imd_t));
+    dev->buffer = malloc(image->buffer_size);
+    memcpy(dev->buffer, image->buffer, image->buffer_size);
+    fdd_cache_release(&imd_cache_ops, image);
+
+    dev->fp = plat_fopen(fn, "rb+");
+    if (dev->fp == NULL) {
+        dev->fp = plat_fopen(fn, "rb");
+        if (dev->fp == NULL) {
+            memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
+            imd_free(dev);
+            return;
+        }
+        writeprot[drive] = 1;
+    }
+
+    if (ui_writeprot[drive] || dev->read_only)
+        writeprot[drive] = 1;
+    fwriteprot[drive] = writeprot[drive];
+
+    /* Set up the drive unit. */
+    imd[drive] = dev;
+
     /* Attach this format to the D86F engine. */
     d86f_handler[drive].disk_flags        = disk_flags;
     d86f_handler[drive].side_flags        = side_flags;
@@ -946,11 +1001,15 @@ imd_load(int drive, char *fn)
     d86f_handler[drive].index_hole_pos    = null_index_hole_pos;
     d86f_handler[drive].get_raw_size      = common_get_raw_size;
     d86f_handler[drive].check_crc         = 1;
+    d86f_handler[drive].sector_level      = 1;
     d86f_set_version(drive, 0x0063);
 
     drives[drive].seek = imd_seek;
 
     d86f_common_handlers(drive);
+
+    /* Have the next disk of the set ready for when it is inserted. */
+    fdd_cache_prefetch_next(&imd_cache_ops, fn, 0);
 }
 
 void
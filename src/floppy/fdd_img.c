@@ -1253,6 +1253,7 @@ jump_if_fdf:
     d86f_handler[drive].index_hole_pos    = null_index_hole_pos;
     d86f_handler[drive].get_raw_size      = common_get_raw_size;
     d86f_handler[drive].check_crc         = 1;
+    d86f_handler[drive].sector_level      = 1;
     d86f_set_version(drive, 0x0063);
 
     drives[drive].seek = img_seek;
@@ -41,6 +41,7 @@
 #include <86box/fdd.h>
 #include <86box/fdd_86f.h>
 #include <86box/fdd_td0.h>
+#include <86box/fdd_cache.h>
 #include <86box/fdc.h>
 #include "lzw/lzw.h"
 
@@ -129,6 +130,9 @@ typedef struct td0_t {
     uint8_t *imagebuf;
 
     uint8_t *processed_buf;
+    uint32_t processed_size;
+
+    void *image; /* decoded image in the cache this one was copied from */
 } td0_t;
 
 /*
@@ -225,23 +229,30 @@ td0_log(const char *fmt, ...)
 #    define td0_log(fmt, ...)
 #endif
 
-static void
-fdd_image_read(int drive, char *buffer, uint32_t offset, uint32_t len)
+/* Images may be decoded in the background without having been selected,
+   so read errors fail the decode rather than the emulator. */
+static int
+fdd_image_read(td0_t *dev, char *buffer, uint32_t offset, uint32_t len)
 {
-    td0_t *dev = td0[drive];
+    if (fseek(dev->fp, offset, SEEK_SET) == -1) {
+        td0_log("TD0: Error seeking to offset %08X\n", offset);
+        return 0;
+    }
+    if (fread(buffer, 1, len, dev->fp) != len) {
+        td0_log("TD0: Error reading %u bytes at offset %08X\n", len, offset);
+        return 0;
+    }
 
-    if (fseek(dev->fp, offset, SEEK_SET) == -1)
-        fatal("fdd_image_read(): Error seeking to the beginning of the file\n");
-    if (fread(buffer, 1, len, dev->fp) != len)
-        fatal("fdd_image_read(): Error reading data\n");
+    return 1;
 }
 
 static int
-dsk_identify(int drive)
+dsk_identify(td0_t *dev)
 {
     char header[2];
 
-    fdd_image_read(drive, header, 0, 2);
+    if (!fdd_image_read(dev, header, 0, 2))
+        return 0;
     if (header[0] == 'T' && header[1] == 'D')
         return 1;
     else if (header[0] == 't' && header[1] == 'd')
@@ -259,10 +270,12 @@ state_data_read(td0dsk_t *state, uint8_t *buf, uint16_t size)
     image_size = ftell(state->fdd_file);
     if (size > image_size - state->fdd_file_offset)
         size = (image_size - state->fdd_file_offset) & 0xffff;
-    if (fseek(state->fdd_file, state->fdd_file_offset, SEEK_SET) == -1)
-        fatal("TD0: Failed to seek in state_data_read()\n");
-    if (fread(buf, 1, size, state->fdd_file) != size)
-        fatal("TD0: Error reading data in state_data_read()\n");
+    /* A read error ends the compressed data early, like the end of the file. */
+    if ((fseek(state->fdd_file, state->fdd_file_offset, SEEK_SET) == -1) ||
+        (fread(buf, 1, size, state->fdd_file) != size)) {
+        td0_log("TD0: Error reading data in state_data_read()\n");
+        return 0;
+    }
     state->fdd_file_offset += size;
 
     return size;
@@ -596,9 +609,8 @@ get_raw_tsize(int side_flags, int slower_rpm)
 }
 
 static int
-td0_initialize(int drive)
+td0_initialize(td0_t *dev, int turbo)
 {
-    td0_t         *dev = td0[drive];
     uint8_t        header[12];
     int            fm;
     int            head;
@@ -648,8 +660,8 @@ td0_initialize(int drive)
         return 0;
     }
 
-    fseek(dev->fp, 0, SEEK_SET);
-    (void) !fread(header, 1, 12, dev->fp);
+    if (!fdd_image_read(dev, (char *) header, 0, 12))
+        return 0;
     head_count = header[9];
 
     if (header[0] == 't') {
@@ -661,18 +673,14 @@ td0_initialize(int drive)
             state_Decode(&disk_decode, dev->imagebuf, TD0_MAX_BUFSZ);
         } else {
             td0_log("TD0: File is compressed (TeleDisk 1.x, LZW)\n");
-            if (fseek(dev->fp, 12, SEEK_SET) == -1)
-                fatal("td0_initialize(): Error seeking to offet 12\n");
-            if (fread(dev->lzw_buf, 1, file_size - 12, dev->fp) != (file_size - 12))
-                fatal("td0_initialize(): Error reading LZW-encoded buffer\n");
+            if (!fdd_image_read(dev, (char *) dev->lzw_buf, 12, file_size - 12))
+                return 0;
             LZWDecodeFile((char *) dev->imagebuf, (char *) dev->lzw_buf, NULL, file_size - 12);
         }
     } else {
         td0_log("TD0: File is uncompressed\n");
-        if (fseek(dev->fp, 12, SEEK_SET) == -1)
-            fatal("td0_initialize(): Error seeking to offet 12\n");
-        if (fread(dev->imagebuf, 1, file_size - 12, dev->fp) != (file_size - 12))
-            fatal("td0_initialize(): Error reading image buffer\n");
+        if (!fdd_image_read(dev, (char *) dev->imagebuf, 12, file_size - 12))
+            return 0;
     }
 
     if (header[7] & 0x80)
@@ -858,9 +866,9 @@ td0_initialize(int drive)
                 /* Set disk flags so that rotation speed is 2% slower. */
                 dev->disk_flags |= (3 << 5);
                 size_diff = raw_tsize - track_size;
-                if ((size_diff < gap_sum) && !fdd_get_turbo(drive)) {
+                if ((size_diff < gap_sum) && !turbo) {
                     /* If we can't fit the sectors with a reasonable minimum gap even at 2% slower RPM, abort. */
-                    td0_log("TD0: Unable to fit the %i sectors into drive %i, track %i, side %i\n", track_spt_adjusted, drive, track, head);
+                    td0_log("TD0: Unable to fit the %i sectors into track %i, side %i\n", track_spt_adjusted, track, head);
                     return 0;
                 }
             }
@@ -888,7 +896,8 @@ td0_initialize(int drive)
     if (dev->tracks <= 43)
         dev->track_width &= ~1;
 
-    dev->sides = head_count;
+    dev->sides          = head_count;
+    dev->processed_size = total_size;
 
     dev->current_side_flags[0] = dev->side_flags[0][0];
     dev->current_side_flags[1] = dev->side_flags[0][1];
@@ -1079,7 +1088,7 @@ td0_seek(int drive, int track)
     int     fm;
     int     sector_adjusted;
 
-    if (dev->fp == NULL)
+    if (dev->processed_buf == NULL)
         return;
 
     if (!dev->track_width && fdd_doublestep_40(drive))
@@ -1188,47 +1197,44 @@ td0_init(void)
     memset(td0, 0x00, sizeof(td0));
 }
 
-void
-td0_abort(int drive)
+static void
+td0_free(void *image)
 {
-    td0_t *dev = td0[drive];
+    td0_t *dev = (td0_t *) image;
 
+    if (dev->lzw_buf)
+        free(dev->lzw_buf);
     if (dev->imagebuf)
         free(dev->imagebuf);
     if (dev->processed_buf)
         free(dev->processed_buf);
     if (dev->fp)
         fclose(dev->fp);
-    memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
     free(dev);
-    td0[drive] = NULL;
 }
 
-void
-td0_load(int drive, char *fn)
+/* Decodes a whole image, without reference to a drive so it can be done in the background. */
+static void *
+td0_decode(const char *fn, int flags, size_t *size)
 {
     td0_t   *dev;
+    uint8_t *buf;
     uint32_t i;
 
-    d86f_unregister(drive);
-
-    writeprot[drive] = 1;
-
     dev = (td0_t *) calloc(1, sizeof(td0_t));
-    td0[drive] = dev;
+    if (dev == NULL)
+        return NULL;
 
     dev->fp = plat_fopen(fn, "rb");
     if (dev->fp == NULL) {
-        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
-        return;
+        free(dev);
+        return NULL;
     }
 
-    fwriteprot[drive] = writeprot[drive];
-
-    if (!dsk_identify(drive)) {
+    if (!dsk_identify(dev)) {
         td0_log("TD0: Not a valid Teledisk image\n");
-        td0_abort(drive);
-        return;
+        td0_free(dev);
+        return NULL;
     } else {
         td0_log("TD0: Valid Teledisk image\n");
     }
@@ -1239,14 +1245,80 @@ td0_load(int drive, char *fn)
     dev->imagebuf = (uint8_t *) calloc(1, i);
     dev->processed_buf = (uint8_t *) calloc(1, i);
 
-    if (!td0_initialize(drive)) {
+    if ((dev->lzw_buf == NULL) || (dev->imagebuf == NULL) || (dev->processed_buf == NULL) ||
+        !td0_initialize(dev, flags)) {
         td0_log("TD0: Failed to initialize\n");
-        td0_abort(drive);
-        return;
+        td0_free(dev);
+        return NULL;
     } else {
         td0_log("TD0: Initialized successfully\n");
     }
 
+    /* Only the sector data is needed from now on, trim it to size. */
+    free(dev->lzw_buf);
+    free(dev->imagebuf);
+    dev->lzw_buf = dev->imagebuf = NULL;
+    fclose(dev->fp);
+    dev->fp = NULL;
+
+    buf = (uint8_t *) malloc(dev->processed_size ? dev->processed_size : 1);
+    if (buf != NULL) {
+        memcpy(buf, dev->processed_buf, dev->processed_size);
+        for (uint16_t j = 0; j < 256; j++) {
+            for (uint8_t k = 0; k < 2; k++) {
+                for (uint16_t l = 0; l < 256; l++) {
+                    if (dev->sects[j][k][l].data != NULL)
+                        dev->sects[j][k][l].data = buf + (dev->sects[j][k][l].data - dev->processed_buf);
+                }
+            }
+        }
+        free(dev->processed_buf);
+        dev->processed_buf = buf;
+    }
+
+    *size = sizeof(td0_t) + dev->processed_size;
+
+    return dev;
+}
+
+static const fdd_cache_ops_t td0_cache_ops = {
+    .name   = "TD0",
+    .decode = td0_decode,
+    .free   = td0_free
+};
+
+void
+td0_load(int drive, char *fn)
+{
+    td0_t *image;
+    td0_t *dev;
+    int    turbo = fdd_get_turbo(drive);
+
+    d86f_unregister(drive);
+
+    writeprot[drive] = 1;
+
+    /* Teledisk images are read-only, so a decoded one can be shared. */
+    image = (td0_t *) fdd_cache_acquire(&td0_cache_ops, fn, turbo);
+    if (image == NULL) {
+        td0_log("TD0: Unable to load image\n");
+        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
+        return;
+    }
+
+    dev = (td0_t *) malloc(sizeof(td0_t));
+    if (dev == NULL) {
+        td0_log("TD0: Unable to allocate the drive state\n");
+        fdd_cache_release(&td0_cache_ops, image);
+        memset(floppyfns[drive], 0, sizeof(floppyfns[drive]));
+        return;
+    }
+    memcpy(dev, image, sizeof(td0_t));
+    dev->image = image;
+    td0[drive] = dev;
+
+    fwriteprot[drive] = writeprot[drive];
+
     /* Attach this format to the D86F engine. */
     d86f_handler[drive].disk_flags        = disk_flags;
     d86f_handler[drive].side_flags        = side_flags;
@@ -1266,6 +1338,9 @@ td0_load(int drive, char *fn)
     drives[drive].seek = td0_seek;
 
     d86f_common_handlers(drive);
+
+    /* Have the next disk of the set ready for when it is inserted. */
+    fdd_cache_prefetch_next(&td0_cache_ops, fn, turbo);
 }
 
 void
@@ -1278,30 +1353,8 @@ td0_close(int drive)
 
     d86f_unregister(drive);
 
-    if (dev->lzw_buf)
-        free(dev->lzw_buf);
-    if (dev->imagebuf)
-        free(dev->imagebuf);
-    if (dev->processed_buf)
-        free(dev->processed_buf);
-
-    for (uint16_t i = 0; i < 256; i++) {
-        for (uint8_t j = 0; j < 2; j++) {
-            for (uint16_t k = 0; k < 256; k++)
-                dev->sects[i][j][k].data = NULL;
-        }
-    }
-
-    for (uint16_t i = 0; i < 256; i++) {
-        memset(dev->side_flags[i], 0, 4);
-        memset(dev->track_in_file[i], 0, 2);
-        memset(dev->calculated_gap3_lengths[i], 0, 2);
-        for (uint8_t j = 0; j < 2; j++)
-            memset(dev->sects[i][j], 0, sizeof(td0_sector_t));
-    }
-
-    if (dev->fp != NULL)
-        fclose(dev->fp);
+    /* The sector data belongs to the cached image. */
+    fdd_cache_release(&td0_cache_ops, dev->image);
 
     /* Release resources. */
     free(dev);
@@ -0,0 +1,37 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CHD (MAME compressed hunks of data) CD-ROM image back-end
+ *          header.
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#ifndef CDROM_IMAGE_CHD_H
+#define CDROM_IMAGE_CHD_H
+
+/* A track as described by the CHD metadata. */
+typedef struct chd_track_t {
+    int  number;
+    int  frames;         /* Frames stored in the CHD, including a stored pre-gap. */
+    int  pregap;
+    int  pregap_in_file; /* Pre-gap data is stored in the CHD. */
+    int  postgap;
+    int  raw_subcode;    /* Raw interleaved P-W subchannel data is stored. */
+    char type[16];       /* Track type in Cue sheet notation, eg. MODE1/2048. */
+} chd_track_t;
+
+/* CHD functions. */
+extern void         *chd_image_open(const uint8_t id, const char *filename, int *tracks_num);
+extern int           chd_image_get_track(void *chd, int track, chd_track_t *info);
+extern track_file_t *chd_track_init(const uint8_t id, void *chd, int track,
+                                    uint32_t sector_size, int *error);
+extern void          chd_image_release(void *chd);
+
+#endif /*CDROM_IMAGE_CHD_H*/
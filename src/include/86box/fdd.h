@@ -110,6 +110,9 @@ extern int  fdd_hole(int drive);
 extern void fdd_stop(int drive);
 extern void fdd_do_writeback(int drive);
 
+extern void     fdd_poll_skip(int drive, uint32_t periods);
+extern uint32_t fdd_poll_resync(int drive);
+
 extern int      motorspin;
 extern uint64_t motoron[FDD_NUM];
 
@@ -144,6 +147,7 @@ typedef struct d86f_handler_t {
     uint32_t (*get_raw_size)(int drive, int side);
 
     uint8_t check_crc;
+    uint8_t sector_level; /* Standard layout, data commands may be serviced a sector at a time. */
 } d86f_handler_t;
 
 extern const int gap3_sizes[5][8][48];
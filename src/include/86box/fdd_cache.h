@@ -0,0 +1,36 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the decoded floppy image cache.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#ifndef EMU_FLOPPY_CACHE_H
+#define EMU_FLOPPY_CACHE_H
+
+/* A format whose images are worth keeping decoded in memory. */
+typedef struct fdd_cache_ops_t {
+    const char *name;
+
+    /* Decodes an image, may be called from the prefetch thread. Returns
+       the decoded image and its size in memory, or NULL on failure. */
+    void *(*decode)(const char *fn, int flags, size_t *size);
+    void  (*free)(void *image);
+} fdd_cache_ops_t;
+
+extern void *fdd_cache_acquire(const fdd_cache_ops_t *ops, const char *fn, int flags);
+extern void  fdd_cache_release(const fdd_cache_ops_t *ops, void *image);
+extern void  fdd_cache_invalidate(const fdd_cache_ops_t *ops, const char *fn);
+extern void  fdd_cache_prefetch_next(const fdd_cache_ops_t *ops, const char *fn, int flags);
+extern void  fdd_cache_close(void);
+
+#endif /*EMU_FLOPPY_CACHE_H*/
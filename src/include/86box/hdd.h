@@ -87,6 +87,8 @@ enum {
 #define HDD_MAX_ZONES     16
 #define HDD_MAX_CACHE_SEG 16
 
+#define HDD_HOST_CACHE_MAX 1048576 /* kB */
+
 typedef struct hdd_preset_t {
     const char *name;
     const char *internal_name;
@@ -181,6 +183,8 @@ typedef struct hard_disk_t {
     uint32_t           cur_track;
     uint32_t           cur_addr;
     uint32_t           vhd_blocksize;
+    int32_t            host_cache;   /* Host cache size in kB,
+                                        0 = disabled (the default). */
 
     uint8_t            max_multiple_block;
     uint8_t            pad1[3];
@@ -214,6 +218,7 @@ extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uin
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count);
 extern int      hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count);
+extern int      hdd_image_flush(uint8_t id);
 extern uint32_t hdd_image_get_last_sector(uint8_t id);
 extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
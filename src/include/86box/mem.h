@@ -134,6 +134,21 @@
 #define MEM_GRANULARITY_PAGE   (MEM_GRANULARITY_MASK & ~0xfff)
 #define MEM_GRANULARITY_BASE   (~MEM_GRANULARITY_MASK)
 
+/* Host page backing for guest RAM. */
+#define MEM_HUGE_PAGES_NONE        0
+#define MEM_HUGE_PAGES_TRANSPARENT 1 /* Transparent huge pages (madvise). */
+#define MEM_HUGE_PAGES_EXPLICIT    2 /* Reserved huge pages (hugetlbfs, Windows large pages). */
+#define MEM_HUGE_PAGE_SIZE         (2 << 20)
+
+/* Software TLB geometry. */
+#define TLB_WAYS               4
+#define TLB_MIN_SIZE           256
+#define TLB_MAX_SIZE           16384
+#define TLB_DEFAULT_SIZE       1024
+
+#define TLB_FLAG_GLOBAL        1 /* Filled from a global page with CR4.PGE set. */
+#define TLB_FLAG_LARGE         2 /* Filled from a 4 MB (or 2 MB PAE) page. */
+
 /* Compatibility #defines. */
 #define mem_set_state(smm, mode, base, size, access) \
     mem_set_access((smm ? ACCESS_SMM : ACCESS_NORMAL), mode, base, size, access)
@@ -158,6 +173,16 @@
 #define mem_set_access_smram_bus(smm, base, size, is_smram) \
     mem_set_access((smm ? ACCESS_BUS_SMM : ACCESS_BUS), 1, base, size, is_smram)
 
+typedef struct tlb_stats_t {
+    uint64_t read_misses;
+    uint64_t write_misses;
+    uint64_t evictions;
+    uint64_t flushes;
+    uint64_t flushes_cr3;
+    uint64_t global_kept;
+    uint64_t invlpg;
+} tlb_stats_t;
+
 typedef struct state_t {
     uint16_t x : 5;
     uint16_t w : 5;
@@ -264,14 +289,12 @@ extern uint8_t *rom;
 extern uint32_t biosmask;
 extern uint32_t biosaddr;
 
-extern int        readlookup[256];
+extern int       *readlookup;
 extern uintptr_t *readlookup2;
 extern uintptr_t  old_rl2;
 extern uint8_t    uncached;
-extern int        readlnext;
-extern int        writelookup[256];
+extern int       *writelookup;
 extern uintptr_t *writelookup2;
-extern int        writelnext;
 extern uint32_t   ram_mapped_addr[64];
 extern uint8_t    page_ff[4096];
 
@@ -297,6 +320,10 @@ extern int shadowbios;
 extern int shadowbios_write;
 extern int readlnum;
 extern int writelnum;
+extern int cachesize; /* (C) software TLB entries */
+extern int mem_huge_pages; /* (C) host huge pages for guest RAM */
+
+extern tlb_stats_t tlb_stats;
 
 extern int memspeed[11];
 
@@ -419,6 +446,8 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern void     mem_read_phys_block(void *dest, uint32_t addr, uint32_t size, int transfer_size);
+extern void     mem_write_phys_block(const void *src, uint32_t addr, uint32_t size, int transfer_size);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -448,9 +477,12 @@ extern void mem_flush_write_page(uint32_t addr, uint32_t virt);
 extern void mem_reset_page_blocks(void);
 
 extern void flushmmucache(void);
+extern void flushmmucache_cr3(void);
+extern void flushmmucache_page(uint32_t addr);
 extern void flushmmucache_write(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
+extern void mem_tlb_stats_log(void);
 
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
@@ -0,0 +1,38 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the pcapng traffic recorder.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#ifndef EMU_NET_CAPTURE_H
+#define EMU_NET_CAPTURE_H
+
+#define NET_CAPTURE_IN  1 /* Received by the card */
+#define NET_CAPTURE_OUT 2 /* Sent by the card */
+
+typedef struct net_capture_t net_capture_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Limit is the size in MB of the rolling capture, 0 for an unlimited one. */
+extern net_capture_t *net_capture_open(int card_num, uint32_t limit);
+extern void           net_capture_packet(net_capture_t *cap, const uint8_t *data, int len, int dir);
+extern void           net_capture_close(net_capture_t *cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_NET_CAPTURE_H*/
@@ -0,0 +1,48 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          Definitions for the shared listener of incoming modem calls.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#ifndef EMU_NET_MODEM_POOL_H
+#define EMU_NET_MODEM_POOL_H
+
+#include <86box/plat_netsocket.h>
+
+typedef struct modem_line_t modem_line_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Adds a line to the pool answering calls on the port, NULL if the port
+   could not be opened. The modem is notified on the emulation thread when
+   a call rings, data arrives or the caller hangs up. */
+extern modem_line_t *modem_pool_join(uint16_t port, void (*notify)(void *priv), void *priv);
+extern void          modem_pool_leave(modem_line_t *line);
+
+/* Whether the modem can take a new call, checked when one comes in. */
+extern void modem_line_set_available(modem_line_t *line, int available);
+
+/* Returns the socket of a call assigned to the line since the last check,
+   or -1. It only identifies the call, all I/O goes through the line. */
+extern SOCKET modem_line_ring(modem_line_t *line);
+extern void   modem_line_hangup(modem_line_t *line);
+
+/* Same return values as plat_netsocket_send() and plat_netsocket_receive(). */
+extern int modem_line_send(modem_line_t *line, const uint8_t *data, unsigned int size, int *wouldblock);
+extern int modem_line_receive(modem_line_t *line, uint8_t *data, unsigned int size, int *wouldblock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_NET_MODEM_POOL_H*/
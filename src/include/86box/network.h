@@ -52,6 +52,7 @@
 #define NET_TYPE_SLIRP 1 /* use the SLiRP port forwarder */
 #define NET_TYPE_PCAP  2 /* use the (Win)Pcap API */
 #define NET_TYPE_VDE   3 /* use the VDE plug API */
+#define NET_TYPE_SWITCH 4 /* use the shared memory switch */
 
 #define NET_MAX_FRAME  1518
 /* Queue size must be a power of 2 */
@@ -59,10 +60,13 @@
 #define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
 #define NET_QUEUE_COUNT    4
 #define NET_CARD_MAX       4
+#define NET_DESC_WIN_SIZE  256
 #define NET_HOST_INTF_MAX  64
 
 #define NET_PERIOD_10M     0.8
 #define NET_PERIOD_100M    0.08
+#define NET_PERIOD_RETRY   200.0 /* Card or host queue full */
+#define NET_PERIOD_WAKE    1.0   /* Idle card woken up by the host */
 
 /* Error buffers for network driver init */
 #define NET_DRV_ERRBUF_SIZE 384
@@ -95,6 +99,9 @@ typedef struct netcard_conf_t {
     int      net_type;
     char     host_dev_name[128];
     uint32_t link_state;
+    int      capture;       /* Record the traffic to a pcapng file */
+    uint32_t capture_limit; /* Size of a rolling capture in MB, 0 = unlimited */
+    uint32_t slirp_sockbuf; /* SLiRP host socket buffers in KB, 0 = host default */
 } netcard_conf_t;
 
 extern netcard_conf_t net_cards_conf[NET_CARD_MAX];
@@ -114,6 +121,17 @@ typedef struct netqueue_t {
     int      tail;
 } netqueue_t;
 
+/* A window of a guest descriptor ring, read with one bus master access and
+   reused while the card walks the ring. It is only used between
+   network_desc_begin() and network_desc_end(), which the card calls around
+   work the guest can not interleave with. */
+typedef struct netdesc_win_t {
+    int      active;
+    uint32_t addr;
+    uint32_t len;
+    uint8_t  data[NET_DESC_WIN_SIZE];
+} netdesc_win_t;
+
 typedef struct _netcard_t netcard_t;
 
 typedef struct netdrv_t {
@@ -126,6 +144,7 @@ typedef struct netdrv_t {
 extern const netdrv_t net_pcap_drv;
 extern const netdrv_t net_slirp_drv;
 extern const netdrv_t net_vde_drv;
+extern const netdrv_t net_switch_drv;
 extern const netdrv_t net_null_drv;
 
 struct _netcard_t {
@@ -144,6 +163,7 @@ struct _netcard_t {
     uint32_t        led_timer;
     uint32_t        led_state;
     uint32_t        link_state;
+    struct net_capture_t *capture;
 };
 
 typedef struct {
@@ -155,10 +175,11 @@ typedef struct {
     int has_slirp;
     int has_pcap;
     int has_vde;
+    int has_switch;
 } network_devmap_t;
 
 
-#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde)
+#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde || x.has_switch)
 
 #ifdef __cplusplus
 extern "C" {
@@ -203,8 +224,14 @@ extern int network_rx_put(netcard_t *card, uint8_t *bufp, int len);
 extern int network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size);
 extern int network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len);
 extern int network_rx_put_pkt(netcard_t *card, netpkt_t *pkt);
+extern int network_rx_putv(netcard_t *card, netpkt_t *pkt_vec, int vec_size);
 extern int network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt);
 
+extern void network_desc_begin(netdesc_win_t *win);
+extern void network_desc_end(netdesc_win_t *win);
+extern void network_desc_read(netdesc_win_t *win, uint32_t addr, void *buf, uint32_t len, uint32_t end, int transfer_size);
+extern void network_desc_write(netdesc_win_t *win, uint32_t addr, const void *buf, uint32_t len, int transfer_size);
+
 #ifdef EMU_DEVICE_H
 /* 3Com Etherlink */
 extern const device_t threec501_device;
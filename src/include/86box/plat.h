@@ -139,6 +139,8 @@ extern int hide_tool_bar;
 extern FILE    *plat_fopen(const char *path, const char *mode);
 extern FILE    *plat_fopen64(const char *path, const char *mode);
 extern void     plat_remove(char *path);
+extern int      plat_rename(const char *from, const char *to);
+extern int      plat_stat(const char *path, uint64_t *size, int64_t *mtime, int *is_dir);
 extern int      plat_getcwd(char *bufp, int max);
 extern int      plat_chdir(char *path);
 extern void     plat_tempfile(char *bufp, char *prefix, char *suffix);
@@ -151,6 +153,11 @@ extern int      plat_dir_check(char *path);
 extern int      plat_dir_create(char *path);
 extern void    *plat_mmap(size_t size, uint8_t executable);
 extern void     plat_munmap(void *ptr, size_t size);
+extern void    *plat_mmap_ram(size_t size, int *huge_pages);
+extern void    *plat_mmap_file(const char *path, uint64_t *size);
+extern void     plat_munmap_file(void *ptr, uint64_t size);
+extern void    *plat_mmap_file_view(const char *path, uint64_t offset, size_t size);
+extern void     plat_munmap_file_view(void *ptr, uint64_t offset, size_t size);
 extern uint64_t plat_timer_read(void);
 extern uint32_t plat_get_ticks(void);
 extern void     plat_delay_ms(uint32_t count);
@@ -1,3 +1,6 @@
+#ifndef PLAT_NETSOCKET_H
+#define PLAT_NETSOCKET_H
+
 #ifndef _WIN32
 #    define SOCKET int
 #else
@@ -21,3 +24,29 @@ int    plat_netsocket_connect(SOCKET socket, const char *hostname, unsigned shor
 /* Returns 0 in case of inability to send. -1 in case of errors. */
 int plat_netsocket_send(SOCKET socket, const unsigned char *data, unsigned int size, int *wouldblock);
 int plat_netsocket_receive(SOCKET socket, unsigned char *data, unsigned int size, int *wouldblock);
+
+/* Readiness notification for many sockets at once, epoll on Linux. The set
+   must only be changed from the thread that waits on it, other threads use
+   plat_netsocket_poll_wake() to have it look at their requests. */
+#define NET_SOCKET_EV_IN  1
+#define NET_SOCKET_EV_OUT 2
+#define NET_SOCKET_EV_ERR 4 /* Error or hang-up, always reported. */
+
+typedef struct net_socket_event_t {
+    void *priv;
+    int   events;
+} net_socket_event_t;
+
+typedef struct plat_netsocket_poll_t plat_netsocket_poll_t;
+
+plat_netsocket_poll_t *plat_netsocket_poll_create(void);
+void                   plat_netsocket_poll_destroy(plat_netsocket_poll_t *set);
+int                    plat_netsocket_poll_add(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv);
+int                    plat_netsocket_poll_modify(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv);
+void                   plat_netsocket_poll_remove(plat_netsocket_poll_t *set, SOCKET socket);
+
+/* Returns the number of events, 0 on timeout or wake-up, -1 on errors. */
+int  plat_netsocket_poll_wait(plat_netsocket_poll_t *set, net_socket_event_t *events, int max, int timeout_ms);
+void plat_netsocket_poll_wake(plat_netsocket_poll_t *set);
+
+#endif /*PLAT_NETSOCKET_H*/
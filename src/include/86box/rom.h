@@ -39,6 +39,17 @@ typedef struct rom_t {
     mem_mapping_t mapping;
 } rom_t;
 
+#define ROM_PACK_FILE "roms.pak"
+
+/* An image in a ROM pack. */
+typedef struct rom_pack_file_t {
+    const uint8_t *data; /* Read-only. */
+    uint32_t       size;
+    const char    *pack;   /* The pack file, */
+    uint64_t       offset; /* where the image is in it, */
+    uint64_t       limit;  /* and its size. */
+} rom_pack_file_t;
+
 typedef struct rom_path_t {
     char               path[1024];
     struct rom_path_t *next;
@@ -48,6 +59,16 @@ extern rom_path_t rom_paths;
 
 extern void rom_add_path(const char *path);
 
+extern int  rom_index_has(const char *root, const char *fn);
+extern void rom_index_reset(void);
+
+extern int      rom_pack_find(const char *root, const char *fn, rom_pack_file_t *file);
+extern FILE    *rom_pack_fopen(const rom_pack_file_t *file);
+extern uint8_t *rom_pack_map(const rom_pack_file_t *file, uint32_t off, uint32_t size);
+extern int      rom_pack_unmap(uint8_t *ptr);
+extern void     rom_pack_reset(void);
+extern int      rom_pack_build(const char *root);
+
 extern uint8_t  rom_read(uint32_t addr, void *priv);
 extern uint16_t rom_readw(uint32_t addr, void *priv);
 extern uint32_t rom_readl(uint32_t addr, void *priv);
@@ -62,6 +83,9 @@ extern FILE *rom_fopen(const char *fn, char *mode);
 extern int   rom_getfile(char *fn, char *s, int size);
 extern int   rom_present(const char *fn);
 
+extern const uint8_t *rom_getdata(const char *fn, uint32_t *size);
+extern void           rom_free(uint8_t *ptr);
+
 extern int rom_load_linear_oddeven(const char *fn, uint32_t addr, int sz,
                                    int off, uint8_t *ptr);
 extern int rom_load_linear(const char *fn, uint32_t addr, int sz,
@@ -75,6 +75,7 @@
 #define GPCMD_ERASE_10                                0x2c
 #define GPCMD_WRITE_AND_VERIFY_10                     0x2e
 #define GPCMD_VERIFY_10                               0x2f
+#define GPCMD_SYNCHRONIZE_CACHE                       0x35
 #define GPCMD_READ_BUFFER                             0x3c
 #define GPCMD_WRITE_SAME_10                           0x41
 #define GPCMD_READ_SUBCHANNEL                         0x42
@@ -423,6 +424,9 @@ typedef struct scsi_common_s {
     uint8_t            (*ven_cmd)(void *sc, uint8_t *cdb, int32_t *BufLen);
 } scsi_common_t;
 
+/* Carries out a background read, returns -1 on error. */
+typedef int (*scsi_device_io_t)(void *priv, uint32_t lba, uint32_t count, uint8_t *buffer);
+
 typedef struct scsi_device_t {
     int32_t            buffer_length;
 
@@ -504,6 +508,10 @@ extern void     scsi_device_command_stop(scsi_device_t *dev);
 extern void     scsi_device_command_phase1(scsi_device_t *dev);
 extern void     scsi_device_identify(scsi_device_t *dev, uint8_t lun);
 extern void     scsi_device_close_all(void);
+extern int      scsi_device_async_read(scsi_device_t *dev, scsi_device_io_t io, void *priv,
+                                       uint32_t lba, uint32_t count, uint8_t *buffer);
+extern int      scsi_device_async_wait(scsi_device_t *dev);
+extern void     scsi_device_async_close(scsi_device_t *dev);
 extern void     scsi_device_init(void);
 
 extern void    scsi_reset(void);
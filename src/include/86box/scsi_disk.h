@@ -35,7 +35,7 @@ typedef struct scsi_disk_t {
 
     uint8_t            id;
     uint8_t            cur_lun;
-    uint8_t            pad0;
+    uint8_t            async_read; /* the data of the current command is being read in the background */
     uint8_t            pad1;
 
     uint16_t           max_transfer_len;
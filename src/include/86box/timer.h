@@ -7,6 +7,7 @@ extern uint64_t tsc;
 #define MAX_USEC64    1000000ULL
 #define MAX_USEC      1000000.0
 
+#define TIMER_IDLE    8
 #define TIMER_PROCESS 4
 #define TIMER_SPLIT   2
 #define TIMER_ENABLED 1
@@ -44,6 +45,7 @@ typedef struct pc_timer_t {
 #endif
     int    flags;  /* The flags are defined above. */
     int    in_callback;
+    int    stat;   /* Slot in the fire count report. */
     double period; /* This is used for large period timers to count
                       the microseconds and split the period. */
 
@@ -78,6 +80,28 @@ extern void timer_init(void);
   timestamp - this is useful for permanently enabled timers*/
 extern void timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start_timer);
 
+/*Host threads can not touch the timer list. They call timer_wake() instead, and
+  every handler added with timer_add_wake() runs on the emulation thread the
+  next time timers are processed, so each handler has to find out for itself
+  whether the wake-up was meant for it*/
+extern void timer_add_wake(void (*handler)(void));
+extern void timer_wake(void);
+
+/*A timer that has nothing to do until some event happens (a port write, host
+  input, a backend enqueue) parks itself with timer_idle(). The code that sees
+  the event calls timer_kick(), which restarts the timer only if it is parked,
+  so it is safe to call on every event. A timer stopped in any other way stays
+  stopped*/
+extern void timer_idle(pc_timer_t *timer);
+extern void timer_kick(pc_timer_t *timer, double period);
+extern void timer_kick_u64(pc_timer_t *timer, uint64_t delay);
+
+/*Name the device owning the timers added from now on, for the report. Returns
+  the previous owner*/
+extern const char *timer_set_owner(const char *owner);
+/*Log how often each timer callback fired since the last reset, if log_stats is set*/
+extern void timer_stats_log(void);
+
 /*1us in 32:32 format*/
 extern uint64_t TIMER_USEC;
 
@@ -117,6 +141,13 @@ timer_is_enabled(pc_timer_t *timer)
     return !!(timer->flags & TIMER_ENABLED);
 }
 
+/*True if timer is parked waiting for timer_kick()*/
+static __inline int
+timer_is_idle(pc_timer_t *timer)
+{
+    return !!(timer->flags & TIMER_IDLE);
+}
+
 /*True if timer currently on*/
 static __inline int
 timer_is_on(pc_timer_t *timer)
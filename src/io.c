@@ -43,6 +43,10 @@ typedef struct _io_ {
     void (*outw)(uint16_t addr, uint16_t val, void *priv);
     void (*outl)(uint16_t addr, uint32_t val, void *priv);
 
+    /* Optional, used by REP INS/OUTS to move a whole run at once. */
+    int (*in_block)(uint16_t addr, void *buf, int size, int count, void *priv);
+    int (*out_block)(uint16_t addr, const void *buf, int size, int count, void *priv);
+
     void *priv;
 
     struct _io_ *prev, *next;
@@ -282,6 +286,83 @@ io_handler_interleaved(int set, uint16_t base, int size,
     io_handler_common(set, base, size, inb, inw, inl, outb, outw, outl, priv, 2);
 }
 
+/* Attach block transfer callbacks to handlers already set with the same priv. */
+void
+io_sethandler_block(uint16_t base, int size,
+                    int (*in_block)(uint16_t addr, void *buf, int size, int count, void *priv),
+                    int (*out_block)(uint16_t addr, const void *buf, int size, int count, void *priv),
+                    void *priv)
+{
+    io_t *p;
+
+    for (int c = 0; c < size; c++) {
+        for (p = io[base + c]; p; p = p->next) {
+            if (p->priv == priv) {
+                p->in_block  = in_block;
+                p->out_block = out_block;
+            }
+        }
+    }
+}
+
+/* Returns the handler that can take a block transfer of size-wide units at
+   port, or NULL if the access has to go through the normal handler chain. */
+static io_t *
+io_block_handler(uint16_t port, int size)
+{
+    io_t *p = io[port];
+    io_t *q;
+
+    if (!p || p->next)
+        return NULL;
+
+    if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size)))
+        return NULL;
+    if ((pci_flags & FLAG_CONFIG_DEV0_IO_ON) && (port >= 0xc000) && (port < 0xc100))
+        return NULL;
+    if (amstrad_latch & 0x80000000)
+        return NULL;
+#ifdef USE_DEBUG_REGS_486
+    if (dr[7] & 0xff)
+        return NULL;
+#endif
+
+    /* The other bytes of the access must not reach any other handler. */
+    for (int i = 1; i < size; i++) {
+        q = io[(port + i) & 0xffff];
+        if (q && (q->next || (q->priv != p->priv)))
+            return NULL;
+    }
+
+    return p;
+}
+
+int
+io_in_block(uint16_t port, void *buf, int size, int count)
+{
+    const io_t *p = io_block_handler(port, size);
+
+    if (!p || !p->in_block || ((size == 2) && !p->inw) || ((size == 4) && !p->inl))
+        return 0;
+
+    io_port = port;
+
+    return p->in_block(port, buf, size, count, p->priv);
+}
+
+int
+io_out_block(uint16_t port, const void *buf, int size, int count)
+{
+    const io_t *p = io_block_handler(port, size);
+
+    if (!p || !p->out_block || ((size == 2) && !p->outw) || ((size == 4) && !p->outl))
+        return 0;
+
+    io_port = port;
+
+    return p->out_block(port, buf, size, count, p->priv);
+}
+
 #ifdef USE_DEBUG_REGS_486
 extern int trap;
 /* Set trap for I/O address breakpoints. */
@@ -83,13 +83,11 @@ uint32_t biosaddr;
 uint32_t pccache;
 uint8_t *pccache2;
 
-int        readlnext;
-int        readlookup[256];
+int       *readlookup;
 uintptr_t *readlookup2;
 uintptr_t  old_rl2;
 uint8_t    uncached = 0;
-int        writelnext;
-int        writelookup[256];
+int       *writelookup;
 uintptr_t *writelookup2;
 
 uint32_t mem_logical_addr;
@@ -98,7 +96,10 @@ int shadowbios = 0;
 int shadowbios_write;
 int readlnum  = 0;
 int writelnum = 0;
-int cachesize = 256;
+int cachesize = TLB_DEFAULT_SIZE;
+int mem_huge_pages = MEM_HUGE_PAGES_NONE;
+
+tlb_stats_t tlb_stats;
 
 uint32_t get_phys_virt;
 uint32_t get_phys_phys;
@@ -129,6 +130,11 @@ uint8_t              *_mem_exec[MEM_MAPPINGS_NO];
 static uint8_t       *page_lookupp; /* pagetable mmu_perm lookup */
 static uint8_t       *readlookupp;
 static uint8_t       *writelookupp;
+static uint8_t       *readlookupf;  /* TLB entry flags (global, large page) */
+static uint8_t       *writelookupf;
+static uint8_t       *readlookup_rr; /* per-set round-robin replacement pointer */
+static uint8_t       *writelookup_rr;
+static uint32_t       tlb_set_mask;
 static mem_mapping_t *base_mapping;
 static mem_mapping_t *last_mapping;
 static mem_mapping_t *read_mapping_bus[MEM_MAPPINGS_NO];
@@ -145,6 +151,8 @@ static size_t ram2_size = 0;
 #else
 static size_t ram_size = 0;
 #endif
+static size_t ram_map_size   = 0;
+static int    ram_huge_pages = MEM_HUGE_PAGES_NONE;
 
 #ifdef ENABLE_MEM_LOG
 int mem_do_log = ENABLE_MEM_LOG;
@@ -173,17 +181,69 @@ mem_addr_is_ram(uint32_t addr)
            (mapping == &ram_mid_mapping2) || (mapping == &ram_remapped_mapping);
 }
 
+static __inline void
+tlb_invalidate_read(int c)
+{
+    readlookup2[readlookup[c]] = LOOKUP_INV;
+    readlookupp[readlookup[c]] = 4;
+    readlookup[c]              = 0xffffffff;
+    readlookupf[c]             = 0;
+}
+
+static __inline void
+tlb_invalidate_write(int c)
+{
+    page_lookup[writelookup[c]]  = NULL;
+    page_lookupp[writelookup[c]] = 4;
+    writelookup2[writelookup[c]] = LOOKUP_INV;
+    writelookupp[writelookup[c]] = 4;
+    writelookup[c]               = 0xffffffff;
+    writelookupf[c]              = 0;
+}
+
+/* Pick a slot for virtual page vpn: a free way of its set if there is one,
+   otherwise round-robin within the set, passing over global entries. */
+static int
+tlb_get_slot(const int *lookup, const uint8_t *flags, uint8_t *rr, uint32_t vpn)
+{
+    uint32_t set  = vpn & tlb_set_mask;
+    int      base = set * TLB_WAYS;
+    int      way;
+
+    for (way = 0; way < TLB_WAYS; way++) {
+        if (lookup[base + way] == (int) 0xffffffff)
+            return base + way;
+    }
+
+    way = rr[set];
+    for (int i = 0; i < TLB_WAYS; i++) {
+        if (!(flags[base + ((rr[set] + i) & (TLB_WAYS - 1))] & TLB_FLAG_GLOBAL)) {
+            way = (rr[set] + i) & (TLB_WAYS - 1);
+            break;
+        }
+    }
+    rr[set] = (way + 1) & (TLB_WAYS - 1);
+
+    tlb_stats.evictions++;
+
+    return base + way;
+}
+
 void
 resetreadlookup(void)
 {
     /* Initialize the page lookup table. */
     memset(page_lookup, 0x00, (1 << 20) * sizeof(page_t *));
 
-    /* Initialize the tables for lower (<= 1024K) RAM. */
-    for (uint16_t c = 0; c < 256; c++) {
+    /* Initialize the software TLB. */
+    for (int c = 0; c < cachesize; c++) {
         readlookup[c]  = 0xffffffff;
         writelookup[c] = 0xffffffff;
     }
+    memset(readlookupf, 0x00, cachesize);
+    memset(writelookupf, 0x00, cachesize);
+    memset(readlookup_rr, 0x00, cachesize / TLB_WAYS);
+    memset(writelookup_rr, 0x00, cachesize / TLB_WAYS);
 
     /* Initialize the tables for high (> 1024K) RAM. */
     memset(readlookup2, 0xff, (1 << 20) * sizeof(uintptr_t));
@@ -192,8 +252,8 @@ resetreadlookup(void)
     memset(writelookup2, 0xff, (1 << 20) * sizeof(uintptr_t));
     memset(writelookupp, 0x04, (1 << 20) * sizeof(uint8_t));
 
-    readlnext  = 0;
-    writelnext = 0;
+    memset(&tlb_stats, 0x00, sizeof(tlb_stats_t));
+
     pccache    = 0xffffffff;
     high_page  = 0;
 }
@@ -201,21 +261,49 @@ resetreadlookup(void)
 void
 flushmmucache(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
+    for (int c = 0; c < cachesize; c++) {
+        if (readlookup[c] != (int) 0xffffffff)
+            tlb_invalidate_read(c);
+        if (writelookup[c] != (int) 0xffffffff)
+            tlb_invalidate_write(c);
+    }
+    mmuflush++;
+    tlb_stats.flushes++;
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
+}
+
+/* CR3 reload: same as flushmmucache(), but entries for global pages survive
+   when CR4.PGE is set. */
+void
+flushmmucache_cr3(void)
+{
+    if (!(cr4 & CR4_PGE)) {
+        flushmmucache();
+        return;
+    }
+
+    for (int c = 0; c < cachesize; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookupp[readlookup[c]] = 4;
-            readlookup[c]              = 0xffffffff;
+            if (readlookupf[c] & TLB_FLAG_GLOBAL)
+                tlb_stats.global_kept++;
+            else
+                tlb_invalidate_read(c);
         }
         if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            page_lookupp[writelookup[c]] = 4;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookupp[writelookup[c]] = 4;
-            writelookup[c]               = 0xffffffff;
+            if (writelookupf[c] & TLB_FLAG_GLOBAL)
+                tlb_stats.global_kept++;
+            else
+                tlb_invalidate_write(c);
         }
     }
     mmuflush++;
+    tlb_stats.flushes_cr3++;
 
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
@@ -225,17 +313,31 @@ flushmmucache(void)
 #endif
 }
 
+/* INVLPG: drop the entries for one page. Entries filled from a large page
+   are dropped if they fall into the same 4 MB region, as we do not keep
+   track of the size of the page they came from. */
+void
+flushmmucache_page(uint32_t addr)
+{
+    int vpn = (int) (addr >> 12);
+
+    for (int c = 0; c < cachesize; c++) {
+        if ((readlookup[c] != (int) 0xffffffff) &&
+            ((readlookup[c] == vpn) || ((readlookupf[c] & TLB_FLAG_LARGE) && ((readlookup[c] >> 10) == (vpn >> 10)))))
+            tlb_invalidate_read(c);
+        if ((writelookup[c] != (int) 0xffffffff) &&
+            ((writelookup[c] == vpn) || ((writelookupf[c] & TLB_FLAG_LARGE) && ((writelookup[c] >> 10) == (vpn >> 10)))))
+            tlb_invalidate_write(c);
+    }
+    tlb_stats.invlpg++;
+}
+
 void
 flushmmucache_write(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            page_lookupp[writelookup[c]] = 4;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookupp[writelookup[c]] = 4;
-            writelookup[c]               = 0xffffffff;
-        }
+    for (int c = 0; c < cachesize; c++) {
+        if (writelookup[c] != (int) 0xffffffff)
+            tlb_invalidate_write(c);
     }
     mmuflush++;
 }
@@ -256,19 +358,11 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookupp[readlookup[c]] = 4;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            page_lookupp[writelookup[c]] = 4;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookupp[writelookup[c]] = 4;
-            writelookup[c]               = 0xffffffff;
-        }
+    for (int c = 0; c < cachesize; c++) {
+        if (readlookup[c] != (int) 0xffffffff)
+            tlb_invalidate_read(c);
+        if (writelookup[c] != (int) 0xffffffff)
+            tlb_invalidate_write(c);
     }
 }
 
@@ -280,7 +374,7 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
     uint32_t a;
 #endif
 
-    for (uint16_t c = 0; c < 256; c++) {
+    for (int c = 0; c < cachesize; c++) {
         if (writelookup[c] != (int) 0xffffffff) {
 #if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
             uintptr_t target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
@@ -298,11 +392,26 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
                 writelookup2[writelookup[c]] = LOOKUP_INV;
                 page_lookup[writelookup[c]]  = NULL;
                 writelookup[c]               = 0xffffffff;
+                writelookupf[c]              = 0;
             }
         }
     }
 }
 
+/* Hits are served by the inline fast paths and the recompiled code straight
+   from readlookup2/writelookup2, and are not counted. */
+void
+mem_tlb_stats_log(void)
+{
+    if (!log_stats)
+        return;
+
+    pclog("TLB: %i entries, %" PRIu64 " read misses, %" PRIu64 " write misses, %" PRIu64 " evictions\n",
+          cachesize, tlb_stats.read_misses, tlb_stats.write_misses, tlb_stats.evictions);
+    pclog("TLB: %" PRIu64 " full flushes, %" PRIu64 " CR3 flushes (%" PRIu64 " global entries kept), %" PRIu64 " INVLPG\n",
+          tlb_stats.flushes, tlb_stats.flushes_cr3, tlb_stats.global_kept, tlb_stats.invlpg);
+}
+
 #define mmutranslate_read(addr)  mmutranslatereal(addr, 0)
 #define mmutranslate_write(addr) mmutranslatereal(addr, 1)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
@@ -583,6 +692,42 @@ mmutranslate_noabrt(uint32_t addr, int rw)
         return mmutranslate_noabrt_normal(addr, rw);
 }
 
+/* The TLB flags of the page virt is in. They are looked up again for each
+   entry rather than kept from the last translation, as an access that
+   straddles two pages translates both before either entry is made. */
+static uint8_t
+mmu_tlb_flags(uint32_t virt)
+{
+    uint64_t temp;
+
+    if (!(cr0 >> 31))
+        return 0;
+
+    if (cr4 & CR4_PAE) {
+        temp = rammap64((cr3 & ~0x1f) + ((virt >> 27) & 0x18)) & 0x000000ffffffffffULL;
+        if (!(temp & 1))
+            return 0;
+
+        temp = rammap64((temp & ~0xfffULL) + ((virt >> 18) & 0xff8)) & 0x000000ffffffffffULL;
+        if (!(temp & 1))
+            return 0;
+        if (temp & 0x80)
+            return TLB_FLAG_LARGE | (((cr4 & CR4_PGE) && (temp & 0x100)) ? TLB_FLAG_GLOBAL : 0);
+
+        temp = rammap64((temp & ~0xfffULL) + ((virt >> 9) & 0xff8)) & 0x000000ffffffffffULL;
+    } else {
+        temp = rammap((cr3 & ~0xfff) + ((virt >> 20) & 0xffc));
+        if (!(temp & 1))
+            return 0;
+        if ((temp & 0x80) && (cr4 & CR4_PSE))
+            return TLB_FLAG_LARGE | (((cr4 & CR4_PGE) && (temp & 0x100)) ? TLB_FLAG_GLOBAL : 0);
+
+        temp = rammap((temp & ~0xfff) + ((virt >> 10) & 0xffc));
+    }
+
+    return ((cr4 & CR4_PGE) && (temp & 0x100)) ? TLB_FLAG_GLOBAL : 0;
+}
+
 uint8_t
 mem_addr_range_match(uint32_t addr, uint32_t start, uint32_t len)
 {
@@ -605,6 +750,7 @@ mem_addr_translate(uint32_t addr, uint32_t chunk_start, uint32_t len)
 void
 addreadlookup(uint32_t virt, uint32_t phys)
 {
+    int slot;
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
     uint32_t a;
 #endif
@@ -615,10 +761,13 @@ addreadlookup(uint32_t virt, uint32_t phys)
     if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV)
         return;
 
-    if (readlookup[readlnext] != (int) 0xffffffff) {
-        if ((readlookup[readlnext] == ((es + DI) >> 12)) || (readlookup[readlnext] == ((es + EDI) >> 12)))
+    slot = tlb_get_slot(readlookup, readlookupf, readlookup_rr, virt >> 12);
+
+    if (readlookup[slot] != (int) 0xffffffff) {
+        if ((readlookup[slot] == ((es + DI) >> 12)) || (readlookup[slot] == ((es + EDI) >> 12)))
             uncached = 1;
-        readlookup2[readlookup[readlnext]] = LOOKUP_INV;
+        readlookup2[readlookup[slot]] = LOOKUP_INV;
+        readlookupp[readlookup[slot]] = 4;
     }
 
 #if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
@@ -633,8 +782,9 @@ addreadlookup(uint32_t virt, uint32_t phys)
 #endif
     readlookupp[virt >> 12] = mmu_perm;
 
-    readlookup[readlnext++] = virt >> 12;
-    readlnext &= (cachesize - 1);
+    readlookup[slot]  = virt >> 12;
+    readlookupf[slot] = mmu_tlb_flags(virt);
+    tlb_stats.read_misses++;
 
     cycles -= 9;
 }
@@ -642,6 +792,7 @@ addreadlookup(uint32_t virt, uint32_t phys)
 void
 addwritelookup(uint32_t virt, uint32_t phys)
 {
+    int slot;
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
     uint32_t a;
 #endif
@@ -652,9 +803,11 @@ addwritelookup(uint32_t virt, uint32_t phys)
     if (page_lookup[virt >> 12])
         return;
 
-    if (writelookup[writelnext] != -1) {
-        page_lookup[writelookup[writelnext]]  = NULL;
-        writelookup2[writelookup[writelnext]] = LOOKUP_INV;
+    slot = tlb_get_slot(writelookup, writelookupf, writelookup_rr, virt >> 12);
+
+    if (writelookup[slot] != -1) {
+        page_lookup[writelookup[slot]]  = NULL;
+        writelookup2[writelookup[slot]] = LOOKUP_INV;
     }
 
 #ifdef USE_NEW_DYNAREC
@@ -686,8 +839,9 @@ addwritelookup(uint32_t virt, uint32_t phys)
     }
     writelookupp[virt >> 12] = mmu_perm;
 
-    writelookup[writelnext++] = virt >> 12;
-    writelnext &= (cachesize - 1);
+    writelookup[slot]  = virt >> 12;
+    writelookupf[slot] = mmu_tlb_flags(virt);
+    tlb_stats.write_misses++;
 
     cycles -= 9;
 }
@@ -1862,6 +2016,84 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+/* Bulk variants of the above for bus master DMA, size must be a multiple of
+   transfer_size. Each 4k page is resolved once, RAM-backed pages are copied
+   in one go and only MMIO pages go through the mapping handlers. */
+void
+mem_read_phys_block(void *dest, uint32_t addr, uint32_t size, int transfer_size)
+{
+    mem_mapping_t *map;
+    uint8_t       *p = (uint8_t *) dest;
+    uint32_t       chunk;
+    uint32_t       off;
+    uint32_t       i;
+
+    mem_logical_addr = 0xffffffff;
+
+    while (size > 0) {
+        map   = read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+        chunk = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+        if (chunk > size)
+            chunk = size;
+
+        if (cpu_use_exec && map && map->exec &&
+            (((off = (addr - map->base) & map->mask) + chunk - 1) <= map->mask))
+            memcpy(p, &(map->exec[off]), chunk);
+        else {
+            /* Round up so a unit straddling the page boundary stays whole. */
+            chunk = (chunk + transfer_size - 1) & ~(transfer_size - 1);
+            if (chunk > size)
+                chunk = size;
+
+            for (i = 0; (i + transfer_size) <= chunk; i += transfer_size)
+                mem_read_phys(&(p[i]), addr + i, transfer_size);
+            for (; i < chunk; i++)
+                p[i] = mem_readb_phys(addr + i);
+        }
+
+        p += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+}
+
+void
+mem_write_phys_block(const void *src, uint32_t addr, uint32_t size, int transfer_size)
+{
+    mem_mapping_t *map;
+    const uint8_t *p = (const uint8_t *) src;
+    uint32_t       chunk;
+    uint32_t       off;
+    uint32_t       i;
+
+    mem_logical_addr = 0xffffffff;
+
+    while (size > 0) {
+        map   = write_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+        chunk = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+        if (chunk > size)
+            chunk = size;
+
+        if (cpu_use_exec && map && map->exec &&
+            (((off = (addr - map->base) & map->mask) + chunk - 1) <= map->mask))
+            memcpy(&(map->exec[off]), p, chunk);
+        else {
+            chunk = (chunk + transfer_size - 1) & ~(transfer_size - 1);
+            if (chunk > size)
+                chunk = size;
+
+            for (i = 0; (i + transfer_size) <= chunk; i += transfer_size)
+                mem_write_phys((void *) &(p[i]), addr + i, transfer_size);
+            for (; i < chunk; i++)
+                mem_writeb_phys(addr + i, p[i]);
+        }
+
+        p += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(void *priv))
 {
@@ -2295,7 +2527,9 @@ void
 mem_invalidate_range(uint32_t start_addr, uint32_t end_addr)
 {
 #ifdef USE_NEW_DYNAREC
-    page_t *page;
+    page_t  *page;
+    uint64_t code;
+    int      c;
 
     start_addr &= ~PAGE_MASK_MASK;
     end_addr = (end_addr + PAGE_MASK_MASK) & ~PAGE_MASK_MASK;
@@ -2305,7 +2539,15 @@ mem_invalidate_range(uint32_t start_addr, uint32_t end_addr)
             continue;
 
         page = &pages[start_addr >> 12];
-        if (page) {
+        /* Pages without recompiled code have nothing to invalidate. Blocks
+           built with CODEBLOCK_BYTE_MASK only show up in the byte mask. */
+        code = page->code_present_mask;
+        if (!code && page->byte_code_present_mask) {
+            for (c = 0; c < 64; c++)
+                code |= page->byte_code_present_mask[c];
+        }
+
+        if (code) {
             page->dirty_mask = 0xffffffffffffffffULL;
 
             if ((page->mem != page_ff) && page->byte_dirty_mask)
@@ -2324,7 +2566,9 @@ mem_invalidate_range(uint32_t start_addr, uint32_t end_addr)
         /* Do nothing if the pages array is empty or DMA reads/writes to/from PCI device memory addresses
            may crash the emulator. */
         cur_addr = (start_addr >> 12);
-        if (cur_addr < pages_sz)
+        if ((cur_addr < pages_sz) &&
+            (pages[cur_addr].code_present_mask[0] | pages[cur_addr].code_present_mask[1] |
+             pages[cur_addr].code_present_mask[2] | pages[cur_addr].code_present_mask[3]))
             memset(pages[cur_addr].dirty_mask, 0xff, sizeof(pages[cur_addr].dirty_mask));
     }
 #endif
@@ -2830,16 +3074,17 @@ mem_reset(void)
     }
 
     if (ram != NULL) {
-        plat_munmap(ram, ram_size);
-        ram      = NULL;
-        ram_size = 0;
+        plat_munmap(ram, ram_map_size);
+        ram          = NULL;
+        ram_size     = 0;
+        ram_map_size = 0;
     }
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
-    if (ram2 != NULL) {
-        plat_munmap(ram2, ram2_size);
-        ram2      = NULL;
-        ram2_size = 0;
-    }
+    /* ram2 only owns its own mapping if the RAM had to be split. */
+    if ((ram2 != NULL) && (ram2_size != 0))
+        plat_munmap(ram2, ram2_size + 16);
+    ram2      = NULL;
+    ram2_size = 0;
 
     if (mem_size > 2097152)
         mem_size = 2097152;
@@ -2847,17 +3092,33 @@ mem_reset(void)
 
     m = 1024UL * (size_t) mem_size;
 
+    /*
+     * Map all of the guest RAM as one contiguous anonymous block, so that
+     * the host can back it with huge pages and it can later be shared or
+     * snapshotted as a whole. Allocate 16 extra bytes of RAM to mitigate
+     * some dynarec recompiler memory access quirks. Fresh anonymous
+     * mappings are zero-filled, so the block is only committed as the
+     * guest touches it.
+     */
+    ram_size       = m;
+    ram_map_size   = m + 16;
+    ram_huge_pages = mem_huge_pages;
+    if (ram_huge_pages != MEM_HUGE_PAGES_NONE)
+        ram_map_size = (ram_map_size + MEM_HUGE_PAGE_SIZE - 1) & ~((size_t) MEM_HUGE_PAGE_SIZE - 1);
+    ram = (uint8_t *) plat_mmap_ram(ram_map_size, &ram_huge_pages);
+
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
-    if (mem_size > 1048576) {
-        ram_size = 1 << 30;
-        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate and clear the RAM block of the first 1 GB */
+    if ((ram == NULL) && (mem_size > 1048576)) {
+        /* Not enough contiguous address space, fall back to two blocks. */
+        ram_size       = 1 << 30;
+        ram_map_size   = ram_size;
+        ram_huge_pages = MEM_HUGE_PAGES_NONE;
+        ram            = (uint8_t *) plat_mmap(ram_size, 0); /* allocate and clear the RAM block of the first 1 GB */
         if (ram == NULL) {
             fatal("Failed to allocate primary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size);
         ram2_size = m - (1 << 30);
-        /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
         ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate and clear the RAM block above 1 GB */
         if (ram2 == NULL) {
             if (config_changed == 2)
@@ -2866,23 +3127,25 @@ mem_reset(void)
                 fatal("Failed to allocate secondary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram2, 0x00, ram2_size + 16);
-    } else
+    }
 #endif
-    {
-        ram_size = m;
-        /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate and clear the RAM block */
-        if (ram == NULL) {
-            fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
-            return;
-        }
-        memset(ram, 0x00, ram_size + 16);
+
+    if (ram == NULL) {
+        fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
+        return;
+    }
+
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
-        if (mem_size > 1048576)
-            ram2 = &(ram[1 << 30]);
+    if ((mem_size > 1048576) && (ram2 == NULL))
+        ram2 = &(ram[1 << 30]);
 #endif
-    }
+
+    mem_log("MEM: %" PRIu64 " KB of guest RAM mapped at %p, %s\n", (uint64_t) (m >> 10), ram,
+            (ram_huge_pages == MEM_HUGE_PAGES_EXPLICIT) ? "reserved huge pages" :
+            ((ram_huge_pages == MEM_HUGE_PAGES_TRANSPARENT) ? "transparent huge pages" : "regular pages"));
+    if (ram_huge_pages != mem_huge_pages)
+        pclog("MEM: Requested huge pages for guest RAM are not available, using %s\n",
+              (ram_huge_pages == MEM_HUGE_PAGES_TRANSPARENT) ? "transparent huge pages" : "regular pages");
 
     /*
      * Allocate the page table based on how much RAM we have.
@@ -3038,6 +3301,22 @@ mem_init(void)
     readlookupp  = malloc((1 << 20) * sizeof(uint8_t));
     writelookup2 = malloc((1 << 20) * sizeof(uintptr_t));
     writelookupp = malloc((1 << 20) * sizeof(uint8_t));
+
+    /* Allocate the software TLB, the size must be a power of two. */
+    if (cachesize < TLB_MIN_SIZE)
+        cachesize = TLB_MIN_SIZE;
+    else if (cachesize > TLB_MAX_SIZE)
+        cachesize = TLB_MAX_SIZE;
+    while (cachesize & (cachesize - 1))
+        cachesize &= (cachesize - 1);
+    tlb_set_mask = (cachesize / TLB_WAYS) - 1;
+
+    readlookup     = (int *) malloc(cachesize * sizeof(int));
+    readlookupf    = (uint8_t *) malloc(cachesize * sizeof(uint8_t));
+    readlookup_rr  = (uint8_t *) malloc((cachesize / TLB_WAYS) * sizeof(uint8_t));
+    writelookup    = (int *) malloc(cachesize * sizeof(int));
+    writelookupf   = (uint8_t *) malloc(cachesize * sizeof(uint8_t));
+    writelookup_rr = (uint8_t *) malloc((cachesize / TLB_WAYS) * sizeof(uint8_t));
 }
 
 static void
@@ -84,6 +84,10 @@ rom_add_path(const char *path)
 
     // Ensure the path ends with a separator.
     path_slash(rom_path->path);
+
+    // The index has to cover the new path.
+    rom_index_reset();
+    rom_pack_reset();
 }
 
 static int
@@ -97,12 +101,86 @@ rom_check(const char *fn)
     else {
         fp = fopen(fn, "rb");
         ret = (fp != NULL);
-        fclose(fp);
+        if (fp != NULL)
+            fclose(fp);
     }
 
     return ret;
 }
 
+#define ROM_FOUND_FILE 1
+#define ROM_FOUND_PACK 2
+
+/* Finds the first ROM path that has the file (or the directory, if the name
+   ends with a slash) and puts its full name into dest. If pf is not NULL,
+   the ROM pack of each path is searched after its files, and an image found
+   there is described in pf. */
+static int
+rom_find(const char *fn, char *dest, rom_pack_file_t *pf)
+{
+    int found;
+
+    for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
+        path_append_filename(dest, rom_path->path, fn);
+
+        /* Paths that could not be indexed are still probed. */
+        found = rom_index_has(rom_path->path, fn);
+        if ((found == 1) || ((found == -1) && rom_check(dest)))
+            return ROM_FOUND_FILE;
+
+        if ((pf != NULL) && rom_pack_find(rom_path->path, fn, pf))
+            return ROM_FOUND_PACK;
+    }
+
+    return 0;
+}
+
+/* Whether the first copy of a ROM found is in a ROM pack. */
+static int
+rom_find_packed(const char *fn, rom_pack_file_t *pf)
+{
+    char temp[1024];
+
+    if (strstr(fn, "roms/") != fn)
+        return 0;
+
+    return rom_find(fn + 5, temp, pf) == ROM_FOUND_PACK;
+}
+
+/* Returns the image of a ROM in a ROM pack, which stays valid for as long as
+   the emulator runs. Returns NULL for ROMs that are files of their own. */
+const uint8_t *
+rom_getdata(const char *fn, uint32_t *size)
+{
+    rom_pack_file_t pf;
+
+    if (!rom_find_packed(fn, &pf))
+        return NULL;
+
+    *size = pf.size;
+    return pf.data;
+}
+
+/* Maps sz bytes of a ROM, starting at off, straight from its ROM pack. */
+static uint8_t *
+rom_map(const char *fn, int sz, int off)
+{
+    rom_pack_file_t pf;
+
+    if ((sz <= 0) || (off < 0) || !rom_find_packed(fn, &pf))
+        return NULL;
+
+    return rom_pack_map(&pf, off, sz);
+}
+
+/* Frees an image from rom_init*() or bios_load*(). */
+void
+rom_free(uint8_t *ptr)
+{
+    if ((ptr != NULL) && !rom_pack_unmap(ptr))
+        free(ptr);
+}
+
 void
 rom_get_full_path(char *dest, const char *fn)
 {
@@ -112,14 +190,8 @@ rom_get_full_path(char *dest, const char *fn)
 
     if (strstr(fn, "roms/") == fn) {
         /* Relative path */
-        for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
-            path_append_filename(temp, rom_path->path, fn + 5);
-
-            if (rom_check(temp)) {
-                strcpy(dest, temp);
-                return;
-            }
-        }
+        if (rom_find(fn + 5, temp, NULL))
+            strcpy(dest, temp);
 
         return;
     } else {
@@ -131,11 +203,26 @@ rom_get_full_path(char *dest, const char *fn)
 FILE *
 rom_fopen(const char *fn, char *mode)
 {
-    char        temp[1024];
-    FILE       *fp = NULL;
+    char            temp[1024];
+    rom_pack_file_t pf;
+    FILE           *fp = NULL;
 
-    if (strstr(fn, "roms/") == fn) {
+    if ((strstr(fn, "roms/") == fn) && (mode[0] == 'r')) {
         /* Relative path */
+        switch (rom_find(fn + 5, temp, &pf)) {
+            case ROM_FOUND_FILE:
+                fp = plat_fopen(temp, mode);
+                break;
+            case ROM_FOUND_PACK:
+                fp = rom_pack_fopen(&pf);
+                break;
+            default:
+                break;
+        }
+
+        return fp;
+    } else if (strstr(fn, "roms/") == fn) {
+        /* Relative path, to be written */
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -157,14 +244,10 @@ rom_getfile(char *fn, char *s, int size)
     char        temp[1024];
 
     if (strstr(fn, "roms/") == fn) {
-        /* Relative path */
-        for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
-            path_append_filename(temp, rom_path->path, fn + 5);
-
-            if (rom_present(temp)) {
-                strncpy(s, temp, size);
-                return 1;
-            }
+        /* Relative path, images in a ROM pack have no file name. */
+        if (rom_find(fn + 5, temp, NULL)) {
+            strncpy(s, temp, size);
+            return 1;
         }
 
         return 0;
@@ -182,7 +265,12 @@ rom_getfile(char *fn, char *s, int size)
 int
 rom_present(const char *fn)
 {
-    FILE *fp;
+    char            temp[1024];
+    rom_pack_file_t pf;
+    FILE           *fp;
+
+    if (strstr(fn, "roms/") == fn)
+        return !!rom_find(fn + 5, temp, &pf);
 
     fp = rom_fopen(fn, "rb");
     if (fp != NULL) {
@@ -298,7 +386,13 @@ rom_writel(uint32_t addr, uint32_t val, void *priv)
 int
 rom_load_linear_oddeven(const char *fn, uint32_t addr, int sz, int off, uint8_t *ptr)
 {
-    FILE *fp = rom_fopen(fn, "rb");
+    FILE *fp;
+
+    /* Only checking for the BIOS. */
+    if (ptr == NULL)
+        return rom_present(fn);
+
+    fp = rom_fopen(fn, "rb");
 
     if (fp == NULL) {
         rom_log("ROM: image '%s' not found\n", fn);
@@ -333,12 +427,11 @@ rom_load_linear_oddeven(const char *fn, uint32_t addr, int sz, int off, uint8_t
 int
 rom_load_linear(const char *fn, uint32_t addr, int sz, int off, uint8_t *ptr)
 {
-    FILE *fp = rom_fopen(fn, "rb");
+    rom_pack_file_t pf;
+    FILE           *fp;
 
-    if (fp == NULL) {
-        rom_log("ROM: image '%s' not found\n", fn);
-        return 0;
-    }
+    if (ptr == NULL)
+        return rom_present(fn);
 
     /* Make sure we only look at the base-256K offset. */
     if (addr >= 0x40000)
@@ -346,6 +439,20 @@ rom_load_linear(const char *fn, uint32_t addr, int sz, int off, uint8_t *ptr)
     else
         addr &= 0x03ffff;
 
+    /* Copy images in a ROM pack straight from it. */
+    if (rom_find_packed(fn, &pf)) {
+        if ((off >= 0) && (sz > 0) && ((uint32_t) off < pf.size))
+            memcpy(ptr + addr, &pf.data[off], MIN((uint32_t) sz, pf.size - off));
+        return 1;
+    }
+
+    fp = rom_fopen(fn, "rb");
+
+    if (fp == NULL) {
+        rom_log("ROM: image '%s' not found\n", fn);
+        return 0;
+    }
+
     if (ptr != NULL) {
         if (fseek(fp, off, SEEK_SET) == -1)
             fatal("rom_load_linear(): Error seeking to the beginning of the file\n");
@@ -406,8 +513,14 @@ rom_load_linear_inverted(const char *fn, uint32_t addr, int sz, int off, uint8_t
 int
 rom_load_interleaved(const char *fnl, const char *fnh, uint32_t addr, int sz, int off, uint8_t *ptr)
 {
-    FILE *fpl = rom_fopen(fnl, "rb");
-    FILE *fph = rom_fopen(fnh, "rb");
+    FILE *fpl;
+    FILE *fph;
+
+    if (ptr == NULL)
+        return rom_present(fnl) && rom_present(fnh);
+
+    fpl = rom_fopen(fnl, "rb");
+    fph = rom_fopen(fnh, "rb");
 
     if (fpl == NULL || fph == NULL) {
         if (fpl == NULL)
@@ -458,7 +571,7 @@ bios_normalize(int n, int up)
 }
 
 static uint8_t *
-rom_reset(uint32_t addr, int sz)
+rom_reset(uint32_t addr, int sz, const char *fn, int off, int *loaded)
 {
     biosaddr = bios_normalize(addr, 0);
     biosmask = bios_normalize(sz, 1) - 1;
@@ -470,13 +583,23 @@ rom_reset(uint32_t addr, int sz)
     /* If not done yet, allocate a 128KB buffer for the BIOS ROM. */
     if (rom != NULL) {
         rom_log("ROM allocated, freeing...\n");
-        free(rom);
+        rom_free(rom);
         rom = NULL;
     }
-    rom_log("Allocating ROM...\n");
-    rom = (uint8_t *) malloc(biosmask + 1);
-    rom_log("Filling ROM with FF's...\n");
-    memset(rom, 0xff, biosmask + 1);
+
+    /* An image that fills the whole ROM can be used straight from a ROM pack. */
+    if ((fn != NULL) && (addr == biosaddr) && (sz == (biosmask + 1))) {
+        rom_log("Mapping ROM...\n");
+        rom = rom_map(fn, sz, off);
+    }
+
+    *loaded = (rom != NULL);
+    if (rom == NULL) {
+        rom_log("Allocating ROM...\n");
+        rom = (uint8_t *) malloc(biosmask + 1);
+        rom_log("Filling ROM with FF's...\n");
+        memset(rom, 0xff, biosmask + 1);
+    }
 
     return rom;
 }
@@ -580,6 +703,7 @@ bios_load(const char *fn1, const char *fn2, uint32_t addr, int sz, int off, int
     uint8_t  ret = 0;
     uint8_t *ptr = NULL;
     int      old_sz = sz;
+    int      loaded = 0;
 
     /*
         f0000, 65536 = prepare 64k rom starting at f0000, load 64k bios at 0000
@@ -587,8 +711,12 @@ bios_load(const char *fn1, const char *fn2, uint32_t addr, int sz, int off, int
         fe000, 49152 = prepare 48k rom starting at f4000, load 8k bios at a000
         fe000, 8192 = prepare 16k rom starting at fc000, load 8k bios at 2000
      */
-    if (!bios_only)
-        ptr = (flags & FLAG_AUX) ? rom : rom_reset(addr, sz);
+    if (!bios_only) {
+        if (flags & FLAG_AUX)
+            ptr = rom;
+        else
+            ptr = rom_reset(addr, sz, (flags & (FLAG_INT | FLAG_INV)) ? NULL : fn1, off, &loaded);
+    }
 
     if (!(flags & FLAG_AUX) && ((addr + sz) > 0x00100000))
         sz = 0x00100000 - addr;
@@ -598,7 +726,9 @@ bios_load(const char *fn1, const char *fn2, uint32_t addr, int sz, int off, int
         rom_log("%sing %i bytes of %sBIOS starting with ptr[%08X] (ptr = %08X)\n", (bios_only) ? "Check" : "Load", sz, (flags & FLAG_AUX) ? "auxiliary " : "", addr - biosaddr, ptr);
 #endif
 
-    if (flags & FLAG_INT)
+    if (loaded)
+        ret = 1;
+    else if (flags & FLAG_INT)
         ret = rom_load_interleaved(fn1, fn2, addr - biosaddr, sz, off, ptr);
     else {
         if (flags & FLAG_INV)
@@ -667,16 +797,24 @@ rom_init(rom_t *rom, const char *fn, uint32_t addr, int sz, int mask, int off, u
 {
     rom_log("rom_init(%08X, %s, %08X, %08X, %08X, %08X, %08X)\n", rom, fn, addr, sz, mask, off, flags);
 
-    /* Allocate a buffer for the image. */
-    rom->rom = malloc(sz);
-    memset(rom->rom, 0xff, sz);
-
-    /* Load the image file into the buffer. */
-    if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
-        /* Nope.. clean up. */
-        free(rom->rom);
+    /* An image that fills the whole buffer can be used straight from a ROM pack. */
+    if ((addr < 0x40000) && (addr & 0x03ffff))
         rom->rom = NULL;
-        return (-1);
+    else
+        rom->rom = rom_map(fn, sz, off);
+
+    if (rom->rom == NULL) {
+        /* Allocate a buffer for the image. */
+        rom->rom = malloc(sz);
+        memset(rom->rom, 0xff, sz);
+
+        /* Load the image file into the buffer. */
+        if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
+            /* Nope.. clean up. */
+            free(rom->rom);
+            rom->rom = NULL;
+            return (-1);
+        }
     }
 
     rom->sz   = sz;
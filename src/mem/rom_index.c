@@ -0,0 +1,493 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Index of the files in the ROM paths.
+ *
+ *          Checking which machines and cards are available asks for
+ *          thousands of ROM files, most of which are not there, and each
+ *          of those used to cost a failed open per ROM path. Instead,
+ *          every ROM path is listed once into a hash set of the names in
+ *          it. The listing is saved in the global data directory along
+ *          with the modification time of each directory, so that as long
+ *          as none of them has changed, the next start only has to look
+ *          at the directories rather than list them again.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#ifdef _WIN32
+#    include <process.h>
+#    define getpid _getpid
+#else
+#    include <unistd.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/mem.h>
+#include <86box/rom.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/plat_dir.h>
+
+/* Hosts whose file names are usually not case sensitive. */
+#if defined(_WIN32) || defined(__APPLE__)
+#    define ROM_INDEX_NOCASE
+#endif
+
+#define ROM_INDEX_FILE  "rom_index.txt"
+#define ROM_INDEX_MAGIC "86Box ROM index 1"
+#define ROM_INDEX_DEPTH 16
+
+typedef struct rom_index_dir_t {
+    char   *path; /* Relative to the root, ending with a slash. */
+    int64_t mtime;
+} rom_index_dir_t;
+
+typedef struct rom_index_t {
+    char     root[1024];
+    int      missing; /* The root does not exist. */
+    int      failed;  /* A directory could not be listed. */
+    int64_t  scan_time;
+    char   **set; /* Relative names, directories end with a slash. */
+    uint32_t set_size;
+    uint32_t set_num;
+
+    rom_index_dir_t *dirs;
+    uint32_t         dirs_num;
+    uint32_t         dirs_size;
+
+    struct rom_index_t *next;
+} rom_index_t;
+
+static rom_index_t *rom_indexes;
+static int          rom_index_built;
+
+#ifdef ENABLE_ROM_INDEX_LOG
+int rom_index_do_log = ENABLE_ROM_INDEX_LOG;
+
+static void
+rom_index_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (rom_index_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define rom_index_log(fmt, ...)
+#endif
+
+static uint32_t
+rom_index_hash(const char *s)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    while (*s)
+        hash = (hash ^ (uint8_t) *s++) * 0x01000193;
+
+    return hash;
+}
+
+/* Turns a name into the form it is stored in. */
+static void
+rom_index_key(char *dest, const char *src, size_t size)
+{
+    size_t i;
+
+    for (i = 0; src[i] && (i < (size - 1)); i++) {
+#ifdef ROM_INDEX_NOCASE
+        dest[i] = (src[i] == '\\') ? '/' : tolower((uint8_t) src[i]);
+#else
+        dest[i] = (src[i] == '\\') ? '/' : src[i];
+#endif
+    }
+    dest[i] = '\0';
+}
+
+static int
+rom_index_find(const rom_index_t *idx, const char *key)
+{
+    uint32_t slot;
+
+    if (!idx->set_size)
+        return 0;
+
+    slot = rom_index_hash(key) & (idx->set_size - 1);
+    while (idx->set[slot] != NULL) {
+        if (!strcmp(idx->set[slot], key))
+            return 1;
+        slot = (slot + 1) & (idx->set_size - 1);
+    }
+
+    return 0;
+}
+
+static void
+rom_index_insert(rom_index_t *idx, const char *name)
+{
+    char     key[1024];
+    uint32_t slot;
+
+    rom_index_key(key, name, sizeof(key));
+    if (!key[0] || rom_index_find(idx, key))
+        return;
+
+    /* Keep the table at most half full. */
+    if (((idx->set_num + 1) * 2) > idx->set_size) {
+        char   **old      = idx->set;
+        uint32_t old_size = idx->set_size;
+
+        idx->set_size = old_size ? (old_size * 2) : 1024;
+        idx->set      = (char **) calloc(idx->set_size, sizeof(char *));
+        for (uint32_t i = 0; i < old_size; i++) {
+            if (old[i] == NULL)
+                continue;
+            slot = rom_index_hash(old[i]) & (idx->set_size - 1);
+            while (idx->set[slot] != NULL)
+                slot = (slot + 1) & (idx->set_size - 1);
+            idx->set[slot] = old[i];
+        }
+        free(old);
+    }
+
+    slot = rom_index_hash(key) & (idx->set_size - 1);
+    while (idx->set[slot] != NULL)
+        slot = (slot + 1) & (idx->set_size - 1);
+    idx->set[slot] = strdup(key);
+    idx->set_num++;
+}
+
+static void
+rom_index_add_dir(rom_index_t *idx, const char *path, int64_t mtime)
+{
+    if (idx->dirs_num == idx->dirs_size) {
+        idx->dirs_size = idx->dirs_size ? (idx->dirs_size * 2) : 64;
+        idx->dirs      = (rom_index_dir_t *) realloc(idx->dirs, idx->dirs_size * sizeof(rom_index_dir_t));
+    }
+
+    idx->dirs[idx->dirs_num].path  = strdup(path);
+    idx->dirs[idx->dirs_num].mtime = mtime;
+    idx->dirs_num++;
+}
+
+static void
+rom_index_free(rom_index_t *idx)
+{
+    for (uint32_t i = 0; i < idx->set_size; i++)
+        free(idx->set[i]);
+    for (uint32_t i = 0; i < idx->dirs_num; i++)
+        free(idx->dirs[i].path);
+    free(idx->set);
+    free(idx->dirs);
+    free(idx);
+}
+
+/* Goes through the platform, which takes UTF-8 paths on every host. */
+static int
+rom_index_stat(const char *fn, int64_t *mtime, int *is_dir)
+{
+    return plat_stat(fn, NULL, mtime, is_dir);
+}
+
+/* Lists a directory and everything below it, path is relative to the root. */
+static void
+rom_index_scan(rom_index_t *idx, const char *path, int depth)
+{
+    char           full[1024];
+    char           child[1024];
+    struct dirent *de;
+    DIR           *dirp;
+    int64_t        mtime;
+    int            is_dir;
+
+    snprintf(full, sizeof(full), "%s%s", idx->root, path);
+    if (!rom_index_stat(full, &mtime, &is_dir) || !is_dir) {
+        idx->missing |= (depth == 0);
+        return;
+    }
+
+#ifdef MAXDIRLEN
+    /* The opendir() of our own only takes short paths. */
+    if (strlen(full) > (MAXDIRLEN - 4)) {
+        idx->failed = 1;
+        return;
+    }
+#endif
+
+    dirp = opendir(full);
+    if (dirp == NULL) {
+        idx->failed = 1;
+        return;
+    }
+
+    rom_index_add_dir(idx, path, mtime);
+    rom_index_insert(idx, path);
+
+    while ((de = readdir(dirp)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+
+        snprintf(child, sizeof(child), "%s%s", path, de->d_name);
+
+#ifdef DT_DIR
+        if ((de->d_type != DT_UNKNOWN) && (de->d_type != DT_LNK))
+            is_dir = (de->d_type == DT_DIR);
+        else
+#endif
+        {
+            snprintf(full, sizeof(full), "%s%s", idx->root, child);
+            if (!rom_index_stat(full, &mtime, &is_dir))
+                continue;
+        }
+
+        if (!is_dir)
+            rom_index_insert(idx, child);
+        else if (depth < ROM_INDEX_DEPTH) {
+            path_slash(child);
+            rom_index_scan(idx, child, depth + 1);
+        }
+    }
+
+    closedir(dirp);
+}
+
+/* Whether no directory has changed since the index was made. */
+static int
+rom_index_valid(const rom_index_t *idx)
+{
+    char    full[1024];
+    int64_t mtime;
+    int     is_dir;
+
+    if (!idx->dirs_num)
+        return 0;
+
+    for (uint32_t i = 0; i < idx->dirs_num; i++) {
+        snprintf(full, sizeof(full), "%s%s", idx->root, idx->dirs[i].path);
+
+        /* A listing made in the same second the directory was changed in
+           may have missed that change. */
+        if (!rom_index_stat(full, &mtime, &is_dir) || (mtime != idx->dirs[i].mtime) ||
+            (mtime >= idx->scan_time))
+            return 0;
+    }
+
+    return 1;
+}
+
+static void
+rom_index_get_file(char *fn, size_t size)
+{
+    char dir[1024] = { 0 };
+
+    plat_get_global_data_dir(dir, 255);
+    if (!dir[0]) {
+        fn[0] = '\0';
+        return;
+    }
+
+    path_slash(dir);
+    snprintf(fn, size, "%s%s", dir, ROM_INDEX_FILE);
+}
+
+static rom_index_t *
+rom_index_load(void)
+{
+    char         fn[1024];
+    char         line[2048];
+    rom_index_t *list = NULL;
+    rom_index_t *idx  = NULL;
+    FILE        *fp;
+    char        *p;
+    int64_t      mtime;
+
+    rom_index_get_file(fn, sizeof(fn));
+    if (!fn[0] || ((fp = plat_fopen(fn, "r")) == NULL))
+        return NULL;
+
+    if ((fgets(line, sizeof(line), fp) == NULL) || strncmp(line, ROM_INDEX_MAGIC, strlen(ROM_INDEX_MAGIC))) {
+        fclose(fp);
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((line[0] == '\0') || (line[1] != ' '))
+            continue;
+
+        if (line[0] == 'R') {
+            idx = (rom_index_t *) calloc(1, sizeof(rom_index_t));
+            snprintf(idx->root, sizeof(idx->root), "%s", &line[2]);
+            idx->next = list;
+            list      = idx;
+        } else if (idx == NULL)
+            continue;
+        else if (line[0] == 'T')
+            idx->scan_time = strtoll(&line[2], NULL, 10);
+        else if (line[0] == 'D') {
+            mtime = strtoll(&line[2], &p, 10);
+            if (*p == ' ')
+                rom_index_add_dir(idx, p + 1, mtime);
+        } else if (line[0] == 'F')
+            rom_index_insert(idx, &line[2]);
+    }
+
+    fclose(fp);
+
+    return list;
+}
+
+static void
+rom_index_save(void)
+{
+    char  fn[1024];
+    char  temp[1040];
+    FILE *fp;
+
+    rom_index_get_file(fn, sizeof(fn));
+    if (!fn[0])
+        return;
+
+    /* Other instances may be reading it, so replace it in one go. The name
+       of the copy is our own, as other instances may be saving one too. */
+    snprintf(temp, sizeof(temp), "%s.%i", fn, (int) getpid());
+    if ((fp = plat_fopen(temp, "w")) == NULL)
+        return;
+
+    fprintf(fp, "%s\n", ROM_INDEX_MAGIC);
+    for (rom_index_t *idx = rom_indexes; idx != NULL; idx = idx->next) {
+        if (!idx->dirs_num || idx->failed)
+            continue;
+
+        fprintf(fp, "R %s\n", idx->root);
+        fprintf(fp, "T %" PRIi64 "\n", idx->scan_time);
+        for (uint32_t i = 0; i < idx->dirs_num; i++)
+            fprintf(fp, "D %" PRIi64 " %s\n", idx->dirs[i].mtime, idx->dirs[i].path);
+        for (uint32_t i = 0; i < idx->set_size; i++) {
+            if (idx->set[i] != NULL)
+                fprintf(fp, "F %s\n", idx->set[i]);
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        plat_remove(temp);
+        return;
+    }
+
+    if (plat_rename(temp, fn) != 0)
+        plat_remove(temp);
+}
+
+static void
+rom_index_build(void)
+{
+    rom_index_t  *loaded = rom_index_load();
+    rom_index_t **tail   = &rom_indexes;
+    rom_index_t **prev;
+    rom_index_t  *idx;
+    int           dirty = 0;
+
+    for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
+        if (!rom_path->path[0])
+            continue;
+
+        for (prev = &loaded; *prev != NULL; prev = &(*prev)->next) {
+            if (!strcmp((*prev)->root, rom_path->path))
+                break;
+        }
+
+        idx = *prev;
+        if (idx != NULL) {
+            *prev     = idx->next;
+            idx->next = NULL;
+            if (!rom_index_valid(idx)) {
+                rom_index_log("ROM index: %s has changed\n", rom_path->path);
+                rom_index_free(idx);
+                idx = NULL;
+            }
+        }
+
+        if (idx == NULL) {
+            idx = (rom_index_t *) calloc(1, sizeof(rom_index_t));
+            snprintf(idx->root, sizeof(idx->root), "%s", rom_path->path);
+            idx->scan_time = (int64_t) time(NULL);
+            rom_index_scan(idx, "", 0);
+            dirty |= !idx->missing;
+        }
+
+        rom_index_log("ROM index: %s, %u names in %u directories\n", idx->root, idx->set_num, idx->dirs_num);
+
+        *tail = idx;
+        tail  = &idx->next;
+    }
+
+    while (loaded != NULL) {
+        idx    = loaded;
+        loaded = idx->next;
+        rom_index_free(idx);
+    }
+
+    if (dirty)
+        rom_index_save();
+
+    rom_index_built = 1;
+}
+
+/* Drops the index, it is made again on the next lookup. */
+void
+rom_index_reset(void)
+{
+    rom_index_t *idx;
+
+    while (rom_indexes != NULL) {
+        idx         = rom_indexes;
+        rom_indexes = idx->next;
+        rom_index_free(idx);
+    }
+
+    rom_index_built = 0;
+}
+
+int
+rom_index_has(const char *root, const char *fn)
+{
+    char key[1024];
+
+    if (!rom_index_built)
+        rom_index_build();
+
+    for (rom_index_t *idx = rom_indexes; idx != NULL; idx = idx->next) {
+        if (strcmp(idx->root, root))
+            continue;
+
+        if (idx->missing)
+            return 0;
+        if (idx->failed)
+            return -1;
+
+        rom_index_key(key, fn, sizeof(key));
+        return rom_index_find(idx, key);
+    }
+
+    return -1;
+}
@@ -0,0 +1,596 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Handling of ROM packs.
+ *
+ *          A ROM pack is a single file holding a whole ROM tree, which
+ *          is put into a ROM path as roms.pak and mapped into memory
+ *          once. Its directory is sorted by name, so that a lookup is a
+ *          binary search, and each image starts on a page of its own,
+ *          so that ROMs which are used as they are can be mapped from
+ *          the pack copy-on-write instead of being read into memory of
+ *          their own. All instances started from the same pack then
+ *          share its pages through the page cache.
+ *
+ *          The file starts with the header, followed by the directory,
+ *          the names, and the images. All numbers are little endian.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#ifdef _WIN32
+#    include <process.h>
+#    define getpid _getpid
+#else
+#    include <unistd.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/mem.h>
+#include <86box/rom.h>
+#include <86box/nvr.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/plat_dir.h>
+
+/* Hosts whose file names are usually not case sensitive. */
+#if defined(_WIN32) || defined(__APPLE__)
+#    define ROM_PACK_NOCASE
+#endif
+
+#define ROM_PACK_MAGIC   "86BoxPAK"
+#define ROM_PACK_VERSION 1
+#define ROM_PACK_ALIGN   4096
+#define ROM_PACK_DEPTH   16
+
+/* The dword reads of the ROM handlers may go up to 3 bytes past the end. */
+#define ROM_PACK_SLACK 4
+
+typedef struct rom_pack_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t num;        /* Directory entries. */
+    uint32_t names_size; /* Bytes of names, each ending with a NUL. */
+    uint32_t reserved[3];
+} rom_pack_header_t;
+
+typedef struct rom_pack_entry_t {
+    uint64_t offset; /* Of the image, from the start of the file. */
+    uint32_t size;
+    uint32_t name; /* Offset of the name among the names. */
+} rom_pack_entry_t;
+
+typedef struct rom_pack_t {
+    char     root[1024];
+    char     path[1024];
+    uint8_t *map;
+    uint64_t map_size;
+
+    const rom_pack_entry_t *entries;
+    uint32_t                num;
+    const char             *names;
+
+    struct rom_pack_t *next;
+} rom_pack_t;
+
+typedef struct rom_pack_view_t {
+    uint8_t *ptr;
+    uint64_t offset;
+    uint32_t size;
+
+    struct rom_pack_view_t *next;
+} rom_pack_view_t;
+
+typedef struct rom_pack_item_t {
+    char    *name;
+    uint32_t size;
+    uint64_t offset;
+} rom_pack_item_t;
+
+typedef struct rom_pack_list_t {
+    const char      *root;
+    rom_pack_item_t *items;
+    uint32_t         num;
+    uint32_t         size;
+} rom_pack_list_t;
+
+static rom_pack_t      *rom_packs;
+static rom_pack_view_t *rom_pack_views;
+static int              rom_packs_opened;
+
+#ifdef ENABLE_ROM_PACK_LOG
+int rom_pack_do_log = ENABLE_ROM_PACK_LOG;
+
+static void
+rom_pack_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (rom_pack_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define rom_pack_log(fmt, ...)
+#endif
+
+/* Names are sorted without regard to case, so that the same pack can be
+   searched on hosts with and without case sensitive file names. */
+static int
+rom_pack_cmp(const char *a, const char *b)
+{
+    int ca;
+    int cb;
+
+    do {
+        ca = tolower((uint8_t) *a++);
+        cb = tolower((uint8_t) *b++);
+    } while (ca && (ca == cb));
+
+    return ca - cb;
+}
+
+static int
+rom_pack_item_cmp(const void *a, const void *b)
+{
+    const rom_pack_item_t *ia = (const rom_pack_item_t *) a;
+    const rom_pack_item_t *ib = (const rom_pack_item_t *) b;
+    int                    ret;
+
+    ret = rom_pack_cmp(ia->name, ib->name);
+    if (!ret)
+        ret = strcmp(ia->name, ib->name);
+
+    return ret;
+}
+
+static void
+rom_pack_open(rom_pack_t *pack)
+{
+    const rom_pack_header_t *hdr;
+    const rom_pack_entry_t  *entry;
+    uint64_t                 dir_end;
+
+    snprintf(pack->path, sizeof(pack->path), "%s%s", pack->root, ROM_PACK_FILE);
+    pack->map = (uint8_t *) plat_mmap_file(pack->path, &pack->map_size);
+    if (pack->map == NULL)
+        return;
+
+    hdr = (const rom_pack_header_t *) pack->map;
+    if ((pack->map_size < sizeof(rom_pack_header_t)) || memcmp(hdr->magic, ROM_PACK_MAGIC, sizeof(hdr->magic)) ||
+        (hdr->version != ROM_PACK_VERSION))
+        goto bad;
+
+    dir_end = sizeof(rom_pack_header_t) + ((uint64_t) hdr->num * sizeof(rom_pack_entry_t)) + hdr->names_size;
+    if ((dir_end > pack->map_size) || !hdr->names_size)
+        goto bad;
+
+    pack->entries = (const rom_pack_entry_t *) &pack->map[sizeof(rom_pack_header_t)];
+    pack->names   = (const char *) &pack->entries[hdr->num];
+    if (pack->names[hdr->names_size - 1] != '\0')
+        goto bad;
+
+    for (uint32_t i = 0; i < hdr->num; i++) {
+        entry = &pack->entries[i];
+        if ((entry->name >= hdr->names_size) || (entry->offset > pack->map_size) ||
+            (entry->size > (pack->map_size - entry->offset)))
+            goto bad;
+    }
+
+    pack->num = hdr->num;
+    rom_pack_log("ROM pack: %s, %u images\n", pack->path, pack->num);
+    return;
+
+bad:
+    rom_pack_log("ROM pack: %s is not valid\n", pack->path);
+    plat_munmap_file(pack->map, pack->map_size);
+    pack->map = NULL;
+}
+
+/* Maps the packs of ROM paths not seen yet. A pack stays mapped for as long
+   as the emulator runs, as ROMs may point into it. */
+static void
+rom_pack_open_all(void)
+{
+    rom_pack_t **tail;
+    rom_pack_t  *pack;
+
+    for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
+        if (!rom_path->path[0])
+            continue;
+
+        for (tail = &rom_packs; *tail != NULL; tail = &(*tail)->next) {
+            if (!strcmp((*tail)->root, rom_path->path))
+                break;
+        }
+
+        if (*tail != NULL)
+            continue;
+
+        pack = (rom_pack_t *) calloc(1, sizeof(rom_pack_t));
+        snprintf(pack->root, sizeof(pack->root), "%s", rom_path->path);
+
+        /* Skip the open if the index knows there is no pack. */
+        if (rom_index_has(pack->root, ROM_PACK_FILE))
+            rom_pack_open(pack);
+
+        *tail = pack;
+    }
+
+    rom_packs_opened = 1;
+}
+
+/* Makes the packs of new ROM paths be looked at on the next lookup. */
+void
+rom_pack_reset(void)
+{
+    rom_packs_opened = 0;
+}
+
+int
+rom_pack_find(const char *root, const char *fn, rom_pack_file_t *file)
+{
+    char                    key[1024];
+    const rom_pack_entry_t *entry;
+    const char             *name;
+    uint32_t                lo;
+    uint32_t                hi;
+    uint32_t                mid;
+    size_t                  i;
+
+    if (!rom_packs_opened)
+        rom_pack_open_all();
+
+    for (i = 0; fn[i] && (i < (sizeof(key) - 1)); i++)
+        key[i] = (fn[i] == '\\') ? '/' : fn[i];
+    key[i] = '\0';
+
+    for (const rom_pack_t *pack = rom_packs; pack != NULL; pack = pack->next) {
+        if ((pack->map == NULL) || strcmp(pack->root, root))
+            continue;
+
+        /* Find the first name that matches without regard to case. */
+        lo = 0;
+        hi = pack->num;
+        while (lo < hi) {
+            mid = lo + ((hi - lo) >> 1);
+            if (rom_pack_cmp(&pack->names[pack->entries[mid].name], key) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        for (; lo < pack->num; lo++) {
+            entry = &pack->entries[lo];
+            name  = &pack->names[entry->name];
+            if (rom_pack_cmp(name, key))
+                break;
+#ifndef ROM_PACK_NOCASE
+            if (strcmp(name, key))
+                continue;
+#endif
+
+            file->data   = &pack->map[entry->offset];
+            file->size   = entry->size;
+            file->pack   = pack->path;
+            file->offset = entry->offset;
+            file->limit  = pack->map_size;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+/* Opens an image in a pack as a file, for code that reads ROMs through one. */
+FILE *
+rom_pack_fopen(const rom_pack_file_t *file)
+{
+    FILE *fp = NULL;
+
+#ifdef _WIN32
+    /* There is no fmemopen() on Windows, so copy the image into a temporary
+       file that goes away once closed. */
+    static int count = 0;
+    char       prefix[16];
+    char       temp[1024];
+
+    snprintf(prefix, sizeof(prefix), "rom%i", count++);
+    plat_tempfile(temp, prefix, ".tmp");
+    fp = plat_fopen(nvr_path(temp), "w+bD");
+    if ((fp != NULL) && (fwrite(file->data, 1, file->size, fp) != file->size)) {
+        fclose(fp);
+        return NULL;
+    }
+    if (fp != NULL)
+        rewind(fp);
+#else
+    fp = fmemopen((void *) file->data, file->size ? file->size : 1, "rb");
+    if ((fp != NULL) && !file->size)
+        (void) fseek(fp, 0, SEEK_END);
+#endif
+
+    return fp;
+}
+
+/* Maps size bytes of an image, starting at off, copy-on-write, so that they
+   can be patched without a copy of their own. Returns NULL if the part is
+   past the end of the image, or the pack can not be mapped again. */
+uint8_t *
+rom_pack_map(const rom_pack_file_t *file, uint32_t off, uint32_t size)
+{
+    rom_pack_view_t *view;
+    uint8_t         *ptr;
+    uint64_t         offset = file->offset + off;
+
+    if (!size || (off > file->size) || (size > (file->size - off)) ||
+        ((offset + size + ROM_PACK_SLACK) > file->limit))
+        return NULL;
+
+    ptr = (uint8_t *) plat_mmap_file_view(file->pack, offset, size + ROM_PACK_SLACK);
+    if (ptr == NULL)
+        return NULL;
+
+    /* The pack may have been replaced since its directory was read. */
+    if (memcmp(ptr, &file->data[off], size)) {
+        rom_pack_log("ROM pack: %s has changed\n", file->pack);
+        plat_munmap_file_view(ptr, offset, size + ROM_PACK_SLACK);
+        return NULL;
+    }
+
+    view         = (rom_pack_view_t *) calloc(1, sizeof(rom_pack_view_t));
+    view->ptr    = ptr;
+    view->offset = offset;
+    view->size   = size + ROM_PACK_SLACK;
+    view->next   = rom_pack_views;
+    rom_pack_views = view;
+
+    return ptr;
+}
+
+/* Returns 1 if the pointer came from rom_pack_map(), and unmaps it. */
+int
+rom_pack_unmap(uint8_t *ptr)
+{
+    rom_pack_view_t *view;
+
+    for (rom_pack_view_t **prev = &rom_pack_views; *prev != NULL; prev = &(*prev)->next) {
+        view = *prev;
+        if (view->ptr != ptr)
+            continue;
+
+        *prev = view->next;
+        plat_munmap_file_view(view->ptr, view->offset, view->size);
+        free(view);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Goes through the platform, which takes UTF-8 paths on every host. */
+static int
+rom_pack_stat(const char *fn, uint64_t *size, int *is_dir)
+{
+    return plat_stat(fn, size, NULL, is_dir);
+}
+
+/* Lists the files of a directory and everything below it, path is relative
+   to the root. */
+static int
+rom_pack_scan(rom_pack_list_t *list, const char *path, int depth)
+{
+    char           full[1024];
+    char           child[1024];
+    struct dirent *de;
+    DIR           *dirp;
+    uint64_t       size;
+    int            is_dir;
+    int            ret = 1;
+
+    snprintf(full, sizeof(full), "%s%s", list->root, path);
+
+#ifdef MAXDIRLEN
+    /* The opendir() of our own only takes short paths. */
+    if (strlen(full) > (MAXDIRLEN - 4)) {
+        rom_pack_log("ROM pack: %s is too long\n", full);
+        return 0;
+    }
+#endif
+
+    dirp = opendir(full);
+    if (dirp == NULL) {
+        rom_pack_log("ROM pack: unable to list %s\n", full);
+        return 0;
+    }
+
+    while (ret && ((de = readdir(dirp)) != NULL)) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+
+        /* Leave out the pack itself and any pack being made. */
+        if (!depth && !strncmp(de->d_name, ROM_PACK_FILE, strlen(ROM_PACK_FILE)))
+            continue;
+
+        snprintf(child, sizeof(child), "%s%s", path, de->d_name);
+        snprintf(full, sizeof(full), "%s%s", list->root, child);
+        if (!rom_pack_stat(full, &size, &is_dir))
+            continue;
+
+        if (is_dir) {
+            if (depth < ROM_PACK_DEPTH) {
+                path_slash(child);
+                ret = rom_pack_scan(list, child, depth + 1);
+            }
+            continue;
+        }
+
+        if (size > UINT32_MAX) {
+            rom_pack_log("ROM pack: %s is too large\n", full);
+            continue;
+        }
+
+        if (list->num == list->size) {
+            list->size  = list->size ? (list->size * 2) : 1024;
+            list->items = (rom_pack_item_t *) realloc(list->items, list->size * sizeof(rom_pack_item_t));
+        }
+
+        list->items[list->num].name = strdup(child);
+        list->items[list->num].size = (uint32_t) size;
+        list->num++;
+    }
+
+    closedir(dirp);
+
+    return ret;
+}
+
+static int
+rom_pack_pad(FILE *fp, uint64_t pos)
+{
+    static const uint8_t zero[ROM_PACK_ALIGN] = { 0 };
+
+    if (pos % ROM_PACK_ALIGN)
+        return fwrite(zero, 1, ROM_PACK_ALIGN - (pos % ROM_PACK_ALIGN), fp) == (ROM_PACK_ALIGN - (pos % ROM_PACK_ALIGN));
+
+    return 1;
+}
+
+static int
+rom_pack_write(FILE *fp, rom_pack_list_t *list)
+{
+    rom_pack_header_t hdr = { 0 };
+    rom_pack_entry_t  entry;
+    uint8_t           buf[65536];
+    char              full[1024];
+    FILE             *in;
+    uint64_t          pos;
+    uint32_t          left;
+    size_t            len;
+    uint32_t          i;
+
+    memcpy(hdr.magic, ROM_PACK_MAGIC, sizeof(hdr.magic));
+    hdr.version = ROM_PACK_VERSION;
+    hdr.num     = list->num;
+    for (i = 0; i < list->num; i++)
+        hdr.names_size += (uint32_t) strlen(list->items[i].name) + 1;
+
+    /* Lay the images out after the directory, each on a page of its own. */
+    pos = sizeof(rom_pack_header_t) + ((uint64_t) list->num * sizeof(rom_pack_entry_t)) + hdr.names_size;
+    for (i = 0; i < list->num; i++) {
+        pos                   = (pos + ROM_PACK_ALIGN - 1) & ~((uint64_t) ROM_PACK_ALIGN - 1);
+        list->items[i].offset = pos;
+        pos += list->items[i].size;
+    }
+
+    if (fwrite(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr))
+        return 0;
+
+    entry.name = 0;
+    for (i = 0; i < list->num; i++) {
+        entry.offset = list->items[i].offset;
+        entry.size   = list->items[i].size;
+        if (fwrite(&entry, 1, sizeof(entry), fp) != sizeof(entry))
+            return 0;
+        entry.name += (uint32_t) strlen(list->items[i].name) + 1;
+    }
+
+    for (i = 0; i < list->num; i++) {
+        len = strlen(list->items[i].name) + 1;
+        if (fwrite(list->items[i].name, 1, len, fp) != len)
+            return 0;
+    }
+
+    pos = sizeof(rom_pack_header_t) + ((uint64_t) list->num * sizeof(rom_pack_entry_t)) + hdr.names_size;
+    for (i = 0; i < list->num; i++) {
+        if (!rom_pack_pad(fp, pos))
+            return 0;
+        pos = list->items[i].offset;
+
+        snprintf(full, sizeof(full), "%s%s", list->root, list->items[i].name);
+        if ((in = plat_fopen(full, "rb")) == NULL) {
+            rom_pack_log("ROM pack: unable to open %s\n", full);
+            return 0;
+        }
+
+        for (left = list->items[i].size; left > 0; left -= (uint32_t) len) {
+            len = fread(buf, 1, MIN(left, sizeof(buf)), in);
+            if (!len || (fwrite(buf, 1, len, fp) != len))
+                break;
+        }
+
+        /* The file has changed while being packed. */
+        if (left || (fgetc(in) != EOF)) {
+            rom_pack_log("ROM pack: %s has changed\n", full);
+            fclose(in);
+            return 0;
+        }
+
+        fclose(in);
+        pos += list->items[i].size;
+    }
+
+    return rom_pack_pad(fp, pos);
+}
+
+/* Packs the ROM tree at the given path into a pack in that path, replacing
+   any pack that was there. Returns the number of images, or -1 on error. */
+int
+rom_pack_build(const char *root)
+{
+    rom_pack_list_t list = { 0 };
+    char            dir[1024];
+    char            fn[1024];
+    char            temp[1040];
+    FILE           *fp;
+    int             ok;
+    int             ret = -1;
+
+    snprintf(dir, sizeof(dir), "%s", root);
+    path_slash(dir);
+    list.root = dir;
+
+    if (rom_pack_scan(&list, "", 0)) {
+        qsort(list.items, list.num, sizeof(rom_pack_item_t), rom_pack_item_cmp);
+
+        /* Instances may be running from it, so replace it in one go. */
+        snprintf(fn, sizeof(fn), "%s%s", dir, ROM_PACK_FILE);
+        snprintf(temp, sizeof(temp), "%s.%i", fn, (int) getpid());
+        if ((fp = plat_fopen(temp, "wb")) != NULL) {
+            ok = rom_pack_write(fp, &list);
+            ok &= (fclose(fp) == 0);
+            if (ok) {
+                if (plat_rename(temp, fn) == 0)
+                    ret = (int) list.num;
+            }
+
+            if (ret == -1)
+                plat_remove(temp);
+        }
+    }
+
+    for (uint32_t i = 0; i < list.num; i++)
+        free(list.items[i].name);
+    free(list.items);
+
+    return ret;
+}
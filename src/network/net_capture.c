@@ -0,0 +1,416 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          pcapng traffic recorder.
+ *
+ *          The emulation thread copies the frames a card sends and
+ *          receives into a ring, without taking any lock, and a writer
+ *          thread per card turns them into pcapng blocks. Timestamps
+ *          are in nanoseconds of emulated time, counted from the wall
+ *          clock time the capture was started at. Frames are dropped,
+ *          and counted, if the writer falls behind.
+ *
+ *          A rolling capture keeps the current file and the previous
+ *          one, each up to half of the configured size, so that the
+ *          last part of the traffic is always on disk.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/net_capture.h>
+
+#define CAPTURE_RING_SIZE (1 << 20) /* Must be a power of 2. */
+#define CAPTURE_RING_MASK (CAPTURE_RING_SIZE - 1)
+#define CAPTURE_REC_WRAP  0xffffffff
+#define CAPTURE_FLUSH_MS  100
+
+#define PCAPNG_SHB        0x0a0d0d0a
+#define PCAPNG_IDB        0x00000001
+#define PCAPNG_EPB        0x00000006
+#define PCAPNG_ISB        0x00000005
+#define PCAPNG_MAGIC      0x1a2b3c4d
+#define PCAPNG_LINK_ETHER 1
+
+/* Ring record header, records are aligned to its size. */
+typedef struct capture_rec_t {
+    uint32_t len;
+    uint32_t dir;
+    uint64_t ts;
+} capture_rec_t;
+
+struct net_capture_t {
+    uint8_t    *ring;
+    atomic_uint head; /* Written by the emulation thread only */
+    atomic_uint tail; /* Written by the writer thread only */
+    atomic_uint dropped;
+    atomic_int  stop;
+    event_t    *wake;
+    thread_t   *thread;
+
+    /* Emulated time, only used by the emulation thread. */
+    uint64_t tsc_last;
+    uint64_t ns;
+    uint64_t ns_base;
+
+    /* Output, only used by the writer thread. */
+    FILE    *fp;
+    uint64_t file_size;
+    uint64_t limit;
+    uint64_t received;
+    int      card_num;
+    char     fn[1024];
+    char     fn_prev[1024];
+};
+
+#ifdef ENABLE_NET_CAPTURE_LOG
+int net_capture_do_log = ENABLE_NET_CAPTURE_LOG;
+
+static void
+net_capture_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (net_capture_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define net_capture_log(fmt, ...)
+#endif
+
+static int
+net_capture_write(net_capture_t *cap, const void *data, size_t len)
+{
+    if (fwrite(data, 1, len, cap->fp) != len)
+        return 0;
+
+    cap->file_size += len;
+    return 1;
+}
+
+static int
+net_capture_write_header(net_capture_t *cap)
+{
+    char     name[32];
+    uint32_t name_len;
+    uint32_t shb[7];
+    uint32_t idb[4];
+    uint32_t opt[2];
+    uint8_t  tsresol[4] = { 9, 0, 0, 0 }; /* 10^-9 s */
+    uint32_t trailer;
+    uint8_t  pad[4] = { 0, 0, 0, 0 };
+
+    shb[0] = PCAPNG_SHB;
+    shb[1] = sizeof(shb);
+    shb[2] = PCAPNG_MAGIC;
+    shb[3] = 0x00000001; /* Version 1.0 */
+    shb[4] = 0xffffffff; /* Section length not specified */
+    shb[5] = 0xffffffff;
+    shb[6] = sizeof(shb);
+
+    snprintf(name, sizeof(name), "net_%02i", cap->card_num + 1);
+    name_len = (uint32_t) strlen(name);
+
+    idb[0] = PCAPNG_IDB;
+    idb[1] = sizeof(idb) + 8 + 4 + ((name_len + 3) & ~3) + 4 + 4;
+    idb[2] = PCAPNG_LINK_ETHER;
+    idb[3] = 0; /* No snapshot length */
+    trailer = idb[1];
+
+    if (!net_capture_write(cap, shb, sizeof(shb)) ||
+        !net_capture_write(cap, idb, sizeof(idb)))
+        return 0;
+
+    /* if_tsresol */
+    opt[0] = 9 | (1 << 16);
+    if (!net_capture_write(cap, opt, 4) || !net_capture_write(cap, tsresol, 4))
+        return 0;
+
+    /* if_name */
+    opt[0] = 2 | (name_len << 16);
+    if (!net_capture_write(cap, opt, 4) || !net_capture_write(cap, name, name_len) ||
+        !net_capture_write(cap, pad, ((name_len + 3) & ~3) - name_len))
+        return 0;
+
+    /* opt_endofopt */
+    opt[0] = 0;
+    return net_capture_write(cap, opt, 4) && net_capture_write(cap, &trailer, 4);
+}
+
+static int
+net_capture_open_file(net_capture_t *cap)
+{
+    cap->fp = plat_fopen(cap->fn, "wb");
+    if (cap->fp == NULL) {
+        net_capture_log("Capture %i: Unable to create %s\n", cap->card_num + 1, cap->fn);
+        return 0;
+    }
+
+    cap->file_size = 0;
+    return net_capture_write_header(cap);
+}
+
+/* Start a new file, keeping the current one as the previous part. */
+static int
+net_capture_rotate(net_capture_t *cap)
+{
+    fclose(cap->fp);
+    cap->fp = NULL;
+
+    /* If the current file can not become the previous part, keep appending
+       to it rather than truncating it, and try again once it has grown by
+       another half of the limit. */
+    if (plat_rename(cap->fn, cap->fn_prev) != 0) {
+        net_capture_log("Capture %i: Unable to rename %s\n", cap->card_num + 1, cap->fn);
+        cap->fp        = plat_fopen(cap->fn, "ab");
+        cap->file_size = 0;
+        return cap->fp != NULL;
+    }
+
+    return net_capture_open_file(cap);
+}
+
+static void
+net_capture_write_packet(net_capture_t *cap, const capture_rec_t *rec, const uint8_t *data)
+{
+    uint32_t epb[7];
+    uint32_t opt[3];
+    uint32_t padded = (rec->len + 3) & ~3;
+    uint8_t  pad[4] = { 0, 0, 0, 0 };
+
+    epb[0] = PCAPNG_EPB;
+    epb[1] = sizeof(epb) + padded + sizeof(opt) + 4;
+    epb[2] = 0; /* Interface */
+    epb[3] = (uint32_t) (rec->ts >> 32);
+    epb[4] = (uint32_t) rec->ts;
+    epb[5] = rec->len;
+    epb[6] = rec->len;
+
+    if (cap->limit && ((cap->file_size + epb[1]) > (cap->limit / 2)) && !net_capture_rotate(cap))
+        return;
+
+    /* epb_flags, with the direction, then opt_endofopt. */
+    opt[0] = 2 | (4 << 16);
+    opt[1] = rec->dir;
+    opt[2] = 0;
+
+    if (!net_capture_write(cap, epb, sizeof(epb)) ||
+        !net_capture_write(cap, data, rec->len) ||
+        !net_capture_write(cap, pad, padded - rec->len) ||
+        !net_capture_write(cap, opt, sizeof(opt)) ||
+        !net_capture_write(cap, &epb[1], 4))
+        net_capture_log("Capture %i: Write error\n", cap->card_num + 1);
+
+    cap->received++;
+}
+
+/* Interface statistics, with the number of frames dropped from the ring. */
+static void
+net_capture_write_stats(net_capture_t *cap)
+{
+    uint32_t isb[13];
+    uint64_t dropped = atomic_load(&cap->dropped);
+
+    isb[0]  = PCAPNG_ISB;
+    isb[1]  = sizeof(isb);
+    isb[2]  = 0; /* Interface */
+    isb[3]  = 0; /* No timestamp */
+    isb[4]  = 0;
+    isb[5]  = 4 | (8 << 16); /* isb_ifrecv */
+    isb[6]  = (uint32_t) (cap->received + dropped);
+    isb[7]  = (uint32_t) ((cap->received + dropped) >> 32);
+    isb[8]  = 5 | (8 << 16); /* isb_ifdrop */
+    isb[9]  = (uint32_t) dropped;
+    isb[10] = 0;
+    isb[11] = 0; /* opt_endofopt */
+    isb[12] = sizeof(isb);
+
+    net_capture_write(cap, isb, sizeof(isb));
+}
+
+static void
+net_capture_drain(net_capture_t *cap)
+{
+    uint32_t head = atomic_load_explicit(&cap->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&cap->tail, memory_order_relaxed);
+
+    while (tail != head) {
+        uint32_t      off = tail & CAPTURE_RING_MASK;
+        capture_rec_t rec;
+
+        memcpy(&rec, &cap->ring[off], sizeof(rec));
+        if (rec.len == CAPTURE_REC_WRAP)
+            tail += CAPTURE_RING_SIZE - off;
+        else {
+            if (cap->fp != NULL)
+                net_capture_write_packet(cap, &rec, &cap->ring[off + sizeof(rec)]);
+            tail += (sizeof(rec) + rec.len + sizeof(rec) - 1) & ~(sizeof(rec) - 1);
+        }
+
+        atomic_store_explicit(&cap->tail, tail, memory_order_release);
+    }
+
+    if (cap->fp != NULL)
+        fflush(cap->fp);
+}
+
+static void
+net_capture_thread(void *priv)
+{
+    net_capture_t *cap = (net_capture_t *) priv;
+
+    net_capture_log("Capture %i: Writer started.\n", cap->card_num + 1);
+
+    while (!atomic_load(&cap->stop)) {
+        thread_wait_event(cap->wake, CAPTURE_FLUSH_MS);
+        thread_reset_event(cap->wake);
+
+        net_capture_drain(cap);
+    }
+
+    net_capture_drain(cap);
+
+    net_capture_log("Capture %i: Writer stopped.\n", cap->card_num + 1);
+}
+
+net_capture_t *
+net_capture_open(int card_num, uint32_t limit)
+{
+    net_capture_t *cap = calloc(1, sizeof(net_capture_t));
+    char           temp[64];
+
+    if (cap == NULL)
+        return NULL;
+
+    /* Before the file is created, so that a failure leaves nothing behind. */
+    cap->ring = malloc(CAPTURE_RING_SIZE);
+    if (cap->ring == NULL) {
+        net_capture_log("Capture %i: Unable to allocate the ring buffer\n", card_num + 1);
+        free(cap);
+        return NULL;
+    }
+
+    cap->card_num = card_num;
+    cap->limit    = ((uint64_t) limit) << 20;
+
+    sprintf(temp, "net_%02i.pcapng", card_num + 1);
+    path_append_filename(cap->fn, usr_path, temp);
+    sprintf(temp, "net_%02i.1.pcapng", card_num + 1);
+    path_append_filename(cap->fn_prev, usr_path, temp);
+
+    if (!net_capture_open_file(cap)) {
+        if (cap->fp != NULL)
+            fclose(cap->fp);
+        free(cap->ring);
+        free(cap);
+        return NULL;
+    }
+
+    cap->ns_base  = ((uint64_t) time(NULL)) * 1000000000ULL;
+    cap->tsc_last = tsc;
+    cap->wake     = thread_create_event();
+    cap->thread   = thread_create(net_capture_thread, cap);
+
+    net_capture_log("Capture %i: Recording to %s\n", card_num + 1, cap->fn);
+
+    return cap;
+}
+
+/* Called from the emulation thread only. */
+void
+net_capture_packet(net_capture_t *cap, const uint8_t *data, int len, int dir)
+{
+    capture_rec_t rec;
+    uint32_t      head;
+    uint32_t      tail;
+    uint32_t      off;
+    uint32_t      total;
+    uint32_t      contig;
+    uint64_t      now = tsc;
+
+    if ((cap == NULL) || (len <= 0))
+        return;
+
+    /* Advance emulated time at the current rate, so that a CPU speed
+       change does not move the earlier timestamps. */
+    if ((now > cap->tsc_last) && TIMER_USEC)
+        cap->ns += (uint64_t) (((double) (now - cap->tsc_last)) * (1000.0 * 4294967296.0) / ((double) TIMER_USEC));
+    cap->tsc_last = now;
+
+    total  = (sizeof(rec) + len + sizeof(rec) - 1) & ~(sizeof(rec) - 1);
+    head   = atomic_load_explicit(&cap->head, memory_order_relaxed);
+    tail   = atomic_load_explicit(&cap->tail, memory_order_acquire);
+    off    = head & CAPTURE_RING_MASK;
+    contig = CAPTURE_RING_SIZE - off;
+
+    if ((CAPTURE_RING_SIZE - (head - tail)) < (total + ((contig < total) ? contig : 0))) {
+        atomic_fetch_add(&cap->dropped, 1);
+        return;
+    }
+
+    if (contig < total) {
+        rec.len = CAPTURE_REC_WRAP;
+        memcpy(&cap->ring[off], &rec, sizeof(rec.len));
+        head += contig;
+        off = 0;
+    }
+
+    rec.len = len;
+    rec.dir = dir;
+    rec.ts  = cap->ns_base + cap->ns;
+    memcpy(&cap->ring[off], &rec, sizeof(rec));
+    memcpy(&cap->ring[off + sizeof(rec)], data, len);
+
+    head += total;
+    atomic_store_explicit(&cap->head, head, memory_order_release);
+
+    /* Only wake the writer early when the ring starts filling up. */
+    if ((head - tail) > (CAPTURE_RING_SIZE / 4))
+        thread_set_event(cap->wake);
+}
+
+void
+net_capture_close(net_capture_t *cap)
+{
+    if (cap == NULL)
+        return;
+
+    atomic_store(&cap->stop, 1);
+    thread_set_event(cap->wake);
+    thread_wait(cap->thread);
+
+    if (cap->fp != NULL) {
+        net_capture_write_stats(cap);
+        fclose(cap->fp);
+    }
+
+    net_capture_log("Capture %i: %llu frames recorded, %u dropped\n", cap->card_num + 1,
+                    (unsigned long long) cap->received, atomic_load(&cap->dropped));
+
+    thread_destroy_event(cap->wake);
+    free(cap->ring);
+    free(cap);
+}
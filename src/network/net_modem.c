@@ -39,6 +39,7 @@
 #include <86box/version.h>
 #include <86box/plat_unused.h>
 #include <86box/plat_netsocket.h>
+#include <86box/net_modem_pool.h>
 
 #ifdef ENABLE_MODEM_LOG
 int modem_do_log = ENABLE_MODEM_LOG;
@@ -144,10 +145,13 @@ typedef struct modem_t {
     int listen_port;
     int ringtimer;
 
-    SOCKET serversocket;
     SOCKET clientsocket;
     SOCKET waitingclientsocket;
 
+    modem_line_t *line;        /* Incoming calls, shared with other modems. */
+    bool          line_call;   /* The call came in on the line. */
+    bool          line_signal; /* The line has something for the modem. */
+
     struct {
         bool    binary[2];
         bool    echo[2];
@@ -432,7 +436,10 @@ modem_data_mode_process_byte(modem_t *modem, uint8_t data)
 static void
 host_to_modem_cb(void *priv)
 {
-    modem_t *modem = (modem_t *) priv;
+    modem_t       *modem = (modem_t *) priv;
+    const uint8_t *buf;
+    uint32_t       len;
+    int            sent  = 1;
 
     if (modem->in_warmup || (modem->serial == NULL))
         goto no_write_to_machine;
@@ -451,7 +458,16 @@ host_to_modem_cb(void *priv)
         goto no_write_to_machine;
 
     if (modem->mode == MODEM_MODE_DATA && fifo8_num_used(&modem->rx_data) && !modem->cooldown) {
-        serial_write_fifo(modem->serial, fifo8_pop(&modem->rx_data));
+        /* At high rates the UART takes a FIFO worth of data at once, the next
+           run then waits for as many character times. */
+        if ((len = serial_get_burst_len(modem->serial)) > 1) {
+            buf  = fifo8_peek_bufptr(&modem->rx_data, len, &len);
+            sent = serial_write_fifo_burst(modem->serial, buf, len);
+            fifo8_drop(&modem->rx_data, sent);
+            if (sent == 0)
+                sent = 1;
+        } else
+            serial_write_fifo(modem->serial, fifo8_pop(&modem->rx_data));
     } else if (fifo8_num_used(&modem->data_pending)) {
         uint8_t val = fifo8_pop(&modem->data_pending);
         serial_write_fifo(modem->serial, val);
@@ -462,7 +478,7 @@ host_to_modem_cb(void *priv)
     }
 
 no_write_to_machine:
-    timer_on_auto(&modem->host_to_serial_timer, (1000000.0 / (double) modem->baudrate) * (double) 9);
+    timer_on_auto(&modem->host_to_serial_timer, (1000000.0 / (double) modem->baudrate) * (double) (9 * sent));
 }
 
 static void
@@ -470,6 +486,8 @@ modem_write(UNUSED(serial_t *s), void *priv, uint8_t txval)
 {
     modem_t *modem = (modem_t *) priv;
 
+    timer_kick(&modem->cmdpause_timer, 1000);
+
     if (modem->mode == MODEM_MODE_COMMAND) {
         if (modem->cmdpos < 2) {
             // Ignore everything until we see "AT" sequence.
@@ -579,6 +597,22 @@ modem_send_res(modem_t *modem, const ResTypes response)
     }
 }
 
+/* Incoming calls are only ever touched through their line. */
+static void
+modem_close_socket(modem_t *modem, SOCKET *socket)
+{
+    if (*socket == (SOCKET) -1)
+        return;
+
+    if (modem->line_call) {
+        modem_line_hangup(modem->line);
+        modem->line_call = false;
+    } else
+        plat_netsocket_close(*socket);
+
+    *socket = (SOCKET) -1;
+}
+
 void
 modem_enter_idle_state(modem_t *modem)
 {
@@ -590,37 +624,12 @@ modem_enter_idle_state(modem_t *modem)
     modem->tcpIpConnInProgress = 0;
     modem->tcpIpConnCounter    = 0;
 
-    if (modem->waitingclientsocket != (SOCKET) -1)
-        plat_netsocket_close(modem->waitingclientsocket);
-
-    if (modem->clientsocket != (SOCKET) -1)
-        plat_netsocket_close(modem->clientsocket);
+    modem_close_socket(modem, &modem->waitingclientsocket);
+    modem_close_socket(modem, &modem->clientsocket);
 
-    modem->clientsocket = modem->waitingclientsocket = (SOCKET) -1;
-    if (modem->serversocket != (SOCKET) -1) {
-        modem->waitingclientsocket = plat_netsocket_accept(modem->serversocket);
-        while (modem->waitingclientsocket != (SOCKET) -1) {
-            plat_netsocket_close(modem->waitingclientsocket);
-            modem->waitingclientsocket = plat_netsocket_accept(modem->serversocket);
-        }
-        plat_netsocket_close(modem->serversocket);
-        modem->serversocket = (SOCKET) -1;
-    }
-
-    if (modem->waitingclientsocket != (SOCKET) -1)
-        plat_netsocket_close(modem->waitingclientsocket);
-
-    modem->waitingclientsocket = (SOCKET) -1;
     modem->tcpIpMode           = false;
     modem->tcpIpConnInProgress = false;
 
-    if (modem->listen_port) {
-        modem->serversocket = plat_netsocket_create_server(NET_SOCKET_TCP, modem->listen_port);
-        if (modem->serversocket == (SOCKET) -1) {
-            modem_log("Failed to set up server on port %d\n", modem->listen_port);
-        }
-    }
-
     if (modem->serial != NULL) {
         serial_set_cts(modem->serial, 1);
         serial_set_dsr(modem->serial, 1);
@@ -639,8 +648,6 @@ modem_enter_connected_state(modem_t *modem)
     modem->tcpIpMode = true;
     modem->cooldown  = true;
     modem->tx_count  = 0;
-    plat_netsocket_close(modem->serversocket);
-    modem->serversocket = -1;
     memset(&modem->telClient, 0, sizeof(modem->telClient));
 
     if (modem->serial != NULL) {
@@ -682,6 +689,15 @@ modem_reset(modem_t *modem)
 void
 modem_dial(modem_t *modem, const char *str)
 {
+    /* Hang up a call still ringing in on the line, or what was dialled would go to it. */
+    modem_close_socket(modem, &modem->waitingclientsocket);
+    modem_close_socket(modem, &modem->clientsocket);
+    modem->line_call = false;
+    modem->ringing   = false;
+    if (modem->serial != NULL)
+        serial_set_ri(modem->serial, 0);
+    modem_line_set_available(modem->line, 0);
+
     modem->tcpIpConnCounter = 0;
     modem->tcpIpMode        = false;
     if (!strcmp(str, "0.0.0.0") || !strcmp(str, "0000")) {
@@ -1137,6 +1153,7 @@ modem_dtr_callback(UNUSED(serial_t *serial), int status, void *priv)
 {
     modem_t *dev  = (modem_t *) priv;
     dev->dtrstate = !!status;
+    timer_kick(&dev->cmdpause_timer, 1000);
     if (status == 1)
         timer_disable(&dev->dtr_timer);
     else if (!timer_is_enabled(&dev->dtr_timer))
@@ -1368,8 +1385,7 @@ modem_cmdpause_timer_callback(void *priv)
             int status = plat_netsocket_connected(modem->clientsocket);
 
             if (status == -1) {
-                plat_netsocket_close(modem->clientsocket);
-                modem->clientsocket = -1;
+                modem_close_socket(modem, &modem->clientsocket);
                 modem_enter_idle_state(modem);
                 modem_send_res(modem, ResNOCARRIER);
                 modem->tcpIpConnInProgress = 0;
@@ -1383,8 +1399,7 @@ modem_cmdpause_timer_callback(void *priv)
             modem->tcpIpConnCounter++;
 
             if (status < 0 || (status == 0 && modem->tcpIpConnCounter >= 5000)) {
-                plat_netsocket_close(modem->clientsocket);
-                modem->clientsocket = -1;
+                modem_close_socket(modem, &modem->clientsocket);
                 modem_enter_idle_state(modem);
                 modem_send_res(modem, ResNOANSWER);
                 modem->tcpIpConnInProgress = 0;
@@ -1394,9 +1409,20 @@ modem_cmdpause_timer_callback(void *priv)
         } while (0);
     }
 
-    if (!modem->connected && modem->waitingclientsocket == -1 && modem->serversocket != -1) {
-        modem->waitingclientsocket = plat_netsocket_accept(modem->serversocket);
-        if (modem->waitingclientsocket != -1) {
+    /* Callers are only handed to modems that can take them. */
+    modem_line_set_available(modem->line, !modem->connected && !modem->ringing && !modem->tcpIpConnInProgress &&
+                                           (modem->waitingclientsocket == -1) && (modem->dtrstate || !modem->dtrmode));
+
+    if (modem->line_signal && !modem->line_call && (modem->waitingclientsocket == -1)) {
+        modem->line_signal         = false;
+        modem->waitingclientsocket = modem_line_ring(modem->line);
+        if ((modem->waitingclientsocket != -1) && (modem->connected || modem->tcpIpConnInProgress || modem->tcpIpMode)) {
+            /* The call came in just before the modem went off-hook. */
+            modem_line_hangup(modem->line);
+            modem->waitingclientsocket = -1;
+        } else if (modem->waitingclientsocket != -1) {
+            modem->line_call   = true;
+            modem->line_signal = true;
             if (modem->dtrstate == 0 && modem->dtrmode != 0) {
                 modem_enter_idle_state(modem);
             } else {
@@ -1434,7 +1460,12 @@ modem_cmdpause_timer_callback(void *priv)
     } else if (modem->connected && modem->tcpIpMode) {
         if (modem->tx_count) {
             int wouldblock = 0;
-            int res        = plat_netsocket_send(modem->clientsocket, modem->tx_pkt_ser_line, modem->tx_count, &wouldblock);
+            int res;
+
+            if (modem->line_call)
+                res = modem_line_send(modem->line, modem->tx_pkt_ser_line, modem->tx_count, &wouldblock);
+            else
+                res = plat_netsocket_send(modem->clientsocket, modem->tx_pkt_ser_line, modem->tx_count, &wouldblock);
 
             if (res <= 0 && !wouldblock) {
                 /* No bytes sent or error. */
@@ -1450,11 +1481,18 @@ modem_cmdpause_timer_callback(void *priv)
                 }
             }
         }
-        if (modem->connected) {
+        if (modem->connected && (modem->line_signal || !modem->line_call)) {
             uint8_t buffer[16];
             int     wouldblock = 0;
             int     recv       = MIN(modem->rx_data.capacity - modem->rx_data.num, sizeof(buffer));
-            int     res        = plat_netsocket_receive(modem->clientsocket, buffer, recv, &wouldblock);
+            int     res;
+
+            if (modem->line_call) {
+                res = modem_line_receive(modem->line, buffer, recv, &wouldblock);
+                /* Keep reading while there may be more than what fit. */
+                modem->line_signal = (res == recv);
+            } else
+                res = plat_netsocket_receive(modem->clientsocket, buffer, recv, &wouldblock);
 
             if (res > 0) {
                 if (modem->telnet_mode)
@@ -1485,6 +1523,21 @@ modem_cmdpause_timer_callback(void *priv)
             modem->plusinc = 0;
         }
     }
+
+    /* Nothing to do until the guest writes, DTR changes or the line rings. */
+    if (!modem->connected && !modem->ringing && !modem->tcpIpConnInProgress && !modem->in_warmup &&
+        (modem->waitingclientsocket == -1))
+        timer_idle(&modem->cmdpause_timer);
+}
+
+/* Runs on the emulation thread when the pool has something for the line. */
+static void
+modem_line_notify(void *priv)
+{
+    modem_t *modem = (modem_t *) priv;
+
+    modem->line_signal = true;
+    timer_kick(&modem->cmdpause_timer, 1000);
 }
 
 /* Initialize the device for use by the user. */
@@ -1500,7 +1553,12 @@ modem_init(UNUSED(const device_t *info))
     modem->listen_port = device_get_config_int("listen_port");
     modem->telnet_mode = device_get_config_int("telnet_mode");
 
-    modem->clientsocket = modem->serversocket = modem->waitingclientsocket = -1;
+    modem->clientsocket = modem->waitingclientsocket = -1;
+    if (modem->listen_port) {
+        modem->line = modem_pool_join(modem->listen_port, modem_line_notify, modem);
+        if (modem->line == NULL)
+            modem_log("Failed to set up server on port %d\n", modem->listen_port);
+    }
 
     fifo8_create(&modem->data_pending, 0x40000);
     fifo8_create(&modem->rx_data, 0x40000);
@@ -1528,6 +1586,7 @@ modem_close(void *priv)
     modem_t *modem     = (modem_t *) priv;
     modem->listen_port = 0;
     modem_reset(modem);
+    modem_pool_leave(modem->line);
     fifo8_destroy(&modem->data_pending);
     fifo8_destroy(&modem->rx_data);
     netcard_close(modem->card);
@@ -0,0 +1,522 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared listener of incoming modem calls.
+ *
+ *          Modems set up to answer calls on the same TCP port form a
+ *          hunt group: one thread per port owns the listening socket
+ *          and the sockets of all calls, waits for all of them at once
+ *          (epoll on Linux) and hands each new caller to the first
+ *          modem that can take it. Callers get BUSY when none can.
+ *          The modems only ever touch the receive and send buffers of
+ *          their line, so the emulation thread never does socket I/O
+ *          for incoming calls. When a call rings, data arrives or the
+ *          caller hangs up, the pool thread flags the line and wakes
+ *          the emulation thread, which notifies the modem; the modems
+ *          do not poll their lines.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/fifo8.h>
+#include <86box/net_modem_pool.h>
+
+#define MODEM_POOL_LINES  32
+#define MODEM_POOL_EVENTS 32
+#define MODEM_POOL_WAIT   1000 /* ms, only matters if a wake-up gets lost. */
+#define MODEM_LINE_BUF    16384
+
+typedef struct modem_pool_t modem_pool_t;
+
+struct modem_line_t {
+    modem_pool_t *pool;
+    SOCKET        socket;
+    int           watch;     /* Events the socket is being watched for. */
+    int           available; /* Set by the modem. */
+    int           assigned;  /* A call is on the line. */
+    int           ringing;   /* Not yet picked up by modem_line_ring(). */
+    int           gone;      /* The caller hung up. */
+    int           hangup;    /* The modem hung up. */
+    int           leaving;
+    atomic_int    signal;    /* The modem has not been notified yet. */
+    void        (*notify)(void *priv);
+    void         *priv;
+    Fifo8         rx;
+    Fifo8         tx;
+};
+
+struct modem_pool_t {
+    uint16_t               port;
+    SOCKET                 server;
+    atomic_int             stop;
+    int                    num_lines;
+    modem_line_t          *lines[MODEM_POOL_LINES];
+    mutex_t               *mutex; /* Protects the lines and their buffers. */
+    plat_netsocket_poll_t *set;
+    thread_t              *thread;
+    modem_pool_t          *next;
+};
+
+/* Only used by the emulation thread. */
+static modem_pool_t *modem_pools;
+
+/* Some line of some pool has been signalled. */
+static atomic_int modem_pool_signalled;
+
+static const uint8_t modem_pool_busy[] = "\r\nBUSY\r\n";
+
+#ifdef ENABLE_MODEM_POOL_LOG
+int modem_pool_do_log = ENABLE_MODEM_POOL_LOG;
+
+static void
+modem_pool_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (modem_pool_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define modem_pool_log(fmt, ...)
+#endif
+
+/* The functions below up to modem_pool_thread() run on the pool thread,
+   with the pool mutex held. */
+static void
+modem_pool_signal(modem_line_t *line)
+{
+    atomic_store(&line->signal, 1);
+    atomic_store(&modem_pool_signalled, 1);
+    timer_wake();
+}
+
+static void
+modem_pool_drop(modem_pool_t *pool, modem_line_t *line)
+{
+    if (line->socket == (SOCKET) -1)
+        return;
+
+    plat_netsocket_poll_remove(pool->set, line->socket);
+    plat_netsocket_close(line->socket);
+    line->socket = (SOCKET) -1;
+    line->watch  = 0;
+    line->gone   = 1;
+
+    /* A caller that gave up before the modem noticed the call. */
+    if (line->ringing) {
+        line->ringing  = 0;
+        line->assigned = 0;
+    }
+
+    if (!line->hangup)
+        modem_pool_signal(line);
+}
+
+static void
+modem_pool_accept(modem_pool_t *pool)
+{
+    modem_line_t *line;
+    SOCKET        socket;
+    int           wouldblock;
+
+    while ((socket = plat_netsocket_accept(pool->server)) != (SOCKET) -1) {
+        line = NULL;
+        for (int i = 0; i < pool->num_lines; i++) {
+            if (pool->lines[i]->available && !pool->lines[i]->assigned && !pool->lines[i]->leaving) {
+                line = pool->lines[i];
+                break;
+            }
+        }
+
+        if (line == NULL) {
+            modem_pool_log("Modem pool %i: all lines busy\n", pool->port);
+            plat_netsocket_send(socket, modem_pool_busy, sizeof(modem_pool_busy) - 1, &wouldblock);
+            plat_netsocket_close(socket);
+            continue;
+        }
+
+        fifo8_reset(&line->rx);
+        fifo8_reset(&line->tx);
+        line->socket   = socket;
+        line->watch    = NET_SOCKET_EV_IN;
+        line->assigned = 1;
+        line->ringing  = 1;
+        line->gone     = 0;
+        line->hangup   = 0;
+        if (plat_netsocket_poll_add(pool->set, socket, NET_SOCKET_EV_IN, line) == -1) {
+            plat_netsocket_close(socket);
+            line->socket   = (SOCKET) -1;
+            line->assigned = 0;
+            line->ringing  = 0;
+        } else
+            modem_pool_signal(line);
+    }
+}
+
+static void
+modem_pool_receive(modem_pool_t *pool, modem_line_t *line)
+{
+    uint8_t  buf[4096];
+    uint32_t len = MIN(fifo8_num_free(&line->rx), sizeof(buf));
+    int      wouldblock = 0;
+    int      res;
+
+    if (!len)
+        return;
+
+    res = plat_netsocket_receive(line->socket, buf, len, &wouldblock);
+    if (res > 0) {
+        fifo8_push_all(&line->rx, buf, res);
+        modem_pool_signal(line);
+    } else if ((res == 0) || !wouldblock)
+        modem_pool_drop(pool, line);
+}
+
+static void
+modem_pool_flush(modem_pool_t *pool, modem_line_t *line)
+{
+    const uint8_t *buf;
+    uint32_t       len;
+    int            wouldblock;
+    int            res;
+
+    while (!fifo8_is_empty(&line->tx)) {
+        buf        = fifo8_peek_bufptr(&line->tx, fifo8_num_used(&line->tx), &len);
+        wouldblock = 0;
+        res        = plat_netsocket_send(line->socket, buf, len, &wouldblock);
+        if (res > 0)
+            fifo8_drop(&line->tx, res);
+        else {
+            if (!wouldblock)
+                modem_pool_drop(pool, line);
+            break;
+        }
+    }
+}
+
+static void
+modem_pool_update(modem_pool_t *pool, modem_line_t *line)
+{
+    int watch;
+
+    if (line->hangup) {
+        modem_pool_drop(pool, line);
+        line->assigned = 0;
+        line->ringing  = 0;
+        line->gone     = 0;
+        line->hangup   = 0;
+    }
+
+    if (line->socket == (SOCKET) -1)
+        return;
+
+    modem_pool_flush(pool, line);
+    if (line->socket == (SOCKET) -1)
+        return;
+
+    /* Stop reading while the modem has not made room, and only wait for
+       the socket to drain when there is something left to send. */
+    watch = (fifo8_num_free(&line->rx) ? NET_SOCKET_EV_IN : 0) |
+            (fifo8_is_empty(&line->tx) ? 0 : NET_SOCKET_EV_OUT);
+    if (watch != line->watch) {
+        plat_netsocket_poll_modify(pool->set, line->socket, watch, line);
+        line->watch = watch;
+    }
+}
+
+static void
+modem_pool_free_line(modem_pool_t *pool, int i)
+{
+    modem_line_t *line = pool->lines[i];
+
+    modem_pool_drop(pool, line);
+    fifo8_destroy(&line->rx);
+    fifo8_destroy(&line->tx);
+    free(line);
+
+    pool->lines[i] = pool->lines[--pool->num_lines];
+}
+
+static void
+modem_pool_thread(void *priv)
+{
+    modem_pool_t      *pool = (modem_pool_t *) priv;
+    net_socket_event_t events[MODEM_POOL_EVENTS];
+    modem_line_t      *line;
+    int                num;
+
+    while (!atomic_load(&pool->stop)) {
+        num = plat_netsocket_poll_wait(pool->set, events, MODEM_POOL_EVENTS, MODEM_POOL_WAIT);
+
+        thread_wait_mutex(pool->mutex);
+
+        for (int i = 0; i < num; i++) {
+            if (events[i].priv == pool) {
+                modem_pool_accept(pool);
+                continue;
+            }
+
+            line = (modem_line_t *) events[i].priv;
+            if (line->socket == (SOCKET) -1)
+                continue;
+
+            /* An error or hang-up is reported even while reading is stopped,
+               there is no point in waiting for room in that case. */
+            if ((events[i].events & NET_SOCKET_EV_ERR) && !fifo8_num_free(&line->rx))
+                modem_pool_drop(pool, line);
+            else if (events[i].events & (NET_SOCKET_EV_IN | NET_SOCKET_EV_ERR))
+                modem_pool_receive(pool, line);
+        }
+
+        /* Lines only go away here, after the events that refer to them. */
+        for (int i = 0; i < pool->num_lines; i++) {
+            if (pool->lines[i]->leaving)
+                modem_pool_free_line(pool, i--);
+            else
+                modem_pool_update(pool, pool->lines[i]);
+        }
+
+        thread_release_mutex(pool->mutex);
+    }
+
+    thread_wait_mutex(pool->mutex);
+    while (pool->num_lines)
+        modem_pool_free_line(pool, 0);
+    thread_release_mutex(pool->mutex);
+
+    plat_netsocket_poll_remove(pool->set, pool->server);
+}
+
+/* Runs on the emulation thread for every timer_wake(). */
+static void
+modem_pool_wake(void)
+{
+    modem_line_t *line;
+
+    if (!atomic_exchange(&modem_pool_signalled, 0))
+        return;
+
+    for (modem_pool_t *pool = modem_pools; pool != NULL; pool = pool->next) {
+        thread_wait_mutex(pool->mutex);
+        for (int i = 0; i < pool->num_lines; i++) {
+            line = pool->lines[i];
+            if (atomic_exchange(&line->signal, 0) && !line->leaving)
+                line->notify(line->priv);
+        }
+        thread_release_mutex(pool->mutex);
+    }
+}
+
+modem_line_t *
+modem_pool_join(uint16_t port, void (*notify)(void *priv), void *priv)
+{
+    modem_pool_t *pool;
+    modem_line_t *line;
+
+    for (pool = modem_pools; pool != NULL; pool = pool->next) {
+        if (pool->port == port)
+            break;
+    }
+
+    if (pool == NULL) {
+        pool         = (modem_pool_t *) calloc(1, sizeof(modem_pool_t));
+        pool->port   = port;
+        pool->server = plat_netsocket_create_server(NET_SOCKET_TCP, port);
+        pool->set    = plat_netsocket_poll_create();
+        if ((pool->server == (SOCKET) -1) || (pool->set == NULL) ||
+            (plat_netsocket_poll_add(pool->set, pool->server, NET_SOCKET_EV_IN, pool) == -1)) {
+            modem_pool_log("Modem pool %i: failed to set up the listener\n", port);
+            if (pool->server != (SOCKET) -1)
+                plat_netsocket_close(pool->server);
+            plat_netsocket_poll_destroy(pool->set);
+            free(pool);
+            return NULL;
+        }
+
+        pool->mutex  = thread_create_mutex();
+        pool->thread = thread_create(modem_pool_thread, pool);
+        pool->next   = modem_pools;
+        modem_pools  = pool;
+    }
+
+    thread_wait_mutex(pool->mutex);
+
+    if (pool->num_lines >= MODEM_POOL_LINES) {
+        thread_release_mutex(pool->mutex);
+        return NULL;
+    }
+
+    line         = (modem_line_t *) calloc(1, sizeof(modem_line_t));
+    line->pool   = pool;
+    line->socket = (SOCKET) -1;
+    line->notify = notify;
+    line->priv   = priv;
+    fifo8_create(&line->rx, MODEM_LINE_BUF);
+    fifo8_create(&line->tx, MODEM_LINE_BUF);
+    pool->lines[pool->num_lines++] = line;
+
+    thread_release_mutex(pool->mutex);
+
+    timer_add_wake(modem_pool_wake);
+
+    modem_pool_log("Modem pool %i: %i lines\n", port, pool->num_lines);
+
+    return line;
+}
+
+void
+modem_pool_leave(modem_line_t *line)
+{
+    modem_pool_t  *pool;
+    modem_pool_t **prev;
+    int            active = 0;
+
+    if (line == NULL)
+        return;
+
+    pool = line->pool;
+
+    thread_wait_mutex(pool->mutex);
+    line->leaving = 1;
+    for (int i = 0; i < pool->num_lines; i++)
+        active += !pool->lines[i]->leaving;
+    thread_release_mutex(pool->mutex);
+
+    if (active) {
+        /* The pool thread frees the line. */
+        plat_netsocket_poll_wake(pool->set);
+        return;
+    }
+
+    atomic_store(&pool->stop, 1);
+    plat_netsocket_poll_wake(pool->set);
+    thread_wait(pool->thread);
+
+    for (prev = &modem_pools; *prev != NULL; prev = &(*prev)->next) {
+        if (*prev == pool) {
+            *prev = pool->next;
+            break;
+        }
+    }
+
+    plat_netsocket_close(pool->server);
+    plat_netsocket_poll_destroy(pool->set);
+    thread_close_mutex(pool->mutex);
+    free(pool);
+}
+
+/* The functions below run on the emulation thread. */
+void
+modem_line_set_available(modem_line_t *line, int available)
+{
+    if ((line == NULL) || (line->available == available))
+        return;
+
+    thread_wait_mutex(line->pool->mutex);
+    line->available = available;
+    thread_release_mutex(line->pool->mutex);
+}
+
+SOCKET
+modem_line_ring(modem_line_t *line)
+{
+    SOCKET ret = (SOCKET) -1;
+
+    if (line == NULL)
+        return ret;
+
+    thread_wait_mutex(line->pool->mutex);
+    if (line->ringing) {
+        line->ringing = 0;
+        ret           = line->socket;
+    }
+    thread_release_mutex(line->pool->mutex);
+
+    return ret;
+}
+
+void
+modem_line_hangup(modem_line_t *line)
+{
+    thread_wait_mutex(line->pool->mutex);
+    line->hangup  = 1;
+    line->ringing = 0;
+    thread_release_mutex(line->pool->mutex);
+
+    plat_netsocket_poll_wake(line->pool->set);
+}
+
+int
+modem_line_send(modem_line_t *line, const uint8_t *data, unsigned int size, int *wouldblock)
+{
+    int wake = 0;
+    int ret  = -1;
+
+    *wouldblock = 0;
+
+    thread_wait_mutex(line->pool->mutex);
+    if (!line->gone) {
+        ret = MIN(size, fifo8_num_free(&line->tx));
+        if (ret) {
+            wake = fifo8_is_empty(&line->tx);
+            fifo8_push_all(&line->tx, data, ret);
+        } else {
+            *wouldblock = 1;
+            ret         = -1;
+        }
+    }
+    thread_release_mutex(line->pool->mutex);
+
+    if (wake)
+        plat_netsocket_poll_wake(line->pool->set);
+
+    return ret;
+}
+
+int
+modem_line_receive(modem_line_t *line, uint8_t *data, unsigned int size, int *wouldblock)
+{
+    int wake = 0;
+    int ret;
+
+    *wouldblock = 0;
+
+    thread_wait_mutex(line->pool->mutex);
+    ret = MIN(size, fifo8_num_used(&line->rx));
+    if (ret) {
+        fifo8_pop_buf(&line->rx, data, ret);
+        wake = !(line->watch & NET_SOCKET_EV_IN) && !line->gone;
+    } else if (!line->gone) {
+        *wouldblock = 1;
+        ret         = -1;
+    }
+    thread_release_mutex(line->pool->mutex);
+
+    /* Reading stopped when the buffer was full, have it resume. */
+    if (wake)
+        plat_netsocket_poll_wake(line->pool->set);
+
+    return ret;
+}
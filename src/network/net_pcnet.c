@@ -261,8 +261,13 @@ typedef struct {
     uint32_t   cMsLinkUpDelay;
     int        transfer_size;
     uint8_t    maclocal[6]; /* configured MAC (local) address */
-    pc_timer_t timer, timer_soft_int, timer_restore;
+    pc_timer_t timer, timer_soft_int, timer_restore, timer_rx_int;
     netcard_t *netcard;
+    /** Descriptor ring windows, see network_desc_read(). */
+    netdesc_win_t rx_win;
+    netdesc_win_t tx_win;
+    /** Receive interrupt moderation delay in microseconds, 0 if disabled. */
+    uint32_t rx_int_delay;
 } nic_t;
 
 /** @todo All structs: big endian? */
@@ -437,6 +442,24 @@ pcnetIsLinkUp(nic_t *dev)
     return !dev->fLinkTempDown && dev->fLinkUp;
 }
 
+/**
+ * Get the physical end address of the receive descriptor ring.
+ */
+static __inline uint32_t
+pcnetRdraEnd(nic_t *dev)
+{
+    return PHYSADDR(dev, dev->GCRDRA + (CSR_RCVRL(dev) << dev->iLog2DescSize));
+}
+
+/**
+ * Get the physical end address of the transmit descriptor ring.
+ */
+static __inline uint32_t
+pcnetTdraEnd(nic_t *dev)
+{
+    return PHYSADDR(dev, dev->GCTDRA + (CSR_XMTRL(dev) << dev->iLog2DescSize));
+}
+
 /**
  * Load transmit message descriptor
  * Make sure we read the own flag first.
@@ -455,27 +478,27 @@ pcnetTmdLoad(nic_t *dev, TMD *tmd, uint32_t addr, int fRetIfNotOwn)
     uint32_t xda32[4];
 
     if (BCR_SWSTYLE(dev) == 0) {
-        dma_bm_read(addr, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr, (uint8_t *) bytes, 4, pcnetTdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) &xda[0], sizeof(xda), dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr, (uint8_t *) &xda[0], sizeof(xda), pcnetTdraEnd(dev), dev->transfer_size);
         ((uint32_t *) tmd)[0] = (uint32_t) xda[0] | ((uint32_t) (xda[1] & 0x00ff) << 16);
         ((uint32_t *) tmd)[1] = (uint32_t) xda[2] | ((uint32_t) (xda[1] & 0xff00) << 16);
         ((uint32_t *) tmd)[2] = (uint32_t) xda[3] << 16;
         ((uint32_t *) tmd)[3] = 0;
     } else if (BCR_SWSTYLE(dev) != 3) {
-        dma_bm_read(addr + 4, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr + 4, (uint8_t *) bytes, 4, pcnetTdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) tmd, 16, dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr, (uint8_t *) tmd, 16, pcnetTdraEnd(dev), dev->transfer_size);
     } else {
-        dma_bm_read(addr + 4, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr + 4, (uint8_t *) bytes, 4, pcnetTdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) &xda32[0], sizeof(xda32), dev->transfer_size);
+        network_desc_read(&dev->tx_win, addr, (uint8_t *) &xda32[0], sizeof(xda32), pcnetTdraEnd(dev), dev->transfer_size);
         ((uint32_t *) tmd)[0] = xda32[2];
         ((uint32_t *) tmd)[1] = xda32[1];
         ((uint32_t *) tmd)[2] = xda32[0];
@@ -510,14 +533,14 @@ pcnetTmdStorePassHost(nic_t *dev, TMD *tmd, uint32_t addr)
         dma_bm_write(addr, (uint8_t*)&xda[0], sizeof(xda), dev->transfer_size);
 #endif
         xda[1] &= ~0x8000;
-        dma_bm_write(addr, (uint8_t *) &xda[0], sizeof(xda), dev->transfer_size);
+        network_desc_write(&dev->tx_win, addr, (uint8_t *) &xda[0], sizeof(xda), dev->transfer_size);
     } else if (BCR_SWSTYLE(dev) != 3) {
 #if 0
         ((uint32_t*)tmd)[1] |=  0x80000000;
         dma_bm_write(addr, (uint8_t*)tmd, 12, dev->transfer_size);
 #endif
         ((uint32_t *) tmd)[1] &= ~0x80000000;
-        dma_bm_write(addr, (uint8_t *) tmd, 12, dev->transfer_size);
+        network_desc_write(&dev->tx_win, addr, (uint8_t *) tmd, 12, dev->transfer_size);
     } else {
         xda32[0] = ((uint32_t *) tmd)[2];
         xda32[1] = ((uint32_t *) tmd)[1];
@@ -527,7 +550,7 @@ pcnetTmdStorePassHost(nic_t *dev, TMD *tmd, uint32_t addr)
         dma_bm_write(addr, (uint8_t*)&xda32[0], sizeof(xda32), dev->transfer_size);
 #endif
         xda32[1] &= ~0x80000000;
-        dma_bm_write(addr, (uint8_t *) &xda32[0], sizeof(xda32), dev->transfer_size);
+        network_desc_write(&dev->tx_win, addr, (uint8_t *) &xda32[0], sizeof(xda32), dev->transfer_size);
     }
 }
 
@@ -549,27 +572,27 @@ pcnetRmdLoad(nic_t *dev, RMD *rmd, uint32_t addr, int fRetIfNotOwn)
     uint32_t rda32[4];
 
     if (BCR_SWSTYLE(dev) == 0) {
-        dma_bm_read(addr, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr, (uint8_t *) bytes, 4, pcnetRdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) &rda[0], sizeof(rda), dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr, (uint8_t *) &rda[0], sizeof(rda), pcnetRdraEnd(dev), dev->transfer_size);
         ((uint32_t *) rmd)[0] = (uint32_t) rda[0] | ((rda[1] & 0x00ff) << 16);
         ((uint32_t *) rmd)[1] = (uint32_t) rda[2] | ((rda[1] & 0xff00) << 16);
         ((uint32_t *) rmd)[2] = (uint32_t) rda[3];
         ((uint32_t *) rmd)[3] = 0;
     } else if (BCR_SWSTYLE(dev) != 3) {
-        dma_bm_read(addr + 4, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr + 4, (uint8_t *) bytes, 4, pcnetRdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) rmd, 16, dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr, (uint8_t *) rmd, 16, pcnetRdraEnd(dev), dev->transfer_size);
     } else {
-        dma_bm_read(addr + 4, (uint8_t *) bytes, 4, dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr + 4, (uint8_t *) bytes, 4, pcnetRdraEnd(dev), dev->transfer_size);
         ownbyte = bytes[3];
         if (!(ownbyte & 0x80) && fRetIfNotOwn)
             return 0;
-        dma_bm_read(addr, (uint8_t *) &rda32[0], sizeof(rda32), dev->transfer_size);
+        network_desc_read(&dev->rx_win, addr, (uint8_t *) &rda32[0], sizeof(rda32), pcnetRdraEnd(dev), dev->transfer_size);
         ((uint32_t *) rmd)[0] = rda32[2];
         ((uint32_t *) rmd)[1] = rda32[1];
         ((uint32_t *) rmd)[2] = rda32[0];
@@ -605,14 +628,14 @@ pcnetRmdStorePassHost(nic_t *dev, RMD *rmd, uint32_t addr)
         dma_bm_write(addr, (uint8_t*)&rda[0], sizeof(rda), dev->transfer_size);
 #endif
         rda[1] &= ~0x8000;
-        dma_bm_write(addr, (uint8_t *) &rda[0], sizeof(rda), dev->transfer_size);
+        network_desc_write(&dev->rx_win, addr, (uint8_t *) &rda[0], sizeof(rda), dev->transfer_size);
     } else if (BCR_SWSTYLE(dev) != 3) {
 #if 0
         ((uint32_t*)rmd)[1] |=  0x80000000;
         dma_bm_write(addr, (uint8_t*)rmd, 12, dev->transfer_size);
 #endif
         ((uint32_t *) rmd)[1] &= ~0x80000000;
-        dma_bm_write(addr, (uint8_t *) rmd, 12, dev->transfer_size);
+        network_desc_write(&dev->rx_win, addr, (uint8_t *) rmd, 12, dev->transfer_size);
     } else {
         rda32[0] = ((uint32_t *) rmd)[2];
         rda32[1] = ((uint32_t *) rmd)[1];
@@ -622,7 +645,7 @@ pcnetRmdStorePassHost(nic_t *dev, RMD *rmd, uint32_t addr)
         dma_bm_write(addr, (uint8_t*)&rda32[0], sizeof(rda32), dev->transfer_size);
 #endif
         rda32[1] &= ~0x80000000;
-        dma_bm_write(addr, (uint8_t *) &rda32[0], sizeof(rda32), dev->transfer_size);
+        network_desc_write(&dev->rx_win, addr, (uint8_t *) &rda32[0], sizeof(rda32), dev->transfer_size);
     }
 }
 
@@ -1210,9 +1233,8 @@ pcnetCalcPacketLen(nic_t *dev, int cb)
  * Write data into guest receive buffers.
  */
 static int
-pcnetReceiveNoSync(void *priv, uint8_t *buf, int size)
+pcnetReceiveFrame(nic_t *dev, uint8_t *buf, int size)
 {
-    nic_t   *dev      = (nic_t *) priv;
     int      is_padr  = 0;
     int      is_bcast = 0;
     int      is_ladr  = 0;
@@ -1433,11 +1455,30 @@ pcnetReceiveNoSync(void *priv, uint8_t *buf, int size)
         }
     }
 
-    pcnetUpdateIrq(dev);
+    /* With moderation, RINT is signalled once the delay expires, or earlier
+       along with any other interrupt source. */
+    if (dev->rx_int_delay && (dev->aCSR[0] & 0x0400)) {
+        if (!timer_is_enabled(&dev->timer_rx_int))
+            timer_set_delay_u64(&dev->timer_rx_int, dev->rx_int_delay * TIMER_USEC);
+    } else
+        pcnetUpdateIrq(dev);
 
     return 1;
 }
 
+static int
+pcnetReceiveNoSync(void *priv, uint8_t *buf, int size)
+{
+    nic_t *dev = (nic_t *) priv;
+    int    ret;
+
+    network_desc_begin(&dev->rx_win);
+    ret = pcnetReceiveFrame(dev, buf, size);
+    network_desc_end(&dev->rx_win);
+
+    return ret;
+}
+
 /**
  * Fails a TMD with a link down error.
  */
@@ -1478,10 +1519,12 @@ pcnetAsyncTransmit(nic_t *dev)
     }
 
     /*
-     * Iterate the transmit descriptors.
+     * Iterate the transmit descriptors. The guest can not run until we are
+     * done, so the ring is read ahead a window at a time.
      */
     unsigned cFlushIrq = 0;
     int      cMax      = 32;
+    network_desc_begin(&dev->tx_win);
     do {
         TMD tmd;
         if (!pcnetTdtePoll(dev, &tmd))
@@ -1661,6 +1704,7 @@ pcnetAsyncTransmit(nic_t *dev)
         if (--cMax == 0)
             break;
     } while (CSR_TXON(dev)); /* transfer on */
+    network_desc_end(&dev->tx_win);
 
     if (cFlushIrq) {
         dev->aCSR[0] |= 0x0200; /* set TINT */
@@ -2893,6 +2937,14 @@ pcnetTimerSoftInt(void *priv)
     timer_advance_u64(&dev->timer_soft_int, (12.8 * (dev->aBCR[BCR_STVAL] & 0xffff)) * TIMER_USEC);
 }
 
+static void
+pcnetTimerRxInt(void *priv)
+{
+    nic_t *dev = (nic_t *) priv;
+
+    pcnetUpdateIrq(dev);
+}
+
 static void
 pcnetTimerRestore(void *priv)
 {
@@ -3067,6 +3119,9 @@ pcnet_init(const device_t *info)
 
     timer_add(&dev->timer_restore, pcnetTimerRestore, dev, 0);
 
+    dev->rx_int_delay = device_get_config_int("rx_int_delay");
+    timer_add(&dev->timer_rx_int, pcnetTimerRxInt, dev, 0);
+
     return dev;
 }
 
@@ -3098,6 +3153,24 @@ static const device_config_t pcnet_pci_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "rx_int_delay",
+        .description    = "Receive interrupt moderation",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Disabled", .value =   0 },
+            { .description = "50 µs",    .value =  50 },
+            { .description = "100 µs",   .value = 100 },
+            { .description = "250 µs",   .value = 250 },
+            { .description = "500 µs",   .value = 500 },
+            { .description = ""                       }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 };
 
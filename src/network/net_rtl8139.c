@@ -63,6 +63,8 @@
 #define VLAN_TCI_LEN   2
 #define VLAN_HLEN      (ETHER_TYPE_LEN + VLAN_TCI_LEN)
 
+#define CPLUS_TX_RING_SIZE 64 /* Descriptors in a C+ mode transmit ring */
+
 #ifdef ENABLE_RTL8139_LOG
 int rtl8139_do_log = ENABLE_RTL8139_LOG;
 
@@ -462,6 +464,13 @@ struct RTL8139State {
     /* PCI interrupt timer */
     pc_timer_t timer;
 
+    /* Receive interrupt moderation, delay in microseconds (0 if disabled) */
+    pc_timer_t rx_int_timer;
+    uint32_t   rx_int_delay;
+
+    /* C+ transmit descriptor ring window */
+    netdesc_win_t tx_win;
+
     mem_mapping_t bar_mem;
 
     /* Support migration to/from old versions */
@@ -800,19 +809,18 @@ rtl8139_do_receive(void *priv, uint8_t *buf, int size_)
                 s->RxRingAddrLO, cplus_rx_ring_desc);
 
         uint32_t val;
+        uint32_t desc[4];
         uint32_t rxdw0;
         uint32_t rxdw1;
         uint32_t rxbufLO;
         uint32_t rxbufHI;
 
-        dma_bm_read(cplus_rx_ring_desc, (uint8_t *) &val, 4, 4);
-        rxdw0 = val;
-        dma_bm_read(cplus_rx_ring_desc + 4, (uint8_t *) &val, 4, 4);
-        rxdw1 = val;
-        dma_bm_read(cplus_rx_ring_desc + 8, (uint8_t *) &val, 4, 4);
-        rxbufLO = val;
-        dma_bm_read(cplus_rx_ring_desc + 12, (uint8_t *) &val, 4, 4);
-        rxbufHI = val;
+        /* Fetch the whole descriptor in one access. */
+        dma_bm_read(cplus_rx_ring_desc, (uint8_t *) desc, 16, 4);
+        rxdw0   = desc[0];
+        rxdw1   = desc[1];
+        rxbufLO = desc[2];
+        rxbufHI = desc[3];
 
         rtl8139_log("+++ C+ mode RX descriptor %d %08x %08x %08x %08x\n",
                     descriptor, rxdw0, rxdw1, rxbufLO, rxbufHI);
@@ -999,13 +1007,25 @@ rtl8139_do_receive(void *priv, uint8_t *buf, int size_)
 
     s->IntrStatus |= RxOK;
 
-    {
+    /* With moderation, RxOK is signalled once the delay expires, or earlier
+       along with any other interrupt source. */
+    if (s->rx_int_delay) {
+        if (!timer_is_enabled(&s->rx_int_timer))
+            timer_set_delay_u64(&s->rx_int_timer, s->rx_int_delay * TIMER_USEC);
+    } else
         rtl8139_update_irq(s);
-    }
 
     return size_;
 }
 
+static void
+rtl8139_rx_int_timer(void *priv)
+{
+    RTL8139State *s = priv;
+
+    rtl8139_update_irq(s);
+}
+
 static void
 rtl8139_reset_rxring(RTL8139State *s, uint32_t bufferSize)
 {
@@ -1029,6 +1049,36 @@ rtl8139_reset_phy(RTL8139State *s)
     s->CSCR = CSCR_F_LINK_100 | CSCR_HEART_BIT | CSCR_LD;
 }
 
+/* TCTR counts PCI clocks. Instead of a timer ticking at the PCI clock rate,
+   the count is worked out from the emulated time since TCTR_base, and the
+   timer only runs while a TimerInt match is pending. */
+static uint32_t
+rtl8139_get_tctr(const RTL8139State *s)
+{
+    double elapsed;
+
+    if (!s->clock_enabled)
+        return s->TCTR;
+
+    elapsed = ((double) (tsc - (uint64_t) s->TCTR_base) * 4294967296.0) / (double) TIMER_USEC;
+
+    return s->TCTR + (uint32_t) (uint64_t) ((elapsed * (double) cpu_pci_speed) / 1000000.0);
+}
+
+static void
+rtl8139_set_next_tctr_time(RTL8139State *s)
+{
+    uint32_t clocks;
+
+    timer_stop(&s->timer);
+
+    if (!s->clock_enabled || (s->TimerInt == 0))
+        return;
+
+    clocks = s->TimerInt - rtl8139_get_tctr(s);
+    timer_on_auto(&s->timer, ((clocks ? (double) clocks : 4294967296.0) * 1000000.0) / (double) cpu_pci_speed);
+}
+
 static void
 rtl8139_reset(void *priv)
 {
@@ -1090,10 +1140,8 @@ rtl8139_reset(void *priv)
     /* also reset timer and disable timer interrupt */
     s->TCTR      = 0;
     s->TimerInt  = 0;
-    s->TCTR_base = 0;
-#if 0
+    s->TCTR_base = tsc;
     rtl8139_set_next_tctr_time(s);
-#endif
 
     /* reset tally counters */
     RTL8139TallyCounters_clear(&s->tally_counters);
@@ -1716,19 +1764,18 @@ rtl8139_cplus_transmit_one(RTL8139State *s)
                 s->TxAddr[0], cplus_tx_ring_desc);
 
     uint32_t val;
+    uint32_t desc[4];
     uint32_t txdw0;
     uint32_t txdw1;
     uint32_t txbufLO;
     uint32_t txbufHI;
 
-    dma_bm_read(cplus_tx_ring_desc, (uint8_t *) &val, 4, 4);
-    txdw0 = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 4, (uint8_t *) &val, 4, 4);
-    txdw1 = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 8, (uint8_t *) &val, 4, 4);
-    txbufLO = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 12, (uint8_t *) &val, 4, 4);
-    txbufHI = le32_to_cpu(val);
+    network_desc_read(&s->tx_win, cplus_tx_ring_desc, desc, 16,
+                      rtl8139_addr64(s->TxAddr[0], s->TxAddr[1]) + 16 * CPLUS_TX_RING_SIZE, 4);
+    txdw0   = le32_to_cpu(desc[0]);
+    txdw1   = le32_to_cpu(desc[1]);
+    txbufLO = le32_to_cpu(desc[2]);
+    txbufHI = le32_to_cpu(desc[3]);
 
     rtl8139_log("+++ C+ mode TX descriptor %d %08x %08x %08x %08x\n", descriptor,
                 txdw0, txdw1, txbufLO, txbufHI);
@@ -1844,7 +1891,7 @@ rtl8139_cplus_transmit_one(RTL8139State *s)
 
     /* update ring data */
     val = cpu_to_le32(tx_status);
-    dma_bm_write(cplus_tx_ring_desc, (uint8_t *) &val, 4, 4);
+    network_desc_write(&s->tx_win, cplus_tx_ring_desc, &val, 4, 4);
 
     /* Now decide if descriptor being processed is holding the last segment of packet */
     if (txdw0 & CP_TX_LS) {
@@ -2150,9 +2197,12 @@ rtl8139_cplus_transmit(RTL8139State *s)
 {
     int txcount = 0;
 
-    while (txcount < 64 && rtl8139_cplus_transmit_one(s)) {
+    /* The guest can not run until the loop is done, read the ring ahead. */
+    network_desc_begin(&s->tx_win);
+    while (txcount < CPLUS_TX_RING_SIZE && rtl8139_cplus_transmit_one(s)) {
         ++txcount;
     }
+    network_desc_end(&s->tx_win);
 
     /* Mark transfer completed */
     if (!txcount) {
@@ -2521,10 +2571,14 @@ rtl8139_io_writeb(uint32_t addr, uint8_t val, void *priv)
 
         case HltClk:
             rtl8139_log("HltClk write val=0x%08x\n", val);
-            if (val == 'R') {
+            if ((val == 'R') && !s->clock_enabled) {
                 s->clock_enabled = 1;
-            } else if (val == 'H') {
+                s->TCTR_base     = tsc;
+                rtl8139_set_next_tctr_time(s);
+            } else if ((val == 'H') && s->clock_enabled) {
+                s->TCTR          = rtl8139_get_tctr(s);
                 s->clock_enabled = 0;
+                rtl8139_set_next_tctr_time(s);
             }
             break;
 
@@ -2660,17 +2714,17 @@ rtl8139_io_writel(uint32_t addr, uint32_t val, void *priv)
 
         case Timer:
             rtl8139_log("TCTR Timer reset on write\n");
-            s->TCTR = 0;
-#if 0
-            s->TCTR_base = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+            s->TCTR      = 0;
+            s->TCTR_base = tsc;
             rtl8139_set_next_tctr_time(s);
-#endif
             break;
 
         case FlashReg:
             rtl8139_log("FlashReg TimerInt write val=0x%08x\n", val);
-            if (s->TimerInt != val)
+            if (s->TimerInt != val) {
                 s->TimerInt = val;
+                rtl8139_set_next_tctr_time(s);
+            }
             break;
 
         default:
@@ -2894,11 +2948,7 @@ rtl8139_io_readl(uint32_t addr, void *priv)
             break;
 
         case Timer:
-#if 0
-            ret = (qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->TCTR_base) /
-                  PCI_PERIOD;
-#endif
-            ret = s->TCTR;
+            ret = rtl8139_get_tctr(s);
             rtl8139_log("TCTR Timer read val=0x%08x\n", ret);
             break;
 
@@ -3078,19 +3128,11 @@ rtl8139_timer(void *priv)
 {
     RTL8139State *s = priv;
 
-    timer_on_auto(&s->timer, 1000000.0 / ((double) cpu_pci_speed));
-
-    if (!s->clock_enabled) {
-        rtl8139_log(">>> timer: clock is not running\n");
-        return;
-    }
-
-    s->TCTR++;
+    /* TCTR has reached TimerInt, it will again after wrapping around. */
+    timer_on_auto(&s->timer, (4294967296.0 * 1000000.0) / (double) cpu_pci_speed);
 
-    if (s->TCTR == s->TimerInt && s->TimerInt != 0) {
-        s->IntrStatus |= PCSTimeout;
-        rtl8139_update_irq(s);
-    }
+    s->IntrStatus |= PCSTimeout;
+    rtl8139_update_irq(s);
 }
 
 static uint8_t
@@ -3297,7 +3339,9 @@ nic_init(const device_t *info)
 
     s->nic = network_attach(s, (uint8_t *) &s->phys[MAC0], rtl8139_do_receive, rtl8139_set_link_status);
     timer_add(&s->timer, rtl8139_timer, s, 0);
-    timer_on_auto(&s->timer, 1000000.0 / cpu_pci_speed);
+
+    s->rx_int_delay = device_get_config_int("rx_int_delay");
+    timer_add(&s->rx_int_timer, rtl8139_rx_int_timer, s, 0);
 
     s->cplus_txbuffer        = NULL;
     s->cplus_txbuffer_len    = 0;
@@ -3309,6 +3353,10 @@ nic_init(const device_t *info)
 static void
 nic_close(void *priv)
 {
+    RTL8139State *s = priv;
+
+    netcard_close(s->nic);
+
     free(priv);
 }
 
@@ -3325,6 +3373,24 @@ static const device_config_t rtl8139c_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "rx_int_delay",
+        .description    = "Receive interrupt moderation",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Disabled", .value =   0 },
+            { .description = "50 µs",    .value =  50 },
+            { .description = "100 µs",   .value = 100 },
+            { .description = "250 µs",   .value = 250 },
+            { .description = "500 µs",   .value = 500 },
+            { .description = ""                       }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 };
 // clang-format on
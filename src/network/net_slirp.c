@@ -46,11 +46,20 @@
 #    define WIN32_LEAN_AND_MEAN
 #    include <windows.h>
 #else
+#    include <sys/socket.h>
 #    include <poll.h>
+#    ifdef __linux__
+#        include <errno.h>
+#        include <sys/epoll.h>
+#        include <unistd.h>
+#    endif
 #endif
 #include <86box/net_event.h>
 
-#define SLIRP_PKT_BATCH NET_QUEUE_LEN
+#define SLIRP_PKT_BATCH    NET_QUEUE_LEN
+#define SLIRP_RX_BATCH     (NET_QUEUE_LEN * 4) /* Frames waiting for the card. */
+#define SLIRP_RX_RETRY     1                   /* ms */
+#define SLIRP_EPOLL_EVENTS 64
 
 enum {
     NET_EVENT_STOP = 0,
@@ -59,6 +68,16 @@ enum {
     NET_EVENT_MAX
 };
 
+#ifdef __linux__
+typedef struct slirp_pollfd_t {
+    uint32_t events;  /* What epoll watches for, if registered. */
+    uint32_t gen;     /* The last fill that asked for it. */
+    uint32_t revents;
+    uint8_t  registered;
+    uint8_t  listed;  /* In the list of registered descriptors. */
+} slirp_pollfd_t;
+#endif
+
 typedef struct net_slirp_t {
     Slirp *        slirp;
     uint8_t        mac_addr[6];
@@ -67,12 +86,22 @@ typedef struct net_slirp_t {
     net_evt_t      rx_event;
     net_evt_t      tx_event;
     net_evt_t      stop_event;
-    netpkt_t       pkt;
     netpkt_t       pkt_tx_v[SLIRP_PKT_BATCH];
-    int            during_tx;
-    int            recv_on_tx;
+    netpkt_t       pkt_rx_v[SLIRP_RX_BATCH];
+    int            rx_count;
+    int            sockbuf; /* Host socket buffer size, 0 = default */
 #ifdef _WIN32
     HANDLE         sock_event;
+#elif defined(__linux__)
+    int             epfd;
+    uint32_t        gen;
+    uint32_t        fd_size;
+    slirp_pollfd_t *fds; /* Indexed by descriptor. */
+    uint32_t        reg_len;
+    uint32_t        reg_size;
+    int            *reg;
+    int             ready_len;
+    int             ready[SLIRP_EPOLL_EVENTS];
 #else
     uint32_t       pfd_len;
     uint32_t       pfd_size;
@@ -161,8 +190,14 @@ net_slirp_register_poll_socket(slirp_os_socket fd, void *opaque)
 net_slirp_register_poll_fd(int fd, void *opaque)
 #endif
 {
-    (void) fd;
-    (void) opaque;
+    net_slirp_t *slirp = (net_slirp_t *) opaque;
+
+    /* Called for every socket libslirp opens, listening ones pass the
+       sizes on to the connections they accept. */
+    if (slirp->sockbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char *) &slirp->sockbuf, sizeof(slirp->sockbuf));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *) &slirp->sockbuf, sizeof(slirp->sockbuf));
+    }
 }
 
 static void
@@ -172,8 +207,20 @@ net_slirp_unregister_poll_socket(slirp_os_socket fd, void *opaque)
 net_slirp_unregister_poll_fd(int fd, void *opaque)
 #endif
 {
+#ifdef __linux__
+    net_slirp_t       *slirp = (net_slirp_t *) opaque;
+    struct epoll_event ev    = { 0 };
+
+    /* The descriptor is about to be closed, and may be reused. */
+    if ((fd >= 0) && ((uint32_t) fd < slirp->fd_size) && slirp->fds[fd].registered) {
+        epoll_ctl(slirp->epfd, EPOLL_CTL_DEL, fd, &ev);
+        slirp->fds[fd].registered = 0;
+        slirp->fds[fd].revents    = 0;
+    }
+#else
     (void) fd;
     (void) opaque;
+#endif
 }
 
 static void
@@ -182,6 +229,26 @@ net_slirp_notify(void *opaque)
     (void) opaque;
 }
 
+/* Hand the frames received so far to the card, keeping those it has no
+   room for at the start of the batch. */
+static void
+net_slirp_rx_flush(net_slirp_t *slirp)
+{
+    netpkt_t tmp;
+    int      put;
+
+    if (!slirp->rx_count)
+        return;
+
+    put = network_rx_putv(slirp->card, slirp->pkt_rx_v, slirp->rx_count);
+    for (int i = put; (put > 0) && (i < slirp->rx_count); i++) {
+        tmp                      = slirp->pkt_rx_v[i - put];
+        slirp->pkt_rx_v[i - put] = slirp->pkt_rx_v[i];
+        slirp->pkt_rx_v[i]       = tmp;
+    }
+    slirp->rx_count -= put;
+}
+
 #if SLIRP_CHECK_VERSION(4, 8, 0)
 slirp_ssize_t
 #else
@@ -193,13 +260,21 @@ net_slirp_send_packet(const void *qp, size_t pkt_len, void *opaque)
 
     slirp_log("SLiRP: received %d-byte packet\n", pkt_len);
 
-    memcpy(slirp->pkt.data, (uint8_t *) qp, pkt_len);
-    slirp->pkt.len = pkt_len;
-    if (slirp->during_tx) {
-        network_rx_on_tx_put_pkt(slirp->card, &slirp->pkt);
-        slirp->recv_on_tx = 1;
-    } else
-        network_rx_put_pkt(slirp->card, &slirp->pkt);
+    if ((pkt_len == 0) || (pkt_len > NET_MAX_FRAME))
+        return pkt_len;
+
+    /* Frames are collected here and handed to the card once per pass of
+       the polling thread, see net_slirp_rx_flush(). */
+    if (slirp->rx_count == SLIRP_RX_BATCH)
+        net_slirp_rx_flush(slirp);
+    if (slirp->rx_count == SLIRP_RX_BATCH) {
+        slirp_log("SLiRP: card busy, dropped %d-byte packet\n", pkt_len);
+        return pkt_len;
+    }
+
+    memcpy(slirp->pkt_rx_v[slirp->rx_count].data, (uint8_t *) qp, pkt_len);
+    slirp->pkt_rx_v[slirp->rx_count].len = pkt_len;
+    slirp->rx_count++;
 
     return pkt_len;
 }
@@ -226,6 +301,70 @@ net_slirp_add_poll(int fd, int events, void *opaque)
     WSAEventSelect(fd, slirp->sock_event, bitmask);
     return fd;
 }
+#elif defined(__linux__)
+/* libslirp asks for the sockets to watch on every pass. Only what changed
+   since the last pass goes to epoll, the index is the descriptor itself. */
+static int
+#    if SLIRP_CHECK_VERSION(4, 9, 0)
+net_slirp_add_poll(slirp_os_socket fd, int events, void *opaque)
+#    else
+net_slirp_add_poll(int fd, int events, void *opaque)
+#    endif
+{
+    net_slirp_t       *slirp = (net_slirp_t *) opaque;
+    slirp_pollfd_t    *pfd;
+    struct epoll_event ev = { 0 };
+
+    if (fd < 0)
+        return -1;
+
+    if ((uint32_t) fd >= slirp->fd_size) {
+        uint32_t        newsize = MAX((uint32_t) fd + 1, slirp->fd_size * 2);
+        slirp_pollfd_t *new     = realloc(slirp->fds, newsize * sizeof(slirp_pollfd_t));
+        if (!new)
+            return -1;
+        memset(&new[slirp->fd_size], 0, (newsize - slirp->fd_size) * sizeof(slirp_pollfd_t));
+        slirp->fds     = new;
+        slirp->fd_size = newsize;
+    }
+
+    if (slirp->reg_len >= slirp->reg_size) {
+        int *new = realloc(slirp->reg, (slirp->reg_size + 16) * sizeof(int));
+        if (!new)
+            return -1;
+        slirp->reg = new;
+        slirp->reg_size += 16;
+    }
+
+    /* Errors and hang-ups are always reported. */
+    if (events & SLIRP_POLL_IN)
+        ev.events |= EPOLLIN;
+    if (events & SLIRP_POLL_OUT)
+        ev.events |= EPOLLOUT;
+    if (events & SLIRP_POLL_PRI)
+        ev.events |= EPOLLPRI;
+    ev.data.fd = fd;
+
+    pfd      = &slirp->fds[fd];
+    pfd->gen = slirp->gen;
+    if (!pfd->registered) {
+        if ((epoll_ctl(slirp->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) &&
+            ((errno != EEXIST) || (epoll_ctl(slirp->epfd, EPOLL_CTL_MOD, fd, &ev) == -1)))
+            return -1;
+        pfd->registered = 1;
+        pfd->events     = ev.events;
+        if (!pfd->listed) {
+            slirp->reg[slirp->reg_len++] = fd;
+            pfd->listed                  = 1;
+        }
+    } else if (pfd->events != ev.events) {
+        if (epoll_ctl(slirp->epfd, EPOLL_CTL_MOD, fd, &ev) == -1)
+            return -1;
+        pfd->events = ev.events;
+    }
+
+    return fd;
+}
 #else
 static int
 #    if SLIRP_CHECK_VERSION(4, 9, 0)
@@ -295,6 +434,70 @@ net_slirp_get_revents(int idx, void *opaque)
 
     return ret;
 }
+#elif defined(__linux__)
+static int
+net_slirp_get_revents(int idx, void *opaque)
+{
+    net_slirp_t *slirp = (net_slirp_t *) opaque;
+    int          ret   = 0;
+    uint32_t     events;
+
+    if ((idx < 0) || ((uint32_t) idx >= slirp->fd_size))
+        return ret;
+
+    events = slirp->fds[idx].revents;
+    if (events & EPOLLIN)
+        ret |= SLIRP_POLL_IN;
+    if (events & EPOLLOUT)
+        ret |= SLIRP_POLL_OUT;
+    if (events & EPOLLPRI)
+        ret |= SLIRP_POLL_PRI;
+    if (events & EPOLLERR)
+        ret |= SLIRP_POLL_ERR;
+    if (events & EPOLLHUP)
+        ret |= SLIRP_POLL_HUP;
+    return ret;
+}
+
+static void
+net_slirp_poll_begin(net_slirp_t *slirp)
+{
+    for (int i = 0; i < slirp->ready_len; i++)
+        slirp->fds[slirp->ready[i]].revents = 0;
+    slirp->ready_len = 0;
+    slirp->gen++;
+}
+
+static int
+net_slirp_poll_wait(net_slirp_t *slirp, uint32_t timeout)
+{
+    struct epoll_event evs[SLIRP_EPOLL_EVENTS];
+    struct epoll_event ev = { 0 };
+    slirp_pollfd_t    *pfd;
+    int                num;
+
+    /* Stop watching the sockets this pass did not ask for. */
+    for (uint32_t i = 0; i < slirp->reg_len;) {
+        pfd = &slirp->fds[slirp->reg[i]];
+        if (pfd->registered && (pfd->gen != slirp->gen)) {
+            epoll_ctl(slirp->epfd, EPOLL_CTL_DEL, slirp->reg[i], &ev);
+            pfd->registered = 0;
+        }
+        if (!pfd->registered) {
+            pfd->listed   = 0;
+            slirp->reg[i] = slirp->reg[--slirp->reg_len];
+        } else
+            i++;
+    }
+
+    num = epoll_wait(slirp->epfd, evs, SLIRP_EPOLL_EVENTS, (int) timeout);
+    for (int i = 0; i < num; i++) {
+        slirp->fds[evs[i].data.fd].revents = evs[i].events;
+        slirp->ready[slirp->ready_len++]   = evs[i].data.fd;
+    }
+
+    return num;
+}
 #else
 static int
 net_slirp_get_revents(int idx, void *opaque)
@@ -314,6 +517,18 @@ net_slirp_get_revents(int idx, void *opaque)
         ret |= SLIRP_POLL_HUP;
     return ret;
 }
+
+static void
+net_slirp_poll_begin(net_slirp_t *slirp)
+{
+    slirp->pfd_len = 0;
+}
+
+static int
+net_slirp_poll_wait(net_slirp_t *slirp, uint32_t timeout)
+{
+    return poll(slirp->pfd, slirp->pfd_len, (int) timeout);
+}
 #endif
 
 static const SlirpCb slirp_cb = {
@@ -353,18 +568,12 @@ net_slirp_in_available(void *priv)
 }
 
 static void
-net_slirp_rx_deferred_packets(net_slirp_t *slirp)
+net_slirp_tx(net_slirp_t *slirp)
 {
-    int packets = 0;
-
-    if (slirp->recv_on_tx) {
-        do {
-            packets = network_rx_on_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
-            for (int i = 0; i < packets; i++)
-                 network_rx_put_pkt(slirp->card, &(slirp->pkt_tx_v[i]));
-        } while (packets > 0);
-        slirp->recv_on_tx = 0;
-    }
+    int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
+
+    for (int i = 0; i < packets; i++)
+        net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
 }
 
 #ifdef _WIN32
@@ -383,36 +592,40 @@ net_slirp_thread(void *priv)
     bool run               = true;
     while (run) {
         uint32_t timeout = -1;
+        DWORD    count   = 3;
+
+        if (slirp->rx_count) {
+            /* The card has no room for what is left of the last batch,
+               leave the host sockets alone so that their peers slow down. */
+            count   = 2;
+            timeout = SLIRP_RX_RETRY;
+        } else {
 #    if SLIRP_CHECK_VERSION(4, 9, 0)
-        slirp_pollfds_fill_socket(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
+            slirp_pollfds_fill_socket(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
 #    else
-        slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
+            slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
 #    endif
-        if (timeout < 0)
-            timeout = INFINITE;
+            if (timeout < 0)
+                timeout = INFINITE;
+        }
 
-        int ret = WaitForMultipleObjects(3, events, FALSE, (DWORD) timeout);
+        int ret = WaitForMultipleObjects(count, events, FALSE, (DWORD) timeout);
         switch (ret - WAIT_OBJECT_0) {
             case NET_EVENT_STOP:
                 run = false;
                 break;
 
             case NET_EVENT_TX:
-                {
-                    slirp->during_tx = 1;
-                    int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
-                    for (int i = 0; i < packets; i++)
-                        net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
-                    slirp->during_tx = 0;
-
-                    net_slirp_rx_deferred_packets(slirp);
-                }
+                net_slirp_tx(slirp);
                 break;
 
             default:
-                slirp_pollfds_poll(slirp->slirp, ret == WAIT_FAILED, net_slirp_get_revents, slirp);
+                if (count == 3)
+                    slirp_pollfds_poll(slirp->slirp, ret == WAIT_FAILED, net_slirp_get_revents, slirp);
                 break;
         }
+
+        net_slirp_rx_flush(slirp);
     }
 
     slirp_log("SLiRP: polling stopped.\n");
@@ -429,37 +642,50 @@ net_slirp_thread(void *priv)
 
     while (1) {
         uint32_t timeout = -1;
-
-        slirp->pfd_len = 0;
-        net_slirp_add_poll(net_event_get_fd(&slirp->stop_event), SLIRP_POLL_IN, slirp);
-        net_slirp_add_poll(net_event_get_fd(&slirp->tx_event), SLIRP_POLL_IN, slirp);
+        int      stop;
+        int      tx;
+
+        if (slirp->rx_count) {
+            /* The card has no room for what is left of the last batch,
+               leave the host sockets alone so that their peers slow down. */
+            struct pollfd pfd[2] = {
+                { .fd = net_event_get_fd(&slirp->stop_event), .events = POLLIN },
+                { .fd = net_event_get_fd(&slirp->tx_event), .events = POLLIN }
+            };
+
+            poll(pfd, 2, SLIRP_RX_RETRY);
+            stop = pfd[0].revents & POLLIN;
+            tx   = pfd[1].revents & POLLIN;
+        } else {
+            net_slirp_poll_begin(slirp);
+            int stop_idx = net_slirp_add_poll(net_event_get_fd(&slirp->stop_event), SLIRP_POLL_IN, slirp);
+            int tx_idx   = net_slirp_add_poll(net_event_get_fd(&slirp->tx_event), SLIRP_POLL_IN, slirp);
 
 #    if SLIRP_CHECK_VERSION(4, 9, 0)
-        slirp_pollfds_fill_socket(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
+            slirp_pollfds_fill_socket(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
 #    else
-        slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
+            slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
 #    endif
 
-        int ret = poll(slirp->pfd, slirp->pfd_len, timeout);
+            int ret = net_slirp_poll_wait(slirp, timeout);
+
+            slirp_pollfds_poll(slirp->slirp, (ret < 0), net_slirp_get_revents, slirp);
 
-        slirp_pollfds_poll(slirp->slirp, (ret < 0), net_slirp_get_revents, slirp);
+            stop = net_slirp_get_revents(stop_idx, slirp) & SLIRP_POLL_IN;
+            tx   = net_slirp_get_revents(tx_idx, slirp) & SLIRP_POLL_IN;
+        }
 
-        if (slirp->pfd[NET_EVENT_STOP].revents & POLLIN) {
+        if (stop) {
             net_event_clear(&slirp->stop_event);
             break;
         }
 
-        if (slirp->pfd[NET_EVENT_TX].revents & POLLIN) {
+        if (tx) {
             net_event_clear(&slirp->tx_event);
-
-            slirp->during_tx = 1;
-            int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
-            for (int i = 0; i < packets; i++)
-                net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
-            slirp->during_tx = 0;
-
-            net_slirp_rx_deferred_packets(slirp);
+            net_slirp_tx(slirp);
         }
+
+        net_slirp_rx_flush(slirp);
     }
 
     slirp_log("SLiRP: polling stopped.\n");
@@ -476,8 +702,17 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     net_slirp_t *slirp = calloc(1, sizeof(net_slirp_t));
     memcpy(slirp->mac_addr, mac_addr, sizeof(slirp->mac_addr));
     slirp->card = (netcard_t *) card;
+    slirp->sockbuf = net_cards_conf[card->card_num].slirp_sockbuf * 1024;
 
-#ifndef _WIN32
+#if defined(__linux__)
+    slirp->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (slirp->epfd == -1) {
+        slirp_log("SLiRP: epoll_create1() failed\n");
+        snprintf(netdrv_errbuf, NET_DRV_ERRBUF_SIZE, "SLiRP initialization failed");
+        free(slirp);
+        return NULL;
+    }
+#elif !defined(_WIN32)
     slirp->pfd_size = 16 * sizeof(struct pollfd);
     slirp->pfd      = calloc(1, slirp->pfd_size);
 #endif
@@ -533,6 +768,11 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     if (!slirp->slirp) {
         slirp_log("SLiRP: initialization failed\n");
         snprintf(netdrv_errbuf, NET_DRV_ERRBUF_SIZE, "SLiRP initialization failed");
+#if defined(__linux__)
+        close(slirp->epfd);
+#elif !defined(_WIN32)
+        free(slirp->pfd);
+#endif
         free(slirp);
         return NULL;
     }
@@ -570,7 +810,9 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     for (int i = 0; i < SLIRP_PKT_BATCH; i++) {
         slirp->pkt_tx_v[i].data = calloc(1, NET_MAX_FRAME);
     }
-    slirp->pkt.data = calloc(1, NET_MAX_FRAME);
+    for (int i = 0; i < SLIRP_RX_BATCH; i++) {
+        slirp->pkt_rx_v[i].data = calloc(1, NET_MAX_FRAME);
+    }
     net_event_init(&slirp->rx_event);
     net_event_init(&slirp->tx_event);
     net_event_init(&slirp->stop_event);
@@ -633,7 +875,16 @@ net_slirp_close(void *priv)
     for (int i = 0; i < SLIRP_PKT_BATCH; i++) {
         free(slirp->pkt_tx_v[i].data);
     }
-    free(slirp->pkt.data);
+    for (int i = 0; i < SLIRP_RX_BATCH; i++) {
+        free(slirp->pkt_rx_v[i].data);
+    }
+#if defined(__linux__)
+    close(slirp->epfd);
+    free(slirp->fds);
+    free(slirp->reg);
+#elif !defined(_WIN32)
+    free(slirp->pfd);
+#endif
     free(slirp);
     slirp_card_num--;
 }
@@ -0,0 +1,612 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared memory virtual Ethernet switch.
+ *
+ *          Cards attached to a switch of the same name, in this or in
+ *          other instances run by the same user, share a memory segment
+ *          with a port per card. Each port has a receive ring the other
+ *          ports put frames in, and the table of source addresses its
+ *          owner has sent frames from, which the other ports look up to
+ *          forward unicast frames. Everything else is flooded. A named
+ *          FIFO per port is used as its doorbell.
+ *
+ *          Only available on hosts with POSIX shared memory.
+ *
+ *
+ *
+ * Authors: agent, <agent@local>
+ *
+ *          Copyright 2026 agent.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_event.h>
+
+#define SWITCH_MAGIC     0x48435753 /* 'SWCH' */
+#define SWITCH_VERSION   1
+#define SWITCH_PORTS     64
+#define SWITCH_SLOTS     128 /* Must be a power of 2. */
+#define SWITCH_MACS      8
+#define SWITCH_PKT_BATCH NET_QUEUE_LEN
+#define SWITCH_NAME_MAX  64
+
+enum {
+    NET_EVENT_STOP = 0,
+    NET_EVENT_TX,
+    NET_EVENT_RX,
+    NET_EVENT_MAX
+};
+
+/* Frames sent to a port. Filled by the other ports, emptied by the owner. */
+typedef struct switch_ring_t {
+    atomic_int  lock; /* PID of the port filling the ring */
+    atomic_uint head;
+    atomic_uint tail;
+    uint16_t    len[SWITCH_SLOTS];
+    uint8_t     data[SWITCH_SLOTS][NET_MAX_FRAME];
+} switch_ring_t;
+
+typedef struct switch_port_t {
+    atomic_int            owner;             /* PID of the owner, 0 if the port is free */
+    atomic_uint           generation;        /* Bumped whenever the port is taken */
+    atomic_uint_least64_t macs[SWITCH_MACS]; /* Learned source addresses, 0 if unused */
+    switch_ring_t         ring;
+} switch_port_t;
+
+typedef struct switch_shm_t {
+    atomic_uint   magic;
+    uint32_t      version;
+    uint32_t      size;
+    uint32_t      pad;
+    switch_port_t port[SWITCH_PORTS];
+} switch_shm_t;
+
+typedef struct net_switch_t {
+    switch_shm_t *shm;
+    netcard_t    *card;
+    thread_t     *poll_tid;
+    net_evt_t     tx_event;
+    net_evt_t     stop_event;
+    int           port;
+    int           doorbell;
+    int           peer_fd[SWITCH_PORTS];
+    uint32_t      peer_gen[SWITCH_PORTS];
+    uint32_t      next_mac;
+    netpkt_t      pktv[SWITCH_PKT_BATCH];
+    uint8_t       mac_addr[6];
+    char          name[SWITCH_NAME_MAX];
+} net_switch_t;
+
+#ifdef ENABLE_NET_SWITCH_LOG
+int net_switch_do_log = ENABLE_NET_SWITCH_LOG;
+
+static void
+net_switch_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (net_switch_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define net_switch_log(fmt, ...)
+#endif
+
+static int
+net_switch_pid_alive(int pid)
+{
+    return (kill(pid, 0) == 0) || (errno != ESRCH);
+}
+
+static void
+net_switch_doorbell_path(char *path, size_t size, const char *name, int port)
+{
+    const char *tmp = getenv("TMPDIR");
+
+    if ((tmp == NULL) || (tmp[0] == '\0'))
+        tmp = "/tmp";
+
+    snprintf(path, size, "%s/86box-switch-%s-%02i", tmp, name, port);
+}
+
+static uint64_t
+net_switch_mac_key(const uint8_t *mac)
+{
+    uint64_t key = 1ULL << 48; /* so that no address is stored as 0 */
+
+    for (int i = 0; i < 6; i++)
+        key |= ((uint64_t) mac[i]) << (i << 3);
+
+    return key;
+}
+
+static void
+net_switch_ring_lock(switch_ring_t *ring)
+{
+    const int pid = (int) getpid();
+    int       holder;
+
+    for (uint32_t i = 0;; i++) {
+        holder = 0;
+        if (atomic_compare_exchange_weak(&ring->lock, &holder, pid))
+            return;
+
+        /* Take over the lock of a port that has gone away while holding it. */
+        if (!(i & 0xfff) && (holder != 0) && (holder != pid) && !net_switch_pid_alive(holder) &&
+            atomic_compare_exchange_strong(&ring->lock, &holder, pid))
+            return;
+
+        sched_yield();
+    }
+}
+
+static void
+net_switch_ring_unlock(switch_ring_t *ring)
+{
+    atomic_store(&ring->lock, 0);
+}
+
+/* Puts a frame in a port's ring, returns 1 if the ring was empty, 0 if not, and -1 if it is full. */
+static int
+net_switch_ring_put(switch_ring_t *ring, const uint8_t *data, int len)
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t slot;
+
+    net_switch_ring_lock(ring);
+
+    head = atomic_load(&ring->head);
+    tail = atomic_load(&ring->tail);
+    if ((head - tail) >= SWITCH_SLOTS) {
+        net_switch_ring_unlock(ring);
+        return -1;
+    }
+
+    slot = head & (SWITCH_SLOTS - 1);
+    memcpy(ring->data[slot], data, len);
+    ring->len[slot] = len;
+    atomic_store(&ring->head, head + 1);
+
+    net_switch_ring_unlock(ring);
+
+    return head == tail;
+}
+
+static void
+net_switch_ring_doorbell(net_switch_t *sw, int port)
+{
+    const uint32_t generation = atomic_load(&sw->shm->port[port].generation);
+    char           path[1024];
+
+    if ((sw->peer_fd[port] == -1) || (sw->peer_gen[port] != generation)) {
+        if (sw->peer_fd[port] != -1)
+            close(sw->peer_fd[port]);
+
+        net_switch_doorbell_path(path, sizeof(path), sw->name, port);
+        sw->peer_fd[port]  = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        sw->peer_gen[port] = generation;
+    }
+
+    /* A full FIFO already has the owner woken up. */
+    if ((sw->peer_fd[port] != -1) && (write(sw->peer_fd[port], "a", 1) < 0) && (errno != EAGAIN)) {
+        close(sw->peer_fd[port]);
+        sw->peer_fd[port] = -1;
+    }
+}
+
+static int
+net_switch_lookup(net_switch_t *sw, const uint8_t *mac)
+{
+    const uint64_t key  = net_switch_mac_key(mac);
+    switch_port_t *port = NULL;
+
+    /* Broadcast and multicast frames are flooded. */
+    if (mac[0] & 0x01)
+        return -1;
+
+    for (int p = 0; p < SWITCH_PORTS; p++) {
+        port = &sw->shm->port[p];
+        if ((p == sw->port) || !atomic_load(&port->owner))
+            continue;
+
+        for (int m = 0; m < SWITCH_MACS; m++) {
+            if (atomic_load(&port->macs[m]) == key)
+                return p;
+        }
+    }
+
+    return -1;
+}
+
+/* Records a source address in our port's table, the oldest one goes if it is full. */
+static void
+net_switch_learn(net_switch_t *sw, const uint8_t *mac)
+{
+    switch_port_t *port = &sw->shm->port[sw->port];
+    const uint64_t key  = net_switch_mac_key(mac);
+
+    if (mac[0] & 0x01)
+        return;
+
+    for (int m = 0; m < SWITCH_MACS; m++) {
+        if (atomic_load(&port->macs[m]) == key)
+            return;
+    }
+
+    atomic_store(&port->macs[sw->next_mac], key);
+    sw->next_mac = (sw->next_mac + 1) % SWITCH_MACS;
+}
+
+static void
+net_switch_forward(net_switch_t *sw, const netpkt_t *pkt, uint64_t *doorbells)
+{
+    int port;
+
+    if (pkt->len < 14)
+        return;
+
+    net_switch_learn(sw, &pkt->data[6]);
+
+    port = net_switch_lookup(sw, pkt->data);
+    if (port != -1) {
+        if (net_switch_ring_put(&sw->shm->port[port].ring, pkt->data, pkt->len) == 1)
+            *doorbells |= 1ULL << port;
+        return;
+    }
+
+    for (port = 0; port < SWITCH_PORTS; port++) {
+        if ((port == sw->port) || !atomic_load(&sw->shm->port[port].owner))
+            continue;
+
+        if (net_switch_ring_put(&sw->shm->port[port].ring, pkt->data, pkt->len) == 1)
+            *doorbells |= 1ULL << port;
+    }
+}
+
+/* Hands the frames in our ring to the card, returns 1 if some had to be left for later. */
+static int
+net_switch_receive(net_switch_t *sw)
+{
+    switch_ring_t *ring = &sw->shm->port[sw->port].ring;
+    uint32_t       tail;
+    uint32_t       slot;
+
+    while ((tail = atomic_load(&ring->tail)) != atomic_load(&ring->head)) {
+        slot = tail & (SWITCH_SLOTS - 1);
+        if (!network_rx_put(sw->card, ring->data[slot], ring->len[slot]))
+            return 1;
+        atomic_store(&ring->tail, tail + 1);
+    }
+
+    return 0;
+}
+
+static void
+net_switch_thread(void *priv)
+{
+    net_switch_t *sw       = (net_switch_t *) priv;
+    int           pending  = 0;
+    uint64_t      doorbells;
+    uint8_t       dummy[64];
+    struct pollfd pfd[NET_EVENT_MAX];
+
+    net_switch_log("Switch %s: Port %i polling started.\n", sw->name, sw->port);
+
+    pfd[NET_EVENT_STOP].fd     = net_event_get_fd(&sw->stop_event);
+    pfd[NET_EVENT_STOP].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_TX].fd     = net_event_get_fd(&sw->tx_event);
+    pfd[NET_EVENT_TX].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_RX].fd     = sw->doorbell;
+    pfd[NET_EVENT_RX].events = POLLIN;
+
+    /* Frames put in the ring before the doorbell was ready rang no doorbell. */
+    pending = net_switch_receive(sw);
+
+    while (1) {
+        /* Frames the card had no room for are retried shortly. */
+        poll(pfd, NET_EVENT_MAX, pending ? 1 : -1);
+
+        if (pfd[NET_EVENT_TX].revents & POLLIN) {
+            net_event_clear(&sw->tx_event);
+
+            doorbells   = 0;
+            int packets = network_tx_popv(sw->card, sw->pktv, SWITCH_PKT_BATCH);
+            for (int i = 0; i < packets; i++)
+                net_switch_forward(sw, &sw->pktv[i], &doorbells);
+
+            for (int p = 0; doorbells; p++, doorbells >>= 1) {
+                if (doorbells & 1)
+                    net_switch_ring_doorbell(sw, p);
+            }
+        }
+
+        /* The doorbell is drained before the ring, so a frame put in after the
+           ring was found empty always leaves the doorbell rung. */
+        if (pfd[NET_EVENT_RX].revents & POLLIN) {
+            while (read(sw->doorbell, dummy, sizeof(dummy)) > 0)
+                ;
+        }
+
+        pending = net_switch_receive(sw);
+
+        if (pfd[NET_EVENT_STOP].revents & POLLIN) {
+            net_event_clear(&sw->stop_event);
+            break;
+        }
+    }
+
+    net_switch_log("Switch %s: Port %i polling stopped.\n", sw->name, sw->port);
+}
+
+static void
+net_switch_error(char *errbuf, const char *message)
+{
+    strncpy(errbuf, message, NET_DRV_ERRBUF_SIZE);
+    net_switch_log("Switch: %s\n", message);
+}
+
+static switch_shm_t *
+net_switch_map(const char *name, char *errbuf)
+{
+    char          path[SWITCH_NAME_MAX + 16];
+    char          buf[NET_DRV_ERRBUF_SIZE];
+    struct stat   st;
+    switch_shm_t *shm;
+    uint32_t      magic = 0;
+    int           fd;
+
+    snprintf(path, sizeof(path), "/86box-switch-%s", name);
+    fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        snprintf(buf, sizeof(buf), "Unable to open switch %s (%s)", name, strerror(errno));
+        net_switch_error(errbuf, buf);
+        return NULL;
+    }
+
+    if ((fstat(fd, &st) == -1) ||
+        ((st.st_size < (off_t) sizeof(switch_shm_t)) && (ftruncate(fd, sizeof(switch_shm_t)) == -1))) {
+        snprintf(buf, sizeof(buf), "Unable to size switch %s (%s)", name, strerror(errno));
+        net_switch_error(errbuf, buf);
+        close(fd);
+        return NULL;
+    }
+
+    shm = (switch_shm_t *) mmap(NULL, sizeof(switch_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        snprintf(buf, sizeof(buf), "Unable to map switch %s (%s)", name, strerror(errno));
+        net_switch_error(errbuf, buf);
+        return NULL;
+    }
+
+    /* The first instance to get here sets the switch up, the others wait for it. */
+    if (atomic_compare_exchange_strong(&shm->magic, &magic, 1)) {
+        shm->version = SWITCH_VERSION;
+        shm->size    = sizeof(switch_shm_t);
+        atomic_store(&shm->magic, SWITCH_MAGIC);
+    } else {
+        for (int i = 0; (i < 1000) && (atomic_load(&shm->magic) != SWITCH_MAGIC); i++)
+            usleep(1000);
+    }
+
+    if ((atomic_load(&shm->magic) != SWITCH_MAGIC) || (shm->version != SWITCH_VERSION) ||
+        (shm->size != sizeof(switch_shm_t))) {
+        snprintf(buf, sizeof(buf), "Switch %s is in use by an incompatible version", name);
+        net_switch_error(errbuf, buf);
+        munmap(shm, sizeof(switch_shm_t));
+        return NULL;
+    }
+
+    return shm;
+}
+
+static int
+net_switch_claim(switch_shm_t *shm)
+{
+    const int      pid = (int) getpid();
+    switch_port_t *port;
+    int            owner;
+
+    for (int p = 0; p < SWITCH_PORTS; p++) {
+        port  = &shm->port[p];
+        owner = atomic_load(&port->owner);
+
+        /* Ports left behind by instances that have gone away are taken over. */
+        if ((owner != 0) && net_switch_pid_alive(owner))
+            continue;
+
+        if (!atomic_compare_exchange_strong(&port->owner, &owner, pid))
+            continue;
+
+        for (int m = 0; m < SWITCH_MACS; m++)
+            atomic_store(&port->macs[m], 0);
+
+        net_switch_ring_lock(&port->ring);
+        atomic_store(&port->ring.tail, atomic_load(&port->ring.head));
+        net_switch_ring_unlock(&port->ring);
+
+        return p;
+    }
+
+    return -1;
+}
+
+/* Gives our port back, and removes the switch if no other port is in use. */
+static void
+net_switch_release(net_switch_t *sw)
+{
+    switch_port_t *port = &sw->shm->port[sw->port];
+    int            pid  = (int) getpid();
+    int            owner;
+    char           path[SWITCH_NAME_MAX + 16];
+
+    for (int m = 0; m < SWITCH_MACS; m++)
+        atomic_store(&port->macs[m], 0);
+
+    atomic_compare_exchange_strong(&port->owner, &pid, 0);
+
+    for (int p = 0; p < SWITCH_PORTS; p++) {
+        owner = atomic_load(&sw->shm->port[p].owner);
+        if ((owner != 0) && net_switch_pid_alive(owner))
+            return;
+    }
+
+    snprintf(path, sizeof(path), "/86box-switch-%s", sw->name);
+    shm_unlink(path);
+    net_switch_log("Switch %s: Last port closed, switch removed\n", sw->name);
+}
+
+void *
+net_switch_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *netdrv_errbuf)
+{
+    const char   *name = (const char *) priv;
+    char          path[1024];
+    char          buf[NET_DRV_ERRBUF_SIZE];
+    net_switch_t *sw;
+    switch_shm_t *shm;
+    int           port;
+    int           fd;
+
+    if ((name == NULL) || (name[0] == '\0') || !strcmp(name, "none")) {
+        net_switch_error(netdrv_errbuf, "No switch name configured");
+        return NULL;
+    }
+
+    if ((strlen(name) >= SWITCH_NAME_MAX) ||
+        (strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.-") != strlen(name))) {
+        net_switch_error(netdrv_errbuf, "Switch names may only contain letters, digits, '.', '_' and '-'");
+        return NULL;
+    }
+
+    shm = net_switch_map(name, netdrv_errbuf);
+    if (shm == NULL)
+        return NULL;
+
+    port = net_switch_claim(shm);
+    if (port == -1) {
+        snprintf(buf, sizeof(buf), "All %i ports of switch %s are in use", SWITCH_PORTS, name);
+        net_switch_error(netdrv_errbuf, buf);
+        munmap(shm, sizeof(switch_shm_t));
+        return NULL;
+    }
+
+    /* Opened for writing as well, so the FIFO never reports a hang up. */
+    net_switch_doorbell_path(path, sizeof(path), name, port);
+    unlink(path);
+    fd = -1;
+    if (mkfifo(path, 0600) == 0)
+        fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        snprintf(buf, sizeof(buf), "Unable to create the doorbell %s (%s)", path, strerror(errno));
+        net_switch_error(netdrv_errbuf, buf);
+        atomic_store(&shm->port[port].owner, 0);
+        munmap(shm, sizeof(switch_shm_t));
+        return NULL;
+    }
+
+    /* Only now that the doorbell is there, so that the other ports reopen the new one. */
+    atomic_fetch_add(&shm->port[port].generation, 1);
+
+    sw           = (net_switch_t *) calloc(1, sizeof(net_switch_t));
+    sw->shm      = shm;
+    sw->card     = (netcard_t *) card;
+    sw->port     = port;
+    sw->doorbell = fd;
+    strcpy(sw->name, name);
+    memcpy(sw->mac_addr, mac_addr, sizeof(sw->mac_addr));
+    for (int p = 0; p < SWITCH_PORTS; p++)
+        sw->peer_fd[p] = -1;
+
+    /* Make the card reachable before it has sent anything. */
+    net_switch_learn(sw, sw->mac_addr);
+
+    for (int i = 0; i < SWITCH_PKT_BATCH; i++)
+        sw->pktv[i].data = calloc(1, NET_MAX_FRAME);
+    net_event_init(&sw->tx_event);
+    net_event_init(&sw->stop_event);
+    sw->poll_tid = thread_create(net_switch_thread, sw);
+
+    net_switch_log("Switch %s: Attached to port %i\n", name, port);
+
+    return sw;
+}
+
+void
+net_switch_in_available(void *priv)
+{
+    net_switch_t *sw = (net_switch_t *) priv;
+
+    net_event_set(&sw->tx_event);
+}
+
+void
+net_switch_close(void *priv)
+{
+    net_switch_t *sw = (net_switch_t *) priv;
+    char          path[1024];
+
+    if (sw == NULL)
+        return;
+
+    net_switch_log("Switch %s: Closing port %i\n", sw->name, sw->port);
+
+    net_event_set(&sw->stop_event);
+    thread_wait(sw->poll_tid);
+
+    net_switch_release(sw);
+
+    for (int p = 0; p < SWITCH_PORTS; p++) {
+        if (sw->peer_fd[p] != -1)
+            close(sw->peer_fd[p]);
+    }
+    close(sw->doorbell);
+    net_switch_doorbell_path(path, sizeof(path), sw->name, sw->port);
+    unlink(path);
+
+    munmap(sw->shm, sizeof(switch_shm_t));
+
+    for (int i = 0; i < SWITCH_PKT_BATCH; i++)
+        free(sw->pktv[i].data);
+    net_event_close(&sw->tx_event);
+    net_event_close(&sw->stop_event);
+    free(sw);
+}
+
+const netdrv_t net_switch_drv = {
+    .notify_in = &net_switch_in_available,
+    .init      = &net_switch_init,
+    .close     = &net_switch_close,
+    .priv      = NULL
+};
@@ -338,6 +338,12 @@ struct TULIPState {
     uint32_t bios_addr;
     uint8_t  filter[16][6];
     int      has_bios;
+
+    /* Receive interrupt moderation, delay in microseconds (0 if disabled) */
+    pc_timer_t rx_int_timer;
+    uint32_t   rx_int_delay;
+
+    netdesc_win_t desc_win;
 };
 
 typedef struct TULIPState TULIPState;
@@ -346,10 +352,13 @@ static void
 tulip_desc_read(TULIPState *s, uint32_t p,
                 struct tulip_descriptor *desc)
 {
-    desc->status    = mem_readl_phys(p);
-    desc->control   = mem_readl_phys(p + 4);
-    desc->buf_addr1 = mem_readl_phys(p + 8);
-    desc->buf_addr2 = mem_readl_phys(p + 12);
+    uint32_t data[4];
+
+    network_desc_read(&s->desc_win, p, data, sizeof(data), 0, 4);
+    desc->status    = data[0];
+    desc->control   = data[1];
+    desc->buf_addr1 = data[2];
+    desc->buf_addr2 = data[3];
 
     if (s->csr[0] & CSR0_DBO) {
         bswap32s(&desc->status);
@@ -363,17 +372,21 @@ static void
 tulip_desc_write(TULIPState *s, uint32_t p,
                  struct tulip_descriptor *desc)
 {
+    uint32_t data[4];
+
     if (s->csr[0] & CSR0_DBO) {
-        mem_writel_phys(p, bswap32(desc->status));
-        mem_writel_phys(p + 4, bswap32(desc->control));
-        mem_writel_phys(p + 8, bswap32(desc->buf_addr1));
-        mem_writel_phys(p + 12, bswap32(desc->buf_addr2));
+        data[0] = bswap32(desc->status);
+        data[1] = bswap32(desc->control);
+        data[2] = bswap32(desc->buf_addr1);
+        data[3] = bswap32(desc->buf_addr2);
     } else {
-        mem_writel_phys(p, desc->status);
-        mem_writel_phys(p + 4, desc->control);
-        mem_writel_phys(p + 8, desc->buf_addr1);
-        mem_writel_phys(p + 12, desc->buf_addr2);
+        data[0] = desc->status;
+        data[1] = desc->control;
+        data[2] = desc->buf_addr1;
+        data[3] = desc->buf_addr2;
     }
+
+    network_desc_write(&s->desc_win, p, data, sizeof(data), 4);
 }
 
 static void
@@ -535,7 +548,12 @@ tulip_receive(void *priv, uint8_t *buf, int size)
         if (!s->rx_frame_len) {
             desc.status |= s->rx_status;
             s->csr[5] |= CSR5_RI;
-            tulip_update_int(s);
+            /* With moderation, RI is signalled once the delay expires, or
+               earlier along with any other interrupt source. */
+            if (!s->rx_int_delay)
+                tulip_update_int(s);
+            else if (!timer_is_enabled(&s->rx_int_timer))
+                timer_set_delay_u64(&s->rx_int_timer, s->rx_int_delay * TIMER_USEC);
         }
         tulip_desc_write(s, s->current_rx_desc, &desc);
         tulip_next_rx_descriptor(s, &desc);
@@ -545,6 +563,14 @@ tulip_receive(void *priv, uint8_t *buf, int size)
     return 1;
 }
 
+static void
+tulip_rx_int_timer(void *priv)
+{
+    TULIPState *s = (TULIPState *) priv;
+
+    tulip_update_int(s);
+}
+
 static void
 tulip_update_rs(TULIPState *s, int state)
 {
@@ -747,10 +773,9 @@ tulip_tx(TULIPState *s, struct tulip_descriptor *desc)
         }
     }
 
-    if (desc->control & TDES1_IC) {
+    /* The interrupt is raised once the whole list has been processed. */
+    if (desc->control & TDES1_IC)
         s->csr[5] |= CSR5_TI;
-        tulip_update_int(s);
-    }
 }
 
 static int
@@ -812,10 +837,8 @@ tulip_setup_frame(TULIPState              *s,
 
     desc->status = 0x7fffffff;
 
-    if (desc->control & TDES1_IC) {
+    if (desc->control & TDES1_IC)
         s->csr[5] |= CSR5_TI;
-        tulip_update_int(s);
-    }
 }
 
 static void
@@ -848,14 +871,16 @@ tulip_xmit_list_update(TULIPState *s)
         return;
     }
 
+    /* The guest can not run until the list is done, read it ahead. */
+    network_desc_begin(&s->desc_win);
+
     for (uint8_t i = 0; i < TULIP_DESC_MAX; i++) {
         tulip_desc_read(s, s->current_tx_desc, &desc);
 
         if (!(desc.status & TDES0_OWN)) {
             tulip_update_ts(s, CSR5_TS_SUSPENDED);
             s->csr[5] |= CSR5_TU;
-            tulip_update_int(s);
-            return;
+            break;
         }
 
         if (desc.control & TDES1_SET) {
@@ -874,6 +899,9 @@ tulip_xmit_list_update(TULIPState *s)
         tulip_desc_write(s, s->current_tx_desc, &desc);
         tulip_next_tx_descriptor(s, &desc);
     }
+
+    network_desc_end(&s->desc_win);
+    tulip_update_int(s);
 }
 
 static void
@@ -1668,6 +1696,8 @@ nic_init(const device_t *info)
     //pclog("EEPROM Data Format=%02x, Count=%02x, MAC=%02x:%02x:%02x:%02x:%02x:%02x.\n", eeprom_data[0x12], eeprom_data[0x13], eeprom_data[0x14], eeprom_data[0x15], eeprom_data[0x16], eeprom_data[0x17], eeprom_data[0x18], eeprom_data[0x19]);
     memcpy(s->mii_regs, tulip_mdi_default, sizeof(tulip_mdi_default));
     s->nic = network_attach(s, &eeprom_data[(info->local == 3) ? 0 : 20], tulip_receive, NULL);
+    s->rx_int_delay = device_get_config_int("rx_int_delay");
+    timer_add(&s->rx_int_timer, tulip_rx_int_timer, s, 0);
     pci_add_card(PCI_ADD_NORMAL, tulip_pci_read, tulip_pci_write, s, &s->pci_slot);
     tulip_reset(s);
     return s;
@@ -1676,6 +1706,10 @@ nic_init(const device_t *info)
 static void
 nic_close(void *priv)
 {
+    TULIPState *s = (TULIPState *) priv;
+
+    netcard_close(s->nic);
+
     free(priv);
 }
 
@@ -1692,6 +1726,24 @@ static const device_config_t dec_tulip_21143_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "rx_int_delay",
+        .description    = "Receive interrupt moderation",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Disabled", .value =   0 },
+            { .description = "50 µs",    .value =  50 },
+            { .description = "100 µs",   .value = 100 },
+            { .description = "250 µs",   .value = 250 },
+            { .description = "500 µs",   .value = 500 },
+            { .description = ""                       }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 };
 
@@ -1718,6 +1770,24 @@ static const device_config_t dec_tulip_21140_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "rx_int_delay",
+        .description    = "Receive interrupt moderation",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Disabled", .value =   0 },
+            { .description = "50 µs",    .value =  50 },
+            { .description = "100 µs",   .value = 100 },
+            { .description = "250 µs",   .value = 250 },
+            { .description = "500 µs",   .value = 500 },
+            { .description = ""                       }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 };
 // clang-format on
@@ -61,12 +61,14 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/dma.h>
 #include <86box/timer.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/timer.h>
 #include <86box/network.h>
+#include <86box/net_capture.h>
 #include <86box/net_ne2000.h>
 #include <86box/net_pcnet.h>
 #include <86box/net_wd8003.h>
@@ -128,6 +130,9 @@ int  network_ndev;
 netdev_t network_devs[NET_HOST_INTF_MAX];
 
 /* Local variables. */
+static netcard_t  *network_cards[NET_CARD_MAX];
+static atomic_uint network_rx_wake; /* Cards the host has queued packets for */
+
 #ifdef ENABLE_NETWORK_LOG
 int             network_do_log = ENABLE_NETWORK_LOG;
 static FILE    *network_dump   = NULL;
@@ -197,6 +202,27 @@ network_winsock_clean(void)
 }
 #endif
 
+/* Restart the timer of the cards that were idle when packets arrived. */
+static void
+network_wake(void)
+{
+    uint32_t wake = atomic_exchange(&network_rx_wake, 0);
+
+    for (int i = 0; wake && (i < NET_CARD_MAX); i++) {
+        netcard_t *card = network_cards[i];
+
+        if ((wake & (1 << i)) && (card != NULL))
+            timer_kick(&card->timer, NET_PERIOD_WAKE);
+    }
+}
+
+static void
+network_rx_signal(netcard_t *card)
+{
+    atomic_fetch_or(&network_rx_wake, 1 << card->card_num);
+    timer_wake();
+}
+
 /*
  * Initialize the configured network cards.
  *
@@ -235,6 +261,12 @@ network_init(void)
         network_devmap.has_vde = 1;
 #endif
 
+#ifdef HAS_SWITCH
+    network_devmap.has_switch = 1;
+#endif
+
+    timer_add_wake(network_wake);
+
 #ifdef ENABLE_NETWORK_LOG
     /* Start packet dump. */
     network_dump = fopen("network.pcap", "wb");
@@ -378,6 +410,28 @@ network_queue_clear(netqueue_t *queue)
     queue->tail = queue->head = 0;
 }
 
+/* Hand the packets the card has queued over to the host. */
+static uint32_t
+network_tx_move(netcard_t *card)
+{
+    uint32_t tx_bytes = 0;
+
+    thread_wait_mutex(card->tx_mutex);
+    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
+        if (!bytes)
+            break;
+        tx_bytes += bytes;
+    }
+    thread_release_mutex(card->tx_mutex);
+    if (tx_bytes) {
+        /* Notify host that a packet is available in the TX queue */
+        card->host_drv.notify_in(card->host_drv.priv);
+    }
+
+    return tx_bytes;
+}
+
 static void
 network_rx_queue(void *priv)
 {
@@ -404,30 +458,15 @@ network_rx_queue(void *priv)
         int res = card->rx(card->card_drv, card->queued_pkt.data, card->queued_pkt.len);
         if (!res)
             break;
+        if (card->capture)
+            net_capture_packet(card->capture, card->queued_pkt.data, card->queued_pkt.len, NET_CAPTURE_IN);
         rx_bytes += card->queued_pkt.len;
         card->queued_pkt.len = 0;
     }
 
     /* Transmission. */
-    uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
-        if (!bytes)
-            break;
-        tx_bytes += bytes;
-    }
-    thread_release_mutex(card->tx_mutex);
-    if (tx_bytes) {
-        /* Notify host that a packet is available in the TX queue */
-        card->host_drv.notify_in(card->host_drv.priv);
-    }
-
-    double timer_period = card->byte_period * (rx_bytes > tx_bytes ? rx_bytes : tx_bytes);
-    if (timer_period < 200)
-        timer_period = 200;
-
-    timer_on_auto(&card->timer, timer_period);
+    uint32_t tx_bytes   = network_tx_move(card);
+    bool     tx_pending = !network_queue_empty(&card->queues[NET_QUEUE_TX_VM]);
 
     bool activity = rx_bytes || tx_bytes;
     bool led_on   = card->led_timer & 0x80000000;
@@ -437,6 +476,22 @@ network_rx_queue(void *priv)
         card->led_timer = 0 | (activity << 31);
     }
 
+    /* Pace by wire time while data is flowing. Once the queues are empty the
+       timer stops, and the next packet from either side restarts it. */
+    double timer_period;
+    if (activity)
+        timer_period = card->byte_period * (rx_bytes > tx_bytes ? rx_bytes : tx_bytes);
+    else if (card->queued_pkt.len || tx_pending)
+        timer_period = NET_PERIOD_RETRY; /* The card or the host is not accepting packets. */
+    else if (card->led_timer & 0x80000000)
+        timer_period = 150000 - (card->led_timer & 0x7fffffff); /* Turn the LEDs off. */
+    else {
+        timer_idle(&card->timer);
+        return;
+    }
+
+    timer_on_auto(&card->timer, timer_period);
+
     card->led_timer += timer_period;
 }
 
@@ -489,6 +544,12 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
             card->host_drv      = net_vde_drv;
             card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
             break;
+#endif
+#ifdef HAS_SWITCH
+        case NET_TYPE_SWITCH:
+            card->host_drv      = net_switch_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
+            break;
 #endif
         default:
             card->host_drv.priv = NULL;
@@ -532,8 +593,12 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
 
     }
 
+    if (net_cards_conf[card->card_num].capture)
+        card->capture = net_capture_open(card->card_num, net_cards_conf[card->card_num].capture_limit);
+
     timer_add(&card->timer, network_rx_queue, card, 0);
     timer_on_auto(&card->timer, 100);
+    network_cards[card->card_num] = card;
 
     return card;
 }
@@ -541,8 +606,10 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
 void
 netcard_close(netcard_t *card)
 {
+    network_cards[card->card_num] = NULL;
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
+    net_capture_close(card->capture);
 
     thread_close_mutex(card->tx_mutex);
     thread_close_mutex(card->rx_mutex);
@@ -599,7 +666,15 @@ network_reset(void)
 void
 network_tx(netcard_t *card, uint8_t *bufp, int len)
 {
-    network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len);
+    /* A card sending a burst of frames from its ring fills the queue before
+       the timer runs, hand the batch over now rather than drop the rest. */
+    if (network_queue_full(&card->queues[NET_QUEUE_TX_VM]))
+        network_tx_move(card);
+
+    if (network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len) && card->capture)
+        net_capture_packet(card->capture, bufp, len, NET_CAPTURE_OUT);
+
+    timer_kick(&card->timer, card->byte_period * len);
 }
 
 int
@@ -639,9 +714,13 @@ network_rx_put(netcard_t *card, uint8_t *bufp, int len)
     int ret = 0;
 
     thread_wait_mutex(card->rx_mutex);
+    bool was_empty = network_queue_empty(&card->queues[NET_QUEUE_RX]);
     ret = network_queue_put(&card->queues[NET_QUEUE_RX], bufp, len);
     thread_release_mutex(card->rx_mutex);
 
+    if (ret && was_empty)
+        network_rx_signal(card);
+
     return ret;
 }
 
@@ -688,12 +767,103 @@ network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
     int ret = 0;
 
     thread_wait_mutex(card->rx_mutex);
+    bool was_empty = network_queue_empty(&card->queues[NET_QUEUE_RX]);
     ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
     thread_release_mutex(card->rx_mutex);
 
+    if (ret && was_empty)
+        network_rx_signal(card);
+
     return ret;
 }
 
+/* Like network_rx_put_pkt() for a whole batch, under one lock. Returns how
+   many packets were taken, the rest did not fit and can be retried. */
+int
+network_rx_putv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
+{
+    netqueue_t *queue     = &card->queues[NET_QUEUE_RX];
+    int         pkt_count = 0;
+
+    thread_wait_mutex(card->rx_mutex);
+    bool was_empty = network_queue_empty(queue);
+    for (int i = 0; i < vec_size; i++) {
+        if (network_queue_full(queue))
+            break;
+        /* Bad packets are taken, and dropped. */
+        network_queue_put_swap(queue, pkt_vec);
+        pkt_count++;
+        pkt_vec++;
+    }
+    bool queued = !network_queue_empty(queue);
+    thread_release_mutex(card->rx_mutex);
+
+    if (was_empty && queued)
+        network_rx_signal(card);
+
+    return pkt_count;
+}
+
+void
+network_desc_begin(netdesc_win_t *win)
+{
+    win->active = 1;
+    win->len    = 0;
+}
+
+void
+network_desc_end(netdesc_win_t *win)
+{
+    win->active = 0;
+    win->len    = 0;
+}
+
+/*
+ * Read a descriptor, or part of one. A miss refills the window starting at
+ * addr, stopping at the end of the ring (if known, 0 otherwise) and at the
+ * page boundary, so that nothing past the ring is touched.
+ */
+void
+network_desc_read(netdesc_win_t *win, uint32_t addr, void *buf, uint32_t len, uint32_t end, int transfer_size)
+{
+    uint32_t size;
+
+    if (win->active && (addr >= win->addr) && ((addr - win->addr + len) <= win->len)) {
+        memcpy(buf, &win->data[addr - win->addr], len);
+        return;
+    }
+
+    size = 0x1000 - (addr & 0xfff);
+    if (size > NET_DESC_WIN_SIZE)
+        size = NET_DESC_WIN_SIZE;
+    if ((end > addr) && (size > (end - addr)))
+        size = end - addr;
+
+    if (!win->active || (len > size)) {
+        dma_bm_read(addr, (uint8_t *) buf, len, transfer_size);
+        return;
+    }
+
+    dma_bm_read(addr, win->data, size, transfer_size);
+    win->addr = addr;
+    win->len  = size;
+    memcpy(buf, win->data, len);
+}
+
+/* Write a descriptor back, keeping the window coherent with guest memory. */
+void
+network_desc_write(netdesc_win_t *win, uint32_t addr, const void *buf, uint32_t len, int transfer_size)
+{
+    dma_bm_write(addr, (const uint8_t *) buf, len, transfer_size);
+
+    if (win->active && win->len && (addr < (win->addr + win->len)) && ((addr + len) > win->addr)) {
+        uint32_t start = (addr > win->addr) ? addr : win->addr;
+        uint32_t stop  = ((addr + len) < (win->addr + win->len)) ? (addr + len) : (win->addr + win->len);
+
+        memcpy(&win->data[start - win->addr], (const uint8_t *) buf + (start - addr), stop - start);
+    }
+}
+
 void
 network_connect(int id, int connect)
 {
@@ -705,6 +875,10 @@ network_connect(int id, int connect)
     } else {
         net_cards_conf[id].link_state |= NET_LINK_DOWN;
     }
+
+    /* Let an idle card pick up the new link state. */
+    atomic_fetch_or(&network_rx_wake, 1 << id);
+    timer_wake();
 }
 
 int
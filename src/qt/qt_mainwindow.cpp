@@ -63,6 +63,10 @@ extern int qt_nvr_save(void);
 #    include <minitrace/minitrace.h>
 #endif
 
+#ifdef USE_DYNAREC_PROFILE
+extern void codegen_prof_request_dump(void);
+#endif
+
 extern bool cpu_thread_running;
 };
 
@@ -672,6 +676,13 @@ MainWindow::MainWindow(QWidget *parent)
     }
 #endif
 
+#ifdef USE_DYNAREC_PROFILE
+    ui->actionDump_recompiler_profile->setVisible(true);
+    connect(ui->actionDump_recompiler_profile, &QAction::triggered, this, [] {
+        codegen_prof_request_dump();
+    });
+#endif
+
     setContextMenuPolicy(Qt::PreventContextMenu);
     /* Remove default Shift+F10 handler, which unfocuses keyboard input even with no context menu. */
     connect(new QShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F10), this), &QShortcut::activated, this, [](){});
@@ -573,7 +573,11 @@ MediaMenu::cdromMount(int i, int dir, const QString &arg)
     else {
         filename = QFileDialog::getOpenFileName(parentWidget, QString(),
                                                 QString(),
+#ifdef USE_CHD
+            tr("CD-ROM images") % util::DlgFilter({ "iso", "cue", "chd" }) % tr("All files") % util::DlgFilter({ "*" }, true));
+#else
             tr("CD-ROM images") % util::DlgFilter({ "iso", "cue" }) % tr("All files") % util::DlgFilter({ "*" }, true));
+#endif
     }
 
     if (filename.isEmpty())
@@ -1081,6 +1085,9 @@ MediaMenu::nicUpdateMenu(int i)
         case NET_TYPE_VDE:
             netType = "VDE";
             break;
+        case NET_TYPE_SWITCH:
+            netType = tr("Switch");
+            break;
     }
 
     QString devName = DeviceConfig::DeviceName(network_card_getdevice(net_cards_conf[i].device_num), network_card_get_internal_name(net_cards_conf[i].device_num), 1);
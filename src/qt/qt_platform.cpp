@@ -60,7 +60,10 @@
 
 #ifdef Q_OS_UNIX
 #    include <pthread.h>
+#    include <fcntl.h>
+#    include <unistd.h>
 #    include <sys/mman.h>
+#    include <sys/stat.h>
 #endif
 
 #ifdef Q_OS_OPENBSD
@@ -366,6 +369,37 @@ plat_remove(char *path)
     QFile(path).remove();
 }
 
+/* Replaces to in one go if it exists, so that it is never missing. */
+int
+plat_rename(const char *from, const char *to)
+{
+#if defined Q_OS_WINDOWS
+    return MoveFileExW((LPCWSTR) QString::fromUtf8(from).utf16(), (LPCWSTR) QString::fromUtf8(to).utf16(),
+                       MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+/* Returns 0 if there is nothing at path, 1 otherwise. */
+int
+plat_stat(const char *path, uint64_t *size, int64_t *mtime, int *is_dir)
+{
+    QFileInfo fi(QString::fromUtf8(path));
+
+    if (!fi.exists())
+        return 0;
+
+    if (size != nullptr)
+        *size = (uint64_t) fi.size();
+    if (mtime != nullptr)
+        *mtime = (int64_t) fi.lastModified().toSecsSinceEpoch();
+    if (is_dir != nullptr)
+        *is_dir = fi.isDir() ? 1 : 0;
+
+    return 1;
+}
+
 void *
 plat_mmap(size_t size, uint8_t executable)
 {
@@ -395,6 +429,229 @@ plat_munmap(void *ptr, size_t size)
 #endif
 }
 
+#if defined Q_OS_WINDOWS
+/* Large pages can only be allocated with the "Lock pages in memory" privilege
+   enabled in the process token. Having been granted it is not enough. */
+static bool
+plat_enable_lock_memory()
+{
+    static int       enabled = -1;
+    HANDLE           token;
+    TOKEN_PRIVILEGES tp;
+
+    if (enabled != -1)
+        return enabled;
+
+    enabled = 0;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    tp.PrivilegeCount           = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    if (LookupPrivilegeValueW(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) &&
+        (GetLastError() == ERROR_SUCCESS))
+        enabled = 1;
+
+    CloseHandle(token);
+
+    return enabled;
+}
+#endif
+
+/* Map guest RAM as a single anonymous block. On entry, *huge_pages holds the
+   requested MEM_HUGE_PAGES_* mode; on return it holds the mode actually in use.
+   The size must be a multiple of MEM_HUGE_PAGE_SIZE if huge pages are requested. */
+void *
+plat_mmap_ram(size_t size, int *huge_pages)
+{
+#if defined Q_OS_WINDOWS
+    void *ret;
+
+    /* Large pages need the "Lock pages in memory" privilege and are never
+       paged out, so there is no transparent variant on Windows. */
+    if (*huge_pages != MEM_HUGE_PAGES_NONE) {
+        SIZE_T large = GetLargePageMinimum();
+
+        if ((large != 0) && !(size & (large - 1)) && plat_enable_lock_memory()) {
+            ret = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (ret != NULL) {
+                *huge_pages = MEM_HUGE_PAGES_EXPLICIT;
+                return ret;
+            }
+        }
+    }
+
+    *huge_pages = MEM_HUGE_PAGES_NONE;
+    return VirtualAlloc(NULL, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+    void *ret;
+
+#    if defined(__linux__) && defined(MAP_HUGETLB)
+    if (*huge_pages == MEM_HUGE_PAGES_EXPLICIT) {
+        ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+        if (ret != MAP_FAILED)
+            return ret;
+
+        /* No (or not enough) pages in the hugetlbfs pool, try transparent ones. */
+        *huge_pages = MEM_HUGE_PAGES_TRANSPARENT;
+    }
+#    endif
+
+#    if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (*huge_pages == MEM_HUGE_PAGES_TRANSPARENT) {
+        /* Over-allocate so the block can be aligned to a huge page boundary,
+           otherwise the kernel can not back the first and last 2 MB with huge pages. */
+        auto *p = (uint8_t *) mmap(0, size + MEM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+
+        if (p != MAP_FAILED) {
+            uintptr_t head = (MEM_HUGE_PAGE_SIZE - ((uintptr_t) p & (MEM_HUGE_PAGE_SIZE - 1))) & (MEM_HUGE_PAGE_SIZE - 1);
+
+            if (head)
+                munmap(p, head);
+            munmap(p + head + size, MEM_HUGE_PAGE_SIZE - head);
+            ret = p + head;
+            if (madvise(ret, size, MADV_HUGEPAGE) != 0)
+                *huge_pages = MEM_HUGE_PAGES_NONE;
+            return ret;
+        }
+    }
+#    endif
+
+    *huge_pages = MEM_HUGE_PAGES_NONE;
+
+    ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    return (ret == MAP_FAILED) ? nullptr : ret;
+#endif
+}
+
+/* Map a whole file read-only. Returns NULL if the file is empty or can not be mapped. */
+void *
+plat_mmap_file(const char *path, uint64_t *size)
+{
+    void *ret = nullptr;
+
+    *size = 0;
+
+#if defined Q_OS_WINDOWS
+    HANDLE file = CreateFileW((LPCWSTR) QString::fromUtf8(path).utf16(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER len;
+    if (GetFileSizeEx(file, &len) && (len.QuadPart > 0) &&
+        ((uint64_t) len.QuadPart <= (uint64_t) SIZE_MAX)) {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            ret = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (ret != nullptr)
+                *size = len.QuadPart;
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+#else
+    struct stat st;
+    int         fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return nullptr;
+
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0) &&
+        ((uint64_t) st.st_size <= (uint64_t) SIZE_MAX)) {
+        ret = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ret == MAP_FAILED)
+            ret = nullptr;
+        else
+            *size = st.st_size;
+    }
+
+    close(fd);
+#endif
+
+    return ret;
+}
+
+void
+plat_munmap_file(void *ptr, uint64_t size)
+{
+#if defined Q_OS_WINDOWS
+    UnmapViewOfFile(ptr);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+/* Granularity the offset of a view has to be a multiple of. */
+static uint64_t
+plat_file_view_granularity()
+{
+#if defined Q_OS_WINDOWS
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return si.dwAllocationGranularity;
+#else
+    return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/* Map part of a file copy-on-write, writes to it are not seen by the file or
+   by other mappings of it. The offset does not have to be page aligned. */
+void *
+plat_mmap_file_view(const char *path, uint64_t offset, size_t size)
+{
+    uint64_t delta = offset % plat_file_view_granularity();
+    uint8_t *ret   = nullptr;
+
+    offset -= delta;
+
+#if defined Q_OS_WINDOWS
+    HANDLE file = CreateFileW((LPCWSTR) QString::fromUtf8(path).utf16(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping != NULL) {
+        ret = (uint8_t *) MapViewOfFile(mapping, FILE_MAP_COPY, (DWORD) (offset >> 32),
+                                        (DWORD) offset, size + delta);
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return nullptr;
+
+    ret = (uint8_t *) mmap(0, size + delta, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+    if (ret == MAP_FAILED)
+        ret = nullptr;
+
+    close(fd);
+#endif
+
+    return (ret == nullptr) ? nullptr : (ret + delta);
+}
+
+void
+plat_munmap_file_view(void *ptr, uint64_t offset, size_t size)
+{
+    uint64_t delta = offset % plat_file_view_granularity();
+
+#if defined Q_OS_WINDOWS
+    UnmapViewOfFile((uint8_t *) ptr - delta);
+#else
+    munmap((uint8_t *) ptr - delta, size + delta);
+#endif
+}
+
 extern bool cpu_thread_running;
 void
 plat_pause(int p)
@@ -70,6 +70,7 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
             // Then only enable as needed based on network type
             switch (net_type_cbox->currentData().toInt()) {
                 case NET_TYPE_VDE:
+                case NET_TYPE_SWITCH:
                     //                option_list_label->setText("VDE Options");
                     option_list_label->setVisible(true);
                     option_list_line->setVisible(true);
@@ -126,7 +127,7 @@ SettingsNetwork::save()
         memset(net_cards_conf[i].host_dev_name, '\0', sizeof(net_cards_conf[i].host_dev_name));
         if (net_cards_conf[i].net_type == NET_TYPE_PCAP) {
             strncpy(net_cards_conf[i].host_dev_name, network_devs[cbox->currentData().toInt()].device, sizeof(net_cards_conf[i].host_dev_name) - 1);
-        } else if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_SWITCH)) {
             strncpy(net_cards_conf[i].host_dev_name, socket_line->text().toUtf8().constData(), sizeof(net_cards_conf[i].host_dev_name));
         }
     }
@@ -194,6 +195,9 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
 
         if (network_devmap.has_vde)
             Models::AddEntry(model, "VDE", NET_TYPE_VDE);
+
+        if (network_devmap.has_switch)
+            Models::AddEntry(model, tr("Switch"), NET_TYPE_SWITCH);
         
         model->removeRows(0, removeRows);
         cbox->setCurrentIndex(cbox->findData(net_cards_conf[i].net_type));
@@ -215,7 +219,7 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
             cbox->setCurrentIndex(selectedRow);
         }  
 
-        if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_SWITCH)) {
             QString currentVdeSocket = net_cards_conf[i].host_dev_name;
             auto editline = findChild<QLineEdit *>(QString("socketVDENIC%1").arg(i+1));
             editline->setText(currentVdeSocket);
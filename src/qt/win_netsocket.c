@@ -19,6 +19,16 @@
 #include <ws2tcpip.h>
 #include <winerror.h>
 
+/* Most sockets a poll set can watch. */
+#define NET_SOCKET_POLL_MAX 256
+
+struct plat_netsocket_poll_t {
+    SOCKET        wake;  /* Loopback UDP socket connected to itself. */
+    int           count;
+    WSAPOLLFD     fds[NET_SOCKET_POLL_MAX + 1]; /* The first one is the wake-up socket. */
+    void         *priv[NET_SOCKET_POLL_MAX + 1];
+};
+
 SOCKET
 plat_netsocket_create(int type)
 {
@@ -201,3 +211,156 @@ plat_netsocket_receive(SOCKET socket, unsigned char *data, unsigned int size, in
     }
     return res;
 }
+
+static short
+plat_netsocket_poll_flags(int events)
+{
+    short flags = 0;
+
+    if (events & NET_SOCKET_EV_IN)
+        flags |= POLLRDNORM;
+    if (events & NET_SOCKET_EV_OUT)
+        flags |= POLLWRNORM;
+
+    return flags;
+}
+
+static int
+plat_netsocket_poll_find(plat_netsocket_poll_t *set, SOCKET socket)
+{
+    for (int i = 1; i < set->count; i++) {
+        if (set->fds[i].fd == socket)
+            return i;
+    }
+
+    return -1;
+}
+
+plat_netsocket_poll_t *
+plat_netsocket_poll_create(void)
+{
+    plat_netsocket_poll_t *set = (plat_netsocket_poll_t *) calloc(1, sizeof(plat_netsocket_poll_t));
+    struct sockaddr_in     sock_addr;
+    int                    len = sizeof(struct sockaddr_in);
+    u_long                 yes = 1;
+
+    /* WSAPoll() only takes sockets, so a wake-up is a datagram to ourselves. */
+    set->wake = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (set->wake == INVALID_SOCKET) {
+        free(set);
+        return NULL;
+    }
+
+    memset(&sock_addr, 0, sizeof(struct sockaddr_in));
+    sock_addr.sin_family      = AF_INET;
+    sock_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sock_addr.sin_port        = 0;
+
+    if ((bind(set->wake, (struct sockaddr *) &sock_addr, len) == SOCKET_ERROR) ||
+        (getsockname(set->wake, (struct sockaddr *) &sock_addr, &len) == SOCKET_ERROR) ||
+        (connect(set->wake, (struct sockaddr *) &sock_addr, len) == SOCKET_ERROR)) {
+        closesocket(set->wake);
+        free(set);
+        return NULL;
+    }
+
+    ioctlsocket(set->wake, FIONBIO, &yes);
+
+    set->fds[0].fd     = set->wake;
+    set->fds[0].events = POLLRDNORM;
+    set->count         = 1;
+
+    return set;
+}
+
+void
+plat_netsocket_poll_destroy(plat_netsocket_poll_t *set)
+{
+    if (set == NULL)
+        return;
+
+    closesocket(set->wake);
+    free(set);
+}
+
+int
+plat_netsocket_poll_add(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    if (set->count > NET_SOCKET_POLL_MAX)
+        return -1;
+
+    set->fds[set->count].fd      = socket;
+    set->fds[set->count].events  = plat_netsocket_poll_flags(events);
+    set->fds[set->count].revents = 0;
+    set->priv[set->count]        = priv;
+    set->count++;
+
+    return 0;
+}
+
+int
+plat_netsocket_poll_modify(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    int i = plat_netsocket_poll_find(set, socket);
+
+    if (i == -1)
+        return -1;
+
+    set->fds[i].events = plat_netsocket_poll_flags(events);
+    set->priv[i]       = priv;
+
+    return 0;
+}
+
+void
+plat_netsocket_poll_remove(plat_netsocket_poll_t *set, SOCKET socket)
+{
+    int i = plat_netsocket_poll_find(set, socket);
+
+    if (i == -1)
+        return;
+
+    set->count--;
+    set->fds[i]  = set->fds[set->count];
+    set->priv[i] = set->priv[set->count];
+}
+
+int
+plat_netsocket_poll_wait(plat_netsocket_poll_t *set, net_socket_event_t *events, int max, int timeout_ms)
+{
+    char buf[64];
+    int  num;
+    int  ret = 0;
+
+    num = WSAPoll(set->fds, set->count, timeout_ms);
+    if (num == SOCKET_ERROR)
+        return -1;
+
+    if (set->fds[0].revents) {
+        while (recv(set->wake, buf, sizeof(buf), 0) > 0)
+            ;
+    }
+
+    for (int i = 1; (i < set->count) && (ret < max); i++) {
+        if (!set->fds[i].revents)
+            continue;
+
+        events[ret].priv   = set->priv[i];
+        events[ret].events = 0;
+        if (set->fds[i].revents & POLLRDNORM)
+            events[ret].events |= NET_SOCKET_EV_IN;
+        if (set->fds[i].revents & POLLWRNORM)
+            events[ret].events |= NET_SOCKET_EV_OUT;
+        if (set->fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+            events[ret].events |= NET_SOCKET_EV_ERR;
+        ret++;
+    }
+
+    return ret;
+}
+
+void
+plat_netsocket_poll_wake(plat_netsocket_poll_t *set)
+{
+    send(set->wake, "", 1, 0);
+}
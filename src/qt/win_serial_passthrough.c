@@ -142,16 +142,17 @@ plat_serpt_write(void *priv, uint8_t data)
     }
 }
 
-uint8_t
-plat_serpt_read_vcon(serial_passthrough_t *dev, uint8_t *data)
+int
+plat_serpt_read_vcon(serial_passthrough_t *dev, uint8_t *data, int len)
 {
     DWORD bytesRead = 0;
-    ReadFile((HANDLE) dev->master_fd, data, 1, &bytesRead, NULL);
-    return !!bytesRead;
+    ReadFile((HANDLE) dev->master_fd, data, len, &bytesRead, NULL);
+    return (int) bytesRead;
 }
 
+/* Reads up to len bytes without blocking, returns how many were read. */
 int
-plat_serpt_read(void *priv, uint8_t *data)
+plat_serpt_read(void *priv, uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
     int                   res = 0;
@@ -159,7 +160,7 @@ plat_serpt_read(void *priv, uint8_t *data)
     switch (dev->mode) {
         case SERPT_MODE_VCON:
         case SERPT_MODE_HOSTSER:
-            res = plat_serpt_read_vcon(dev, data);
+            res = plat_serpt_read_vcon(dev, data, len);
             break;
         default:
             break;
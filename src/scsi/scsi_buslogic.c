@@ -583,6 +583,11 @@ BuslogicSCSIBIOSDMATransfer(x54x_t *dev, ESCMD *ESCSICmd, uint8_t TargetID, int
             buslogic_log("BusLogic BIOS DMA: Reading %i bytes from %08X\n", TransferLength, Address);
             dma_bm_read(Address, sd->sc->temp_buffer, TransferLength, transfer_size);
         } else if (!dir && ((ESCSICmd->DataDirection == CCB_DATA_XFER_IN) || (ESCSICmd->DataDirection == 0x00))) {
+            /* A failed read ends the command with an error in phase 1, there is nothing to transfer. */
+            if (scsi_device_async_wait(sd) < 0) {
+                buslogic_log("BusLogic BIOS DMA: Background read failed\n");
+                return;
+            }
             buslogic_log("BusLogic BIOS DMA: Writing %i bytes at %08X\n", TransferLength, Address);
             dma_bm_write(Address, sd->sc->temp_buffer, TransferLength, transfer_size);
         }
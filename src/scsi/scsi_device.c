@@ -30,8 +30,28 @@
 #include <86box/hdc_ide.h>
 #include <86box/scsi.h>
 #include <86box/scsi_device.h>
+#include <86box/thread.h>
 #include <86box/plat_unused.h>
 
+/* The read of the current command, carried out by the target's I/O thread. */
+typedef struct scsi_async_t {
+    uint8_t          pending; /* handed over and not carried out yet */
+    int              result;
+    uint32_t         lba;
+    uint32_t         count;
+    uint8_t         *buffer;
+    scsi_device_io_t io;
+    void            *priv;
+
+    volatile int     quit;
+    mutex_t         *mutex;
+    event_t         *wake;
+    event_t         *done;
+    thread_t        *thread;
+} scsi_async_t;
+
+static scsi_async_t *scsi_async_reads[SCSI_BUS_MAX][SCSI_ID_MAX];
+
 scsi_device_t scsi_devices[SCSI_BUS_MAX][SCSI_ID_MAX];
 int scsi_command_length[8] = { 6, 10, 10, 6, 16, 12, 10, 6 };
 uint8_t scsi_null_device_sense[18] = { 0x70, 0, SENSE_ILLEGAL_REQUEST, 0, 0, 0, 0, 0, 0, 0, 0, 0, ASC_INV_LUN, 0, 0, 0, 0, 0 };
@@ -199,6 +219,170 @@ scsi_device_close_all(void)
     }
 }
 
+/*
+ * Background reads.
+ *
+ * The medium access of a READ command is carried out by a thread per
+ * target, so the host I/O overlaps with the emulated seek and transfer
+ * time the controller waits out before the data in phase, and with the
+ * I/O of the other targets. The controllers wait for it before they
+ * touch the target's buffer, and the target waits for it again before
+ * it completes the command in phase 1, so a failed read ends the command
+ * that issued it with CHECK CONDITION.
+ *
+ * Writes are done on the emulation thread: the status of a write is only
+ * returned once the data is on the medium. Only one command per target
+ * is ever in flight, as no controller supports disconnection, so there
+ * is no command queuing, reordering or queue depth here, and INQUIRY
+ * does not report CmdQue.
+ */
+static scsi_async_t *
+scsi_device_async_get(scsi_device_t *dev)
+{
+    const int bus = (int) ((dev - &scsi_devices[0][0]) / SCSI_ID_MAX);
+    const int id  = (int) ((dev - &scsi_devices[0][0]) % SCSI_ID_MAX);
+
+    return scsi_async_reads[bus][id];
+}
+
+static void
+scsi_device_async_thread(void *priv)
+{
+    scsi_async_t *rd = (scsi_async_t *) priv;
+    int           ret;
+
+    while (!rd->quit) {
+        thread_wait_event(rd->wake, -1);
+        thread_reset_event(rd->wake);
+
+        thread_wait_mutex(rd->mutex);
+        if (rd->quit || !rd->pending) {
+            thread_release_mutex(rd->mutex);
+            continue;
+        }
+        thread_release_mutex(rd->mutex);
+
+        /* The request is not touched by anyone else while it is pending. */
+        ret = rd->io(rd->priv, rd->lba, rd->count, rd->buffer);
+
+        thread_wait_mutex(rd->mutex);
+        rd->result  = ret;
+        rd->pending = 0;
+        thread_release_mutex(rd->mutex);
+
+        thread_set_event(rd->done);
+    }
+}
+
+static scsi_async_t *
+scsi_device_async_create(scsi_device_t *dev)
+{
+    const int     bus   = (int) ((dev - &scsi_devices[0][0]) / SCSI_ID_MAX);
+    const int     id    = (int) ((dev - &scsi_devices[0][0]) % SCSI_ID_MAX);
+    scsi_async_t *rd = scsi_async_reads[bus][id];
+
+    if (rd == NULL) {
+        rd = (scsi_async_t *) calloc(1, sizeof(scsi_async_t));
+        if (rd == NULL)
+            return NULL;
+
+        rd->mutex  = thread_create_mutex();
+        rd->wake   = thread_create_event();
+        rd->done   = thread_create_event();
+        rd->thread = thread_create(scsi_device_async_thread, rd);
+        if (rd->thread == NULL) {
+            thread_destroy_event(rd->done);
+            thread_destroy_event(rd->wake);
+            thread_close_mutex(rd->mutex);
+            free(rd);
+            return NULL;
+        }
+
+        scsi_async_reads[bus][id] = rd;
+    }
+
+    return rd;
+}
+
+/* Starts the read of the current command into the device's buffer, which
+   must not be touched until scsi_device_async_wait() has returned. Returns
+   0 if the read could not be started, and the caller has to do it itself. */
+int
+scsi_device_async_read(scsi_device_t *dev, scsi_device_io_t io, void *priv,
+                       uint32_t lba, uint32_t count, uint8_t *buffer)
+{
+    scsi_async_t *rd = scsi_device_async_create(dev);
+
+    if (rd == NULL)
+        return 0;
+
+    /* Nothing can be pending here, but make sure of it. */
+    (void) scsi_device_async_wait(dev);
+
+    thread_wait_mutex(rd->mutex);
+    rd->pending = 1;
+    rd->result  = 0;
+    rd->lba     = lba;
+    rd->count   = count;
+    rd->buffer  = buffer;
+    rd->io      = io;
+    rd->priv    = priv;
+    thread_release_mutex(rd->mutex);
+
+    thread_set_event(rd->wake);
+
+    return 1;
+}
+
+/* Waits for the background read, returns -1 if it has failed. */
+int
+scsi_device_async_wait(scsi_device_t *dev)
+{
+    scsi_async_t *rd = scsi_device_async_get(dev);
+    int           ret;
+
+    if (rd == NULL)
+        return 0;
+
+    thread_wait_mutex(rd->mutex);
+    while (rd->pending) {
+        /* The thread clears pending under the mutex before it sets the
+           event, so the event can not be missed here. */
+        thread_reset_event(rd->done);
+        thread_release_mutex(rd->mutex);
+        thread_wait_event(rd->done, -1);
+        thread_wait_mutex(rd->mutex);
+    }
+    ret = (rd->result < 0) ? -1 : 0;
+    thread_release_mutex(rd->mutex);
+
+    return ret;
+}
+
+void
+scsi_device_async_close(scsi_device_t *dev)
+{
+    const int     bus   = (int) ((dev - &scsi_devices[0][0]) / SCSI_ID_MAX);
+    const int     id    = (int) ((dev - &scsi_devices[0][0]) % SCSI_ID_MAX);
+    scsi_async_t *rd = scsi_async_reads[bus][id];
+
+    if (rd == NULL)
+        return;
+
+    (void) scsi_device_async_wait(dev);
+
+    rd->quit = 1;
+    thread_set_event(rd->wake);
+    thread_wait(rd->thread);
+
+    thread_destroy_event(rd->done);
+    thread_destroy_event(rd->wake);
+    thread_close_mutex(rd->mutex);
+    free(rd);
+
+    scsi_async_reads[bus][id] = NULL;
+}
+
 void
 scsi_device_init(void)
 {
@@ -269,6 +453,9 @@ scsi_bus_read(scsi_bus_t *scsi_bus)
                 case SCSI_PHASE_DATA_IN:
                     scsi_device_log("DataIn.\n");
                     scsi_bus->state = STATE_DATAIN;
+                    /* A failed read leaves zeroes in the buffer, the error is in the status. */
+                    if (scsi_device_async_wait(dev) < 0)
+                        scsi_device_log("Background read failed\n");
                     if ((dev->sc != NULL) && (dev->sc->temp_buffer != NULL))
                         scsi_bus->data = dev->sc->temp_buffer[scsi_bus->data_pos++];
 
@@ -68,6 +68,7 @@ const uint8_t scsi_disk_command_flags[0x100] = {
     [0x2a ... 0x2b] = IMPLEMENTED | CHECK_READY,
     [0x2e]          = IMPLEMENTED | CHECK_READY,
     [0x2f]          = IMPLEMENTED | CHECK_READY | SCSI_ONLY,
+    [0x35]          = IMPLEMENTED | CHECK_READY,
     [0x41]          = IMPLEMENTED | CHECK_READY,
     [0x55]          = IMPLEMENTED,
     [0x5a]          = IMPLEMENTED,
@@ -627,9 +628,38 @@ scsi_disk_buf_alloc(scsi_disk_t *dev, uint32_t len)
         dev->temp_buffer = (uint8_t *) malloc(len);
 }
 
+static scsi_device_t *
+scsi_disk_get_device(const scsi_disk_t *dev)
+{
+    const uint8_t scsi_bus = (dev->drv->scsi_id >> 4) & 0x0f;
+    const uint8_t scsi_id  = dev->drv->scsi_id & 0x0f;
+
+    return &scsi_devices[scsi_bus][scsi_id];
+}
+
+static int
+scsi_disk_async_io(void *priv, uint32_t lba, uint32_t count, uint8_t *buffer)
+{
+    const scsi_disk_t *dev = (scsi_disk_t *) priv;
+    int                ret = hdd_image_read(dev->id, lba, count, buffer);
+
+    /* Do not hand whatever was read before the error over to the initiator. */
+    if (ret < 0)
+        memset(buffer, 0x00, count << 9);
+
+    return ret;
+}
+
 static void
 scsi_disk_buf_free(scsi_disk_t *dev)
 {
+    /* The command is being dropped, just make sure the read is done with the buffer. */
+    if (dev->async_read) {
+        if (scsi_device_async_wait(scsi_disk_get_device(dev)) < 0)
+            scsi_disk_log(dev->log, "Background read of a dropped command failed\n");
+        dev->async_read = 0;
+    }
+
     if (dev->temp_buffer) {
         scsi_disk_log(dev->log, "Freeing buffer...\n");
         free(dev->temp_buffer);
@@ -776,21 +806,34 @@ scsi_disk_blocks(scsi_disk_t *dev, int32_t *len, UNUSED(int first_batch), const
 
     *len = dev->requested_blocks << 9;
 
-    for (int i = 0; i < dev->requested_blocks; i++) {
-        if (out) {
-            if (hdd_image_write(dev->id, dev->sector_pos, 1, dev->temp_buffer +
-                                (i << 9)) < 0) {
-                scsi_disk_write_error(dev);
-                return -1;
-            }
-        } else {
-            if (hdd_image_read(dev->id, dev->sector_pos, 1, dev->temp_buffer +
-                               (i << 9)) < 0) {
-                scsi_disk_read_error(dev);
-                return -1;
+    /*
+       SCSI disks hand reads that fit on the medium over to the target's
+       I/O thread, they complete while the controller waits out the transfer
+       time. Their result is checked when the command is stopped.
+     */
+    if (!out && (dev->drv->bus_type == HDD_BUS_SCSI) &&
+        ((dev->sector_pos + dev->requested_blocks) <= medium_size) &&
+        scsi_device_async_read(scsi_disk_get_device(dev), scsi_disk_async_io, dev,
+                               dev->sector_pos, dev->requested_blocks, dev->temp_buffer)) {
+        dev->async_read = 1;
+        dev->sector_pos += dev->requested_blocks;
+    } else {
+        for (int i = 0; i < dev->requested_blocks; i++) {
+            if (out) {
+                if (hdd_image_write(dev->id, dev->sector_pos, 1, dev->temp_buffer +
+                                    (i << 9)) < 0) {
+                    scsi_disk_write_error(dev);
+                    return -1;
+                }
+            } else {
+                if (hdd_image_read(dev->id, dev->sector_pos, 1, dev->temp_buffer +
+                                   (i << 9)) < 0) {
+                    scsi_disk_read_error(dev);
+                    return -1;
+                }
             }
+            dev->sector_pos++;
         }
-        dev->sector_pos++;
     }
 
     scsi_disk_log(dev->log, "%s %i bytes of blocks...\n", out ? "Written" : "Read", *len);
@@ -1447,6 +1490,15 @@ atapi_out:
             scsi_disk_command_complete(dev);
             break;
 
+        case GPCMD_SYNCHRONIZE_CACHE:
+            if (hdd_image_flush(dev->id) < 0)
+                scsi_disk_write_error(dev);
+            else {
+                scsi_disk_set_phase(dev, SCSI_PHASE_STATUS);
+                scsi_disk_command_complete(dev);
+            }
+            break;
+
         case GPCMD_SEEK_6:
         case GPCMD_SEEK_10:
             switch (cdb[0]) {
@@ -1505,6 +1557,18 @@ scsi_disk_command_stop(scsi_common_t *sc)
 {
     scsi_disk_t *dev = (scsi_disk_t *) sc;
 
+    /* A background read only reports its result once it has been carried out. */
+    if (dev->async_read) {
+        dev->async_read = 0;
+        if (scsi_device_async_wait(scsi_disk_get_device(dev)) < 0) {
+            /* Report the start of the transfer that failed. */
+            dev->sector_pos -= dev->requested_blocks;
+            scsi_disk_read_error(dev);
+            scsi_disk_buf_free(dev);
+            return;
+        }
+    }
+
     scsi_disk_command_complete(dev);
     scsi_disk_buf_free(dev);
 }
@@ -1545,8 +1609,15 @@ scsi_disk_phase_data_out(scsi_common_t *sc)
         case GPCMD_WRITE_AND_VERIFY_10:
         case GPCMD_WRITE_12:
         case GPCMD_WRITE_AND_VERIFY_12:
-            if (dev->requested_blocks > 0)
-                scsi_disk_blocks(dev, &len, 1, 1);
+            if ((dev->requested_blocks > 0) && (scsi_disk_blocks(dev, &len, 1, 1) > 0)) {
+                /* Forced unit access and write and verify go to the medium before completing. */
+                if (((dev->current_cdb[0] == GPCMD_WRITE_AND_VERIFY_10) ||
+                     (dev->current_cdb[0] == GPCMD_WRITE_AND_VERIFY_12) ||
+                     (((dev->current_cdb[0] == GPCMD_WRITE_10) ||
+                       (dev->current_cdb[0] == GPCMD_WRITE_12)) && (dev->current_cdb[1] & 0x08))) &&
+                    (hdd_image_flush(dev->id) < 0))
+                    scsi_disk_write_error(dev);
+            }
             break;
         case GPCMD_WRITE_SAME_10:
             if (!dev->current_cdb[7] && !dev->current_cdb[8])
@@ -1752,6 +1823,9 @@ scsi_disk_hard_reset(void)
             if (scsi_id >= SCSI_ID_MAX)
                 continue;
 
+            /* Make sure no read is still running on the previous image. */
+            scsi_device_async_close(&scsi_devices[scsi_bus][scsi_id]);
+
             /* Make sure to ignore any SCSI disk whose image file name is empty. */
             if (strlen(hdd[c].fn) == 0)
                 continue;
@@ -1866,6 +1940,7 @@ scsi_disk_close(void)
                 const uint8_t scsi_bus = (hdd[c].scsi_id >> 4) & 0x0f;
                 const uint8_t scsi_id  = hdd[c].scsi_id & 0x0f;
 
+                scsi_device_async_close(&scsi_devices[scsi_bus][scsi_id]);
                 memset(&scsi_devices[scsi_bus][scsi_id], 0x00, sizeof(scsi_device_t));
             }
 
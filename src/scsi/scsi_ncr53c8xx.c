@@ -681,6 +681,9 @@ ncr53c8xx_do_dma(ncr53c8xx_t *dev, int out, uint8_t id)
         if (!dev->buffer_pos)
             ncr53c8xx_log("(ID=%02i LUN=%02i) SCSI Command 0x%02x: SCSI Command Phase 1 on PHASE_DI\n", id, dev->current_lun, dev->last_command);
 #endif
+        /* A failed read leaves zeroes in the buffer, the error is reported in phase 1. */
+        if (scsi_device_async_wait(sd) < 0)
+            ncr53c8xx_log("(ID=%02i LUN=%02i) SCSI Command 0x%02x: Background read failed\n", id, dev->current_lun, dev->last_command);
         ncr53c8xx_write(dev, addr, sd->sc->temp_buffer + dev->buffer_pos, count);
     }
 
@@ -832,6 +832,10 @@ esp_do_dma(esp_t *dev)
             if (len > dev->xfer_counter)
                 len = dev->xfer_counter;
 
+            /* A failed read leaves zeroes in the buffer, the error is reported in phase 1. */
+            if (scsi_device_async_wait(sd) < 0)
+                esp_log("ESP background read failed\n");
+
             switch (dev->rregs[ESP_CMD]) {
                 case (CMD_TI | CMD_DMA):
                     if (dev->mca) {
@@ -1115,6 +1119,8 @@ esp_do_nodma(esp_t *dev)
                 return;
             }
             if (fifo8_is_empty(&dev->fifo)) {
+                if (scsi_device_async_wait(sd) < 0)
+                    esp_log("ESP background read failed\n");
                 esp_fifo_push(dev, sd->sc->temp_buffer[dev->buffer_pos]);
                 dev->buffer_pos++;
                 dev->ti_size--;
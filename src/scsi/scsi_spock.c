@@ -976,7 +976,10 @@ spock_process_scsi(spock_t *scsi, scb_t *scb)
                 else
                     scsi->media_period += p;
 
-                if (scb->enable & ENABLE_PT) {
+                /* A failed read ends the command with an error in phase 1, there is nothing to transfer. */
+                if ((sd->phase == SCSI_PHASE_DATA_IN) && (scsi_device_async_wait(sd) < 0))
+                    spock_log("SCSI ID %i: Background read failed\n", scsi->cdb_id);
+                else if (scb->enable & ENABLE_PT) {
                     int32_t  buflen = sd->buffer_length;
                     int      sg_pos = 0;
                     uint32_t DataTx = 0;
@@ -267,7 +267,10 @@ x54x_bios_scsi_command(scsi_device_t *dev, uint8_t *cdb, uint8_t *buf, int len,
         }
 
         if (dev->phase == SCSI_PHASE_DATA_IN) {
-            if (buf)
+            /* A failed read ends the command with an error in phase 1, there is nothing to transfer. */
+            if (scsi_device_async_wait(dev) < 0)
+                x54x_log("BIOS SCSI command: background read failed\n");
+            else if (buf)
                 memcpy(buf, dev->sc->temp_buffer, dev->buffer_length);
             else
                 dma_bm_write(addr, dev->sc->temp_buffer, dev->buffer_length, transfer_size);
@@ -792,6 +795,12 @@ x54x_buf_dma_transfer(x54x_t *dev, Req_t *req, int Is24bit, int TransferLength,
              dir ? "write" : "read", BufLen, DataLength, DataPointer);
 
     if ((req->CmdBlock.common.ControlByte != 0x03) && TransferLength && BufLen) {
+        /* A failed read ends the command with an error in phase 1, there is nothing to transfer. */
+        if (write_to_host && (scsi_device_async_wait(&scsi_devices[dev->bus][req->TargetID]) < 0)) {
+            x54x_log("Background read failed\n");
+            return;
+        }
+
         if ((req->CmdBlock.common.Opcode == SCATTER_GATHER_COMMAND) || (req->CmdBlock.common.Opcode == SCATTER_GATHER_COMMAND_RES)) {
 
             /* If the control byte is 0x00, it means that the transfer direction is set up by the SCSI command without
@@ -258,21 +258,33 @@ mt32_sysex(uint8_t *data, unsigned int len)
         mt32_check("mt32emu_play_sysex", mt32emu_play_sysex(context, data, len), MT32EMU_RC_OK);
 }
 
+/* ROMs in a ROM pack are handed over as they are mapped, without a copy. */
+static int
+mt32_add_rom(char *name, mt32emu_return_code expected)
+{
+    const uint8_t *data;
+    uint32_t       size;
+    char           fn[512];
+
+    if ((data = rom_getdata(name, &size)) != NULL)
+        return mt32_check("mt32emu_add_rom_data", mt32emu_add_rom_data(context, data, size, NULL), expected);
+
+    if (!rom_getfile(name, fn, 512))
+        return 0;
+
+    return mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), expected);
+}
+
 void *
 mt32emu_init(char *control_rom, char *pcm_rom)
 {
     midi_device_t *dev;
-    char           fn[512];
 
     context = mt32emu_create_context(strstr(control_rom, "MT32_CONTROL.ROM") ? handler_mt32 : handler_cm32l, NULL);
 
-    if (!rom_getfile(control_rom, fn, 512))
-        return 0;
-    if (!mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), MT32EMU_RC_ADDED_CONTROL_ROM))
-        return 0;
-    if (!rom_getfile(pcm_rom, fn, 512))
+    if (!mt32_add_rom(control_rom, MT32EMU_RC_ADDED_CONTROL_ROM))
         return 0;
-    if (!mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), MT32EMU_RC_ADDED_PCM_ROM))
+    if (!mt32_add_rom(pcm_rom, MT32EMU_RC_ADDED_PCM_ROM))
         return 0;
 
     if (!mt32_check("mt32emu_open_synth", mt32emu_open_synth(context), MT32EMU_RC_OK))
@@ -1,5 +1,8 @@
+#include <inttypes.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
@@ -17,8 +20,52 @@ pc_timer_t *timer_head = NULL;
 /* Are we initialized? */
 int timer_inited = 0;
 
+/* Deferred wakeup requested by a host thread, run from timer_process(). */
+#define TIMER_WAKE_MAX 4
+
+static atomic_int timer_wake_pending;
+static void     (*timer_wake_handlers[TIMER_WAKE_MAX])(void);
+static int        timer_num_wake_handlers;
+
+/* Fire counts per callback and owning device. Slot 0 collects timers that
+   were not set up through timer_add(), or that did not fit in the table. */
+#define TIMER_STATS_MAX 512
+
+typedef struct timer_stat_t {
+    void      (*callback)(void *priv);
+    const char *owner;
+    uint64_t    fires;
+    uint64_t    idles;
+    uint64_t    kicks;
+} timer_stat_t;
+
+static timer_stat_t timer_stats[TIMER_STATS_MAX];
+static const char  *timer_owner;
+
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+static int
+timer_stat_slot(void (*callback)(void *priv))
+{
+    uint32_t hash = (uint32_t) (((uintptr_t) callback) >> 4) ^ (uint32_t) (((uintptr_t) timer_owner) >> 4);
+    int      slot;
+
+    for (int i = 0; i < (TIMER_STATS_MAX - 1); i++) {
+        slot = 1 + ((hash + i) % (TIMER_STATS_MAX - 1));
+
+        if (timer_stats[slot].callback == NULL) {
+            timer_stats[slot].callback = callback;
+            timer_stats[slot].owner    = timer_owner;
+            return slot;
+        }
+
+        if ((timer_stats[slot].callback == callback) && (timer_stats[slot].owner == timer_owner))
+            return slot;
+    }
+
+    return 0;
+}
+
 void
 timer_enable(pc_timer_t *timer)
 {
@@ -28,6 +75,8 @@ timer_enable(pc_timer_t *timer)
     if (!timer_inited || (timer == NULL))
         return;
 
+    timer->flags &= ~TIMER_IDLE;
+
     if (timer->flags & TIMER_ENABLED)
         timer_disable(timer);
 
@@ -90,7 +139,13 @@ timer_enable(pc_timer_t *timer)
 void
 timer_disable(pc_timer_t *timer)
 {
-    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
+    if (!timer_inited || (timer == NULL))
+        return;
+
+    /* A parked timer that gets stopped must not be restarted by a kick. */
+    timer->flags &= ~TIMER_IDLE;
+
+    if (!(timer->flags & TIMER_ENABLED))
         return;
 
     if (!timer->next && !timer->prev && timer != timer_head)
@@ -114,6 +169,12 @@ timer_process(void)
 {
     pc_timer_t *timer;
 
+    if (atomic_load_explicit(&timer_wake_pending, memory_order_relaxed) &&
+        atomic_exchange(&timer_wake_pending, 0)) {
+        for (int i = 0; i < timer_num_wake_handlers; i++)
+            timer_wake_handlers[i]();
+    }
+
     if (!timer_head)
         return;
 
@@ -137,6 +198,7 @@ timer_process(void)
             /* Make sure it's not NULL, so that we can
                have a NULL callback when no operation
                is needed. */
+            timer_stats[timer->stat].fires++;
             timer->in_callback = 1;
             timer->callback(timer->priv);
             timer->in_callback = 0;
@@ -172,6 +234,8 @@ timer_init(void)
     timer_target = 0ULL;
     tsc          = 0;
 
+    memset(timer_stats, 0x00, sizeof(timer_stats));
+
     /* Initialise the CPU-independent timer */
     rivatimer_init();
 
@@ -187,11 +251,120 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->in_callback = 0;
     timer->priv        = priv;
     timer->flags       = 0;
+    timer->stat        = timer_stat_slot(callback);
     timer->prev        = timer->next = NULL;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
 
+/* Handlers stay registered, adding one twice is a no-op. */
+void
+timer_add_wake(void (*handler)(void))
+{
+    for (int i = 0; i < timer_num_wake_handlers; i++) {
+        if (timer_wake_handlers[i] == handler)
+            return;
+    }
+
+    if (timer_num_wake_handlers < TIMER_WAKE_MAX)
+        timer_wake_handlers[timer_num_wake_handlers++] = handler;
+    else
+        fatal("timer_add_wake(): too many wake handlers\n");
+}
+
+/* May be called from any thread. */
+void
+timer_wake(void)
+{
+    atomic_store(&timer_wake_pending, 1);
+}
+
+const char *
+timer_set_owner(const char *owner)
+{
+    const char *prev = timer_owner;
+
+    timer_owner = owner;
+
+    return prev;
+}
+
+static int
+timer_stats_compare(const void *a, const void *b)
+{
+    const timer_stat_t *sa = &timer_stats[*(const int *) a];
+    const timer_stat_t *sb = &timer_stats[*(const int *) b];
+
+    if (sa->fires != sb->fires)
+        return (sa->fires < sb->fires) ? 1 : -1;
+
+    return 0;
+}
+
+void
+timer_stats_log(void)
+{
+    int      order[TIMER_STATS_MAX];
+    int      count = 0;
+    uint64_t total = 0;
+
+    if (!log_stats)
+        return;
+
+    for (int i = 0; i < TIMER_STATS_MAX; i++) {
+        if (timer_stats[i].fires || timer_stats[i].kicks) {
+            order[count++] = i;
+            total += timer_stats[i].fires;
+        }
+    }
+
+    if (!total)
+        return;
+
+    qsort(order, count, sizeof(int), timer_stats_compare);
+
+    pclog("Timers: %" PRIu64 " callbacks fired, busiest first:\n", total);
+    for (int i = 0; (i < count) && (i < 16); i++) {
+        const timer_stat_t *st = &timer_stats[order[i]];
+
+        pclog("Timers: %12" PRIu64 " (%5.1f%%) %-32s %p, %" PRIu64 " parked, %" PRIu64 " woken\n",
+              st->fires, (100.0 * st->fires) / total, st->owner ? st->owner : "(no device)",
+              (void *) (uintptr_t) st->callback, st->idles, st->kicks);
+    }
+}
+
+/* Park the timer until the next timer_kick(). */
+void
+timer_idle(pc_timer_t *timer)
+{
+    if (!timer_inited || (timer == NULL))
+        return;
+
+    timer_stop(timer);
+    timer->flags |= TIMER_IDLE;
+    timer_stats[timer->stat].idles++;
+}
+
+void
+timer_kick(pc_timer_t *timer, double period)
+{
+    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_IDLE))
+        return;
+
+    timer_stats[timer->stat].kicks++;
+    timer_on_auto(timer, period);
+}
+
+void
+timer_kick_u64(pc_timer_t *timer, uint64_t delay)
+{
+    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_IDLE))
+        return;
+
+    timer_stats[timer->stat].kicks++;
+    timer_set_delay_u64(timer, delay);
+}
+
 /* The API for big timer periods starts here. */
 void
 timer_stop(pc_timer_t *timer)
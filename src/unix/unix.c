@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <dlfcn.h>
@@ -424,6 +425,109 @@ plat_munmap(void *ptr, size_t size)
     munmap(ptr, size);
 }
 
+/* Map guest RAM as a single anonymous block. On entry, *huge_pages holds the
+   requested MEM_HUGE_PAGES_* mode; on return it holds the mode actually in use.
+   The size must be a multiple of MEM_HUGE_PAGE_SIZE if huge pages are requested. */
+void *
+plat_mmap_ram(size_t size, int *huge_pages)
+{
+    void *ret;
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (*huge_pages == MEM_HUGE_PAGES_EXPLICIT) {
+        ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+        if (ret != MAP_FAILED)
+            return ret;
+
+        /* No (or not enough) pages in the hugetlbfs pool, try transparent ones. */
+        *huge_pages = MEM_HUGE_PAGES_TRANSPARENT;
+    }
+#endif
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (*huge_pages == MEM_HUGE_PAGES_TRANSPARENT) {
+        /* Over-allocate so the block can be aligned to a huge page boundary,
+           otherwise the kernel can not back the first and last 2 MB with huge pages. */
+        uint8_t  *p = mmap(0, size + MEM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+        uintptr_t head;
+
+        if (p != MAP_FAILED) {
+            head = (MEM_HUGE_PAGE_SIZE - ((uintptr_t) p & (MEM_HUGE_PAGE_SIZE - 1))) & (MEM_HUGE_PAGE_SIZE - 1);
+            if (head)
+                munmap(p, head);
+            munmap(p + head + size, MEM_HUGE_PAGE_SIZE - head);
+            ret = p + head;
+            if (madvise(ret, size, MADV_HUGEPAGE) != 0)
+                *huge_pages = MEM_HUGE_PAGES_NONE;
+            return ret;
+        }
+    }
+#endif
+
+    *huge_pages = MEM_HUGE_PAGES_NONE;
+
+    ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    return (ret == MAP_FAILED) ? NULL : ret;
+}
+
+/* Map a whole file read-only. Returns NULL if the file is empty or can not be mapped. */
+void *
+plat_mmap_file(const char *path, uint64_t *size)
+{
+    struct stat st;
+    void       *ret = NULL;
+    int         fd  = open(path, O_RDONLY);
+
+    *size = 0;
+    if (fd < 0)
+        return NULL;
+
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0) &&
+        ((uint64_t) st.st_size <= (uint64_t) SIZE_MAX)) {
+        ret = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ret == MAP_FAILED)
+            ret = NULL;
+        else
+            *size = st.st_size;
+    }
+
+    close(fd);
+
+    return ret;
+}
+
+void
+plat_munmap_file(void *ptr, uint64_t size)
+{
+    munmap(ptr, size);
+}
+
+/* Map part of a file copy-on-write, writes to it are not seen by the file or
+   by other mappings of it. The offset does not have to be page aligned. */
+void *
+plat_mmap_file_view(const char *path, uint64_t offset, size_t size)
+{
+    uint64_t delta = offset % (uint64_t) sysconf(_SC_PAGESIZE);
+    uint8_t *ret;
+    int      fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    ret = mmap(0, size + delta, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset - delta);
+    close(fd);
+
+    return (ret == MAP_FAILED) ? NULL : (ret + delta);
+}
+
+void
+plat_munmap_file_view(void *ptr, uint64_t offset, size_t size)
+{
+    uint64_t delta = offset % (uint64_t) sysconf(_SC_PAGESIZE);
+
+    munmap((uint8_t *) ptr - delta, size + delta);
+}
+
 uint64_t
 plat_timer_read(void)
 {
@@ -459,6 +563,31 @@ plat_remove(char *path)
     remove(path);
 }
 
+/* Replaces to in one go if it exists, so that it is never missing. */
+int
+plat_rename(const char *from, const char *to)
+{
+    return rename(from, to);
+}
+
+int
+plat_stat(const char *path, uint64_t *size, int64_t *mtime, int *is_dir)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0)
+        return 0;
+
+    if (size != NULL)
+        *size = (uint64_t) st.st_size;
+    if (mtime != NULL)
+        *mtime = (int64_t) st.st_mtime;
+    if (is_dir != NULL)
+        *is_dir = S_ISDIR(st.st_mode);
+
+    return 1;
+}
+
 void
 ui_sb_update_icon_state(UNUSED(int tag), UNUSED(int state))
 {
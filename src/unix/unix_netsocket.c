@@ -24,6 +24,27 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <unistd.h>
+#ifdef __linux__
+#    include <sys/epoll.h>
+#    include <sys/eventfd.h>
+#else
+#    include <poll.h>
+#endif
+
+/* Most sockets a poll set can watch without epoll. */
+#define NET_SOCKET_POLL_MAX 256
+
+struct plat_netsocket_poll_t {
+#ifdef __linux__
+    int epfd;
+    int wakefd;
+#else
+    int           pipefd[2];
+    int           count;
+    struct pollfd fds[NET_SOCKET_POLL_MAX + 1]; /* The first one is the wake-up pipe. */
+    void         *priv[NET_SOCKET_POLL_MAX + 1];
+#endif
+};
 
 SOCKET
 plat_netsocket_create(int type)
@@ -94,6 +115,9 @@ plat_netsocket_accept(SOCKET socket)
     if (clientsocket == -1)
         return -1;
 
+    /* Unlike on Windows, the listener's O_NONBLOCK is not inherited. */
+    fcntl(clientsocket, F_SETFL, fcntl(clientsocket, F_GETFL, 0) | O_NONBLOCK);
+
     return clientsocket;
 }
 
@@ -201,3 +225,263 @@ plat_netsocket_receive(SOCKET socket, unsigned char *data, unsigned int size, in
     }
     return res;
 }
+
+#ifdef __linux__
+static uint32_t
+plat_netsocket_poll_flags(int events)
+{
+    uint32_t flags = 0;
+
+    if (events & NET_SOCKET_EV_IN)
+        flags |= EPOLLIN | EPOLLRDHUP;
+    if (events & NET_SOCKET_EV_OUT)
+        flags |= EPOLLOUT;
+
+    return flags;
+}
+
+plat_netsocket_poll_t *
+plat_netsocket_poll_create(void)
+{
+    plat_netsocket_poll_t *set = (plat_netsocket_poll_t *) calloc(1, sizeof(plat_netsocket_poll_t));
+    struct epoll_event     ev   = { 0 };
+
+    set->epfd   = epoll_create1(EPOLL_CLOEXEC);
+    set->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((set->epfd == -1) || (set->wakefd == -1)) {
+        plat_netsocket_poll_destroy(set);
+        return NULL;
+    }
+
+    /* The wake-up eventfd is told apart by pointing at the set itself. */
+    ev.events   = EPOLLIN;
+    ev.data.ptr = set;
+    epoll_ctl(set->epfd, EPOLL_CTL_ADD, set->wakefd, &ev);
+
+    return set;
+}
+
+void
+plat_netsocket_poll_destroy(plat_netsocket_poll_t *set)
+{
+    if (set == NULL)
+        return;
+
+    if (set->wakefd != -1)
+        close(set->wakefd);
+    if (set->epfd != -1)
+        close(set->epfd);
+    free(set);
+}
+
+int
+plat_netsocket_poll_add(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    struct epoll_event ev = { 0 };
+
+    ev.events   = plat_netsocket_poll_flags(events);
+    ev.data.ptr = priv;
+
+    return epoll_ctl(set->epfd, EPOLL_CTL_ADD, socket, &ev);
+}
+
+int
+plat_netsocket_poll_modify(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    struct epoll_event ev = { 0 };
+
+    ev.events   = plat_netsocket_poll_flags(events);
+    ev.data.ptr = priv;
+
+    return epoll_ctl(set->epfd, EPOLL_CTL_MOD, socket, &ev);
+}
+
+void
+plat_netsocket_poll_remove(plat_netsocket_poll_t *set, SOCKET socket)
+{
+    struct epoll_event ev = { 0 };
+
+    epoll_ctl(set->epfd, EPOLL_CTL_DEL, socket, &ev);
+}
+
+int
+plat_netsocket_poll_wait(plat_netsocket_poll_t *set, net_socket_event_t *events, int max, int timeout_ms)
+{
+    struct epoll_event evs[64];
+    uint64_t           val;
+    int                num;
+    int                ret = 0;
+
+    num = epoll_wait(set->epfd, evs, (max < 64) ? max : 64, timeout_ms);
+    if (num == -1)
+        return (errno == EINTR) ? 0 : -1;
+
+    for (int i = 0; i < num; i++) {
+        if (evs[i].data.ptr == set) {
+            while (read(set->wakefd, &val, sizeof(val)) > 0)
+                ;
+            continue;
+        }
+
+        events[ret].priv   = evs[i].data.ptr;
+        events[ret].events = 0;
+        /* A peer that went away shows up as readable, recv() then returns 0. */
+        if (evs[i].events & (EPOLLIN | EPOLLRDHUP))
+            events[ret].events |= NET_SOCKET_EV_IN;
+        if (evs[i].events & EPOLLOUT)
+            events[ret].events |= NET_SOCKET_EV_OUT;
+        if (evs[i].events & (EPOLLERR | EPOLLHUP))
+            events[ret].events |= NET_SOCKET_EV_ERR;
+        ret++;
+    }
+
+    return ret;
+}
+
+void
+plat_netsocket_poll_wake(plat_netsocket_poll_t *set)
+{
+    uint64_t val = 1;
+
+    if (write(set->wakefd, &val, sizeof(val)) == -1)
+        return;
+}
+#else
+static short
+plat_netsocket_poll_flags(int events)
+{
+    short flags = 0;
+
+    if (events & NET_SOCKET_EV_IN)
+        flags |= POLLIN;
+    if (events & NET_SOCKET_EV_OUT)
+        flags |= POLLOUT;
+
+    return flags;
+}
+
+static int
+plat_netsocket_poll_find(plat_netsocket_poll_t *set, SOCKET socket)
+{
+    for (int i = 1; i < set->count; i++) {
+        if (set->fds[i].fd == socket)
+            return i;
+    }
+
+    return -1;
+}
+
+plat_netsocket_poll_t *
+plat_netsocket_poll_create(void)
+{
+    plat_netsocket_poll_t *set = (plat_netsocket_poll_t *) calloc(1, sizeof(plat_netsocket_poll_t));
+
+    if (pipe(set->pipefd) == -1) {
+        free(set);
+        return NULL;
+    }
+
+    fcntl(set->pipefd[0], F_SETFL, fcntl(set->pipefd[0], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(set->pipefd[1], F_SETFL, fcntl(set->pipefd[1], F_GETFL, 0) | O_NONBLOCK);
+
+    set->fds[0].fd     = set->pipefd[0];
+    set->fds[0].events = POLLIN;
+    set->count         = 1;
+
+    return set;
+}
+
+void
+plat_netsocket_poll_destroy(plat_netsocket_poll_t *set)
+{
+    if (set == NULL)
+        return;
+
+    close(set->pipefd[0]);
+    close(set->pipefd[1]);
+    free(set);
+}
+
+int
+plat_netsocket_poll_add(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    if (set->count > NET_SOCKET_POLL_MAX)
+        return -1;
+
+    set->fds[set->count].fd      = socket;
+    set->fds[set->count].events  = plat_netsocket_poll_flags(events);
+    set->fds[set->count].revents = 0;
+    set->priv[set->count]        = priv;
+    set->count++;
+
+    return 0;
+}
+
+int
+plat_netsocket_poll_modify(plat_netsocket_poll_t *set, SOCKET socket, int events, void *priv)
+{
+    int i = plat_netsocket_poll_find(set, socket);
+
+    if (i == -1)
+        return -1;
+
+    set->fds[i].events = plat_netsocket_poll_flags(events);
+    set->priv[i]       = priv;
+
+    return 0;
+}
+
+void
+plat_netsocket_poll_remove(plat_netsocket_poll_t *set, SOCKET socket)
+{
+    int i = plat_netsocket_poll_find(set, socket);
+
+    if (i == -1)
+        return;
+
+    set->count--;
+    set->fds[i]  = set->fds[set->count];
+    set->priv[i] = set->priv[set->count];
+}
+
+int
+plat_netsocket_poll_wait(plat_netsocket_poll_t *set, net_socket_event_t *events, int max, int timeout_ms)
+{
+    uint8_t buf[64];
+    int     num;
+    int     ret = 0;
+
+    num = poll(set->fds, set->count, timeout_ms);
+    if (num == -1)
+        return (errno == EINTR) ? 0 : -1;
+
+    if (set->fds[0].revents) {
+        while (read(set->pipefd[0], buf, sizeof(buf)) > 0)
+            ;
+    }
+
+    for (int i = 1; (i < set->count) && (ret < max); i++) {
+        if (!set->fds[i].revents)
+            continue;
+
+        events[ret].priv   = set->priv[i];
+        events[ret].events = 0;
+        if (set->fds[i].revents & POLLIN)
+            events[ret].events |= NET_SOCKET_EV_IN;
+        if (set->fds[i].revents & POLLOUT)
+            events[ret].events |= NET_SOCKET_EV_OUT;
+        if (set->fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+            events[ret].events |= NET_SOCKET_EV_ERR;
+        ret++;
+    }
+
+    return ret;
+}
+
+void
+plat_netsocket_poll_wake(plat_netsocket_poll_t *set)
+{
+    if (write(set->pipefd[1], "", 1) == -1)
+        return;
+}
+#endif
@@ -48,11 +48,12 @@
 
 #define LOG_PREFIX "serial_passthrough: "
 
+/* Reads up to len bytes without blocking, returns how many were read. */
 int
-plat_serpt_read(void *priv, uint8_t *data)
+plat_serpt_read(void *priv, uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
-    int                   res;
+    ssize_t               res;
     struct timeval        tv;
     fd_set                rdfds;
 
@@ -69,8 +70,9 @@ plat_serpt_read(void *priv, uint8_t *data)
                 return 0;
             }
 
-            if (read(dev->master_fd, data, 1) > 0) {
-                return 1;
+            res = read(dev->master_fd, data, len);
+            if (res > 0) {
+                return (int) res;
             }
             break;
         default:
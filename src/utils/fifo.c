@@ -55,7 +55,7 @@ fifo_get_count(void *priv)
     if (fifo->end == fifo->start)
         ret = fifo->full ? fifo->len : 0;
     else
-        ret = abs(fifo->end - fifo->start);
+        ret = (fifo->end - fifo->start + fifo->len) % fifo->len;
 
     return ret;
 }